@@ -30,6 +30,7 @@ int AtomCreate(Atom* pThis)
   pThis->isInHBond = FALSE;
   pThis->isBBAtom = FALSE;
   pThis->bfactor = 1000.0;
+  pThis->hbDorBIndex = -1;
 
   return Success;
 }
@@ -526,6 +527,35 @@ int AtomArrayAppend(AtomArray* pThis, Atom* pNewAtom)
 }
 
 
+// look up the donor-base/acceptor-base atom of each H-bond atom once, so that energy loops do not search by name
+int AtomArrayResolveHbDorB(AtomArray* pThis)
+{
+  for (int i = 0; i < pThis->atomNum; i++)
+  {
+    Atom* pAtom = &pThis->atoms[i];
+    int index = -1;
+    if ((pAtom->isHBatomH || pAtom->isHBatomA) && FAILED(AtomArrayFind(pThis, pAtom->hbDorB, &index)))
+    {
+      index = -1;
+    }
+    pAtom->hbDorBIndex = index;
+  }
+  return Success;
+}
+
+
+Atom* AtomArrayGetHbDorB(AtomArray* pThis, Atom* pAtom)
+{
+  // the cached index stays valid as long as the atom order is unchanged; fall back to the name search otherwise
+  int index = pAtom->hbDorBIndex;
+  if (index >= 0 && index < pThis->atomNum && strcmp(pThis->atoms[index].name, pAtom->hbDorB) == 0)
+  {
+    return pThis->atoms + index;
+  }
+  return AtomArrayGetByName(pThis, pAtom->hbDorB);
+}
+
+
 double AtomArrayCalcTotalCharge(AtomArray* pThis)
 {
   double totalCharge = 0.0;
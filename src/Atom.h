@@ -62,6 +62,7 @@ typedef struct _Atom
   char hbHorA[MAX_LEN_ATOM_DONOR + 1];
   char hbDorB[MAX_LEN_ATOM_ACCEPTOR + 1];
   char hbB2[MAX_LEN_ATOM_ACCEPTOR + 1];
+  int  hbDorBIndex; // index of the hbDorB atom in the owning atom array, -1 if not resolved
   char chainName[MAX_LEN_CHAIN_NAME + 1];
   int  posInChain;
   Type_AtomPolarity polarity;
@@ -113,6 +114,8 @@ int AtomArrayInsert(AtomArray* pThis, int index, Atom* pNewAtom);
 int AtomArrayRemove(AtomArray* pThis, int index);
 int AtomArrayRemoveByName(AtomArray* pThis, char* atomName);
 int AtomArrayAppend(AtomArray* pThis, Atom* pNewAtom);
+int AtomArrayResolveHbDorB(AtomArray* pThis);
+Atom* AtomArrayGetHbDorB(AtomArray* pThis, Atom* pAtom);
 double AtomArrayCalcTotalCharge(AtomArray* pThis);
 double AtomArrayCalcMinDistance(AtomArray* pThis, AtomArray* pOther);
 BOOL AtomArrayAllAtomXYZAreValid(AtomArray* pThis);
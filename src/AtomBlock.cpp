@@ -0,0 +1,206 @@
+/*******************************************************************************************************************************
+Copyright (c) Xiaoqiang Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************************/
+
+#include "AtomBlock.h"
+#include "EnergyFunction.h"
+#include <math.h>
+
+// the kernel is compiled for AVX-512, AVX2 and the baseline ISA; the loader picks the best one for the host cpu
+#if defined(__GNUC__) && !defined(__clang__) && (defined(__x86_64__) || defined(__i386__))
+#define ATOM_BLOCK_KERNEL_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define ATOM_BLOCK_KERNEL_CLONES
+#endif
+
+
+// converts the atom parameters the same way for both sides of the kernel
+static void AtomBlockPackAtom(Atom* pAtom, double* repRadius, double* charge, double* lamda, double* isHeavy, double* isPolar)
+{
+  BOOL hydrogen = AtomIsHydrogen(pAtom);
+  BOOL polar = (pAtom->polarity == Type_AtomPolarity_P || pAtom->polarity == Type_AtomPolarity_C) ? TRUE : FALSE;
+  *repRadius = (hydrogen && polar) ? 0.2 * pAtom->vdw_radius : RADIUS_SCALE_FOR_VDW * pAtom->vdw_radius;
+  *charge = fabs(pAtom->charge) < 1e-2 ? 0.0 : pAtom->charge;
+  // hydrogens never enter desolvation; keep a safe divisor for the masked lanes
+  *lamda = hydrogen ? 1.0 : pAtom->EEF1_lamda_;
+  *isHeavy = hydrogen ? 0.0 : 1.0;
+  *isPolar = polar ? 1.0 : 0.0;
+}
+
+
+int AtomBlockFill(AtomBlock* pThis, AtomArray* pAtoms, Type_AtomBlockFilter filter)
+{
+  pThis->atomNum = 0;
+  for (int i = 0; i < AtomArrayGetCount(pAtoms); i++)
+  {
+    Atom* pAtom = AtomArrayGet(pAtoms, i);
+    if (pAtom->isXyzValid == FALSE) continue;
+    if (filter == Type_AtomBlockFilter_SideChain && pAtom->isBBAtom == TRUE) continue;
+    if (filter == Type_AtomBlockFilter_BackBone && pAtom->isBBAtom == FALSE) continue;
+    if (pThis->atomNum == ATOM_BLOCK_CAPACITY)
+    {
+      return ValueError;
+    }
+    int n = pThis->atomNum;
+    pThis->x[n] = pAtom->xyz.X;
+    pThis->y[n] = pAtom->xyz.Y;
+    pThis->z[n] = pAtom->xyz.Z;
+    pThis->vdwRadius[n] = pAtom->vdw_radius;
+    pThis->vdwEpsilon[n] = pAtom->vdw_epsilon;
+    pThis->eef1Volume[n] = pAtom->EEF1_volume;
+    pThis->eef1FreeDG[n] = pAtom->EEF1_freeDG;
+    AtomBlockPackAtom(pAtom, &pThis->repRadius[n], &pThis->charge[n], &pThis->eef1Lamda[n], &pThis->isHeavy[n], &pThis->isPolar[n]);
+    pThis->atoms[n] = pAtom;
+    pThis->atomNum++;
+  }
+
+  XYZ sum;
+  sum.X = 0.0; sum.Y = 0.0; sum.Z = 0.0;
+  for (int i = 0; i < pThis->atomNum; i++)
+  {
+    sum.X += pThis->x[i];
+    sum.Y += pThis->y[i];
+    sum.Z += pThis->z[i];
+  }
+  pThis->center = sum;
+  pThis->radius = 0.0;
+  if (pThis->atomNum > 0)
+  {
+    pThis->center.X /= pThis->atomNum;
+    pThis->center.Y /= pThis->atomNum;
+    pThis->center.Z /= pThis->atomNum;
+  }
+  for (int i = 0; i < pThis->atomNum; i++)
+  {
+    double dx = pThis->x[i] - pThis->center.X;
+    double dy = pThis->y[i] - pThis->center.Y;
+    double dz = pThis->z[i] - pThis->center.Z;
+    double dist2 = dx * dx + dy * dy + dz * dz;
+    if (dist2 > pThis->radius) pThis->radius = dist2;
+  }
+  pThis->radius = sqrt(pThis->radius);
+  return Success;
+}
+
+
+// evaluates vdw attraction/repulsion, electrostatics and LK desolvation of one atom against every atom of a block
+// for 1-5 (and beyond) interactions; mirrors VdwAttEnergyAtomAndAtom, VdwRepEnergyAtomAndAtom, ElecEnergyAtomAndAtom
+// and LKDesolvationEnergyAtomAndAtom term by term, with all branches turned into per-lane selects
+ATOM_BLOCK_KERNEL_CLONES
+static void AtomBlockKernel(const AtomBlock* pBlock, double x1, double y1, double z1, double radius1, double epsilon1,
+  double repRadius1, double charge1, double volume1, double lamda1, double freeDG1, double isHeavy1, double sums[6])
+{
+  const double RATIO_CUTOFF = 0.70;
+  const double B6_0 = 1.0 / (RATIO_CUTOFF * RATIO_CUTOFF * RATIO_CUTOFF * RATIO_CUTOFF * RATIO_CUTOFF * RATIO_CUTOFF);
+  const double coefficient = -0.089793561062582974;
+  double att = 0.0, rep = 0.0, ele = 0.0, desolv12 = 0.0, desolv21P = 0.0, desolv21H = 0.0;
+  const int n = pBlock->atomNum;
+
+#pragma omp simd reduction(+:att,rep,ele,desolv12,desolv21P,desolv21H)
+  for (int j = 0; j < n; j++)
+  {
+    double dx = pBlock->x[j] - x1;
+    double dy = pBlock->y[j] - y1;
+    double dz = pBlock->z[j] - z1;
+    double distance = sqrt(dx * dx + dy * dy + dz * dz);
+    bool inRange = distance <= ENERGY_DISTANCE_CUTOFF;
+    double epsilon = sqrt(epsilon1 * pBlock->vdwEpsilon[j]);
+
+    // vdw attraction
+    double rsum = RADIUS_SCALE_FOR_VDW * (radius1 + pBlock->vdwRadius[j]);
+    double ratio = distance / rsum;
+    double inv = rsum / distance;
+    double inv2 = inv * inv;
+    double B6 = inv2 * inv2 * inv2;
+    double energyLJ = epsilon * (B6 * B6 - 2.0 * B6);
+    double c = rsum / 5.0;
+    double c2 = c * c;
+    double B6c = c2 * c2 * c2;
+    double M = epsilon * (B6c * B6c - 2.0 * B6c);
+    double N = 2.4 * epsilon * (B6c - B6c * B6c);
+    double energyTail = (2 * M + N) * distance * distance * distance + (-33 * M - 17 * N) * distance * distance
+      + (180 * M + 96 * N) * distance + (-324 * M - 180 * N);
+    double energyAtt = distance <= 5.0 ? energyLJ : energyTail;
+    energyAtt = (ratio < 0.8909 || distance >= ENERGY_DISTANCE_CUTOFF) ? 0.0 : energyAtt;
+    att += inRange ? energyAtt * ENERGY_SCALE_FACTOR_BOND_15 : 0.0;
+
+    // vdw repulsion
+    double rsumRep = repRadius1 + pBlock->repRadius[j];
+    double ratioRep = distance / rsumRep;
+    double invRep = rsumRep / distance;
+    double invRep2 = invRep * invRep;
+    double B6Rep = invRep2 * invRep2 * invRep2;
+    double energyRepLJ = epsilon * (B6Rep * B6Rep - 2.0 * B6Rep);
+    double a = epsilon * (B6_0 * B6_0 - 2.0 * B6_0);
+    double b = epsilon * 12.0 * (B6_0 / RATIO_CUTOFF - B6_0 * B6_0 / RATIO_CUTOFF);
+    double energyRepLinear = b * epsilon * (ratioRep - RATIO_CUTOFF) + a * epsilon;
+    double energyRep = ratioRep >= RATIO_CUTOFF ? energyRepLJ : energyRepLinear;
+    energyRep = ratioRep > 0.8909 ? 0.0 : energyRep;
+    rep += inRange ? energyRep * ENERGY_SCALE_FACTOR_BOND_15 : 0.0;
+
+    // electrostatics; uncharged atoms were stored with a zero charge
+    double distMin = 0.8 * (radius1 + pBlock->vdwRadius[j]);
+    double distElec = distance < distMin ? distMin : distance;
+    double energyElec = COULOMB_CONSTANT * charge1 * pBlock->charge[j] / distElec / distElec / 40.0;
+    ele += (inRange && distance <= ELEC_DISTANCE_CUTOFF) ? energyElec * ENERGY_SCALE_FACTOR_BOND_15 : 0.0;
+
+    // LK desolvation
+    double r1 = radius1 * RADIUS_SCALE_FOR_DESOLV;
+    double r2 = pBlock->vdwRadius[j] * RADIUS_SCALE_FOR_DESOLV;
+    double r12 = r1 + r2;
+    double distDesolv = distance < r12 ? r12 : distance;
+    double lamda2 = pBlock->eef1Lamda[j];
+    double xx1 = (distDesolv - r1) / lamda1;
+    double xx2 = (distDesolv - r2) / lamda2;
+    double d12 = coefficient * pBlock->eef1Volume[j] * freeDG1 / (lamda1 * distDesolv * distDesolv) * exp(-1.0 * xx1 * xx1);
+    double d21 = coefficient * volume1 * pBlock->eef1FreeDG[j] / (lamda2 * distDesolv * distDesolv) * exp(-1.0 * xx2 * xx2);
+    bool bothHeavy = inRange && isHeavy1 > 0.5 && pBlock->isHeavy[j] > 0.5;
+    desolv12 += bothHeavy ? d12 : 0.0;
+    desolv21P += (bothHeavy && pBlock->isPolar[j] > 0.5) ? d21 : 0.0;
+    desolv21H += (bothHeavy && pBlock->isPolar[j] < 0.5) ? d21 : 0.0;
+  }
+
+  sums[0] = att;
+  sums[1] = rep;
+  sums[2] = ele;
+  sums[3] = desolv12;
+  sums[4] = desolv21P;
+  sums[5] = desolv21H;
+}
+
+
+// adds the vdw attraction, vdw repulsion, electrostatics, polar desolvation and hydrophobic desolvation
+// energies between pAtom and all atoms of the block to basicTerms[0..4]
+int AtomBlockBasicEnergy(AtomBlock* pThis, Atom* pAtom, double basicTerms[5])
+{
+  if (pThis->atomNum == 0 || XYZDistance(&pAtom->xyz, &pThis->center) > pThis->radius + ENERGY_DISTANCE_CUTOFF)
+  {
+    return Success;
+  }
+  double repRadius1, charge1, lamda1, isHeavy1, isPolar1;
+  AtomBlockPackAtom(pAtom, &repRadius1, &charge1, &lamda1, &isHeavy1, &isPolar1);
+  double sums[6];
+  AtomBlockKernel(pThis, pAtom->xyz.X, pAtom->xyz.Y, pAtom->xyz.Z, pAtom->vdw_radius, pAtom->vdw_epsilon,
+    repRadius1, charge1, pAtom->EEF1_volume, lamda1, pAtom->EEF1_freeDG, isHeavy1, sums);
+  basicTerms[0] += sums[0];
+  basicTerms[1] += sums[1];
+  basicTerms[2] += sums[2];
+  // desolvation of atom1 is polar or hydrophobic by its own polarity, that of the block atoms by theirs
+  if (isPolar1 > 0.5) basicTerms[3] += sums[3];
+  else basicTerms[4] += sums[3];
+  basicTerms[3] += sums[4];
+  basicTerms[4] += sums[5];
+  return Success;
+}
@@ -0,0 +1,57 @@
+/*******************************************************************************************************************************
+Copyright (c) Xiaoqiang Huang
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy,
+modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************************/
+#ifndef ATOM_BLOCK_H
+#define ATOM_BLOCK_H
+
+#include "Atom.h"
+
+// maximum number of atoms packed into one block; larger sets use the scalar path
+#define ATOM_BLOCK_CAPACITY                128
+
+typedef enum _Type_AtomBlockFilter
+{
+  Type_AtomBlockFilter_All,
+  Type_AtomBlockFilter_SideChain,
+  Type_AtomBlockFilter_BackBone
+} Type_AtomBlockFilter;
+
+// structure-of-arrays copy of the atoms of one residue or rotamer,
+// laid out for the batched basic energy kernel
+typedef struct _AtomBlock
+{
+  double x[ATOM_BLOCK_CAPACITY];
+  double y[ATOM_BLOCK_CAPACITY];
+  double z[ATOM_BLOCK_CAPACITY];
+  double vdwRadius[ATOM_BLOCK_CAPACITY];
+  double vdwEpsilon[ATOM_BLOCK_CAPACITY];
+  double repRadius[ATOM_BLOCK_CAPACITY];
+  double charge[ATOM_BLOCK_CAPACITY];
+  double eef1Volume[ATOM_BLOCK_CAPACITY];
+  double eef1Lamda[ATOM_BLOCK_CAPACITY];
+  double eef1FreeDG[ATOM_BLOCK_CAPACITY];
+  double isHeavy[ATOM_BLOCK_CAPACITY];
+  double isPolar[ATOM_BLOCK_CAPACITY];
+  Atom* atoms[ATOM_BLOCK_CAPACITY];
+  int atomNum;
+  // bounding sphere of the block, used to skip atoms that cannot reach it
+  XYZ center;
+  double radius;
+} AtomBlock;
+
+int AtomBlockFill(AtomBlock* pThis, AtomArray* pAtoms, Type_AtomBlockFilter filter);
+int AtomBlockBasicEnergy(AtomBlock* pThis, Atom* pAtom, double basicTerms[5]);
+
+#endif // ATOM_BLOCK_H
@@ -20,6 +20,7 @@ IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 int AtomParamsSetCreate(AtomParamsSet* pThis)
 {
   StringArrayCreate(&pThis->residueNames);
+  StringIndexCreate(&pThis->residueIndex);
   pThis->atomCount = NULL;
   pThis->atoms = NULL;
   return Success;
@@ -39,10 +40,18 @@ int AtomParamsSetDestroy(AtomParamsSet* pThis)
   free(pThis->atoms);
   free(pThis->atomCount);
   StringArrayDestroy(&pThis->residueNames);
+  StringIndexDestroy(&pThis->residueIndex);
   return Success;
 }
 
 
+static int AtomParamsSetFindResidue(AtomParamsSet* pThis, char* residueName, int* pos)
+{
+  *pos = StringIndexGet(&pThis->residueIndex, residueName);
+  return *pos < 0 ? DataNotExistError : Success;
+}
+
+
 int AtomParamsSetAdd(AtomParamsSet* pThis, char* residueName, Atom* pNewAtom)
 {
   if (strlen(residueName) > MAX_LEN_RES_NAME)
@@ -54,9 +63,9 @@ int AtomParamsSetAdd(AtomParamsSet* pThis, char* residueName, Atom* pNewAtom)
     return result;
   }
 
-  int resiIndex;
+  int resiIndex = -1;
   int atomIndex;
-  int result = StringArrayFind(&pThis->residueNames, residueName, &resiIndex);
+  int result = AtomParamsSetFindResidue(pThis, residueName, &resiIndex);
   // new residue
   if (FAILED(result))
   {
@@ -64,6 +73,7 @@ int AtomParamsSetAdd(AtomParamsSet* pThis, char* residueName, Atom* pNewAtom)
     pThis->atoms = (Atom**)realloc(pThis->atoms, sizeof(Atom*) * newResidueCount);
     pThis->atoms[newResidueCount - 1] = NULL;
     StringArrayAppend(&pThis->residueNames, residueName);
+    StringIndexSet(&pThis->residueIndex, residueName, newResidueCount - 1);
     pThis->atomCount = (int*)realloc(pThis->atomCount, sizeof(int) * newResidueCount);
     pThis->atomCount[newResidueCount - 1] = 0;
     resiIndex = AtomParamsSetGetResidueCount(pThis) - 1;
@@ -148,8 +158,8 @@ int AtomParamsSetGetResidueName(AtomParamsSet* pThis, int index, char* residueNa
 
 int AtomParamsSetGetAtomCount(AtomParamsSet* pThis, char* residueName, int* pCount)
 {
-  int pos;
-  int result = StringArrayFind(&pThis->residueNames, residueName, &pos);
+  int pos = -1;
+  int result = AtomParamsSetFindResidue(pThis, residueName, &pos);
   if (FAILED(result)) return result;
   *pCount = pThis->atomCount[pos];
   return Success;
@@ -158,8 +168,8 @@ int AtomParamsSetGetAtomCount(AtomParamsSet* pThis, char* residueName, int* pCou
 
 int AtomParamsSetGetAtomParam(AtomParamsSet* pThis, char* residueName, int index, Atom* pDestAtom)
 {
-  int pos;
-  int result = StringArrayFind(&pThis->residueNames, residueName, &pos);
+  int pos = -1;
+  int result = AtomParamsSetFindResidue(pThis, residueName, &pos);
   if (FAILED(result)) return result;
   if (index < 0 || index >= pThis->atomCount[pos])
   {
@@ -172,8 +182,8 @@ int AtomParamsSetGetAtomParam(AtomParamsSet* pThis, char* residueName, int index
 
 int AtomParamsSetGetAtomParamByName(AtomParamsSet* pThis, char* residueName, char* atomName, Atom* pDestAtom)
 {
-  int pos, atomIndex;
-  int result = StringArrayFind(&pThis->residueNames, residueName, &pos);
+  int pos = -1, atomIndex;
+  int result = AtomParamsSetFindResidue(pThis, residueName, &pos);
   if (FAILED(result))  return result;
   for (atomIndex = 0;atomIndex < pThis->atomCount[pos];atomIndex++)
   {
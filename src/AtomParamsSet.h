@@ -22,6 +22,7 @@ IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 typedef struct _AtomParamsSet
 {
   StringArray residueNames;
+  StringIndex residueIndex;
   Atom** atoms;
   int* atomCount;
 } AtomParamsSet;
@@ -22,6 +22,8 @@ int DesignSiteCreate(DesignSite* pThis)
   RotamerSetCreate(&pThis->rots);
   pThis->chnNdx = -1;
   pThis->resNdx = -1;
+  pThis->seqNdx = -1;
+  IntArrayCreate(&pThis->nbrNdxs, 0);
   return Success;
 }
 int DesignSiteDestroy(DesignSite* pThis)
@@ -31,6 +33,8 @@ int DesignSiteDestroy(DesignSite* pThis)
   RotamerSetDestroy(&pThis->rots);
   pThis->chnNdx = -1;
   pThis->resNdx = -1;
+  pThis->seqNdx = -1;
+  IntArrayDestroy(&pThis->nbrNdxs);
   return Success;
 }
 RotamerSet* DesignSiteGetRotamers(DesignSite* pThis)
@@ -98,6 +102,8 @@ int DesignSiteCopy(DesignSite* pThis, DesignSite* pOther)
 {
   pThis->chnNdx = pOther->chnNdx;
   pThis->resNdx = pOther->resNdx;
+  pThis->seqNdx = pOther->seqNdx;
+  IntArrayCopy(&pThis->nbrNdxs, &pOther->nbrNdxs);
   pThis->pRes = pOther->pRes;
   RotamerSetCopy(&pThis->rots, &pOther->rots);
   return Success;
@@ -25,6 +25,8 @@ typedef struct _DesignSite
   Residue* pRes;
   int chnNdx;
   int resNdx;
+  int seqNdx; // position in the sequence built by StructureGetWholeSequence(), -1 if not on the designed chain
+  IntArray nbrNdxs; // design sites whose rotamers may interact with the rotamers of this site, see StructureBuildDesignSiteGraph()
 } DesignSite;
 
 int DesignSiteCreate(DesignSite* pThis);
@@ -15,6 +15,7 @@ IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 ********************************************************************************************************************************/
 
 #include "EnergyFunction.h"
+#include "AtomBlock.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
@@ -23,6 +24,7 @@ IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
 extern double CUT_EXCL_LOW_PROB_ROT;
+extern BOOL FLAG_ENERGY_SIMD;
 
 double WEIGHTS[MAX_ENERGY_TERM];
 
@@ -525,22 +527,7 @@ BOOL ResidueIntraBond14Check(char* atom1, char* atom2, BondSet* pBondSet)
 
 int ResidueIntraBondConnectionCheck(char* atom1, char* atom2, BondSet* pBondSet)
 {
-  if (ResidueIntraBond12Check(atom1, atom2, pBondSet))
-  {
-    return 12;
-  }
-  else if (ResidueIntraBond13Check(atom1, atom2, pBondSet))
-  {
-    return 13;
-  }
-  else if (ResidueIntraBond14Check(atom1, atom2, pBondSet))
-  {
-    return 14;
-  }
-  else
-  {
-    return 15;
-  }
+  return BondSetGetSeparation(pBondSet, BondSetGetAtomSlot(pBondSet, atom1), BondSetGetAtomSlot(pBondSet, atom2));
 }
 
 int ResidueAndNextResidueInterBondConnectionCheck_charmm22(char* atomOnPreResi, char* atomOnNextResi, Residue* pPreResi, Residue* pNextResi)
@@ -1269,6 +1256,13 @@ int AminoAcidReferenceEnergy(char* AAname, double energyTerm[MAX_ENERGY_TERM])
 
 int EnergyIntraResidue(Residue* pThis, double energyTerms[MAX_ENERGY_TERM])
 {
+  // look up the bond separation table slot of every atom once
+  BondSet* pBonds = ResidueGetBonds(pThis);
+  int* atomSlots = (int*)malloc(sizeof(int) * (ResidueGetAtomCount(pThis) + 1));
+  for (int i = 0; i < ResidueGetAtomCount(pThis); i++)
+  {
+    atomSlots[i] = BondSetGetAtomSlot(pBonds, AtomGetName(ResidueGetAtom(pThis, i)));
+  }
   for (int i = 0; i < ResidueGetAtomCount(pThis); i++)
   {
     Atom* pAtom1 = ResidueGetAtom(pThis, i);
@@ -1301,7 +1295,7 @@ int EnergyIntraResidue(Residue* pThis, double energyTerms[MAX_ENERGY_TERM])
           || strcmp(ResidueGetName(pThis), "LYS") == 0
           || strcmp(ResidueGetName(pThis), "ARG") == 0)
         {
-          int bondType = ResidueIntraBondConnectionCheck(AtomGetName(pAtom1), AtomGetName(pAtom2), ResidueGetBonds(pThis));
+          int bondType = BondSetGetSeparation(pBonds, atomSlots[i], atomSlots[j]);
           if (bondType == 12 || bondType == 13)
           {
             continue;
@@ -1322,7 +1316,7 @@ int EnergyIntraResidue(Residue* pThis, double energyTerms[MAX_ENERGY_TERM])
         {
           continue;
         }
-        int bondType = ResidueIntraBondConnectionCheck(AtomGetName(pAtom1), AtomGetName(pAtom2), ResidueGetBonds(pThis));
+        int bondType = BondSetGetSeparation(pBonds, atomSlots[i], atomSlots[j]);
         if (bondType == 12 || bondType == 13)
         {
           continue;
@@ -1343,12 +1337,12 @@ int EnergyIntraResidue(Residue* pThis, double energyTerms[MAX_ENERGY_TERM])
           double hbtot = 0, hbd = 0, hbt = 0, hbp = 0;
           if (pAtom1->isHBatomH == TRUE && pAtom2->isHBatomA == TRUE)
           {
-            HBondEnergyAtomAndAtom(pAtom1, pAtom2, ResidueGetAtomByName(pThis, AtomGetHbDorB(pAtom1)), ResidueGetAtomByName(pThis, AtomGetHbDorB(pAtom2)),
+            HBondEnergyAtomAndAtom(pAtom1, pAtom2, ResidueGetAtomHbDorB(pThis, pAtom1), ResidueGetAtomHbDorB(pThis, pAtom2),
               distance, bondType, &hbtot, &hbd, &hbt, &hbp);
           }
           else if (pAtom2->isHBatomH == TRUE && pAtom1->isHBatomA == TRUE)
           {
-            HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomByName(pThis, AtomGetHbDorB(pAtom2)), ResidueGetAtomByName(pThis, AtomGetHbDorB(pAtom1)),
+            HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomHbDorB(pThis, pAtom2), ResidueGetAtomHbDorB(pThis, pAtom1),
               distance, bondType, &hbtot, &hbd, &hbt, &hbp);
           }
           energyTerms[26] += hbd;
@@ -1359,6 +1353,7 @@ int EnergyIntraResidue(Residue* pThis, double energyTerms[MAX_ENERGY_TERM])
     }
 
   }
+  free(atomSlots);
   return Success;
 }
 
@@ -1404,12 +1399,12 @@ int EnergyResidueAndNextResidue(Residue* pThis, Residue* pOther, double energyTe
         double hbtot = 0, hbd = 0, hbt = 0, hbp = 0;
         if (pAtom1->isHBatomH == TRUE && pAtom2->isHBatomA == TRUE)
         {
-          HBondEnergyAtomAndAtom(pAtom1, pAtom2, ResidueGetAtomByName(pThis, AtomGetHbDorB(pAtom1)), ResidueGetAtomByName(pOther, AtomGetHbDorB(pAtom2)),
+          HBondEnergyAtomAndAtom(pAtom1, pAtom2, ResidueGetAtomHbDorB(pThis, pAtom1), ResidueGetAtomHbDorB(pOther, pAtom2),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         else if (pAtom2->isHBatomH == TRUE && pAtom1->isHBatomA == TRUE)
         {
-          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomByName(pOther, AtomGetHbDorB(pAtom2)), ResidueGetAtomByName(pThis, AtomGetHbDorB(pAtom1)),
+          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomHbDorB(pOther, pAtom2), ResidueGetAtomHbDorB(pThis, pAtom1),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         if (pThis->posInChain - pOther->posInChain <= 2 && pThis->posInChain - pOther->posInChain >= -2)
@@ -1460,12 +1455,12 @@ int EnergyResidueAndNextResidue(Residue* pThis, Residue* pOther, double energyTe
           double hbtot = 0, hbd = 0, hbt = 0, hbp = 0;
           if (pAtom1->isHBatomH && pAtom2->isHBatomA)
           {
-            HBondEnergyAtomAndAtom(pAtom1, pAtom2, ResidueGetAtomByName(pThis, AtomGetHbDorB(pAtom1)), ResidueGetAtomByName(pOther, AtomGetHbDorB(pAtom2)),
+            HBondEnergyAtomAndAtom(pAtom1, pAtom2, ResidueGetAtomHbDorB(pThis, pAtom1), ResidueGetAtomHbDorB(pOther, pAtom2),
               distance, bondType, &hbtot, &hbd, &hbt, &hbp);
           }
           else if (pAtom2->isHBatomH && pAtom1->isHBatomA)
           {
-            HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomByName(pOther, AtomGetHbDorB(pAtom2)), ResidueGetAtomByName(pThis, AtomGetHbDorB(pAtom1)),
+            HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomHbDorB(pOther, pAtom2), ResidueGetAtomHbDorB(pThis, pAtom1),
               distance, bondType, &hbtot, &hbd, &hbt, &hbp);
           }
           if (pThis->posInChain - pOther->posInChain <= 2 && pThis->posInChain - pOther->posInChain >= -2)
@@ -1501,10 +1496,18 @@ int EnergyResidueAndNextResidue(Residue* pThis, Residue* pOther, double energyTe
 
 int EnergyResidueAndOtherResidueSameChain(Residue* pThis, Residue* pOther, double energyTerms[MAX_ENERGY_TERM])
 {
+  AtomBlock block;
+  BOOL useBlock = (FLAG_ENERGY_SIMD && AtomBlockFill(&block, &pOther->atoms, Type_AtomBlockFilter_All) == Success) ? TRUE : FALSE;
+
   for (int i = 0;i < ResidueGetAtomCount(pThis);i++)
   {
     Atom* pAtom1 = ResidueGetAtom(pThis, i);
     if (pAtom1->isXyzValid == FALSE)continue;
+    if (useBlock)
+    {
+      AtomBlockBasicEnergy(&block, pAtom1, &energyTerms[31]);
+      if (!pAtom1->isHBatomH && !pAtom1->isHBatomA) continue;
+    }
     for (int j = 0;j < ResidueGetAtomCount(pOther);j++)
     {
       Atom* pAtom2 = ResidueGetAtom(pOther, j);
@@ -1513,26 +1516,29 @@ int EnergyResidueAndOtherResidueSameChain(Residue* pThis, Residue* pOther, doubl
       if (distance > ENERGY_DISTANCE_CUTOFF) continue;
       int bondType = 15;
       double vdwAtt = 0, vdwRep = 0, ele = 0, desolvP = 0, desolvH = 0;
-      VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &vdwAtt);
-      VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &vdwRep);
-      ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
-      LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desolvP, &desolvH);
-      energyTerms[31] += vdwAtt;
-      energyTerms[32] += vdwRep;
-      energyTerms[33] += ele;
-      energyTerms[34] += desolvP;
-      energyTerms[35] += desolvH;
+      if (!useBlock)
+      {
+        VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &vdwAtt);
+        VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &vdwRep);
+        ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
+        LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desolvP, &desolvH);
+        energyTerms[31] += vdwAtt;
+        energyTerms[32] += vdwRep;
+        energyTerms[33] += ele;
+        energyTerms[34] += desolvP;
+        energyTerms[35] += desolvH;
+      }
       if (distance < HB_HA_DIST_CUTOFF_MAX)
       {
         double hbtot = 0, hbd = 0, hbt = 0, hbp = 0;
         if (pAtom1->isHBatomH && pAtom2->isHBatomA)
         {
-          HBondEnergyAtomAndAtom(pAtom1, pAtom2, ResidueGetAtomByName(pThis, AtomGetHbDorB(pAtom1)), ResidueGetAtomByName(pOther, AtomGetHbDorB(pAtom2)),
+          HBondEnergyAtomAndAtom(pAtom1, pAtom2, ResidueGetAtomHbDorB(pThis, pAtom1), ResidueGetAtomHbDorB(pOther, pAtom2),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         else if (pAtom2->isHBatomH && pAtom1->isHBatomA)
         {
-          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomByName(pOther, AtomGetHbDorB(pAtom2)), ResidueGetAtomByName(pThis, AtomGetHbDorB(pAtom1)),
+          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomHbDorB(pOther, pAtom2), ResidueGetAtomHbDorB(pThis, pAtom1),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         if (pThis->posInChain - pOther->posInChain <= 2 && pThis->posInChain - pOther->posInChain >= -2)
@@ -1599,10 +1605,18 @@ int EnergyResidueAndOtherResidueSameChain(Residue* pThis, Residue* pOther, doubl
 
 int EnergyResidueAndOtherResidueDiffChain(Residue* pThis, Residue* pOther, double energyTerms[MAX_ENERGY_TERM])
 {
+  AtomBlock block;
+  BOOL useBlock = (FLAG_ENERGY_SIMD && AtomBlockFill(&block, &pOther->atoms, Type_AtomBlockFilter_All) == Success) ? TRUE : FALSE;
+
   for (int i = 0; i < ResidueGetAtomCount(pThis); i++)
   {
     Atom* pAtom1 = ResidueGetAtom(pThis, i);
     if (!pAtom1->isXyzValid)continue;
+    if (useBlock)
+    {
+      AtomBlockBasicEnergy(&block, pAtom1, &energyTerms[51]);
+      if (!pAtom1->isHBatomH && !pAtom1->isHBatomA) continue;
+    }
     for (int j = 0; j < ResidueGetAtomCount(pOther); j++)
     {
       Atom* pAtom2 = ResidueGetAtom(pOther, j);
@@ -1611,26 +1625,29 @@ int EnergyResidueAndOtherResidueDiffChain(Residue* pThis, Residue* pOther, doubl
       if (distance > ENERGY_DISTANCE_CUTOFF) continue;
       double att = 0, rep = 0, ele = 0, desP = 0, desH = 0;
       int bondType = 15;
-      VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &att);
-      VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &rep);
-      ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
-      LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desP, &desH);
-      energyTerms[51] += att;
-      energyTerms[52] += rep;
-      energyTerms[53] += ele;
-      energyTerms[54] += desP;
-      energyTerms[55] += desH;
+      if (!useBlock)
+      {
+        VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &att);
+        VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &rep);
+        ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
+        LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desP, &desH);
+        energyTerms[51] += att;
+        energyTerms[52] += rep;
+        energyTerms[53] += ele;
+        energyTerms[54] += desP;
+        energyTerms[55] += desH;
+      }
       if (distance < HB_HA_DIST_CUTOFF_MAX)
       {
         double hbtot = 0, hbd = 0, hbt = 0, hbp = 0;
         if (pAtom1->isHBatomH == TRUE && pAtom2->isHBatomA == TRUE)
         {
-          HBondEnergyAtomAndAtom(pAtom1, pAtom2, ResidueGetAtomByName(pThis, AtomGetHbDorB(pAtom1)), ResidueGetAtomByName(pOther, AtomGetHbDorB(pAtom2)),
+          HBondEnergyAtomAndAtom(pAtom1, pAtom2, ResidueGetAtomHbDorB(pThis, pAtom1), ResidueGetAtomHbDorB(pOther, pAtom2),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         else if (pAtom1->isHBatomA && pAtom2->isHBatomH)
         {
-          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomByName(pOther, AtomGetHbDorB(pAtom2)), ResidueGetAtomByName(pThis, AtomGetHbDorB(pAtom1)),
+          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomHbDorB(pOther, pAtom2), ResidueGetAtomHbDorB(pThis, pAtom1),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         if (pAtom1->isBBAtom && pAtom2->isBBAtom)
@@ -1691,10 +1708,18 @@ int EnergyResidueAndOtherResidueDiffChain(Residue* pThis, Residue* pOther, doubl
 
 int EnergyResidueAndLigandResidue(Residue* pProtein, Residue* pLigand, double energyTerms[MAX_ENERGY_TERM])
 {
+  AtomBlock block;
+  BOOL useBlock = (FLAG_ENERGY_SIMD && AtomBlockFill(&block, &pLigand->atoms, Type_AtomBlockFilter_All) == Success) ? TRUE : FALSE;
+
   for (int i = 0; i < ResidueGetAtomCount(pProtein); i++)
   {
     Atom* pAtom1 = ResidueGetAtom(pProtein, i);
     if (pAtom1->isXyzValid == FALSE)continue;
+    if (useBlock)
+    {
+      AtomBlockBasicEnergy(&block, pAtom1, &energyTerms[71]);
+      if (!pAtom1->isHBatomH && !pAtom1->isHBatomA) continue;
+    }
     for (int j = 0; j < ResidueGetAtomCount(pLigand); j++)
     {
       Atom* pAtom2 = ResidueGetAtom(pLigand, j);
@@ -1703,26 +1728,29 @@ int EnergyResidueAndLigandResidue(Residue* pProtein, Residue* pLigand, double en
       if (distance > ENERGY_DISTANCE_CUTOFF) continue;
       int bondType = 15;
       double vdwAtt = 0, vdwRep = 0, ele = 0, desolvP = 0, desolvH = 0;
-      VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &vdwAtt);
-      VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &vdwRep);
-      ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
-      LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desolvP, &desolvH);
-      energyTerms[71] += vdwAtt;
-      energyTerms[72] += vdwRep;
-      energyTerms[73] += ele;
-      energyTerms[74] += desolvP;
-      energyTerms[75] += desolvH;
+      if (!useBlock)
+      {
+        VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &vdwAtt);
+        VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &vdwRep);
+        ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
+        LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desolvP, &desolvH);
+        energyTerms[71] += vdwAtt;
+        energyTerms[72] += vdwRep;
+        energyTerms[73] += ele;
+        energyTerms[74] += desolvP;
+        energyTerms[75] += desolvH;
+      }
       if (distance < HB_HA_DIST_CUTOFF_MAX)
       {
         double hbtot = 0, hbd = 0, hbt = 0, hbp = 0;
         if (pAtom1->isHBatomH == TRUE && pAtom2->isHBatomA == TRUE)
         {
-          HBondEnergyAtomAndAtom(pAtom1, pAtom2, ResidueGetAtomByName(pProtein, AtomGetHbDorB(pAtom1)), ResidueGetAtomByName(pLigand, AtomGetHbDorB(pAtom2)),
+          HBondEnergyAtomAndAtom(pAtom1, pAtom2, ResidueGetAtomHbDorB(pProtein, pAtom1), ResidueGetAtomHbDorB(pLigand, pAtom2),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         else if (pAtom2->isHBatomH == TRUE && pAtom1->isHBatomA == TRUE)
         {
-          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomByName(pLigand, AtomGetHbDorB(pAtom2)), ResidueGetAtomByName(pProtein, AtomGetHbDorB(pAtom1)),
+          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomHbDorB(pLigand, pAtom2), ResidueGetAtomHbDorB(pProtein, pAtom1),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         if (pAtom1->isBBAtom == FALSE && pAtom2->isBBAtom == FALSE)
@@ -1751,6 +1779,13 @@ int EnergyResidueAndLigandResidue(Residue* pProtein, Residue* pLigand, double en
 
 int EnergyIntraRotamer(Rotamer* pThis, double energyTerms[MAX_ENERGY_TERM])
 {
+  // look up the bond separation table slot of every atom once
+  BondSet* pBonds = RotamerGetBonds(pThis);
+  int* atomSlots = (int*)malloc(sizeof(int) * (RotamerGetAtomCount(pThis) + 1));
+  for (int i = 0; i < RotamerGetAtomCount(pThis); ++i)
+  {
+    atomSlots[i] = BondSetGetAtomSlot(pBonds, AtomGetName(RotamerGetAtom(pThis, i)));
+  }
   for (int i = 0; i < RotamerGetAtomCount(pThis); ++i)
   {
     Atom* pAtom1 = RotamerGetAtom(pThis, i);
@@ -1768,7 +1803,7 @@ int EnergyIntraRotamer(Rotamer* pThis, double energyTerms[MAX_ENERGY_TERM])
           strcmp(RotamerGetType(pThis), "GLN") == 0 || strcmp(RotamerGetType(pThis), "GLU") == 0 ||
           strcmp(RotamerGetType(pThis), "LYS") == 0 || strcmp(RotamerGetType(pThis), "ARG") == 0)
         {
-          int bondType = ResidueIntraBondConnectionCheck(AtomGetName(pAtom1), AtomGetName(pAtom2), RotamerGetBonds(pThis));
+          int bondType = BondSetGetSeparation(pBonds, atomSlots[i], atomSlots[j]);
           if (bondType == 12 || bondType == 13) continue;
           double vdwAtt = 0, vdwRep = 0, desolvP = 0, desolvH = 0;
           VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &vdwAtt);
@@ -1783,7 +1818,7 @@ int EnergyIntraRotamer(Rotamer* pThis, double energyTerms[MAX_ENERGY_TERM])
       else if ((pAtom1->isBBAtom == TRUE && pAtom2->isBBAtom == FALSE) || (pAtom1->isBBAtom == FALSE && pAtom2->isBBAtom == TRUE))
       {
         if (strcmp(AtomGetName(pAtom1), "CB") == 0 || strcmp(AtomGetName(pAtom2), "CB") == 0) continue;
-        int bondType = ResidueIntraBondConnectionCheck(AtomGetName(pAtom1), AtomGetName(pAtom2), RotamerGetBonds(pThis));
+        int bondType = BondSetGetSeparation(pBonds, atomSlots[i], atomSlots[j]);
         if (bondType == 12 || bondType == 13) continue;
         double vdwAtt = 0, vdwRep = 0, desolvP = 0, desolvH = 0, ele = 0;
         VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &vdwAtt);
@@ -1800,12 +1835,12 @@ int EnergyIntraRotamer(Rotamer* pThis, double energyTerms[MAX_ENERGY_TERM])
           double hbtot = 0, hbd = 0, hbt = 0, hbp = 0;
           if (pAtom1->isHBatomH == TRUE && pAtom2->isHBatomA == TRUE)
           {
-            HBondEnergyAtomAndAtom(pAtom1, pAtom2, RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom1)), RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom2)),
+            HBondEnergyAtomAndAtom(pAtom1, pAtom2, RotamerGetAtomHbDorB(pThis, pAtom1), RotamerGetAtomHbDorB(pThis, pAtom2),
               distance, bondType, &hbtot, &hbd, &hbt, &hbp);
           }
           else if (pAtom2->isHBatomH == TRUE && pAtom1->isHBatomA == TRUE)
           {
-            HBondEnergyAtomAndAtom(pAtom2, pAtom1, RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom2)), RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom1)),
+            HBondEnergyAtomAndAtom(pAtom2, pAtom1, RotamerGetAtomHbDorB(pThis, pAtom2), RotamerGetAtomHbDorB(pThis, pAtom1),
               distance, bondType, &hbtot, &hbd, &hbt, &hbp);
           }
           energyTerms[26] += hbd;
@@ -1815,17 +1850,26 @@ int EnergyIntraRotamer(Rotamer* pThis, double energyTerms[MAX_ENERGY_TERM])
       }
     }
   }
+  free(atomSlots);
   return Success;
 }
 
 
 int EnergyRotamerAndRotamerSameChain(Rotamer* pThis, Rotamer* pOther, double energyTerms[MAX_ENERGY_TERM])
 {
+  AtomBlock block;
+  BOOL useBlock = (FLAG_ENERGY_SIMD && AtomBlockFill(&block, &pOther->atoms, Type_AtomBlockFilter_SideChain) == Success) ? TRUE : FALSE;
+
   for (int i = 0;i < RotamerGetAtomCount(pThis);i++)
   {
     Atom* pAtom1 = RotamerGetAtom(pThis, i);
     if (pAtom1->isXyzValid == FALSE) continue;
     if (pAtom1->isBBAtom) continue;
+    if (useBlock)
+    {
+      AtomBlockBasicEnergy(&block, pAtom1, &energyTerms[31]);
+      if (!pAtom1->isHBatomH && !pAtom1->isHBatomA) continue;
+    }
     for (int j = 0;j < RotamerGetAtomCount(pOther);j++)
     {
       Atom* pAtom2 = RotamerGetAtom(pOther, j);
@@ -1835,21 +1879,24 @@ int EnergyRotamerAndRotamerSameChain(Rotamer* pThis, Rotamer* pOther, double ene
       if (distance > ENERGY_DISTANCE_CUTOFF) continue;
       int bondType = 15;
       double att = 0, rep = 0, ele = 0, desP = 0, desH = 0;
-      VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &att);
-      VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &rep);
-      ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
-      LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desP, &desH);
-      energyTerms[31] += att;
-      energyTerms[32] += rep;
-      energyTerms[33] += ele;
-      energyTerms[34] += desP;
-      energyTerms[35] += desH;
+      if (!useBlock)
+      {
+        VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &att);
+        VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &rep);
+        ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
+        LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desP, &desH);
+        energyTerms[31] += att;
+        energyTerms[32] += rep;
+        energyTerms[33] += ele;
+        energyTerms[34] += desP;
+        energyTerms[35] += desH;
+      }
       if (distance < HB_HA_DIST_CUTOFF_MAX)
       {
         double hbtot = 0, hbd = 0, hbt = 0, hbp = 0;
         if (pAtom1->isHBatomH && pAtom2->isHBatomA)
         {
-          HBondEnergyAtomAndAtom(pAtom1, pAtom2, RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom1)), RotamerGetAtomByName(pOther, AtomGetHbDorB(pAtom2)),
+          HBondEnergyAtomAndAtom(pAtom1, pAtom2, RotamerGetAtomHbDorB(pThis, pAtom1), RotamerGetAtomHbDorB(pOther, pAtom2),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
           if (pThis->posInChain - pOther->posInChain <= 2 && pThis->posInChain - pOther->posInChain >= -2)
           {
@@ -1864,7 +1911,7 @@ int EnergyRotamerAndRotamerSameChain(Rotamer* pThis, Rotamer* pOther, double ene
         }
         else if (pAtom1->isHBatomA && pAtom2->isHBatomH)
         {
-          HBondEnergyAtomAndAtom(pAtom2, pAtom1, RotamerGetAtomByName(pOther, AtomGetHbDorB(pAtom2)), RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom1)),
+          HBondEnergyAtomAndAtom(pAtom2, pAtom1, RotamerGetAtomHbDorB(pOther, pAtom2), RotamerGetAtomHbDorB(pThis, pAtom1),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
           if (pThis->posInChain - pOther->posInChain <= 2 && pThis->posInChain - pOther->posInChain >= -2)
           {
@@ -1916,11 +1963,19 @@ int EnergyRotamerAndRotamerSameChain(Rotamer* pThis, Rotamer* pOther, double ene
 
 int EnergyRotamerAndRotamerDiffChain(Rotamer* pThis, Rotamer* pOther, double energyTerms[MAX_ENERGY_TERM])
 {
+  AtomBlock block;
+  BOOL useBlock = (FLAG_ENERGY_SIMD && AtomBlockFill(&block, &pOther->atoms, Type_AtomBlockFilter_SideChain) == Success) ? TRUE : FALSE;
+
   for (int i = 0; i < RotamerGetAtomCount(pThis); i++)
   {
     Atom* pAtom1 = RotamerGetAtom(pThis, i);
     if (pAtom1->isXyzValid == FALSE) continue;
     if (pAtom1->isBBAtom) continue;
+    if (useBlock)
+    {
+      AtomBlockBasicEnergy(&block, pAtom1, &energyTerms[51]);
+      if (!pAtom1->isHBatomH && !pAtom1->isHBatomA) continue;
+    }
     for (int j = 0; j < RotamerGetAtomCount(pOther); j++)
     {
       Atom* pAtom2 = RotamerGetAtom(pOther, j);
@@ -1930,26 +1985,29 @@ int EnergyRotamerAndRotamerDiffChain(Rotamer* pThis, Rotamer* pOther, double ene
       if (distance > ENERGY_DISTANCE_CUTOFF) continue;
       double att = 0, rep = 0, ele = 0, desP = 0, desH = 0;
       int bondType = 15;
-      VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &att);
-      VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &rep);
-      ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
-      LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desP, &desH);
-      energyTerms[51] += att;
-      energyTerms[52] += rep;
-      energyTerms[53] += ele;
-      energyTerms[54] += desP;
-      energyTerms[55] += desH;
+      if (!useBlock)
+      {
+        VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &att);
+        VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &rep);
+        ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
+        LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desP, &desH);
+        energyTerms[51] += att;
+        energyTerms[52] += rep;
+        energyTerms[53] += ele;
+        energyTerms[54] += desP;
+        energyTerms[55] += desH;
+      }
       if (distance < HB_HA_DIST_CUTOFF_MAX)
       {
         double hbtot = 0, hbd = 0, hbt = 0, hbp = 0;
         if (pAtom1->isHBatomH && pAtom2->isHBatomA)
         {
-          HBondEnergyAtomAndAtom(pAtom1, pAtom2, RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom1)), RotamerGetAtomByName(pOther, AtomGetHbDorB(pAtom2)),
+          HBondEnergyAtomAndAtom(pAtom1, pAtom2, RotamerGetAtomHbDorB(pThis, pAtom1), RotamerGetAtomHbDorB(pOther, pAtom2),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         else if (pAtom1->isHBatomA && pAtom2->isHBatomH)
         {
-          HBondEnergyAtomAndAtom(pAtom2, pAtom1, RotamerGetAtomByName(pOther, AtomGetHbDorB(pAtom2)), RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom1)),
+          HBondEnergyAtomAndAtom(pAtom2, pAtom1, RotamerGetAtomHbDorB(pOther, pAtom2), RotamerGetAtomHbDorB(pThis, pAtom1),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         /*if(pAtom1->isBBAtom && pAtom2->isBBAtom){
@@ -2007,11 +2065,19 @@ int EnergyRotamerAndRotamerDiffChain(Rotamer* pThis, Rotamer* pOther, double ene
 
 int EnergyRotamerAndLigandRotamer(Rotamer* pThis, Rotamer* pOther, double energyTerms[MAX_ENERGY_TERM])
 {
+  AtomBlock block;
+  BOOL useBlock = (FLAG_ENERGY_SIMD && AtomBlockFill(&block, &pOther->atoms, Type_AtomBlockFilter_SideChain) == Success) ? TRUE : FALSE;
+
   for (int i = 0; i < RotamerGetAtomCount(pThis); i++)
   {
     Atom* pAtom1 = RotamerGetAtom(pThis, i);
     if (pAtom1->isXyzValid == FALSE) continue;
     if (pAtom1->isBBAtom) continue;
+    if (useBlock)
+    {
+      AtomBlockBasicEnergy(&block, pAtom1, &energyTerms[71]);
+      if (!pAtom1->isHBatomH && !pAtom1->isHBatomA) continue;
+    }
     for (int j = 0; j < RotamerGetAtomCount(pOther); j++)
     {
       Atom* pAtom2 = RotamerGetAtom(pOther, j);
@@ -2021,26 +2087,29 @@ int EnergyRotamerAndLigandRotamer(Rotamer* pThis, Rotamer* pOther, double energy
       if (distance > ENERGY_DISTANCE_CUTOFF) continue;
       double att = 0, rep = 0, ele = 0, desP = 0, desH = 0;
       int bondType = 15;
-      VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &att);
-      VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &rep);
-      ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
-      LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desP, &desH);
-      energyTerms[71] += att;
-      energyTerms[72] += rep;
-      energyTerms[73] += ele;
-      energyTerms[74] += desP;
-      energyTerms[75] += desH;
+      if (!useBlock)
+      {
+        VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &att);
+        VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &rep);
+        ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
+        LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desP, &desH);
+        energyTerms[71] += att;
+        energyTerms[72] += rep;
+        energyTerms[73] += ele;
+        energyTerms[74] += desP;
+        energyTerms[75] += desH;
+      }
       if (distance < HB_HA_DIST_CUTOFF_MAX)
       {
         double hbtot = 0, hbd = 0, hbt = 0, hbp = 0;
         if (pAtom1->isHBatomH && pAtom2->isHBatomA)
         {
-          HBondEnergyAtomAndAtom(pAtom1, pAtom2, RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom1)), RotamerGetAtomByName(pOther, AtomGetHbDorB(pAtom2)),
+          HBondEnergyAtomAndAtom(pAtom1, pAtom2, RotamerGetAtomHbDorB(pThis, pAtom1), RotamerGetAtomHbDorB(pOther, pAtom2),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         else if (pAtom1->isHBatomA && pAtom2->isHBatomH)
         {
-          HBondEnergyAtomAndAtom(pAtom2, pAtom1, RotamerGetAtomByName(pOther, AtomGetHbDorB(pAtom2)), RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom1)),
+          HBondEnergyAtomAndAtom(pAtom2, pAtom1, RotamerGetAtomHbDorB(pOther, pAtom2), RotamerGetAtomHbDorB(pThis, pAtom1),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         energyTerms[84] += hbd;
@@ -2061,11 +2130,19 @@ int EnergyRotamerAndFixedResidueSameChain(Rotamer* pThis, Residue* pOther, doubl
   if (RotamerGetPosInChain(pThis) + 1 == ResidueGetPosInChain(pOther)) neighborCheck = 12;
   else if (RotamerGetPosInChain(pThis) - 1 == ResidueGetPosInChain(pOther)) neighborCheck = 21;
 
+  AtomBlock block;
+  BOOL useBlock = (FLAG_ENERGY_SIMD && neighborCheck == 0 && AtomBlockFill(&block, &pOther->atoms, Type_AtomBlockFilter_All) == Success) ? TRUE : FALSE;
+
   for (int i = 0; i < RotamerGetAtomCount(pThis); i++)
   {
     Atom* pAtom1 = RotamerGetAtom(pThis, i);
     if (pAtom1->isXyzValid == FALSE) continue;
     if (pAtom1->isBBAtom) continue;
+    if (useBlock)
+    {
+      AtomBlockBasicEnergy(&block, pAtom1, &energyTerms[31]);
+      if (!pAtom1->isHBatomH && !pAtom1->isHBatomA) continue;
+    }
     for (int j = 0; j < ResidueGetAtomCount(pOther); j++)
     {
       Atom* pAtom2 = ResidueGetAtom(pOther, j);
@@ -2077,26 +2154,29 @@ int EnergyRotamerAndFixedResidueSameChain(Rotamer* pThis, Residue* pOther, doubl
       else if (neighborCheck == 21) bondType = ResidueAndNextResidueInterBondConnectionCheck_charmm19(AtomGetName(pAtom2), AtomGetName(pAtom1), RotamerGetType(pThis));
       if (bondType == 12 || bondType == 13) continue;
       double att = 0, rep = 0, ele = 0, desP = 0, desH = 0;
-      VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &att);
-      VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &rep);
-      ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
-      LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desP, &desH);
-      energyTerms[31] += att;
-      energyTerms[32] += rep;
-      energyTerms[33] += ele;
-      energyTerms[34] += desP;
-      energyTerms[35] += desH;
+      if (!useBlock)
+      {
+        VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &att);
+        VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &rep);
+        ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
+        LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desP, &desH);
+        energyTerms[31] += att;
+        energyTerms[32] += rep;
+        energyTerms[33] += ele;
+        energyTerms[34] += desP;
+        energyTerms[35] += desH;
+      }
       if (distance < HB_HA_DIST_CUTOFF_MAX)
       {
         double hbtot = 0, hbd = 0, hbt = 0, hbp = 0;
         if (pAtom1->isHBatomH && pAtom2->isHBatomA)
         {
-          HBondEnergyAtomAndAtom(pAtom1, pAtom2, RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom1)), ResidueGetAtomByName(pOther, AtomGetHbDorB(pAtom2)),
+          HBondEnergyAtomAndAtom(pAtom1, pAtom2, RotamerGetAtomHbDorB(pThis, pAtom1), ResidueGetAtomHbDorB(pOther, pAtom2),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         else if (pAtom1->isHBatomA && pAtom2->isHBatomH)
         {
-          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomByName(pOther, AtomGetHbDorB(pAtom2)), RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom1)),
+          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomHbDorB(pOther, pAtom2), RotamerGetAtomHbDorB(pThis, pAtom1),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         if (pThis->posInChain - pOther->posInChain <= 2 && pThis->posInChain - pOther->posInChain >= -2)
@@ -2163,11 +2243,19 @@ int EnergyRotamerAndFixedResidueSameChain(Rotamer* pThis, Residue* pOther, doubl
 
 int EnergyRotamerAndFixedResidueDiffChain(Rotamer* pThis, Residue* pOther, double energyTerms[MAX_ENERGY_TERM])
 {
+  AtomBlock block;
+  BOOL useBlock = (FLAG_ENERGY_SIMD && AtomBlockFill(&block, &pOther->atoms, Type_AtomBlockFilter_All) == Success) ? TRUE : FALSE;
+
   for (int i = 0; i < RotamerGetAtomCount(pThis); i++)
   {
     Atom* pAtom1 = RotamerGetAtom(pThis, i);
     if (!pAtom1->isXyzValid) continue;
     if (pAtom1->isBBAtom) continue;
+    if (useBlock)
+    {
+      AtomBlockBasicEnergy(&block, pAtom1, &energyTerms[51]);
+      if (!pAtom1->isHBatomH && !pAtom1->isHBatomA) continue;
+    }
     for (int j = 0; j < ResidueGetAtomCount(pOther); j++)
     {
       Atom* pAtom2 = ResidueGetAtom(pOther, j);
@@ -2176,26 +2264,29 @@ int EnergyRotamerAndFixedResidueDiffChain(Rotamer* pThis, Residue* pOther, doubl
       if (distance > ENERGY_DISTANCE_CUTOFF) continue;
       double att = 0, rep = 0, ele = 0, desP = 0, desH = 0;
       int bondType = 15;
-      VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &att);
-      VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &rep);
-      ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
-      LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desP, &desH);
-      energyTerms[51] += att;
-      energyTerms[52] += rep;
-      energyTerms[53] += ele;
-      energyTerms[54] += desP;
-      energyTerms[55] += desH;
+      if (!useBlock)
+      {
+        VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &att);
+        VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &rep);
+        ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
+        LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desP, &desH);
+        energyTerms[51] += att;
+        energyTerms[52] += rep;
+        energyTerms[53] += ele;
+        energyTerms[54] += desP;
+        energyTerms[55] += desH;
+      }
       if (distance < HB_HA_DIST_CUTOFF_MAX)
       {
         double hbtot = 0, hbd = 0, hbt = 0, hbp = 0;
         if (pAtom1->isHBatomH && pAtom2->isHBatomA)
         {
-          HBondEnergyAtomAndAtom(pAtom1, pAtom2, RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom1)), ResidueGetAtomByName(pOther, AtomGetHbDorB(pAtom2)),
+          HBondEnergyAtomAndAtom(pAtom1, pAtom2, RotamerGetAtomHbDorB(pThis, pAtom1), ResidueGetAtomHbDorB(pOther, pAtom2),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         else if (pAtom1->isHBatomA && pAtom2->isHBatomH)
         {
-          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomByName(pOther, AtomGetHbDorB(pAtom2)), RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom1)),
+          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomHbDorB(pOther, pAtom2), RotamerGetAtomHbDorB(pThis, pAtom1),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         /*if(pAtom1->isBBAtom == TRUE && pAtom2->isBBAtom == TRUE){
@@ -2256,11 +2347,19 @@ int EnergyRotamerAndFixedResidueDiffChain(Rotamer* pThis, Residue* pOther, doubl
 
 int EnergyRotamerAndFixedLigResidue(Rotamer* pThis, Residue* pLigand, double energyTerms[MAX_ENERGY_TERM])
 {
+  AtomBlock block;
+  BOOL useBlock = (FLAG_ENERGY_SIMD && AtomBlockFill(&block, &pLigand->atoms, Type_AtomBlockFilter_All) == Success) ? TRUE : FALSE;
+
   for (int i = 0; i < RotamerGetAtomCount(pThis); i++)
   {
     Atom* pAtom1 = RotamerGetAtom(pThis, i);
     if (pAtom1->isXyzValid == FALSE) continue;
     if (pAtom1->isBBAtom) continue;
+    if (useBlock)
+    {
+      AtomBlockBasicEnergy(&block, pAtom1, &energyTerms[71]);
+      if (!pAtom1->isHBatomH && !pAtom1->isHBatomA) continue;
+    }
     for (int j = 0; j < ResidueGetAtomCount(pLigand); j++)
     {
       Atom* pAtom2 = ResidueGetAtom(pLigand, j);
@@ -2270,26 +2369,29 @@ int EnergyRotamerAndFixedLigResidue(Rotamer* pThis, Residue* pLigand, double ene
       if (distance > ENERGY_DISTANCE_CUTOFF) continue;
       double att = 0, rep = 0, ele = 0, desP = 0, desH = 0;
       int bondType = 15;
-      VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &att);
-      VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &rep);
-      ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
-      LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desP, &desH);
-      energyTerms[71] += att;
-      energyTerms[72] += rep;
-      energyTerms[73] += ele;
-      energyTerms[74] += desP;
-      energyTerms[75] += desH;
+      if (!useBlock)
+      {
+        VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &att);
+        VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &rep);
+        ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
+        LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desP, &desH);
+        energyTerms[71] += att;
+        energyTerms[72] += rep;
+        energyTerms[73] += ele;
+        energyTerms[74] += desP;
+        energyTerms[75] += desH;
+      }
       if (distance < HB_HA_DIST_CUTOFF_MAX)
       {
         double hbtot = 0, hbd = 0, hbt = 0, hbp = 0;
         if (pAtom1->isHBatomH && pAtom2->isHBatomA)
         {
-          HBondEnergyAtomAndAtom(pAtom1, pAtom2, RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom1)), ResidueGetAtomByName(pLigand, AtomGetHbDorB(pAtom2)),
+          HBondEnergyAtomAndAtom(pAtom1, pAtom2, RotamerGetAtomHbDorB(pThis, pAtom1), ResidueGetAtomHbDorB(pLigand, pAtom2),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         else if (pAtom1->isHBatomA && pAtom2->isHBatomH)
         {
-          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomByName(pLigand, AtomGetHbDorB(pAtom2)), RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom1)),
+          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomHbDorB(pLigand, pAtom2), RotamerGetAtomHbDorB(pThis, pAtom1),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         //if(pAtom1->isBBAtom == FALSE && pAtom2->isBBAtom == FALSE){
@@ -2313,10 +2415,18 @@ int EnergyRotamerAndFixedLigResidue(Rotamer* pThis, Residue* pLigand, double ene
 
 int EnergyLigRotamerAndFixedResidue(Rotamer* pThis, Residue* pOther, double energyTerms[MAX_ENERGY_TERM])
 {
+  AtomBlock block;
+  BOOL useBlock = (FLAG_ENERGY_SIMD && AtomBlockFill(&block, &pOther->atoms, Type_AtomBlockFilter_All) == Success) ? TRUE : FALSE;
+
   for (int i = 0; i < RotamerGetAtomCount(pThis); i++)
   {
     Atom* pAtom1 = RotamerGetAtom(pThis, i);
     if (pAtom1->isXyzValid == FALSE) continue;
+    if (useBlock)
+    {
+      AtomBlockBasicEnergy(&block, pAtom1, &energyTerms[71]);
+      if (!pAtom1->isHBatomH && !pAtom1->isHBatomA) continue;
+    }
     for (int j = 0; j < ResidueGetAtomCount(pOther); j++)
     {
       Atom* pAtom2 = ResidueGetAtom(pOther, j);
@@ -2325,26 +2435,29 @@ int EnergyLigRotamerAndFixedResidue(Rotamer* pThis, Residue* pOther, double ener
       if (distance > ENERGY_DISTANCE_CUTOFF) continue;
       double att = 0, rep = 0, ele = 0, desP = 0, desH = 0;
       int bondType = 15;
-      VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &att);
-      VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &rep);
-      ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
-      LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desP, &desH);
-      energyTerms[71] += att;
-      energyTerms[72] += rep;
-      energyTerms[73] += ele;
-      energyTerms[74] += desP;
-      energyTerms[75] += desH;
+      if (!useBlock)
+      {
+        VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &att);
+        VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &rep);
+        ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
+        LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desP, &desH);
+        energyTerms[71] += att;
+        energyTerms[72] += rep;
+        energyTerms[73] += ele;
+        energyTerms[74] += desP;
+        energyTerms[75] += desH;
+      }
       if (distance < HB_HA_DIST_CUTOFF_MAX)
       {
         double hbtot = 0, hbd = 0, hbt = 0, hbp = 0;
         if (pAtom1->isHBatomH && pAtom2->isHBatomA)
         {
-          HBondEnergyAtomAndAtom(pAtom1, pAtom2, RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom1)), ResidueGetAtomByName(pOther, AtomGetHbDorB(pAtom2)),
+          HBondEnergyAtomAndAtom(pAtom1, pAtom2, RotamerGetAtomHbDorB(pThis, pAtom1), ResidueGetAtomHbDorB(pOther, pAtom2),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         else if (pAtom1->isHBatomA && pAtom2->isHBatomH)
         {
-          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomByName(pOther, AtomGetHbDorB(pAtom2)), RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom1)),
+          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomHbDorB(pOther, pAtom2), RotamerGetAtomHbDorB(pThis, pAtom1),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         if (pAtom1->isBBAtom == FALSE && pAtom2->isBBAtom == FALSE)
@@ -2373,11 +2486,19 @@ int EnergyRotamerAndDesignResidueSameChain(Rotamer* pThis, Residue* pOther, doub
   if (RotamerGetPosInChain(pThis) + 1 == ResidueGetPosInChain(pOther)) neighborCheck = 12;
   else if (RotamerGetPosInChain(pThis) - 1 == ResidueGetPosInChain(pOther)) neighborCheck = 21;
 
+  AtomBlock block;
+  BOOL useBlock = (FLAG_ENERGY_SIMD && neighborCheck == 0 && AtomBlockFill(&block, &pOther->atoms, Type_AtomBlockFilter_BackBone) == Success) ? TRUE : FALSE;
+
   for (int i = 0;i < RotamerGetAtomCount(pThis);i++)
   {
     Atom* pAtom1 = RotamerGetAtom(pThis, i);
     if (pAtom1->isXyzValid == FALSE) continue;
     if (pAtom1->isBBAtom) continue;
+    if (useBlock)
+    {
+      AtomBlockBasicEnergy(&block, pAtom1, &energyTerms[31]);
+      if (!pAtom1->isHBatomH && !pAtom1->isHBatomA) continue;
+    }
     for (int j = 0;j < ResidueGetAtomCount(pOther);j++)
     {
       Atom* pAtom2 = ResidueGetAtom(pOther, j);
@@ -2390,26 +2511,29 @@ int EnergyRotamerAndDesignResidueSameChain(Rotamer* pThis, Residue* pOther, doub
       else if (neighborCheck == 21) bondType = ResidueAndNextResidueInterBondConnectionCheck_charmm19(AtomGetName(pAtom2), AtomGetName(pAtom1), RotamerGetType(pThis));
       if (bondType == 12 || bondType == 13) continue;
       double att = 0, rep = 0, ele = 0, desP = 0, desH = 0;
-      VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &att);
-      VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &rep);
-      ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
-      LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desP, &desH);
-      energyTerms[31] += att;
-      energyTerms[32] += rep;
-      energyTerms[33] += ele;
-      energyTerms[34] += desP;
-      energyTerms[35] += desH;
+      if (!useBlock)
+      {
+        VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &att);
+        VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &rep);
+        ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
+        LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desP, &desH);
+        energyTerms[31] += att;
+        energyTerms[32] += rep;
+        energyTerms[33] += ele;
+        energyTerms[34] += desP;
+        energyTerms[35] += desH;
+      }
       if (distance < HB_HA_DIST_CUTOFF_MAX)
       {
         double hbtot = 0, hbd = 0, hbt = 0, hbp = 0;
         if (pAtom1->isHBatomH && pAtom2->isHBatomA)
         {
-          HBondEnergyAtomAndAtom(pAtom1, pAtom2, RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom1)), ResidueGetAtomByName(pOther, AtomGetHbDorB(pAtom2)),
+          HBondEnergyAtomAndAtom(pAtom1, pAtom2, RotamerGetAtomHbDorB(pThis, pAtom1), ResidueGetAtomHbDorB(pOther, pAtom2),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         else if (pAtom1->isHBatomA && pAtom2->isHBatomH)
         {
-          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomByName(pOther, AtomGetHbDorB(pAtom2)), RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom1)),
+          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomHbDorB(pOther, pAtom2), RotamerGetAtomHbDorB(pThis, pAtom1),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         if (pThis->posInChain - pOther->posInChain <= 2 && pThis->posInChain - pOther->posInChain >= -2)
@@ -2432,11 +2556,19 @@ int EnergyRotamerAndDesignResidueSameChain(Rotamer* pThis, Residue* pOther, doub
 
 int EnergyRotamerAndDesignResidueDiffChain(Rotamer* pThis, Residue* pOther, double energyTerms[MAX_ENERGY_TERM])
 {
+  AtomBlock block;
+  BOOL useBlock = (FLAG_ENERGY_SIMD && AtomBlockFill(&block, &pOther->atoms, Type_AtomBlockFilter_BackBone) == Success) ? TRUE : FALSE;
+
   for (int i = 0; i < RotamerGetAtomCount(pThis); i++)
   {
     Atom* pAtom1 = RotamerGetAtom(pThis, i);
     if (!pAtom1->isXyzValid) continue;
     if (pAtom1->isBBAtom) continue;
+    if (useBlock)
+    {
+      AtomBlockBasicEnergy(&block, pAtom1, &energyTerms[51]);
+      if (!pAtom1->isHBatomH && !pAtom1->isHBatomA) continue;
+    }
     for (int j = 0; j < ResidueGetAtomCount(pOther); j++)
     {
       Atom* pAtom2 = ResidueGetAtom(pOther, j);
@@ -2446,26 +2578,29 @@ int EnergyRotamerAndDesignResidueDiffChain(Rotamer* pThis, Residue* pOther, doub
       if (distance > ENERGY_DISTANCE_CUTOFF) continue;
       double att = 0, rep = 0, ele = 0, desP = 0, desH = 0;
       int bondType = 15;
-      VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &att);
-      VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &rep);
-      ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
-      LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desP, &desH);
-      energyTerms[51] += att;
-      energyTerms[52] += rep;
-      energyTerms[53] += ele;
-      energyTerms[54] += desP;
-      energyTerms[55] += desH;
+      if (!useBlock)
+      {
+        VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &att);
+        VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &rep);
+        ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
+        LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desP, &desH);
+        energyTerms[51] += att;
+        energyTerms[52] += rep;
+        energyTerms[53] += ele;
+        energyTerms[54] += desP;
+        energyTerms[55] += desH;
+      }
       if (distance < HB_HA_DIST_CUTOFF_MAX)
       {
         double hbtot = 0, hbd = 0, hbt = 0, hbp = 0;
         if (pAtom1->isHBatomH && pAtom2->isHBatomA)
         {
-          HBondEnergyAtomAndAtom(pAtom1, pAtom2, RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom1)), ResidueGetAtomByName(pOther, AtomGetHbDorB(pAtom2)),
+          HBondEnergyAtomAndAtom(pAtom1, pAtom2, RotamerGetAtomHbDorB(pThis, pAtom1), ResidueGetAtomHbDorB(pOther, pAtom2),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         else if (pAtom1->isHBatomA && pAtom2->isHBatomH)
         {
-          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomByName(pOther, AtomGetHbDorB(pAtom2)), RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom1)),
+          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomHbDorB(pOther, pAtom2), RotamerGetAtomHbDorB(pThis, pAtom1),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         energyTerms[64] += hbd;
@@ -2483,11 +2618,19 @@ int EnergyRotamerAndDesignResidueDiffChain(Rotamer* pThis, Residue* pOther, doub
 
 int EnergyLigRotamerAndDesignResidue(Rotamer* pThis, Residue* pOther, double energyTerms[MAX_ENERGY_TERM])
 {
+  AtomBlock block;
+  BOOL useBlock = (FLAG_ENERGY_SIMD && AtomBlockFill(&block, &pOther->atoms, Type_AtomBlockFilter_BackBone) == Success) ? TRUE : FALSE;
+
   for (int i = 0; i < RotamerGetAtomCount(pThis); i++)
   {
     Atom* pAtom1 = RotamerGetAtom(pThis, i);
     if (pAtom1->isXyzValid == FALSE) continue;
     if (pAtom1->isBBAtom) continue;
+    if (useBlock)
+    {
+      AtomBlockBasicEnergy(&block, pAtom1, &energyTerms[71]);
+      if (!pAtom1->isHBatomH && !pAtom1->isHBatomA) continue;
+    }
     for (int j = 0; j < ResidueGetAtomCount(pOther); j++)
     {
       Atom* pAtom2 = ResidueGetAtom(pOther, j);
@@ -2497,26 +2640,29 @@ int EnergyLigRotamerAndDesignResidue(Rotamer* pThis, Residue* pOther, double ene
       if (distance > ENERGY_DISTANCE_CUTOFF) continue;
       double att = 0, rep = 0, ele = 0, desP = 0, desH = 0;
       int bondType = 15;
-      VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &att);
-      VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &rep);
-      ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
-      LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desP, &desH);
-      energyTerms[71] += att;
-      energyTerms[72] += rep;
-      energyTerms[73] += ele;
-      energyTerms[74] += desP;
-      energyTerms[75] += desH;
+      if (!useBlock)
+      {
+        VdwAttEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &att);
+        VdwRepEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &rep);
+        ElecEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &ele);
+        LKDesolvationEnergyAtomAndAtom(pAtom1, pAtom2, distance, bondType, &desP, &desH);
+        energyTerms[71] += att;
+        energyTerms[72] += rep;
+        energyTerms[73] += ele;
+        energyTerms[74] += desP;
+        energyTerms[75] += desH;
+      }
       if (distance < HB_HA_DIST_CUTOFF_MAX)
       {
         double hbtot = 0, hbd = 0, hbt = 0, hbp = 0;
         if (pAtom1->isHBatomH && pAtom2->isHBatomA)
         {
-          HBondEnergyAtomAndAtom(pAtom1, pAtom2, RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom1)), ResidueGetAtomByName(pOther, AtomGetHbDorB(pAtom2)),
+          HBondEnergyAtomAndAtom(pAtom1, pAtom2, RotamerGetAtomHbDorB(pThis, pAtom1), ResidueGetAtomHbDorB(pOther, pAtom2),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         else if (pAtom1->isHBatomA && pAtom2->isHBatomH)
         {
-          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomByName(pOther, AtomGetHbDorB(pAtom2)), RotamerGetAtomByName(pThis, AtomGetHbDorB(pAtom1)),
+          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomHbDorB(pOther, pAtom2), RotamerGetAtomHbDorB(pThis, pAtom1),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         energyTerms[84] += hbd;
@@ -2719,12 +2865,12 @@ int EnergyResidueAndResidueSameChain(Residue* pThis, Residue* pOther, double ene
         double hbtot = 0, hbd = 0, hbt = 0, hbp = 0;
         if (pAtom1->isHBatomH && pAtom2->isHBatomA)
         {
-          HBondEnergyAtomAndAtom(pAtom1, pAtom2, ResidueGetAtomByName(pThis, AtomGetHbDorB(pAtom1)), ResidueGetAtomByName(pOther, AtomGetHbDorB(pAtom2)),
+          HBondEnergyAtomAndAtom(pAtom1, pAtom2, ResidueGetAtomHbDorB(pThis, pAtom1), ResidueGetAtomHbDorB(pOther, pAtom2),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         else if (pAtom1->isHBatomA && pAtom2->isHBatomH)
         {
-          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomByName(pOther, AtomGetHbDorB(pAtom2)), ResidueGetAtomByName(pThis, AtomGetHbDorB(pAtom1)),
+          HBondEnergyAtomAndAtom(pAtom2, pAtom1, ResidueGetAtomHbDorB(pOther, pAtom2), ResidueGetAtomHbDorB(pThis, pAtom1),
             distance, bondType, &hbtot, &hbd, &hbt, &hbp);
         }
         if (pThis->posInChain - pOther->posInChain <= 2 && pThis->posInChain - pOther->posInChain >= -2)
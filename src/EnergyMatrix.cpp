@@ -19,12 +19,22 @@ IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "EnergyMatrix.h"
 #include <string.h>
 #include <time.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 extern char DES_CHAINS[MAX_LEN_ONE_LINE_CONTENT + 1];
 extern BOOL FLAG_MONOMER;
 extern BOOL FLAG_PPI;
 extern BOOL FLAG_PROT_LIG;
 extern BOOL FLAG_ENZYME;
+extern int NTHREADS;
 
 int EnergyMatrixBlockCreate(EnergyMatrixBlock* pThis)
 {
@@ -33,6 +43,7 @@ int EnergyMatrixBlockCreate(EnergyMatrixBlock* pThis)
   pThis->RotamerCountSiteI = 0;
   pThis->RotamerCountSiteK = 0;
   pThis->energyIK = NULL;
+  pThis->isMapped = FALSE;
   return Success;
 }
 
@@ -41,9 +52,10 @@ void EnergyMatrixBlockDestroy(EnergyMatrixBlock* pThis)
 {
   if (pThis->energyIK != NULL)
   {
-    free(pThis->energyIK);
+    if (pThis->isMapped == FALSE) free(pThis->energyIK);
     pThis->energyIK = NULL;
   }
+  pThis->isMapped = FALSE;
 }
 
 
@@ -77,7 +89,7 @@ int EnergyMatrixBlockGenerate(EnergyMatrixBlock* pThis, Structure* pStructure, i
   pThis->DesignSiteK = designSiteK;
   pThis->RotamerCountSiteI = RotamerSetGetCount(DesignSiteGetRotamers(pDesignSiteI));
   pThis->RotamerCountSiteK = RotamerSetGetCount(DesignSiteGetRotamers(pDesignSiteK));
-  pThis->energyIK = (double*)malloc(sizeof(double) * pThis->RotamerCountSiteI * pThis->RotamerCountSiteK);
+  pThis->energyIK = (double*)calloc(pThis->RotamerCountSiteI * pThis->RotamerCountSiteK, sizeof(double));
 
   if (designSiteI == designSiteK)
   {
@@ -172,7 +184,7 @@ int EnergyMatrixBlockGenerate(EnergyMatrixBlock* pThis, Structure* pStructure, i
 
       EnergyTermWeighting(energyTerms);
       *pEnergy += energyTerms[0];
-      fprintf(outputFile, "%f %d %d %d %d\n", *pEnergy, designSiteI, j, designSiteK, j);
+      if (outputFile != NULL) fprintf(outputFile, "%f %d %d %d %d\n", *pEnergy, designSiteI, j, designSiteK, j);
       RotamerExtract(pRotamerIJ);
     }
     return Success;
@@ -194,6 +206,14 @@ int EnergyMatrixBlockGenerate(EnergyMatrixBlock* pThis, Structure* pStructure, i
       {
         EnergyRotamerAndRotamerSameChain(pRotamerIJ, pRotamerKS, energyTerms);
       }
+      else if (ChainGetType(StructureGetChain(pStructure, pDesignSiteK->chnNdx)) == Type_Chain_SmallMol)
+      {
+        EnergyRotamerAndLigandRotamer(pRotamerIJ, pRotamerKS, energyTerms);
+      }
+      else if (ChainGetType(StructureGetChain(pStructure, pDesignSiteI->chnNdx)) == Type_Chain_SmallMol)
+      {
+        EnergyRotamerAndLigandRotamer(pRotamerKS, pRotamerIJ, energyTerms);
+      }
       else
       {
         EnergyRotamerAndRotamerDiffChain(pRotamerIJ, pRotamerKS, energyTerms);
@@ -203,7 +223,7 @@ int EnergyMatrixBlockGenerate(EnergyMatrixBlock* pThis, Structure* pStructure, i
       {
         *pEnergy += energyTerms[a];
       }
-      fprintf(outputFile, "%f %d %d %d %d\n", *pEnergy, designSiteI, j, designSiteK, s);
+      if (outputFile != NULL) fprintf(outputFile, "%f %d %d %d %d\n", *pEnergy, designSiteI, j, designSiteK, s);
       RotamerExtract(pRotamerKS);
     }
     RotamerExtract(pRotamerIJ);
@@ -216,6 +236,8 @@ int EnergyMatrixCreate(EnergyMatrix* pThis)
 {
   pThis->designSiteCount = 0;
   pThis->blocks = NULL;
+  pThis->mappedData = NULL;
+  pThis->mappedSize = 0;
   return Success;
 }
 
@@ -232,6 +254,16 @@ void EnergyMatrixDestroy(EnergyMatrix* pThis)
   }
   free(pThis->blocks);
   pThis->blocks = NULL;
+  if (pThis->mappedData != NULL)
+  {
+#ifdef _WIN32
+    free(pThis->mappedData);
+#else
+    munmap(pThis->mappedData, (size_t)pThis->mappedSize);
+#endif
+    pThis->mappedData = NULL;
+    pThis->mappedSize = 0;
+  }
 }
 
 
@@ -257,6 +289,10 @@ int EnergyMatrixRead(EnergyMatrix* pThis, char* filepath)
 {
   int result = Success;
   char errMsg[MAX_LEN_ERR_MSG + 1];
+  if (EnergyMatrixFileIsBinary(filepath))
+  {
+    return EnergyMatrixReadBinary(pThis, filepath);
+  }
   FILE* pFile = fopen(filepath, "r");
   if (!pFile)
   {
@@ -379,6 +415,17 @@ int EnergyMatrixCheck(char* matrixFile)
   int result = Success;
   char errMsg[MAX_LEN_ERR_MSG + 1];
 
+  if (EnergyMatrixFileIsBinary(matrixFile))
+  {
+    // header and block index are validated while mapping
+    EnergyMatrix matrix;
+    EnergyMatrixCreate(&matrix);
+    result = EnergyMatrixReadBinary(&matrix, matrixFile);
+    if (!FAILED(result)) printf("all blocks of energy matrix file %s are okay\n", matrixFile);
+    EnergyMatrixDestroy(&matrix);
+    return result;
+  }
+
   siteCount = 0;
   for (i = 0; i < 1000; i++) rotamerCount[i] = 0;
 
@@ -517,6 +564,208 @@ int EnergyMatrixWrite(EnergyMatrix* pThis, char* filepath)
 }
 
 
+BOOL EnergyMatrixFileIsBinary(char* filepath)
+{
+  char magic[8];
+  FILE* pFile = fopen(filepath, "rb");
+  if (!pFile) return FALSE;
+  size_t count = fread(magic, 1, 8, pFile);
+  fclose(pFile);
+  return (count == 8 && memcmp(magic, ENERGY_MATRIX_BINARY_MAGIC, 8) == 0) ? TRUE : FALSE;
+}
+
+
+int EnergyMatrixWriteBinary(EnergyMatrix* pThis, char* filepath)
+{
+  int result = Success;
+  char errMsg[MAX_LEN_ERR_MSG + 1];
+  FILE* pFile = fopen(filepath, "wb");
+  if (!pFile)
+  {
+    result = IOError;
+    sprintf(errMsg, "in file %s line %d, cannot write to file %s", __FILE__, __LINE__, filepath);
+    TraceError(errMsg, result);
+    return result;
+  }
+  printf("Write binary EnergyMatrix file %s\n", filepath);
+
+  int siteCount = pThis->designSiteCount;
+  EnergyMatrixFileHeader header;
+  memset(&header, 0, sizeof(EnergyMatrixFileHeader));
+  memcpy(header.magic, ENERGY_MATRIX_BINARY_MAGIC, 8);
+  header.version = ENERGY_MATRIX_BINARY_VERSION;
+  header.designSiteCount = siteCount;
+  header.blockCount = (long long)siteCount * (siteCount + 1) / 2;
+
+  // blocks follow the index in (i,k) order; every offset stays 8-byte aligned for direct mapping
+  EnergyMatrixFileBlockIndex* index = (EnergyMatrixFileBlockIndex*)calloc(header.blockCount > 0 ? header.blockCount : 1, sizeof(EnergyMatrixFileBlockIndex));
+  long long offset = sizeof(EnergyMatrixFileHeader) + sizeof(EnergyMatrixFileBlockIndex) * header.blockCount;
+  long long b = 0;
+  for (int i = 0; i < siteCount; i++)
+  {
+    for (int k = i; k < siteCount; k++)
+    {
+      EnergyMatrixBlock* pBlock = EnergyMatrixGetBlock(pThis, i, k);
+      int countI = pBlock->energyIK != NULL ? pBlock->RotamerCountSiteI : 0;
+      int countK = pBlock->energyIK != NULL ? pBlock->RotamerCountSiteK : 0;
+      index[b].designSiteI = i;
+      index[b].designSiteK = k;
+      index[b].rotamerCountSiteI = countI;
+      index[b].rotamerCountSiteK = countK;
+      index[b].offset = offset;
+      offset += sizeof(double) * (long long)countI * countK;
+      b++;
+    }
+  }
+  header.fileSize = offset;
+
+  BOOL ok = fwrite(&header, sizeof(EnergyMatrixFileHeader), 1, pFile) == 1 ? TRUE : FALSE;
+  if (ok && header.blockCount > 0)
+  {
+    ok = fwrite(index, sizeof(EnergyMatrixFileBlockIndex), (size_t)header.blockCount, pFile) == (size_t)header.blockCount ? TRUE : FALSE;
+  }
+  for (b = 0; ok && b < header.blockCount; b++)
+  {
+    size_t valueCount = (size_t)index[b].rotamerCountSiteI * index[b].rotamerCountSiteK;
+    if (valueCount == 0) continue;
+    EnergyMatrixBlock* pBlock = EnergyMatrixGetBlock(pThis, index[b].designSiteI, index[b].designSiteK);
+    ok = fwrite(pBlock->energyIK, sizeof(double), valueCount, pFile) == valueCount ? TRUE : FALSE;
+  }
+  free(index);
+  fclose(pFile);
+  if (!ok)
+  {
+    result = IOError;
+    sprintf(errMsg, "in file %s line %d, failed writing to file %s", __FILE__, __LINE__, filepath);
+    TraceError(errMsg, result);
+    return result;
+  }
+  return Success;
+}
+
+
+int EnergyMatrixReadBinary(EnergyMatrix* pThis, char* filepath)
+{
+  int result = Success;
+  char errMsg[MAX_LEN_ERR_MSG + 1];
+  void* data = NULL;
+  long long size = 0;
+
+#ifdef _WIN32
+  FILE* pFile = fopen(filepath, "rb");
+  if (!pFile)
+  {
+    result = IOError;
+    sprintf(errMsg, "in file %s line %d, cannot read file %s", __FILE__, __LINE__, filepath);
+    TraceError(errMsg, result);
+    return result;
+  }
+  fseek(pFile, 0, SEEK_END);
+  size = ftell(pFile);
+  fseek(pFile, 0, SEEK_SET);
+  data = malloc(size > 0 ? (size_t)size : 1);
+  if (fread(data, 1, (size_t)size, pFile) != (size_t)size)
+  {
+    free(data);
+    data = NULL;
+  }
+  fclose(pFile);
+#else
+  int fd = open(filepath, O_RDONLY);
+  struct stat st;
+  if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0)
+  {
+    size = st.st_size;
+    // private mapping: pages are shared with other readers of the file until a value is modified in memory
+    data = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) data = NULL;
+  }
+  if (fd >= 0) close(fd);
+#endif
+  if (data == NULL)
+  {
+    result = IOError;
+    sprintf(errMsg, "in file %s line %d, cannot read file %s", __FILE__, __LINE__, filepath);
+    TraceError(errMsg, result);
+    return result;
+  }
+
+  EnergyMatrixFileHeader* pHeader = (EnergyMatrixFileHeader*)data;
+  EnergyMatrixFileBlockIndex* index = (EnergyMatrixFileBlockIndex*)((char*)data + sizeof(EnergyMatrixFileHeader));
+  if (size < (long long)sizeof(EnergyMatrixFileHeader) || memcmp(pHeader->magic, ENERGY_MATRIX_BINARY_MAGIC, 8) != 0 ||
+    pHeader->version != ENERGY_MATRIX_BINARY_VERSION || pHeader->fileSize != size || pHeader->designSiteCount < 0 ||
+    pHeader->blockCount != (long long)pHeader->designSiteCount * (pHeader->designSiteCount + 1) / 2 ||
+    (long long)sizeof(EnergyMatrixFileHeader) + (long long)sizeof(EnergyMatrixFileBlockIndex) * pHeader->blockCount > size)
+  {
+    result = FormatError;
+    sprintf(errMsg, "in file %s line %d, file %s is not a valid version %d binary energy matrix", __FILE__, __LINE__, filepath, ENERGY_MATRIX_BINARY_VERSION);
+    TraceError(errMsg, result);
+  }
+  // every block lies after the index, inside the file, and each (i,k) pair is listed exactly once
+  long long dataStart = (long long)sizeof(EnergyMatrixFileHeader) + (long long)sizeof(EnergyMatrixFileBlockIndex) * pHeader->blockCount;
+  BOOL* seen = NULL;
+  if (result == Success)
+  {
+    seen = (BOOL*)calloc(pHeader->designSiteCount > 0 ? (size_t)pHeader->designSiteCount * pHeader->designSiteCount : 1, sizeof(BOOL));
+  }
+  for (long long b = 0; result == Success && b < pHeader->blockCount; b++)
+  {
+    EnergyMatrixFileBlockIndex* pIndex = &index[b];
+    if (pIndex->designSiteI < 0 || pIndex->designSiteI > pIndex->designSiteK || pIndex->designSiteK >= pHeader->designSiteCount ||
+      pIndex->rotamerCountSiteI < 0 || pIndex->rotamerCountSiteK < 0 || pIndex->offset < dataStart || pIndex->offset % sizeof(double) != 0 ||
+      pIndex->offset + (long long)sizeof(double) * pIndex->rotamerCountSiteI * pIndex->rotamerCountSiteK > size ||
+      seen[pIndex->designSiteI * pHeader->designSiteCount + pIndex->designSiteK] == TRUE)
+    {
+      result = FormatError;
+      sprintf(errMsg, "in file %s line %d, bad block index #%lld in binary energy matrix %s", __FILE__, __LINE__, b, filepath);
+      TraceError(errMsg, result);
+    }
+    else
+    {
+      seen[pIndex->designSiteI * pHeader->designSiteCount + pIndex->designSiteK] = TRUE;
+    }
+  }
+  free(seen);
+  if (FAILED(result))
+  {
+#ifdef _WIN32
+    free(data);
+#else
+    munmap(data, (size_t)size);
+#endif
+    return result;
+  }
+
+  printf("mapping binary energy matrix from file %s\n", filepath);
+  EnergyMatrixDestroy(pThis);
+  EnergyMatrixCreate(pThis);
+  int siteCount = pHeader->designSiteCount;
+  pThis->designSiteCount = siteCount;
+  pThis->blocks = (EnergyMatrixBlock*)malloc(sizeof(EnergyMatrixBlock) * (siteCount > 0 ? siteCount * siteCount : 1));
+  for (int i = 0; i < siteCount * siteCount; i++)
+  {
+    EnergyMatrixBlockCreate(&pThis->blocks[i]);
+  }
+  for (long long b = 0; b < pHeader->blockCount; b++)
+  {
+    EnergyMatrixBlock* pBlock = EnergyMatrixGetBlock(pThis, index[b].designSiteI, index[b].designSiteK);
+    pBlock->DesignSiteI = index[b].designSiteI;
+    pBlock->DesignSiteK = index[b].designSiteK;
+    pBlock->RotamerCountSiteI = index[b].rotamerCountSiteI;
+    pBlock->RotamerCountSiteK = index[b].rotamerCountSiteK;
+    if (index[b].rotamerCountSiteI > 0 && index[b].rotamerCountSiteK > 0)
+    {
+      pBlock->energyIK = (double*)((char*)data + index[b].offset);
+      pBlock->isMapped = TRUE;
+    }
+  }
+  pThis->mappedData = data;
+  pThis->mappedSize = size;
+
+  return Success;
+}
+
+
 EnergyMatrixBlock* EnergyMatrixGetBlock(EnergyMatrix* pThis, int designSiteI, int designSiteK)
 {
   return &pThis->blocks[designSiteI * pThis->designSiteCount + designSiteK];
@@ -715,6 +964,189 @@ int EnergyMatrixGenerate(Structure* pStructure, char* energyMatrixFilePath, int
 }
 
 
+static int JobCompareAmountDescending(const void* a, const void* b)
+{
+  double da = ((Job*)a)->computationAmount;
+  double db = ((Job*)b)->computationAmount;
+  if (da > db) return -1;
+  if (da < db) return 1;
+  return 0;
+}
+
+
+int JobSchedulerCreate(JobScheduler* pThis, Job* jobs, int jobCount, int slotCount)
+{
+  if (slotCount < 1) slotCount = 1;
+  pThis->slotCount = slotCount;
+  pThis->slots = (Slot*)malloc(sizeof(Slot) * slotCount);
+  pThis->heads = (int*)malloc(sizeof(int) * slotCount);
+  pThis->tails = (int*)malloc(sizeof(int) * slotCount);
+  for (int i = 0; i < slotCount; i++)
+  {
+    pThis->slots[i].jobs = NULL;
+    pThis->slots[i].jobCount = 0;
+    pThis->slots[i].totalComputationAmount = 0.0;
+  }
+
+  //assign the largest remaining job to the least loaded slot
+  Job* sorted = (Job*)malloc(sizeof(Job) * (jobCount > 0 ? jobCount : 1));
+  if (jobCount > 0) memcpy(sorted, jobs, sizeof(Job) * jobCount);
+  qsort(sorted, jobCount, sizeof(Job), JobCompareAmountDescending);
+  for (int i = 0; i < jobCount; i++)
+  {
+    Slot* pMinSlot = &pThis->slots[0];
+    for (int j = 1; j < slotCount; j++)
+    {
+      if (pThis->slots[j].totalComputationAmount < pMinSlot->totalComputationAmount)
+      {
+        pMinSlot = &pThis->slots[j];
+      }
+    }
+    pMinSlot->jobCount++;
+    pMinSlot->jobs = (Job*)realloc(pMinSlot->jobs, sizeof(Job) * pMinSlot->jobCount);
+    pMinSlot->jobs[pMinSlot->jobCount - 1] = sorted[i];
+    pMinSlot->totalComputationAmount += sorted[i].computationAmount;
+  }
+  free(sorted);
+
+  for (int i = 0; i < slotCount; i++)
+  {
+    pThis->heads[i] = 0;
+    pThis->tails[i] = pThis->slots[i].jobCount;
+  }
+#ifdef _OPENMP
+  omp_lock_t* locks = (omp_lock_t*)malloc(sizeof(omp_lock_t) * slotCount);
+  for (int i = 0; i < slotCount; i++) omp_init_lock(&locks[i]);
+  pThis->locks = locks;
+#else
+  pThis->locks = NULL;
+#endif
+  return Success;
+}
+
+
+void JobSchedulerDestroy(JobScheduler* pThis)
+{
+#ifdef _OPENMP
+  omp_lock_t* locks = (omp_lock_t*)pThis->locks;
+  for (int i = 0; i < pThis->slotCount; i++) omp_destroy_lock(&locks[i]);
+#endif
+  free(pThis->locks);
+  for (int i = 0; i < pThis->slotCount; i++)
+  {
+    free(pThis->slots[i].jobs);
+  }
+  free(pThis->slots);
+  free(pThis->heads);
+  free(pThis->tails);
+  pThis->slots = NULL;
+  pThis->heads = NULL;
+  pThis->tails = NULL;
+  pThis->locks = NULL;
+  pThis->slotCount = 0;
+}
+
+
+BOOL JobSchedulerNext(JobScheduler* pThis, int slotIndex, Job* pJob)
+{
+  for (int n = 0; n < pThis->slotCount; n++)
+  {
+    int s = (slotIndex + n) % pThis->slotCount;
+    BOOL found = FALSE;
+#ifdef _OPENMP
+    omp_set_lock(&((omp_lock_t*)pThis->locks)[s]);
+#endif
+    if (pThis->heads[s] < pThis->tails[s])
+    {
+      if (n == 0) *pJob = pThis->slots[s].jobs[pThis->heads[s]++];
+      else *pJob = pThis->slots[s].jobs[--pThis->tails[s]];
+      found = TRUE;
+    }
+#ifdef _OPENMP
+    omp_unset_lock(&((omp_lock_t*)pThis->locks)[s]);
+#endif
+    if (found) return TRUE;
+  }
+  return FALSE;
+}
+
+
+int EnergyMatrixGenerateInMemory(Structure* pStructure, EnergyMatrix* pMatrix, int threadCount)
+{
+  int siteCount = pStructure->desSiteCount;
+  EnergyMatrixDestroy(pMatrix);
+  EnergyMatrixCreate(pMatrix);
+  pMatrix->designSiteCount = siteCount;
+  pMatrix->blocks = (EnergyMatrixBlock*)malloc(sizeof(EnergyMatrixBlock) * (siteCount > 0 ? siteCount * siteCount : 1));
+  for (int i = 0; i < siteCount * siteCount; i++)
+  {
+    EnergyMatrixBlockCreate(&pMatrix->blocks[i]);
+  }
+
+  int jobCount = siteCount * (siteCount + 1) / 2;
+  Job* jobs = (Job*)malloc(sizeof(Job) * (jobCount > 0 ? jobCount : 1));
+  int counter = 0;
+  for (int i = 0; i < siteCount; i++)
+  {
+    for (int k = i; k < siteCount; k++)
+    {
+      int rotamerCountOnSiteI = RotamerSetGetCount(&pStructure->designSites[i].rots);
+      int rotamerCountOnSiteK = RotamerSetGetCount(&pStructure->designSites[k].rots);
+      jobs[counter].computationAmount = i == k ? rotamerCountOnSiteI : (double)rotamerCountOnSiteI * rotamerCountOnSiteK;
+      jobs[counter].designSiteI = i;
+      jobs[counter].designSiteK = k;
+      jobs[counter].rotamerPartitionIndexOnSiteI = 0;
+      jobs[counter].rotamerPartitionIndexOnSiteK = 0;
+      counter++;
+    }
+  }
+
+#ifndef _OPENMP
+  threadCount = 1;
+#endif
+  if (threadCount > jobCount) threadCount = jobCount;
+  if (threadCount < 1) threadCount = 1;
+  JobScheduler scheduler;
+  JobSchedulerCreate(&scheduler, jobs, jobCount, threadCount);
+  printf("computing energy matrix of %d blocks with %d thread(s)\n", jobCount, threadCount);
+
+  int result = Success;
+#pragma omp parallel num_threads(threadCount)
+  {
+    int slotIndex = 0;
+#ifdef _OPENMP
+    slotIndex = omp_get_thread_num();
+#endif
+    Structure view;
+    Structure* pView = pStructure;
+    if (threadCount > 1)
+    {
+      StructureDesignViewCreate(&view, pStructure);
+      pView = &view;
+    }
+    Job job;
+    while (JobSchedulerNext(&scheduler, slotIndex, &job))
+    {
+      int jobResult = EnergyMatrixBlockGenerate(EnergyMatrixGetBlock(pMatrix, job.designSiteI, job.designSiteK),
+        pView, job.designSiteI, job.designSiteK, NULL);
+      if (FAILED(jobResult))
+      {
+#pragma omp critical (EnergyMatrixResult)
+        result = jobResult;
+      }
+    }
+    if (threadCount > 1)
+    {
+      StructureDesignViewDestroy(&view);
+    }
+  }
+
+  JobSchedulerDestroy(&scheduler);
+  free(jobs);
+  return result;
+}
+
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //split the whole job of energy matrix computation into small jobs for parallel computing
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -1532,8 +1964,9 @@ int SelfEnergyGenerate(Structure* pStructure, char* filepath)
 
 int SelfEnergyGenerate2(Structure* pStruct, AAppTable* pAAppTable, RamaTable* pRamaTable, char* filepath)
 {
-  FILE* fileOut = fopen(filepath, "w");
-  if (fileOut == NULL)
+  // the self energies are kept on the rotamers; the text file is only written if a path is given
+  FILE* fileOut = NULL;
+  if (filepath != NULL && (fileOut = fopen(filepath, "w")) == NULL)
   {
     char errMsg[MAX_LEN_ONE_LINE_CONTENT + 1];
     sprintf(errMsg, "in file %s line %d, cannot write to file %s", __FILE__, __LINE__, filepath);
@@ -1541,14 +1974,47 @@ int SelfEnergyGenerate2(Structure* pStruct, AAppTable* pAAppTable, RamaTable* pR
     return IOError;
   }
 
+  int nthreads = NTHREADS;
+#ifndef _OPENMP
+  nthreads = 1;
+#endif
+
+  // only residues near the rotamers of a design site are visited, found with a cell grid of residue bounding spheres
+  ResidueGrid grid;
+  ResidueGridCreate(&grid);
+  ResidueGridBuild(&grid, pStruct, ENERGY_DISTANCE_CUTOFF);
+  IntArray* pNbrs = (IntArray*)malloc(sizeof(IntArray) * StructureGetChainCount(pStruct));
+  for (int a = 0; a < StructureGetChainCount(pStruct); a++)
+  {
+    IntArrayCreate(&pNbrs[a], 0);
+  }
+
   for (int i = 0; i < StructureGetDesignSiteCount(pStruct); i++)
   {
     DesignSite* pSiteI = StructureGetDesignSite(pStruct, i);
     RotamerSet* pSetI = DesignSiteGetRotamers(pSiteI);
     Chain* pChainI = StructureGetChain(pStruct, pSiteI->chnNdx);
+    XYZ siteCenter;
+    double siteRadius;
+    RotamerSetGetBoundingSphere(pSetI, &siteCenter, &siteRadius);
+    ResidueGridFindNeighbors(&grid, &siteCenter, siteRadius, ENERGY_DISTANCE_CUTOFF, pNbrs);
+    // the site itself is always visited for the intra-rotamer energy
+    IntArray* pSiteChainNbrs = &pNbrs[pSiteI->chnNdx];
+    if (IntArrayFind(pSiteChainNbrs, pSiteI->resNdx) == -1)
+    {
+      int pos = 0;
+      while (pos < IntArrayGetLength(pSiteChainNbrs) && IntArrayGet(pSiteChainNbrs, pos) < pSiteI->resNdx) pos++;
+      IntArrayInsert(pSiteChainNbrs, pos, pSiteI->resNdx);
+    }
+    // rotamers of a site only read the shared structure, so they are computed in parallel;
+    // each one accumulates into its own energy terms and the file is written afterwards in rotamer order
+#pragma omp parallel for schedule(dynamic, 4) num_threads(nthreads)
     for (int j = 0; j < RotamerSetGetCount(pSetI); j++)
     {
       Rotamer* pRotIJ = RotamerSetGet(pSetI, j);
+      XYZ rotCenter;
+      double rotRadius;
+      RotamerGetBoundingSphere(pRotIJ, &rotCenter, &rotRadius);
       RotamerRestore(pRotIJ, pSetI);
       double energyTerms[MAX_ENERGY_TERM] = { 0 };
       double energyTermsBind[MAX_ENERGY_TERM] = { 0 };
@@ -1559,8 +2025,11 @@ int SelfEnergyGenerate2(Structure* pStruct, AAppTable* pAAppTable, RamaTable* pR
           Chain* pChainA = StructureGetChain(pStruct, a);
           if (a == pSiteI->chnNdx)
           { // same chain
-            for (int b = 0; b < ChainGetResidueCount(pChainA); b++)
+            for (int n = 0; n < IntArrayGetLength(&pNbrs[a]); n++)
             {
+              int b = IntArrayGet(&pNbrs[a], n);
+              if ((a != pSiteI->chnNdx || b != pSiteI->resNdx)
+                && ResidueGridSphereMayInteract(&grid, ResidueGridGetSerial(&grid, a, b), &rotCenter, rotRadius, ENERGY_DISTANCE_CUTOFF) == FALSE) continue;
               Residue* pResAB = ChainGetResidue(pChainA, b);
               if (b == pSiteI->resNdx)
               { // same position -> same rotamer
@@ -1598,8 +2067,11 @@ int SelfEnergyGenerate2(Structure* pStruct, AAppTable* pAAppTable, RamaTable* pR
               || ChainGetType(pChainA) == Type_Chain_RNA
               || ChainGetType(pChainA) == Type_Chain_Water)
             {
-              for (int b = 0; b < ChainGetResidueCount(pChainA); b++)
+              for (int n = 0; n < IntArrayGetLength(&pNbrs[a]); n++)
               {
+                int b = IntArrayGet(&pNbrs[a], n);
+                if ((a != pSiteI->chnNdx || b != pSiteI->resNdx)
+                  && ResidueGridSphereMayInteract(&grid, ResidueGridGetSerial(&grid, a, b), &rotCenter, rotRadius, ENERGY_DISTANCE_CUTOFF) == FALSE) continue;
                 Residue* pResAB = ChainGetResidue(pChainA, b);
                 if (pResAB->desType == Type_DesType_Fixed)
                 {
@@ -1632,8 +2104,11 @@ int SelfEnergyGenerate2(Structure* pStruct, AAppTable* pAAppTable, RamaTable* pR
             }
             else if (ChainGetType(pChainA) == Type_Chain_SmallMol)
             { // chainA is small molecule
-              for (int b = 0; b < ChainGetResidueCount(pChainA); b++)
+              for (int n = 0; n < IntArrayGetLength(&pNbrs[a]); n++)
               {
+                int b = IntArrayGet(&pNbrs[a], n);
+                if ((a != pSiteI->chnNdx || b != pSiteI->resNdx)
+                  && ResidueGridSphereMayInteract(&grid, ResidueGridGetSerial(&grid, a, b), &rotCenter, rotRadius, ENERGY_DISTANCE_CUTOFF) == FALSE) continue;
                 Residue* pResidueAB = ChainGetResidue(pChainA, b);
                 if (pResidueAB->desType == Type_DesType_Fixed)
                 {
@@ -1661,8 +2136,11 @@ int SelfEnergyGenerate2(Structure* pStruct, AAppTable* pAAppTable, RamaTable* pR
           }
           else
           { // different chain
-            for (int b = 0; b < ChainGetResidueCount(pChainA); b++)
+            for (int n = 0; n < IntArrayGetLength(&pNbrs[a]); n++)
             {
+              int b = IntArrayGet(&pNbrs[a], n);
+              if ((a != pSiteI->chnNdx || b != pSiteI->resNdx)
+                && ResidueGridSphereMayInteract(&grid, ResidueGridGetSerial(&grid, a, b), &rotCenter, rotRadius, ENERGY_DISTANCE_CUTOFF) == FALSE) continue;
               Residue* pResAB = ChainGetResidue(pChainA, b);
               if (pResAB->desType == Type_DesType_Fixed)
               {
@@ -1685,11 +2163,21 @@ int SelfEnergyGenerate2(Structure* pStruct, AAppTable* pAAppTable, RamaTable* pR
       pRotIJ->selfEnergy += energyTerms[0];
       EnergyTermWeighting(energyTermsBind);
       pRotIJ->selfEnergyBin += energyTermsBind[0];
-      fprintf(fileOut, "%d %d %f %f\n", i, j, pRotIJ->selfEnergy, pRotIJ->selfEnergyBin);
       RotamerExtract(pRotIJ);
     }
+    for (int j = 0; fileOut != NULL && j < RotamerSetGetCount(pSetI); j++)
+    {
+      Rotamer* pRotIJ = RotamerSetGet(pSetI, j);
+      fprintf(fileOut, "%d %d %f %f\n", i, j, pRotIJ->selfEnergy, pRotIJ->selfEnergyBin);
+    }
   }
-  fclose(fileOut);
+  if (fileOut != NULL) fclose(fileOut);
+  for (int a = 0; a < StructureGetChainCount(pStruct); a++)
+  {
+    IntArrayDestroy(&pNbrs[a]);
+  }
+  free(pNbrs);
+  ResidueGridDestroy(&grid);
 
   return Success;
 }
@@ -1720,7 +2208,14 @@ int SelfEnergyReadAndCheck(Structure* pStruct, RotamerList* pList, char* filepat
     pRotamer->selfEnergy = selfTot;
     pRotamer->selfEnergyBin = selfBin;
   }
+  fclose(pFile);
 
+  return SelfEnergyCheck(pStruct, pList);
+}
+
+
+int SelfEnergyCheck(Structure* pStruct, RotamerList* pList)
+{
   for (int i = 0; i < StructureGetDesignSiteCount(pStruct); i++)
   {
     DesignSite* pSite = StructureGetDesignSite(pStruct, i);
@@ -1760,7 +2255,18 @@ int SelfEnergyReadAndCheck(Structure* pStruct, RotamerList* pList, char* filepat
       }
     }
   }
-  fclose(pFile);
+
+  for (int i = 0; i < pList->desSiteCount; i++)
+  {
+    pList->remainRotamerCount[i] = 0;
+    for (int j = 0; j < pList->rotamerCount[i]; j++)
+    {
+      if (pList->remainFlag[i][j])
+      {
+        pList->remainRotamerCount[i]++;
+      }
+    }
+  }
 
   return Success;
 }
@@ -1809,7 +2315,7 @@ int RotamerListCreateFromEnergyMatrix(RotamerList* pThis, EnergyMatrix* pEnergyM
       pThis->remainFlag[i][j] = TRUE;
     }
   }
-  pThis->rotamerCount = (int*)malloc(sizeof(int) * pThis->desSiteCount);
+  pThis->remainRotamerCount = (int*)malloc(sizeof(int) * pThis->desSiteCount);
   for (int i = 0;i < pThis->desSiteCount;i++)
   {
     pThis->remainRotamerCount[i] = 0;
@@ -2050,6 +2556,13 @@ int EnergyMatrixBlockUpdate(EnergyMatrixBlock* pEnergyBlock, BOOL* siteIRotamerD
   {
     if (siteKRotamerDeletedFlag[s] == FALSE) newRotamerCountSiteK++;
   }
+  if (pEnergyBlock->energyIK == NULL)
+  {
+    // an empty block (e.g. a non-interacting site pair) only keeps the rotamer counts
+    pEnergyBlock->RotamerCountSiteI = newRotamerCountSiteI;
+    pEnergyBlock->RotamerCountSiteK = newRotamerCountSiteK;
+    return Success;
+  }
   newEnergyIK = (double*)malloc(sizeof(double) * newRotamerCountSiteI * newRotamerCountSiteK);
   pPositionInNewEnergyIK = &newEnergyIK[0];
   for (int j = 0;j < pEnergyBlock->RotamerCountSiteI;j++)
@@ -2068,8 +2581,9 @@ int EnergyMatrixBlockUpdate(EnergyMatrixBlock* pEnergyBlock, BOOL* siteIRotamerD
 
   pEnergyBlock->RotamerCountSiteI = newRotamerCountSiteI;
   pEnergyBlock->RotamerCountSiteK = newRotamerCountSiteK;
-  free(pEnergyBlock->energyIK);
+  if (pEnergyBlock->isMapped == FALSE) free(pEnergyBlock->energyIK);
   pEnergyBlock->energyIK = newEnergyIK;
+  pEnergyBlock->isMapped = FALSE;
 
   return Success;
 }
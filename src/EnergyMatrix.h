@@ -29,6 +29,28 @@ IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define  PARTITION_SIZE_PARA                   2000
 #define  COMPUTATIONAL_AMOUNT_MAGNIFICATION    1.0
 
+// binary energy matrix file: header, one index entry per block (i<=k), then each block as contiguous doubles
+#define  ENERGY_MATRIX_BINARY_MAGIC            "UDEMATRX"
+#define  ENERGY_MATRIX_BINARY_VERSION          1
+
+typedef struct _EnergyMatrixFileHeader
+{
+  char      magic[8];
+  int       version;
+  int       designSiteCount;
+  long long blockCount;
+  long long fileSize;
+} EnergyMatrixFileHeader;
+
+typedef struct _EnergyMatrixFileBlockIndex
+{
+  int       designSiteI;
+  int       designSiteK;
+  int       rotamerCountSiteI;
+  int       rotamerCountSiteK;
+  long long offset;
+} EnergyMatrixFileBlockIndex;
+
 
 typedef struct _EnergyMatrixBlock
 {
@@ -37,6 +59,7 @@ typedef struct _EnergyMatrixBlock
   int    RotamerCountSiteI;
   int    RotamerCountSiteK;
   double* energyIK;
+  BOOL   isMapped; // energyIK points into a mapped matrix file and must not be freed
 } EnergyMatrixBlock;
 
 int     EnergyMatrixBlockCreate(EnergyMatrixBlock* pThis);
@@ -50,6 +73,8 @@ typedef struct _EnergyMatrix
 {
   int designSiteCount;
   EnergyMatrixBlock* blocks;
+  void* mappedData;
+  long long mappedSize;
 } EnergyMatrix;
 
 typedef struct _Job
@@ -77,11 +102,30 @@ typedef struct _Slot
   double totalComputationAmount;
 } Slot;
 
+// in-process work stealing over a job list: jobs are spread over the slots (one per thread) by
+// computation amount, each worker drains its own slot from the largest job down and then steals
+// the smallest remaining jobs from the other slots
+typedef struct _JobScheduler
+{
+  int slotCount;
+  Slot* slots;
+  int* heads;
+  int* tails;
+  void* locks;
+} JobScheduler;
+
+int  JobSchedulerCreate(JobScheduler* pThis, Job* jobs, int jobCount, int slotCount);
+void JobSchedulerDestroy(JobScheduler* pThis);
+BOOL JobSchedulerNext(JobScheduler* pThis, int slotIndex, Job* pJob);
+
 int  EnergyMatrixCreate(EnergyMatrix* pThis);
 void EnergyMatrixDestroy(EnergyMatrix* pThis);
 int  EnergyMatrixCopy(EnergyMatrix* pThis, EnergyMatrix* pOther);
 int  EnergyMatrixRead(EnergyMatrix* pThis, char* filepath);
 int  EnergyMatrixWrite(EnergyMatrix* pThis, char* filepath);
+int  EnergyMatrixReadBinary(EnergyMatrix* pThis, char* filepath);
+int  EnergyMatrixWriteBinary(EnergyMatrix* pThis, char* filepath);
+BOOL EnergyMatrixFileIsBinary(char* filepath);
 int  EnergyMatrixCheck(char* filepath);
 EnergyMatrixBlock* EnergyMatrixGetBlock(EnergyMatrix* pThis, int designSiteI, int designSiteK);
 double* EnergyMatrixGet(EnergyMatrix* pThis, int designSiteI, int designSiteK, int rotamerIJ, int rotamerKS);
@@ -91,6 +135,8 @@ int EnergyMatrixShow(EnergyMatrix* pThis);
 //'slotIndex' and 'slotCount' is designed for parallel computation,
 //If not used in parallel computation environment, set both parameters to be 1
 int EnergyMatrixGenerate(Structure* pStructure, char* energyMatrixFilePath, int slotIndex, int slotCount);
+//compute the whole energy matrix inside this process with 'threadCount' workers writing into pMatrix
+int EnergyMatrixGenerateInMemory(Structure* pStructure, EnergyMatrix* pMatrix, int threadCount);
 
 
 
@@ -148,8 +194,11 @@ int RotamerListUpdateByDeleteArray(RotamerList* pList, IntArray* pDeleteArray);
 int RotamerDeleteBySelfEnergyCheck2(EnergyMatrix* pMatrix, Structure* pStructure, RotamerList* pList, IntArray* pDeleteList, EnergyMatrix* pRemainFlag);
 
 int SelfEnergyGenerate(Structure* pStructure, char* selfEnergyFilePath);
+// 'selfEnergyFilePath' may be NULL, the self energies are always stored on the rotamers
 int SelfEnergyGenerate2(Structure* pStructure, AAppTable* pAAppTable, RamaTable* pRamaTable, char* selfEnergyFilePath);
 int SelfEnergyReadAndCheck(Structure* pStructure, RotamerList* pRotamerList, char* selfEnergyFile);
+// prune rotamers by the self energies stored on the rotamers and update the remaining rotamer counts
+int SelfEnergyCheck(Structure* pStructure, RotamerList* pRotamerList);
 
 int EnergyMatrixReadNew(EnergyMatrix* pThis, RotamerList* pList, char* energyMatrixFile);
 int DeleteArrayGenerateFromTwoRotamerList(IntArray* pDeleteRotamerArray, RotamerList* pOld, RotamerList* pNew);
@@ -18,79 +18,524 @@ IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #pragma warning(disable:4305)
 #include "EvoGetPhiPsi.h"
 
+#define PHIPSI_RESIDUE_FEATURES 23  // profile (20) and one-hot secondary structure (3) of a window position
+#define PHIPSI_PROPERTY_FEATURES 12 // physico-chemical properties of the central residue
+#define PHIPSI_WINDOW_FEATURES (PHIPSI_RESIDUE_FEATURES + PHIPSI_PROPERTY_FEATURES)
 
-void PhiPsiPrediction::getPhiPsi::systemCall(char* evolutionpath)
+#define FANN_LINEAR 0
+#define FANN_SIGMOID 3
+#define FANN_SIGMOID_SYMMETRIC 5
+
+
+static char aad1[] =
+{
+  'A','C','D','E','F',
+  'G','H','I','K','L',
+  'M','N','P','Q','R',
+  'S','T','V','W','Y',
+  'J','B','Z','X','O','U'
+};
+
+static float blosumn[][26] =
 {
-  char command[1000] = "";
-  sprintf(command, "%s/bin/getannfeature 10 ./psitmp.chk ./protein.ss2 ./annfeat10.dat", evolutionpath);
-  system(command);
-  sprintf(command, "%s/bin/simple_onetestphi 10 50 %s/param/phitrainres10-50.net ./annfeat10.dat ./qphi.txt", evolutionpath, evolutionpath);
-  system(command);
-  sprintf(command, "%s/bin/getannfeature 8 ./psitmp.chk ./protein.ss2 ./annfeat8.dat", evolutionpath);
-  system(command);
-  sprintf(command, "%s/bin/simple_onetestpsi 8 80 %s/param/psitrainres8-80.net ./annfeat8.dat ./qpsi.txt", evolutionpath, evolutionpath);
-  system(command);
+  {0.290148,0.021592,0.029690,0.040486,0.021592,0.078273,0.014845,0.043185,0.044534,0.059379,0.017544,0.025641,0.029690,0.025641,0.031039,0.085020,0.049933,0.068826,0.005398,0.017544,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.065041,0.483740,0.016260,0.016260,0.020325,0.032520,0.008130,0.044715,0.020325,0.065041,0.016260,0.016260,0.016260,0.012195,0.016260,0.040650,0.036585,0.056911,0.004065,0.012195,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.041045,0.007463,0.397388,0.091418,0.014925,0.046642,0.018657,0.022388,0.044776,0.027985,0.009328,0.069030,0.022388,0.029851,0.029851,0.052239,0.035448,0.024254,0.003731,0.011194,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.055249,0.007366,0.090239,0.296501,0.016575,0.034991,0.025783,0.022099,0.075506,0.036832,0.012891,0.040516,0.025783,0.064457,0.049724,0.055249,0.036832,0.031308,0.005525,0.016575,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.033827,0.010571,0.016913,0.019027,0.386892,0.025370,0.016913,0.063425,0.019027,0.114165,0.025370,0.016913,0.010571,0.010571,0.019027,0.025370,0.025370,0.054968,0.016913,0.088795,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.078273,0.010796,0.033738,0.025641,0.016194,0.510121,0.013495,0.018893,0.033738,0.028340,0.009447,0.039136,0.018893,0.018893,0.022942,0.051282,0.029690,0.024291,0.005398,0.010796,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.041985,0.007634,0.038168,0.053435,0.030534,0.038168,0.354962,0.022901,0.045802,0.038168,0.015267,0.053435,0.019084,0.038168,0.045802,0.041985,0.026718,0.022901,0.007634,0.057252,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.047128,0.016200,0.017673,0.017673,0.044183,0.020619,0.008837,0.270987,0.023564,0.167894,0.036819,0.014728,0.014728,0.013255,0.017673,0.025037,0.039764,0.176730,0.005891,0.020619,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.056995,0.008636,0.041451,0.070812,0.015544,0.043178,0.020725,0.027634,0.278066,0.043178,0.015544,0.041451,0.027634,0.053541,0.107081,0.053541,0.039724,0.032815,0.005181,0.017271,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.044534,0.016194,0.015182,0.020243,0.054656,0.021255,0.010121,0.115385,0.025304,0.375506,0.049595,0.014170,0.014170,0.016194,0.024291,0.024291,0.033401,0.096154,0.007085,0.022267,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.052209,0.016064,0.020080,0.028112,0.048193,0.028112,0.016064,0.100402,0.036145,0.196787,0.160643,0.020080,0.016064,0.028112,0.032129,0.036145,0.040161,0.092369,0.008032,0.024096,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.042697,0.008989,0.083146,0.049438,0.017978,0.065169,0.031461,0.022472,0.053933,0.031461,0.011236,0.316854,0.020225,0.033708,0.044944,0.069663,0.049438,0.026966,0.004494,0.015730,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.056848,0.010336,0.031008,0.036176,0.012920,0.036176,0.012920,0.025840,0.041344,0.036176,0.010336,0.023256,0.493540,0.020672,0.025840,0.043928,0.036176,0.031008,0.002584,0.012920,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.055882,0.008824,0.047059,0.102941,0.014706,0.041176,0.029412,0.026471,0.091176,0.047059,0.020588,0.044118,0.023529,0.214706,0.073529,0.055882,0.041176,0.035294,0.005882,0.020588,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.044574,0.007752,0.031008,0.052326,0.017442,0.032946,0.023256,0.023256,0.120155,0.046512,0.015504,0.038760,0.019380,0.048450,0.344961,0.044574,0.034884,0.031008,0.005814,0.017442,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.109948,0.017452,0.048866,0.052356,0.020942,0.066318,0.019197,0.029668,0.054101,0.041885,0.015707,0.054101,0.029668,0.033159,0.040140,0.219895,0.082024,0.041885,0.005236,0.017452,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.072978,0.017751,0.037475,0.039448,0.023669,0.043393,0.013807,0.053254,0.045365,0.065089,0.019724,0.043393,0.027613,0.027613,0.035503,0.092702,0.246548,0.071006,0.005917,0.017751,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.069959,0.019204,0.017833,0.023320,0.035665,0.024691,0.008230,0.164609,0.026063,0.130315,0.031550,0.016461,0.016461,0.016461,0.021948,0.032922,0.049383,0.268861,0.005487,0.020576,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.030303,0.007576,0.015152,0.022727,0.060606,0.030303,0.015152,0.030303,0.022727,0.053030,0.015152,0.015152,0.007576,0.015152,0.022727,0.022727,0.022727,0.030303,0.492424,0.068182,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.040498,0.009346,0.018692,0.028037,0.130841,0.024922,0.046729,0.043614,0.031153,0.068536,0.018692,0.021807,0.015576,0.021807,0.028037,0.031153,0.028037,0.046729,0.028037,0.317757,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
+  {0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462}
+};
+
+// the central-residue properties of the feature tool, indexed as aad1; the last property is always zero
+static float propertyTable[20][PHIPSI_PROPERTY_FEATURES - 1] =
+{
+  {0.513,0.169,0.402,0.412,0.132,0.700,0.000,0.500,0.831,0.165,0.109}, // A
+  {0.316,0.291,0.262,0.834,0.277,0.778,0.000,0.500,0.065,0.330,0.357}, // C
+  {0.328,0.123,0.000,0.706,0.360,0.111,0.250,1.000,0.506,0.374,0.449}, // D
+  {0.503,0.151,0.013,0.706,0.527,0.111,0.250,1.000,0.636,0.530,0.558}, // E
+  {0.376,0.308,0.377,0.708,0.781,0.811,0.000,0.500,0.325,0.757,0.698}, // F
+  {0.182,0.151,0.396,0.000,0.000,0.456,0.000,0.500,0.753,0.000,0.000}, // G
+  {0.336,0.222,0.599,0.706,0.625,0.144,0.500,0.000,0.117,0.609,0.620}, // H
+  {0.379,0.372,0.393,1.000,0.515,1.000,0.000,0.500,0.506,0.661,0.434}, // I
+  {0.427,0.176,0.834,0.706,0.700,0.067,0.750,0.000,0.584,0.757,0.551}, // K
+  {0.482,0.241,0.393,0.706,0.558,0.922,0.000,0.500,1.000,0.661,0.434}, // L
+  {0.455,0.228,0.355,0.706,0.570,0.711,0.000,0.500,0.117,0.661,0.574}, // M
+  {0.292,0.141,1.000,0.706,0.385,0.111,0.000,0.500,0.377,0.417,0.442}, // N
+  {0.200,0.101,0.427,0.790,0.286,0.322,0.000,0.500,0.494,0.365,0.310}, // P
+  {0.474,0.168,0.343,0.706,0.538,0.111,0.000,0.500,0.364,0.574,0.550}, // Q
+  {0.440,0.202,1.000,0.706,0.869,0.000,1.000,0.000,0.481,0.870,0.768}, // R
+  {0.309,0.192,0.347,0.581,0.180,0.411,0.000,0.500,0.701,0.217,0.232}, // S
+  {0.289,0.268,0.337,0.875,0.316,0.422,0.000,0.500,0.584,0.391,0.341}, // T
+  {0.325,0.414,0.391,1.000,0.378,0.967,0.000,0.500,0.675,0.496,0.326}, // V
+  {0.400,0.289,0.373,0.706,1.000,0.400,0.000,0.500,0.000,1.000,1.000}, // W
+  {0.370,0.311,0.341,0.708,0.850,0.356,0.000,0.500,0.234,0.809,0.822}  // Y
+};
+
+// position in aad1 of the k-th profile column as the feature tool read it (PSI-BLAST order ARNDCQEGHILKMFPSTWYV)
+static int profileReadOrder[20] = { 0,14,11,2,1,13,3,5,6,7,9,8,10,4,12,15,16,18,19,17 };
+
+
+static int PhiPsiAminoIndex(char aa)
+{
+  int i;
+  for (i = 0;i < 20;i++) if (aa == aad1[i]) break;
+  return i;
 }
 
 
-PhiPsiPrediction::getPhiPsi::getPhiPsi(SequenceData dsInfo, char evolutionpath[500])
+// features and angles used to be passed between the programs as text, keep the same precision
+static float PhiPsiRoundAsText(double value, const char* format)
+{
+  char text[50] = "";
+  sprintf(text, format, value);
+  return strtof(text, NULL);
+}
+
+
+static int AnnNetRead(PhiPsiPrediction::AnnNet* pThis, char* netfile)
+{
+  FILE* fp = NULL;
+  char key[500] = "", line[5000] = "";
+  int layerSizes[20];
+  int layerCount = 0, neuronCount = 0, connectionCount = 0;
+  int* inputCounts = NULL;
+  int* activations = NULL;
+  float* steepnesses = NULL;
+  int result = -1;
+
+  memset(pThis, 0, sizeof(PhiPsiPrediction::AnnNet));
+  fp = fopen(netfile, "r");
+  if (fp == NULL)
+  {
+    printf("cannot open %s\n", netfile);
+    return(-1);
+  }
+  if (fscanf(fp, "%s", line) != 1 || strcmp(line, "FANN_FLO_2.1") != 0)
+  {
+    printf("%s is not a FANN_FLO_2.1 network file\n", netfile);
+    fclose(fp);
+    return(-1);
+  }
+
+  while (fscanf(fp, " %499[^=]=", key) == 1)
+  {
+    if (strcmp(key, "layer_sizes") == 0)
+    {
+      fgets(line, 5000, fp);
+      char* pos = line;
+      char* end = NULL;
+      layerCount = 0;
+      while (layerCount < 20)
+      {
+        int size = (int)strtol(pos, &end, 10);
+        if (end == pos) break;
+        layerSizes[layerCount++] = size;
+        neuronCount += size;
+        pos = end;
+      }
+    }
+    else if (strcmp(key, "network_type") == 0 || strcmp(key, "connection_rate") == 0)
+    {
+      float value = 0;
+      fgets(line, 5000, fp);
+      sscanf(line, "%f", &value);
+      if ((key[0] == 'n' && value != 0) || (key[0] == 'c' && value < 1))
+      {
+        printf("%s: only fully connected layered networks are supported\n", netfile);
+        break;
+      }
+    }
+    else if (strncmp(key, "neurons", 7) == 0)
+    {
+      if (layerCount < 2) break;
+      inputCounts = new int[neuronCount];
+      activations = new int[neuronCount];
+      steepnesses = new float[neuronCount];
+      for (int i = 0;i < neuronCount;i++)
+      {
+        if (fscanf(fp, " (%d, %d, %f)", &inputCounts[i], &activations[i], &steepnesses[i]) != 3) break;
+        connectionCount += inputCounts[i];
+      }
+    }
+    else if (strncmp(key, "connections", 11) == 0)
+    {
+      if (inputCounts == NULL) break;
+      pThis->inputCount = layerSizes[0] - 1;
+      pThis->layerCount = layerCount - 1;
+      pThis->layers = new PhiPsiPrediction::AnnLayer[pThis->layerCount];
+      memset(pThis->layers, 0, sizeof(PhiPsiPrediction::AnnLayer) * pThis->layerCount);
+      int firstNeuron = layerSizes[0], firstInput = 0;
+      bool valid = true;
+      for (int l = 0;l < pThis->layerCount && valid;l++)
+      {
+        PhiPsiPrediction::AnnLayer* pLayer = &pThis->layers[l];
+        pLayer->neuronCount = layerSizes[l + 1] - 1;
+        pLayer->inputCount = layerSizes[l];
+        pLayer->activations = new int[pLayer->neuronCount];
+        pLayer->steepnesses = new float[pLayer->neuronCount];
+        pLayer->weights = new float[pLayer->neuronCount * pLayer->inputCount];
+        for (int n = 0;n < pLayer->neuronCount && valid;n++)
+        {
+          int neuron = firstNeuron + n;
+          int act = activations[neuron];
+          if (inputCounts[neuron] != pLayer->inputCount || (act != FANN_LINEAR && act != FANN_SIGMOID && act != FANN_SIGMOID_SYMMETRIC))
+          {
+            valid = false;
+            break;
+          }
+          pLayer->activations[n] = act;
+          pLayer->steepnesses[n] = steepnesses[neuron];
+          for (int c = 0;c < pLayer->inputCount;c++)
+          {
+            int from = -1;
+            if (fscanf(fp, " (%d, %f)", &from, &pLayer->weights[n * pLayer->inputCount + c]) != 2 || from != firstInput + c)
+            {
+              valid = false;
+              break;
+            }
+          }
+        }
+        // the bias neuron closing each layer has no inputs
+        if (inputCounts[firstNeuron + pLayer->neuronCount] != 0) valid = false;
+        firstInput = firstNeuron;
+        firstNeuron += layerSizes[l + 1];
+      }
+      if (valid) result = 0;
+      else printf("%s: only fully connected layered networks with linear or sigmoid activations are supported\n", netfile);
+      break;
+    }
+    else
+    {
+      fgets(line, 5000, fp);
+    }
+  }
+  fclose(fp);
+
+  if (inputCounts != NULL) delete[] inputCounts;
+  if (activations != NULL) delete[] activations;
+  if (steepnesses != NULL) delete[] steepnesses;
+  if (result != 0) printf("cannot read network %s\n", netfile);
+  return result;
+}
+
+
+static void AnnNetFree(PhiPsiPrediction::AnnNet* pThis)
+{
+  for (int l = 0;l < pThis->layerCount;l++)
+  {
+    delete[] pThis->layers[l].activations;
+    delete[] pThis->layers[l].steepnesses;
+    delete[] pThis->layers[l].weights;
+  }
+  if (pThis->layers != NULL) delete[] pThis->layers;
+  memset(pThis, 0, sizeof(PhiPsiPrediction::AnnNet));
+}
+
+
+// forward pass with the same float summation order and activation as fann_run(), so the predicted
+// angles match those of the original simple_onetestphi/simple_onetestpsi programs
+static float AnnNetRun(const PhiPsiPrediction::AnnNet* pThis, const float* input, float* values, float* next)
+{
+  for (int i = 0;i < pThis->inputCount;i++) values[i] = input[i];
+  values[pThis->inputCount] = 1;
+  for (int l = 0;l < pThis->layerCount;l++)
+  {
+    const PhiPsiPrediction::AnnLayer* pLayer = &pThis->layers[l];
+    int count = pLayer->inputCount;
+    for (int n = 0;n < pLayer->neuronCount;n++)
+    {
+      const float* w = pLayer->weights + n * count;
+      float sum = 0;
+      int i = count & 3;
+      switch (i)
+      {
+      case 3:
+        sum += w[2] * values[2];
+        // fall through
+      case 2:
+        sum += w[1] * values[1];
+        // fall through
+      case 1:
+        sum += w[0] * values[0];
+        // fall through
+      case 0:
+        break;
+      }
+      for (;i != count;i += 4)
+      {
+        sum += w[i] * values[i] + w[i + 1] * values[i + 1] + w[i + 2] * values[i + 2] + w[i + 3] * values[i + 3];
+      }
+
+      float steepness = pLayer->steepnesses[n];
+      float maxSum = 150 / steepness;
+      sum = steepness * sum;
+      if (sum > maxSum) sum = maxSum;
+      else if (sum < -maxSum) sum = -maxSum;
+      if (pLayer->activations[n] == FANN_SIGMOID_SYMMETRIC) next[n] = (float)(2.0f / (1.0f + exp((double)(-2.0f * sum))) - 1.0f);
+      else if (pLayer->activations[n] == FANN_SIGMOID) next[n] = (float)(1.0f / (1.0f + exp((double)(-2.0f * sum))));
+      else next[n] = sum;
+    }
+    next[pLayer->neuronCount] = 1;
+    float* tmp = values;
+    values = next;
+    next = tmp;
+  }
+
+  return values[0];
+}
+
+
+int PhiPsiPrediction::PhiPsiParamsRead(PhiPsiParams* pThis, char evolutionpath[500])
 {
-  FILE* fpwb = NULL;
-  int i, j, k;
   char file[500] = "";
 
-  static char aad1[] =
-  {
-    'A','C','D','E','F',
-    'G','H','I','K','L',
-    'M','N','P','Q','R',
-    'S','T','V','W','Y',
-    'J','B','Z','X','O','U'
-  };
-
-  static float blosumn[][26] =
-  {
-    {0.290148,0.021592,0.029690,0.040486,0.021592,0.078273,0.014845,0.043185,0.044534,0.059379,0.017544,0.025641,0.029690,0.025641,0.031039,0.085020,0.049933,0.068826,0.005398,0.017544,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.065041,0.483740,0.016260,0.016260,0.020325,0.032520,0.008130,0.044715,0.020325,0.065041,0.016260,0.016260,0.016260,0.012195,0.016260,0.040650,0.036585,0.056911,0.004065,0.012195,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.041045,0.007463,0.397388,0.091418,0.014925,0.046642,0.018657,0.022388,0.044776,0.027985,0.009328,0.069030,0.022388,0.029851,0.029851,0.052239,0.035448,0.024254,0.003731,0.011194,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.055249,0.007366,0.090239,0.296501,0.016575,0.034991,0.025783,0.022099,0.075506,0.036832,0.012891,0.040516,0.025783,0.064457,0.049724,0.055249,0.036832,0.031308,0.005525,0.016575,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.033827,0.010571,0.016913,0.019027,0.386892,0.025370,0.016913,0.063425,0.019027,0.114165,0.025370,0.016913,0.010571,0.010571,0.019027,0.025370,0.025370,0.054968,0.016913,0.088795,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.078273,0.010796,0.033738,0.025641,0.016194,0.510121,0.013495,0.018893,0.033738,0.028340,0.009447,0.039136,0.018893,0.018893,0.022942,0.051282,0.029690,0.024291,0.005398,0.010796,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.041985,0.007634,0.038168,0.053435,0.030534,0.038168,0.354962,0.022901,0.045802,0.038168,0.015267,0.053435,0.019084,0.038168,0.045802,0.041985,0.026718,0.022901,0.007634,0.057252,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.047128,0.016200,0.017673,0.017673,0.044183,0.020619,0.008837,0.270987,0.023564,0.167894,0.036819,0.014728,0.014728,0.013255,0.017673,0.025037,0.039764,0.176730,0.005891,0.020619,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.056995,0.008636,0.041451,0.070812,0.015544,0.043178,0.020725,0.027634,0.278066,0.043178,0.015544,0.041451,0.027634,0.053541,0.107081,0.053541,0.039724,0.032815,0.005181,0.017271,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.044534,0.016194,0.015182,0.020243,0.054656,0.021255,0.010121,0.115385,0.025304,0.375506,0.049595,0.014170,0.014170,0.016194,0.024291,0.024291,0.033401,0.096154,0.007085,0.022267,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.052209,0.016064,0.020080,0.028112,0.048193,0.028112,0.016064,0.100402,0.036145,0.196787,0.160643,0.020080,0.016064,0.028112,0.032129,0.036145,0.040161,0.092369,0.008032,0.024096,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.042697,0.008989,0.083146,0.049438,0.017978,0.065169,0.031461,0.022472,0.053933,0.031461,0.011236,0.316854,0.020225,0.033708,0.044944,0.069663,0.049438,0.026966,0.004494,0.015730,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.056848,0.010336,0.031008,0.036176,0.012920,0.036176,0.012920,0.025840,0.041344,0.036176,0.010336,0.023256,0.493540,0.020672,0.025840,0.043928,0.036176,0.031008,0.002584,0.012920,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.055882,0.008824,0.047059,0.102941,0.014706,0.041176,0.029412,0.026471,0.091176,0.047059,0.020588,0.044118,0.023529,0.214706,0.073529,0.055882,0.041176,0.035294,0.005882,0.020588,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.044574,0.007752,0.031008,0.052326,0.017442,0.032946,0.023256,0.023256,0.120155,0.046512,0.015504,0.038760,0.019380,0.048450,0.344961,0.044574,0.034884,0.031008,0.005814,0.017442,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.109948,0.017452,0.048866,0.052356,0.020942,0.066318,0.019197,0.029668,0.054101,0.041885,0.015707,0.054101,0.029668,0.033159,0.040140,0.219895,0.082024,0.041885,0.005236,0.017452,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.072978,0.017751,0.037475,0.039448,0.023669,0.043393,0.013807,0.053254,0.045365,0.065089,0.019724,0.043393,0.027613,0.027613,0.035503,0.092702,0.246548,0.071006,0.005917,0.017751,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.069959,0.019204,0.017833,0.023320,0.035665,0.024691,0.008230,0.164609,0.026063,0.130315,0.031550,0.016461,0.016461,0.016461,0.021948,0.032922,0.049383,0.268861,0.005487,0.020576,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.030303,0.007576,0.015152,0.022727,0.060606,0.030303,0.015152,0.030303,0.022727,0.053030,0.015152,0.015152,0.007576,0.015152,0.022727,0.022727,0.022727,0.030303,0.492424,0.068182,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.040498,0.009346,0.018692,0.028037,0.130841,0.024922,0.046729,0.043614,0.031153,0.068536,0.018692,0.021807,0.015576,0.021807,0.028037,0.031153,0.028037,0.046729,0.028037,0.317757,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462},
-    {0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462,0.038462}
-  };
-
-  //strcpy(pwd,evolutionpath);
-  sprintf(file, "./psitmp.chk");
-  fpwb = fopen(file, "wb");
-  fwrite(&dsInfo.len, sizeof(int), 1, fpwb);
-  for (i = 0;i < dsInfo.len;i++) fwrite(&dsInfo.seq[i], sizeof(char), 1, fpwb);
-  for (i = 0;i < dsInfo.len;i++)
-  {
-    for (j = 0;j < 20;j++) if (dsInfo.seq[i] == aad1[j]) break;
-    if (j > 20) { printf("check ....\n"); break; }
-    for (k = 0;k < 20;k++) fwrite(&blosumn[k][j], sizeof(float), 1, fpwb);
-  }
-  fclose(fpwb);
-  systemCall(evolutionpath);
+  memset(pThis, 0, sizeof(PhiPsiParams));
+  sprintf(file, "%s/param/phitrainres10-50.net", evolutionpath);
+  if (AnnNetRead(&pThis->phiNet, file) != 0) return(-1);
+  sprintf(file, "%s/param/psitrainres8-80.net", evolutionpath);
+  if (AnnNetRead(&pThis->psiNet, file) != 0) return(-1);
+  for (int i = 0;i < 2;i++)
+  {
+    AnnNet* pNet = i == 0 ? &pThis->phiNet : &pThis->psiNet;
+    int span = pNet->inputCount / PHIPSI_WINDOW_FEATURES;
+    if (pNet->inputCount % PHIPSI_WINDOW_FEATURES != 0 || span % 2 == 0 || pNet->layers[pNet->layerCount - 1].neuronCount != 1)
+    {
+      printf("phi/psi network with %d inputs does not match the window features\n", pNet->inputCount);
+      return(-1);
+    }
+  }
+
+  return(0);
 }
 
 
+void PhiPsiPrediction::PhiPsiParamsFree(PhiPsiParams* pThis)
+{
+  AnnNetFree(&pThis->phiNet);
+  AnnNetFree(&pThis->psiNet);
+}
+
+
+// profile and secondary-structure features of residue r as the getannfeature program computed them
+static void PhiPsiResidueFeatureRow(SequenceData dsInfo, const int* aminoIndex, int r, float* x)
+{
+  // the program was given a 20-float BLOSUM column per residue but read it back as 20 doubles per
+  // residue (repeating the last one at the end of the data); a row whose values sum below 1e-7 was
+  // replaced by the BLOSUM row of the residue type, the others are too small to survive the rounding
+  int doubleCount = dsInfo.len * 10;
+  float row[20];
+  double sum = 0;
+  for (int k = 0;k < 20;k++)
+  {
+    int q = r * 20 + k;
+    if (q >= doubleCount) q = doubleCount - 1;
+    float pair[2];
+    for (int h = 0;h < 2;h++)
+    {
+      int f = 2 * q + h;
+      pair[h] = blosumn[f % 20][aminoIndex[f / 20]];
+    }
+    double value;
+    memcpy(&value, pair, sizeof(double));
+    row[profileReadOrder[k]] = (float)value;
+  }
+  for (int k = 0;k < 20;k++) sum += row[k];
+  if (sum < 1e-7)
+  {
+    for (int k = 0;k < 20;k++) row[k] = blosumn[aminoIndex[r]][k];
+  }
+
+  for (int k = 0;k < 20;k++) x[k] = PhiPsiRoundAsText(row[k], "%5.3f");
+  // one-hot coil, helix, strand
+  x[20] = x[21] = x[22] = 0;
+  if (dsInfo.ss1[r] == '1') x[21] = 1;
+  else if (dsInfo.ss1[r] == '2') x[22] = 1;
+  else x[20] = 1;
+}
+
+
+// predicts the angles whose window holds a row marked in rows (all of them if rows is NULL) or
+// whose central residue is center
+void PhiPsiPrediction::getPhiPsi::Predict(const AnnNet* pNet, const char* rows, int center, bool isPsi, float* angles)
+{
+  int window = (pNet->inputCount / PHIPSI_WINDOW_FEATURES - 1) / 2;
+  int maxCount = pNet->inputCount;
+  for (int l = 0;l < pNet->layerCount;l++)
+  {
+    if (pNet->layers[l].neuronCount > maxCount) maxCount = pNet->layers[l].neuronCount;
+  }
+  float* input = new float[pNet->inputCount];
+  float* values = new float[maxCount + 1];
+  float* next = new float[maxCount + 1];
+
+  int marked = 0; // marked rows within the window of residue i
+  if (rows != NULL)
+  {
+    for (int j = 0;j < window && j < len;j++) marked += rows[j];
+  }
+  for (int i = 0;i < len;i++)
+  {
+    if (rows != NULL)
+    {
+      if (i + window < len) marked += rows[i + window];
+      if (i - window - 1 >= 0) marked -= rows[i - window - 1];
+      if (marked == 0 && i != center) continue;
+    }
+
+    int aa = aminoIndex[i] < 20 ? aminoIndex[i] : 5;
+    memset(input, 0, sizeof(float) * pNet->inputCount);
+    for (int j = i - window, slot = 0;j <= i + window;j++, slot++)
+    {
+      if (j < 0 || j >= len) continue;
+      float* x = input + slot * PHIPSI_WINDOW_FEATURES;
+      memcpy(x, residueFeatures + j * PHIPSI_RESIDUE_FEATURES, sizeof(float) * PHIPSI_RESIDUE_FEATURES);
+      memcpy(x + PHIPSI_RESIDUE_FEATURES, propertyTable[aa], sizeof(float) * (PHIPSI_PROPERTY_FEATURES - 1));
+    }
+
+    double out = AnnNetRun(pNet, input, values, next);
+    double angle;
+    if (!isPsi)
+    {
+      angle = (out + 1.0) * 180.0;
+      if (angle > 360.0) angle = 360.0;
+      else if (angle < 0.0) angle = 0.0;
+      if (angle > 180.0) angle -= 360.0;
+    }
+    else
+    {
+      // psi is predicted on a circle shifted by 0.72 turn
+      double shift = 0.72;
+      angle = (out + 1.0) / 2.0;
+      if (angle < 0.0) angle = 0.0;
+      else if (angle > 1.0) angle = 1.0;
+      if (angle < 1.0 - shift) angle += shift;
+      else angle -= 1.0 - shift;
+      angle *= 360.0;
+      if (angle > 180.0) angle -= 360.0;
+    }
+    angles[i] = PhiPsiRoundAsText(angle, "%8.1f");
+  }
+
+  delete[] input;
+  delete[] values;
+  delete[] next;
+}
+
+
+void PhiPsiPrediction::getPhiPsi::Init(const PhiPsiParams* pParams, int length)
+{
+  params = pParams;
+  len = length;
+  aminoIndex = new int[len];
+  residueFeatures = new float[len * PHIPSI_RESIDUE_FEATURES];
+  rowChanged = new char[len];
+}
+
+
+PhiPsiPrediction::getPhiPsi::getPhiPsi(const PhiPsiParams* pParams, int length)
+{
+  Init(pParams, length);
+}
+
+
+PhiPsiPrediction::getPhiPsi::~getPhiPsi()
+{
+  delete[] aminoIndex;
+  delete[] residueFeatures;
+  delete[] rowChanged;
+}
+
+
+void PhiPsiPrediction::getPhiPsi::Predict(SequenceData dsInfo, float* phiQ, float* psiQ)
+{
+  for (int i = 0;i < len;i++) aminoIndex[i] = PhiPsiAminoIndex(dsInfo.seq[i]);
+  for (int r = 0;r < len;r++) PhiPsiResidueFeatureRow(dsInfo, aminoIndex, r, residueFeatures + r * PHIPSI_RESIDUE_FEATURES);
+  Predict(&params->phiNet, NULL, -1, false, phiQ);
+  Predict(&params->psiNet, NULL, -1, true, psiQ);
+}
+
+
+void PhiPsiPrediction::getPhiPsi::Update(SequenceData dsInfo, int pos, int ssBegin, int ssEnd, float* phiQ, float* psiQ)
+{
+  aminoIndex[pos] = PhiPsiAminoIndex(dsInfo.seq[pos]);
+
+  // rows reading the BLOSUM stream of the residue, its own fallback row and the rows whose SS changed;
+  // the stream of the last residue is also repeated into every row reading past the end of the data
+  memset(rowChanged, 0, sizeof(char) * len);
+  rowChanged[pos / 2] = rowChanged[pos] = 1;
+  for (int r = ssBegin;r <= ssEnd;r++) rowChanged[r] = 1;
+  if (pos == len - 1)
+  {
+    for (int r = 0;r < len;r++)
+    {
+      if (r * 20 + 19 >= len * 10 - 1) rowChanged[r] = 1;
+    }
+  }
+  for (int r = 0;r < len;r++)
+  {
+    if (rowChanged[r]) PhiPsiResidueFeatureRow(dsInfo, aminoIndex, r, residueFeatures + r * PHIPSI_RESIDUE_FEATURES);
+  }
+
+  Predict(&params->phiNet, rowChanged, pos, false, phiQ);
+  Predict(&params->psiNet, rowChanged, pos, true, psiQ);
+}
+
+
+PhiPsiPrediction::getPhiPsi::getPhiPsi(SequenceData dsInfo, const PhiPsiParams* pParams, float* phiQ, float* psiQ)
+{
+  Init(pParams, dsInfo.len);
+  Predict(dsInfo, phiQ, psiQ);
+}
+
+
+PhiPsiPrediction::getPhiPsi::getPhiPsi(SequenceData dsInfo, char evolutionpath[500])
+{
+  PhiPsiParams params;
+  memset(&params, 0, sizeof(PhiPsiParams));
+  Init(&params, dsInfo.len);
+  if (PhiPsiParamsRead(&params, evolutionpath) != 0)
+  {
+    PhiPsiParamsFree(&params);
+    return;
+  }
+
+  float* phiQ = new float[dsInfo.len];
+  float* psiQ = new float[dsInfo.len];
+  Predict(dsInfo, phiQ, psiQ);
+  PhiPsiParamsFree(&params);
+
+  FILE* fp = fopen("./qphi.txt", "w");
+  if (fp != NULL)
+  {
+    for (int i = 0;i < dsInfo.len;i++) fprintf(fp, "%d %8.1f\n", i + 1, phiQ[i]);
+    fclose(fp);
+  }
+  fp = fopen("./qpsi.txt", "w");
+  if (fp != NULL)
+  {
+    for (int i = 0;i < dsInfo.len;i++) fprintf(fp, "%d %8.1f\n", i + 1, psiQ[i]);
+    fclose(fp);
+  }
+  delete[] phiQ;
+  delete[] psiQ;
+}
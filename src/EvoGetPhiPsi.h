@@ -26,12 +26,56 @@ IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 namespace PhiPsiPrediction
 {
+  // a fully connected layered network stored in the FANN_FLO_2.1 text format
+  struct AnnLayer
+  {
+    int neuronCount;      // without the bias neuron
+    int inputCount;       // neurons of the previous layer including its bias neuron
+    int* activations;     // FANN activation function id of each neuron
+    float* steepnesses;
+    float* weights;       // neuronCount x inputCount
+  };
+
+  struct AnnNet
+  {
+    int inputCount;       // without the bias neuron
+    int layerCount;       // hidden and output layers
+    AnnLayer* layers;
+  };
+
+  // phi and psi networks read from the evolution parameter directory, loaded once and shared read-only
+  struct PhiPsiParams
+  {
+    AnnNet phiNet;        // phitrainres10-50.net, window 10
+    AnnNet psiNet;        // psitrainres8-80.net, window 8
+  };
+
+  int PhiPsiParamsRead(PhiPsiParams* pThis, char path[500]);
+  void PhiPsiParamsFree(PhiPsiParams* pThis);
+
   class getPhiPsi
   {
-    //char pwd[500];
+    const PhiPsiParams* params = NULL;
+    int len;
+    int* aminoIndex;
+    float* residueFeatures;
+    char* rowChanged;     // feature rows touched by the current update
+
+    void Init(const PhiPsiParams* pParams, int length);
+    void Predict(const AnnNet* pNet, const char* rows, int center, bool isPsi, float* angles);
+
   public:
+    // predicts the query phi/psi and writes them to ./qphi.txt and ./qpsi.txt
     getPhiPsi(SequenceData dsInfo, char evolutionpath[500]);
-    void systemCall(char* evolutionpath);
+    // predicts the query phi/psi into phiQ/psiQ (dsInfo.len values each)
+    getPhiPsi(SequenceData dsInfo, const PhiPsiParams* pParams, float* phiQ, float* psiQ);
+    // keeps the features of the last predicted sequence so that Update() can follow single-site mutations
+    getPhiPsi(const PhiPsiParams* pParams, int length);
+    ~getPhiPsi();
+    void Predict(SequenceData dsInfo, float* phiQ, float* psiQ);
+    // dsInfo.seq differs from the last predicted sequence at pos only and dsInfo.ss1 over [ssBegin, ssEnd];
+    // phiQ/psiQ hold the last prediction and are rewritten where the angles may have changed
+    void Update(SequenceData dsInfo, int pos, int ssBegin, int ssEnd, float* phiQ, float* psiQ);
   };
 }
 
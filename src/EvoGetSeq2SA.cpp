@@ -20,53 +20,192 @@ IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "EvoGetSeq2SA.h"
 
 
-SAPrediction::getSeq2SA::getSeq2SA(char prdA2[MAX_LEN], char fasta[MAX_LEN], char sstruct[MAX_LEN], char evolutionpath[500])
+int SAPrediction::SAParamsRead(SAParams* pThis, char evolutionpath[500])
 {
+  FILE* fp = NULL;
   int i, j;
+  char file[500] = "";
+  char line[5000] = "XXX", amn = 'X';
+  float tmp1 = 0, tmp2 = 0, tmp3 = 0;
+
+  memset(pThis, 0, sizeof(SAParams));
+  sprintf(file, "%s/param/wgtSA", evolutionpath);
+  fp = fopen(file, "r");     //weight file
+  if (fp == NULL)
+  {
+    printf("cannot open %s\n", file);
+    return(-1);
+  }
+  for (i = 0;i < 636;i++)
+  {       //330
+    for (j = 0;j < 120;j++)
+    {     //150
+      fscanf(fp, "%f\n", &pThis->w1[i][j]);
+    }
+  }
+  for (i = 0;i < 120;i++)
+  {       //150
+    for (j = 0;j < NLAYER3;j++)
+    {     //3
+      fscanf(fp, "%f\n", &pThis->w2[i][j]);
+    }
+  }
+  for (i = 0;i < MLAYER1;i++)
+  {       //75
+    for (j = 0;j < MLAYER2;j++)
+    {     //40
+      fscanf(fp, "%f\n", &pThis->v1[i][j]);
+    }
+  }
+  for (i = 0;i < MLAYER2;i++)
+  {       //40
+    for (j = 0;j < MLAYER3;j++)
+    {     //3
+      fscanf(fp, "%f\n", &pThis->v2[i][j]);
+    }
+  }
+  fclose(fp);
 
-  SEG = 12;
-  NLAYER1 = SEG * 53; //number of input nodes=SEG*53
-  NLAYER2 = 120;    //number of  hidden nodes
+  sprintf(file, "%s/param/SApropensity.txt", evolutionpath);
+  fp = fopen(file, "r");
+  if (fp == NULL)
+  {
+    printf("cannot open %s\n", file);
+    return(-1);
+  }
+  fgets(line, 5000, fp);
+  i = 0;
+  while (!feof(fp) && i < 21)
+  {
+    fgets(line, 5000, fp);
+    if (feof(fp)) break;
+    sscanf(line, "%c %f %f %f", &amn, &tmp1, &tmp2, &tmp3);
+    pThis->amino[i] = amn;
+    pThis->propensity[i][1] = tmp1;    // B
+    pThis->propensity[i][2] = tmp2;    // I 
+    pThis->propensity[i][3] = tmp3;    // E
+    i++;
+  }
+  fclose(fp);
 
-  sprintf(wgtfile, "%s/param/wgtSA", evolutionpath);
-  sprintf(propfile, "%s/param/SApropensity.txt", evolutionpath);
+  return(0);
+}
 
-  Read_wgt();
-  Read_score1(fasta);    // Score1 is from Blosum62 matrix, normalized by 2.0 and taken as algebric sigmoid function
-  Read_score(sstruct);   // Score is directly taken from propensity file. Score2 is composition mutiplied by Sander A-X-A. Score 3 is SS info
 
-  for (i = 1;i <= Len;i++)
+SAPrediction::getSeq2SA::getSeq2SA(char prdA2[MAX_LEN], char fasta[MAX_LEN], char sstruct[MAX_LEN], char evolutionpath[500])
+{
+  SAParams* pParams = new SAParams;
+  SAParamsRead(pParams, evolutionpath);
+  params = pParams;
+  Predict(prdA2, fasta, sstruct);
+  delete pParams;
+}
+
+
+SAPrediction::getSeq2SA::getSeq2SA(char prdA2[MAX_LEN], char fasta[MAX_LEN], char sstruct[MAX_LEN], const SAParams* pParams)
+{
+  params = pParams;
+  Predict(prdA2, fasta, sstruct);
+}
+
+
+SAPrediction::getSeq2SA::getSeq2SA(const SAParams* pParams)
+{
+  params = pParams;
+  Len = 0;
+}
+
+
+void SAPrediction::getSeq2SA::NetRange(int begin, int end)
+{
+  int i, j, r, rows;
+
+  for (i = begin;i <= end;i += NET_BATCH)
   {
-    FeedNet(i);
-    Netout();
-    for (j = 0;j < NLAYER3;j++)
+    rows = end - i + 1 < NET_BATCH ? end - i + 1 : NET_BATCH;
+    for (r = 0;r < rows;r++)
     {
-      nout[i][j] = out[j];
+      FeedNet(i + r);
+      memcpy(batchIn[r], in1, sizeof(float) * NLAYER1);
+    }
+    utility::LayerBatch(&batchIn[0][0], 636, rows, &params->w1[0][0], 120, NLAYER1, NLAYER2, &batchHidden[0][0], 120);
+    for (r = 0;r < rows;r++)
+    {
+      memcpy(in2, batchHidden[r], sizeof(float) * NLAYER2);
+      NetoutHidden();
+      for (j = 0;j < NLAYER3;j++)
+      {
+        nout[i + r][j] = out[j];
+      }
     }
   }
+}
 
-  for (i = 1;i <= Len;i++)
+
+void SAPrediction::getSeq2SA::NetRange1(char prdA2[MAX_LEN], int begin, int end)
+{
+  int i;
+
+  for (i = begin;i <= end;i++)
   {
     FeedNet1(i);
     Netout1();
     if (mout[0] >= mout[1] && mout[0] >= mout[2])
     {
-      prdA2[i] = '1';          // prdA2[i]='B';
+      prdA2[i - 1] = '1';          // prdA2[i]='B';
     }
     else if (mout[1] >= mout[0] && mout[1] >= mout[2])
     {
-      prdA2[i] = '2';          // prdA2[i]='I';  
+      prdA2[i - 1] = '2';          // prdA2[i]='I';
     }
     else if (mout[2] >= mout[0] && mout[2] >= mout[1])
     {
-      prdA2[i] = '3';          // prdA2[i]='E'; 
+      prdA2[i - 1] = '3';          // prdA2[i]='E';
     }
   }
+}
 
-  for (i = 0;i < Len;i++)
-  {
-    prdA2[i] = prdA2[i + 1];
-  }
+
+void SAPrediction::getSeq2SA::Predict(char prdA2[MAX_LEN], char fasta[MAX_LEN], char sstruct[MAX_LEN])
+{
+  memset(StrA2, '0', sizeof(StrA2)); // no native SA; keeps the unused training targets in range
+  memset(im1, 0, sizeof(im1));       // the window of the second network fills only SEG * 5 of its inputs
+
+  SEG = 12;
+  NLAYER1 = SEG * 53; //number of input nodes=SEG*53
+  NLAYER2 = 120;    //number of  hidden nodes
+
+  Read_score1(fasta);    // Score1 is from Blosum62 matrix, normalized by 2.0 and taken as algebric sigmoid function
+  Read_score(sstruct);   // Score is directly taken from propensity file. Score2 is composition mutiplied by Sander A-X-A. Score 3 is SS info
+
+  NetRange(1, Len);
+  NetRange1(prdA2, 1, Len);
+  prdA2[Len] = '\0';
+}
+
+
+void SAPrediction::getSeq2SA::Update(char prdA2[MAX_LEN], char fasta[MAX_LEN], char sstruct[MAX_LEN], int pos, int ssBegin, int ssEnd)
+{
+  int i, left = SEG / 2, right = SEG - 1 - SEG / 2;
+  int p = pos + 1;
+
+  StrA1[p] = fasta[pos];
+  ResidueScore1(p);
+  ResidueScore(p);
+  // the composition term covers the same window as the network
+  int b = p - right < 1 ? 1 : p - right;
+  int e = p + left > Len ? Len : p + left;
+  for (i = b;i <= e;i++) ResidueScore2(i);
+  for (i = ssBegin + 1;i <= ssEnd + 1;i++) ResidueScore3(i, sstruct);
+  if (ssBegin + 1 < b) b = ssBegin + 1;
+  if (ssEnd + 1 > e) e = ssEnd + 1;
+
+  b = b - right < 1 ? 1 : b - right;
+  e = e + left > Len ? Len : e + left;
+  NetRange(b, e);
+  b = b - right < 1 ? 1 : b - right;
+  e = e + left > Len ? Len : e + left;
+  NetRange1(prdA2, b, e);
 }
 
 
@@ -78,112 +217,71 @@ inline float SAPrediction::getSeq2SA::SANDER(int i)
 }
 
 
-void SAPrediction::getSeq2SA::Read_wgt()
+/****************************************************************/
+int SAPrediction::getSeq2SA::Read_score(char sstruct[MAX_LEN])
 {
-  FILE* fpout;
-  int i, j;
+  int i;
 
-  fpout = fopen(wgtfile, "r");     //weight file
-  for (i = 0;i < NLAYER1;i++)
-  {       //330
-    for (j = 0;j < NLAYER2;j++)
-    {     //150
-      fscanf(fpout, "%f\n", &w1[i][j]);
-      Dw1[i][j] = 0.0;
-    }
-  }
-  for (i = 0;i < NLAYER2;i++)
-  {       //150
-    for (j = 0;j < NLAYER3;j++)
-    {     //3
-      fscanf(fpout, "%f\n", &w2[i][j]);
-      Dw2[i][j] = 0.0;
-    }
-  }
-  for (i = 0;i < MLAYER1;i++)
-  {       //75
-    for (j = 0;j < MLAYER2;j++)
-    {     //40
-      fscanf(fpout, "%f\n", &v1[i][j]);
-      Dv1[i][j] = 0.0;
-    }
+  for (i = 1;i <= Len;i++)
+  {
+    ResidueScore(i);
   }
-  for (i = 0;i < MLAYER2;i++)
-  {       //40
-    for (j = 0;j < MLAYER3;j++)
-    {     //3
-      fscanf(fpout, "%f\n", &v2[i][j]);
-      Dv2[i][j] = 0.0;
-    }
+
+  for (i = 1;i <= Len;i++)
+  {
+    ResidueScore2(i);
+    ResidueScore3(i, sstruct);
   }
-  fclose(fpout);
+
+  return(0);
 }
 
-/****************************************************************/
-int SAPrediction::getSeq2SA::Read_score(char sstruct[MAX_LEN])
+
+void SAPrediction::getSeq2SA::ResidueScore(int i)
 {
-  int i, j, k;
-  FILE* fp = NULL;
-  char line[5000] = "XXX", amn = 'X', amino[MAX_LEN] = "XXX";
-  float tmp1 = 0, tmp2 = 0, tmp3 = 0, aa[24] = { 0 };
-  float propensity[MAX_LEN][4] = { 0 };
+  int j, k;
+  float tmp1 = 0;
 
-  fp = fopen(propfile, "r");
-  fgets(line, 5000, fp);
-  i = 0;
-  while (!feof(fp))
+  for (j = 0;j < 20;j++) if (StrA1[i] == params->amino[j]) break;
+  for (k = 0;k < 3;k++)
   {
-    fgets(line, 5000, fp);
-    if (feof(fp)) break;
-    sscanf(line, "%c %f %f %f", &amn, &tmp1, &tmp2, &tmp3);
-    amino[i] = amn;
-    propensity[i][1] = tmp1;    // B
-    propensity[i][2] = tmp2;    // I 
-    propensity[i][3] = tmp3;    // E
-    i++;
+    tmp1 = params->propensity[j][k + 1];
+    Score[i][k] = tmp1 / sqrt(1.0 + tmp1 * tmp1);
   }
-  fclose(fp);
-  for (i = 1;i <= Len;i++)
+}
+
+
+void SAPrediction::getSeq2SA::ResidueScore2(int i)
+{
+  int j, k;
+  float tmp1 = 0, aa[24] = { 0 };
+
+  for (j = (i - SEG / 2);j < (i - SEG / 2) + SEG;j++)
   {
-    for (j = 0;j < 20;j++) if (StrA1[i] == amino[j]) break;
-    for (k = 0;k < 3;k++)
-    {
-      tmp1 = propensity[j][k + 1];
-      Score[i][k] = tmp1 / sqrt(1.0 + tmp1 * tmp1);
-    }
+    if (j > 0 && j < Len)
+      aa[getID(StrA1[j])] += SANDER(getID(StrA1[j]));
   }
 
-  for (i = 1;i <= Len;i++)
+  for (k = 0;k < 23;k++)
   {
-    for (j = 0;j < 23;j++) aa[j] = 0.0;
-    for (j = (i - SEG / 2);j < (i - SEG / 2) + SEG;j++)
-    {
-      if (j > 0 && j < Len)
-        aa[getID(StrA1[j])] += SANDER(getID(StrA1[j]));
-    }
-
-    for (k = 0;k < 23;k++)
-    {
-      tmp1 = aa[k] / 150.0;
-      Score2[i][k] = tmp1 / sqrt(1.0 + tmp1 * tmp1);
-    }
-
-    Score3[i][0] = Score3[i][1] = Score3[i][2] = 0.0;
-    if (sstruct[i - 1] == '1')  Score3[i][0] = 1.0;
-    if (sstruct[i - 1] == '2')  Score3[i][1] = 1.0;
-    if (sstruct[i - 1] == '3')  Score3[i][2] = 1.0;
+    tmp1 = aa[k] / 150.0;
+    Score2[i][k] = tmp1 / sqrt(1.0 + tmp1 * tmp1);
   }
+}
 
-  return(0);
+
+void SAPrediction::getSeq2SA::ResidueScore3(int i, char sstruct[MAX_LEN])
+{
+  Score3[i][0] = Score3[i][1] = Score3[i][2] = 0.0;
+  if (sstruct[i - 1] == '1')  Score3[i][0] = 1.0;
+  if (sstruct[i - 1] == '2')  Score3[i][1] = 1.0;
+  if (sstruct[i - 1] == '3')  Score3[i][2] = 1.0;
 }
 
 /****************************************************************/
 int SAPrediction::getSeq2SA::Read_score1(char fasta[MAX_LEN])
 {
-  int i, j, aa_num = 0;
-  char* ncbicodes = "XAXCDEFGHIKLMNPQRSTVWXYXXX";
-  float tmp3 = 0;
-  utility::Blosum62 bsm;
+  int i;
 
   // read Score1[][]---------------->
   Len = strlen(fasta);
@@ -193,40 +291,51 @@ int SAPrediction::getSeq2SA::Read_score1(char fasta[MAX_LEN])
   }
   for (i = 1;i <= Len;i++)
   {
-    aa_num = bsm.aanum(StrA1[i]);
-    Score1[i][0] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[1]));
-    Score1[i][4] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[3]));
-    Score1[i][3] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[4]));
-    Score1[i][6] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[5]));
-    Score1[i][13] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[6]));
-    Score1[i][7] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[7]));
-    Score1[i][8] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[8]));
-    Score1[i][9] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[9]));
-    Score1[i][11] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[10]));
-    Score1[i][10] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[11]));
-    Score1[i][12] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[12]));
-    Score1[i][2] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[13]));
-    Score1[i][14] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[14]));
-    Score1[i][5] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[15]));
-    Score1[i][1] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[16]));
-    Score1[i][15] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[17]));
-    Score1[i][16] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[18]));
-    Score1[i][19] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[19]));
-    Score1[i][17] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[20]));
-    Score1[i][18] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[22]));
-
-    for (j = 0;j < 20;j++)
-    {
-      tmp3 = Score1[i][j];
-      Score1[i][j] = tmp3 / sqrt(1.0 + tmp3 * tmp3);
-    }
-    Score1[i][20] = 0;
+    ResidueScore1(i);
   }
 
   return Len;
 }
 
 
+void SAPrediction::getSeq2SA::ResidueScore1(int i)
+{
+  int j, aa_num = 0;
+  char* ncbicodes = "XAXCDEFGHIKLMNPQRSTVWXYXXX";
+  float tmp3 = 0;
+  utility::Blosum62 bsm;
+
+  aa_num = bsm.aanum(StrA1[i]);
+  Score1[i][0] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[1]));
+  Score1[i][4] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[3]));
+  Score1[i][3] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[4]));
+  Score1[i][6] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[5]));
+  Score1[i][13] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[6]));
+  Score1[i][7] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[7]));
+  Score1[i][8] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[8]));
+  Score1[i][9] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[9]));
+  Score1[i][11] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[10]));
+  Score1[i][10] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[11]));
+  Score1[i][12] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[12]));
+  Score1[i][2] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[13]));
+  Score1[i][14] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[14]));
+  Score1[i][5] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[15]));
+  Score1[i][1] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[16]));
+  Score1[i][15] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[17]));
+  Score1[i][16] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[18]));
+  Score1[i][19] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[19]));
+  Score1[i][17] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[20]));
+  Score1[i][18] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[22]));
+
+  for (j = 0;j < 20;j++)
+  {
+    tmp3 = Score1[i][j];
+    Score1[i][j] = tmp3 / sqrt(1.0 + tmp3 * tmp3);
+  }
+  Score1[i][20] = 0;
+}
+
+
 int SAPrediction::getSeq2SA::getID(char c)
 {
   switch (c)
@@ -363,15 +472,13 @@ void SAPrediction::getSeq2SA::FeedNet(int I)
 }
 
 /**************************************************************************/
-void SAPrediction::getSeq2SA::Netout()
+// sigmoid hidden layer and output layer, from the hidden-layer sums that the batched first layer left in in2
+void SAPrediction::getSeq2SA::NetoutHidden()
 {
   int i, j;
 
   for (i = 0;i < NLAYER2;i++)
   {
-    in2[i] = 0.0;
-    for (j = 0;j < NLAYER1;j++)
-      in2[i] += w1[j][i] * in1[j];
     out2[i] = 1.0 / (1.0 + exp(-1.0 * in2[i]));
   }
 
@@ -379,7 +486,7 @@ void SAPrediction::getSeq2SA::Netout()
   {
     in3[i] = 0.0;
     for (j = 0;j < NLAYER2;j++)
-      in3[i] += w2[j][i] * out2[j];
+      in3[i] += params->w2[j][i] * out2[j];
     out[i] = 1.0 / (1.0 + exp(-1.0 * in3[i]));
   }
 }
@@ -431,7 +538,7 @@ void SAPrediction::getSeq2SA::Netout1()
   {
     im2[i] = 0.0;
     for (j = 0;j < MLAYER1;j++)
-      im2[i] += v1[j][i] * im1[j];
+      im2[i] += params->v1[j][i] * im1[j];
     mout2[i] = 1.0 / (1.0 + exp(-1.0 * im2[i]));
   }
 
@@ -439,7 +546,7 @@ void SAPrediction::getSeq2SA::Netout1()
   {
     im3[i] = 0.0;
     for (j = 0;j < MLAYER2;j++)
-      im3[i] += v2[j][i] * mout2[j];
+      im3[i] += params->v2[j][i] * mout2[j];
     mout[i] = 1.0 / (1.0 + exp(-1.0 * im3[i]));
   }
 }
@@ -22,6 +22,19 @@ IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 namespace SAPrediction
 {
+  // everything the predictor reads from the evolution parameter directory, loaded once and shared read-only
+  struct SAParams
+  {
+    float w1[636][120];
+    float w2[120][NLAYER3];
+    float v1[MLAYER1][MLAYER2];
+    float v2[MLAYER2][MLAYER3];
+    char amino[21];
+    float propensity[21][4];
+  };
+
+  int SAParamsRead(SAParams* pThis, char path[500]);
+
   class getSeq2SA
   {
 
@@ -37,28 +50,35 @@ namespace SAPrediction
     char StrA1[MAX_LEN], StrA2[MAX_LEN];
     float Score1[MAX_LEN][21], Score2[MAX_LEN][23], Score[MAX_LEN][4], Score3[MAX_LEN][4];
     float nout[MAX_LEN][NLAYER3], pout[MAX_LEN][NLAYER3];
-    float w1[636][120], Dw1[636][120];
     float in1[636];
-    float w2[120][NLAYER3], Dw2[120][NLAYER3];
     float in2[120], out2[120], in3[NLAYER3], out[NLAYER3];
+    float batchIn[NET_BATCH][636], batchHidden[NET_BATCH][120];
     float tgtout[NLAYER3];
-    float v1[MLAYER1][MLAYER2], Dv1[MLAYER1][MLAYER2];
-    float v2[MLAYER2][MLAYER3], Dv2[MLAYER2][MLAYER3];
     float im1[MLAYER1], im2[MLAYER2], mout2[MLAYER2], im3[MLAYER3], mout[MLAYER3];
 
-    float dw2[120][NLAYER3];
-    float dv1[MLAYER1][MLAYER2], dv2[MLAYER2][MLAYER3]; // Derivatives
+    const SAParams* params;
 
-    char wgtfile[500], propfile[500];
+    void NetRange(int begin, int end);
+    void NetRange1(char prdA2[MAX_LEN], int begin, int end);
 
   public:
     /* function declaration */
     getSeq2SA(char prdA2[MAX_LEN], char fasta[MAX_LEN], char sstruct[MAX_LEN], char path[500]);
-    void Read_wgt();
+    getSeq2SA(char prdA2[MAX_LEN], char fasta[MAX_LEN], char sstruct[MAX_LEN], const SAParams* pParams);
+    // keeps the network outputs of the last predicted sequence so that Update() can follow single-site mutations
+    getSeq2SA(const SAParams* pParams);
+    void Predict(char prdA2[MAX_LEN], char fasta[MAX_LEN], char sstruct[MAX_LEN]);
+    // fasta differs from the last predicted sequence at pos only and sstruct over [ssBegin, ssEnd];
+    // prdA2 holds the last prediction and is rewritten where the SA may have changed
+    void Update(char prdA2[MAX_LEN], char fasta[MAX_LEN], char sstruct[MAX_LEN], int pos, int ssBegin, int ssEnd);
     int Read_score1(char fasta[MAX_LEN]);
     int Read_score(char sstruct[MAX_LEN]);
+    void ResidueScore1(int i);
+    void ResidueScore(int i);
+    void ResidueScore2(int i);
+    void ResidueScore3(int i, char sstruct[MAX_LEN]);
     void FeedNet(int I);
-    void Netout();
+    void NetoutHidden();
     void FeedNet1(int I);
     void Netout1();
     float SANDER(int i);
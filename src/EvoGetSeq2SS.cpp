@@ -20,245 +20,344 @@ IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "EvoGetSeq2SS.h"
 #include "Utility.h"
 
-extern BOOL FLAG_EVOPHIPSI;
-
-SSPrediction::getSeq2SS::getSeq2SS(char prdA2[MAX_LEN], char fasta[MAX_LEN], char evolutionpath[500])
+static int ReadSSNetWeights(SSPrediction::SSNetWeights* pThis, char* wgtfile, int nlayer1, int nlayer2)
 {
-  /* variable declaration */
-  FILE* fp = NULL;
   int i, j;
-  float pout[MAX_LEN][NLAYER3] = { 0 };
+  FILE* fpout = NULL;
+
+  fpout = fopen(wgtfile, "r");       //weight file
+  if (fpout == NULL)
+  {
+    printf("cannot open %s\n", wgtfile);
+    return(-1);
+  }
+  for (i = 0;i < nlayer1;i++)
+  {       //330
+    for (j = 0;j < nlayer2;j++)
+    {     //150
+      fscanf(fpout, "%f\n", &pThis->w1[i][j]);
+    }
+  }
+  for (i = 0;i < nlayer2;i++)
+  {       //150
+    for (j = 0;j < NLAYER3;j++)
+    {     //3
+      fscanf(fpout, "%f\n", &pThis->w2[i][j]);
+    }
+  }
+  for (i = 0;i < MLAYER1;i++)
+  {       //75
+    for (j = 0;j < MLAYER2;j++)
+    {     //40
+      fscanf(fpout, "%f\n", &pThis->v1[i][j]);
+    }
+  }
+  for (i = 0;i < MLAYER2;i++)
+  {       //40
+    for (j = 0;j < MLAYER3;j++)
+    {     //3
+      fscanf(fpout, "%f\n", &pThis->v2[i][j]);
+    }
+  }
+  fclose(fpout);
+
+  return 0;
+}
+
+
+int SSPrediction::SSParamsRead(SSParams* pThis, char evolutionpath[500])
+{
   char file[500] = "";
+  FILE* fp = NULL;
+  char line[5000] = "XXX", aa = 'X';
+  float tmp1 = 0, tmp2 = 0, tmp3 = 0;
 
-  SEG = 21;
-  NLAYER1 = SEG * 25;
-  NLAYER2 = 150;
+  memset(pThis, 0, sizeof(SSParams));
+  sprintf(file, "%s/param/wgtSS1", evolutionpath);
+  if (ReadSSNetWeights(&pThis->wgt1, file, 21 * 25, 150) != 0) return(-1);
+  sprintf(file, "%s/param/wgtSS2", evolutionpath);
+  if (ReadSSNetWeights(&pThis->wgt2, file, 17 * 25, 150) != 0) return(-1);
 
-  Len = Read_score1(fasta, 2.0);      // Score1 is from Blosum62 matrix, normalized by 2.0 and taken as algebric sigmoid function
+  sprintf(file, "%s/param/SSpropensity.txt", evolutionpath);
+  if ((fp = fopen(file, "r")) == NULL)
+  {
+    printf("cannot open propensity.txt\n");
+    return(-1);
+  }
+  fgets(line, 5000, fp);
+  int i = 0;
+  while (!feof(fp) && i < 21)
+  {
+    fgets(line, 5000, fp);
+    if (feof(fp)) break;
+    sscanf(line, "%c %f %f %f", &aa, &tmp1, &tmp2, &tmp3);
+    pThis->amino[i] = aa;
+    pThis->propensity[i][1] = tmp1;
+    pThis->propensity[i][2] = tmp2;
+    pThis->propensity[i][3] = tmp3;
+    i++;
+  }
+  fclose(fp);
 
-  sprintf(wgtfile, "%s/param/wgtSS1", evolutionpath);
-  //printf("XX%s\n", wgtfile);
+  return(0);
+}
 
-  Read_wgt();
-  sprintf(propfile, "%s/param/SSpropensity.txt", evolutionpath);
-  Read_score();          // Score is directly taken from propensity file. It is used by next run also.
 
-  for (i = 1;i <= Len;i++)
+SSPrediction::getSeq2SS::getSeq2SS(char prdA2[MAX_LEN], char fasta[MAX_LEN], char evolutionpath[500])
+{
+  SSParams* pParams = new SSParams;
+  SSParamsRead(pParams, evolutionpath);
+  params = pParams;
+  Predict(prdA2, fasta);
+  delete pParams;
+}
+
+
+SSPrediction::getSeq2SS::getSeq2SS(char prdA2[MAX_LEN], char fasta[MAX_LEN], const SSParams* pParams)
+{
+  params = pParams;
+  Predict(prdA2, fasta);
+}
+
+
+SSPrediction::getSeq2SS::getSeq2SS(const SSParams* pParams)
+{
+  params = pParams;
+  Len = 0;
+}
+
+
+// EEHEE => EEEEE, --H-- => CCCCC, then EEHHEE => EEEEEE, --HH-- => CCCCCC; a position depends on
+// the unsmoothed SS at most 3 residues away
+static void SmoothSS(char* prd, int begin, int end)
+{
+  int i;
+
+  for (i = begin;i <= end;i++)
   {
-    FeedNet(i);
-    Netout();
-    for (j = 0;j < NLAYER3;j++)
+    if ((prd[i - 2] == '2') && (prd[i - 1] == '2') && (prd[i] == '1') && (prd[i + 1] == '2') && (prd[i + 2] == '2'))
+    {
+      prd[i] = '2';
+    }
+    else if ((prd[i - 2] != '1') && (prd[i - 1] != '1') && (prd[i] == '1') && (prd[i + 1] != '1') && (prd[i + 2] != '1'))
     {
-      nout[i][j] = out[j];
+      prd[i] = '3';
     }
   }
-
-  for (i = 1;i <= Len;i++)
+  for (i = begin;i <= end;i++)
   {
-    FeedNet1(i);
-    Netout1();
-
-    pout[i][0] = mout[0];          // 0 > H ; 1 > E ; 2 > C
-    if (mout[1] > mout[0] && mout[1] > mout[2])
+    if ((prd[i - 2] == '2') && (prd[i - 1] == '2') && (prd[i] == '1') && (prd[i + 1] == '1') && (prd[i + 2] == '2') && (prd[i + 3] == '2'))
     {
-      pout[i][1] = mout[1] * 1.3;    // 0 > H ; 1 > E ; 2 > C
+      prd[i] = prd[i + 1] = '2';
     }
-    if (mout[2] > mout[0] && mout[2] > mout[1])
+    else if ((prd[i - 2] != '1') && (prd[i - 1] != '1') && (prd[i] == '1') && (prd[i + 1] == '1') && (prd[i + 2] != '1') && (prd[i + 3] != '1'))
     {
-      pout[i][2] = mout[2] * 1.15;  // 0 > H ; 1 > E ; 2 > C
+      prd[i] = prd[i + 1] = '3';
     }
   }
+}
+
 
-  SEG = 17;
+// the first pass uses wgtSS1 with window 21 and Blosum62 scores normalized by 2.0, the second one
+// wgtSS2 with window 17 and scores normalized by 1.0
+void SSPrediction::getSeq2SS::SetPass(int k)
+{
+  pass = k;
+  SEG = k == 0 ? 21 : 17;
   NLAYER1 = SEG * 25;
-  Len = Read_score1(fasta, 1.0);      // Score1 is from Blosum62 matrix, normalized by 1.0 and taken as algebric sigmoid function
-  sprintf(wgtfile, "%s/param/wgtSS2", evolutionpath);
-  Read_wgt();
+  NLAYER2 = 150;
+  wgt = k == 0 ? &params->wgt1 : &params->wgt2;
+}
 
-  for (i = 1;i <= Len;i++)
+
+void SSPrediction::getSeq2SS::NetRange(int begin, int end)
+{
+  int i, j, r, rows;
+
+  for (i = begin;i <= end;i += NET_BATCH)
   {
-    FeedNet(i);
-    Netout();
-    for (j = 0;j < NLAYER3;j++)
+    rows = end - i + 1 < NET_BATCH ? end - i + 1 : NET_BATCH;
+    for (r = 0;r < rows;r++)
+    {
+      FeedNet(i + r);
+      memcpy(batchIn[r], in1, sizeof(float) * NLAYER1);
+    }
+    utility::LayerBatch(&batchIn[0][0], 525, rows, &wgt->w1[0][0], 150, NLAYER1, NLAYER2, &batchHidden[0][0], 150);
+    for (r = 0;r < rows;r++)
     {
-      nout[i][j] = out[j];
+      memcpy(in2, batchHidden[r], sizeof(float) * NLAYER2);
+      NetoutHidden();
+      for (j = 0;j < NLAYER3;j++)
+      {
+        nout[pass][i + r][j] = out[j];
+      }
     }
   }
+}
 
-  for (i = 1;i <= Len;i++)
+
+void SSPrediction::getSeq2SS::NetRange1(int begin, int end)
+{
+  int i, j;
+
+  for (i = begin;i <= end;i++)
   {
     FeedNet1(i);
     Netout1();
-
-    pout[i][0] += mout[0];        // 0 > H ; 1 > E ; 2 > C
-    if (mout[1] > mout[0] && mout[1] > mout[2])
-    {
-      pout[i][1] += mout[1] * 1.3;    // 0 > H ; 1 > E ; 2 > C
-    }
-    if (mout[2] > mout[0] && mout[2] > mout[1])
+    for (j = 0;j < MLAYER3;j++)
     {
-      pout[i][2] += mout[2] * 1.15;    // 0 > H ; 1 > E ; 2 > C
+      pout[pass][i][j] = mout[j];
     }
   }
+}
 
-  for (i = 1;i <= Len;i++)
+
+void SSPrediction::getSeq2SS::ArgmaxRange(int begin, int end)
+{
+  int i, k;
+  float p[NLAYER3];
+  char* prd = rawSS + 4;
+
+  for (i = begin;i <= end;i++)
   {
-    if (pout[i][0] >= pout[i][1] && pout[i][0] >= pout[i][2])
-    {
-      prdA2[i] = '1';            // H
-    }
-    else if (pout[i][1] >= pout[i][0] && pout[i][1] >= pout[i][2])
-    {
-      prdA2[i] = '2';            // E
-    }
-    else if (pout[i][2] >= pout[i][0] && pout[i][2] >= pout[i][1])
+    p[0] = p[1] = p[2] = 0;
+    for (k = 0;k < 2;k++)
     {
-      prdA2[i] = '3';            // C
+      const float* m = pout[k][i];
+      p[0] += m[0];                  // 0 > H ; 1 > E ; 2 > C
+      if (m[1] > m[0] && m[1] > m[2])
+      {
+        p[1] += m[1] * 1.3;
+      }
+      if (m[2] > m[0] && m[2] > m[1])
+      {
+        p[2] += m[2] * 1.15;
+      }
     }
-  }
 
-  //smooth the predictions 
-  for (i = 1;i <= Len;i++)
-  {  // EEHEE => EEEEE  otherwise   --H-- => CCCCC
-    if ((prdA2[i - 2] == '2') && (prdA2[i - 1] == '2') && (prdA2[i] == '1') && (prdA2[i + 1] == '2') && (prdA2[i + 2] == '2'))
+    if (p[0] >= p[1] && p[0] >= p[2])
     {
-      prdA2[i] = '2';
+      prd[i] = '1';            // H
     }
-    else if ((prdA2[i - 2] != '1') && (prdA2[i - 1] != '1') && (prdA2[i] == '1') && (prdA2[i + 1] != '1') && (prdA2[i + 2] != '1'))
+    else if (p[1] >= p[0] && p[1] >= p[2])
     {
-      prdA2[i] = '3';
+      prd[i] = '2';            // E
     }
-  }
-  for (i = 1;i <= Len;i++)
-  {  // EEHHEE => EEEEEE       otherwise        --HH-- => CCCCCC
-    if ((prdA2[i - 2] == '2') && (prdA2[i - 1] == '2') && (prdA2[i] == '1') && (prdA2[i + 1] == '1') && (prdA2[i + 2] == '2') && (prdA2[i + 3] == '2'))
-    {
-      prdA2[i] = prdA2[i + 1] = '2';
-    }
-    else if ((prdA2[i - 2] != '1') && (prdA2[i - 1] != '1') && (prdA2[i] == '1') && (prdA2[i + 1] == '1') && (prdA2[i + 2] != '1') && (prdA2[i + 3] != '1'))
+    else if (p[2] >= p[0] && p[2] >= p[1])
     {
-      prdA2[i] = prdA2[i + 1] = '3';
+      prd[i] = '3';            // C
     }
   }
+}
 
-  if (FLAG_EVOPHIPSI)
-  {
-    //sprintf(file,"%s/protein.ss2",path);
-    sprintf(file, "./protein.ss2");
-    fp = fopen(file, "w");
-    fprintf(fp, "# SS prediction from single sequence developed by Pralay Mitra\n\n");
-    for (i = 1;i <= Len;i++)
-    {
-      fprintf(fp, "%4d %c ", i, fasta[i - 1]);
-      if (prdA2[i] == '1')   fprintf(fp, "H ");
-      else if (prdA2[i] == '2')  fprintf(fp, "E ");
-      else       fprintf(fp, "C ");
-      fprintf(fp, "%7.3f%7.3f%7.3f\n", pout[i][0] / 2.0, pout[i][1] / 2.0, pout[i][2] / 2.0);
-    }
-    fclose(fp);
-  }
+
+void SSPrediction::getSeq2SS::Predict(char prdA2[MAX_LEN], char fasta[MAX_LEN])
+{
+  /* variable declaration */
+  int i;
+
+  memset(StrA2, '0', sizeof(StrA2)); // no native SS; keeps the unused training targets in range
+  memset(rawSS, 0, sizeof(rawSS));
+
+  SetPass(0);
+  Len = Read_score1(fasta, 2.0);      // Score1 is from Blosum62 matrix, normalized by 2.0 and taken as algebric sigmoid function
+  Read_score();          // Score is directly taken from propensity file. It is used by next run also.
+  NetRange(1, Len);
+  NetRange1(1, Len);
+
+  SetPass(1);
+  Read_score1(fasta, 1.0);      // Score1 is from Blosum62 matrix, normalized by 1.0 and taken as algebric sigmoid function
+  NetRange(1, Len);
+  NetRange1(1, Len);
+
+  ArgmaxRange(1, Len);
+
+  //smooth the predictions
+  memcpy(smoothSS, rawSS, sizeof(smoothSS));
+  SmoothSS(smoothSS + 4, 1, Len);
 
   for (i = 0;i < Len;i++)
   {
-    prdA2[i] = prdA2[i + 1];
+    prdA2[i] = smoothSS[i + 5];
   }
+  prdA2[Len] = '\0';
 }
 
-int SSPrediction::getSeq2SS::Read_score()
+
+void SSPrediction::getSeq2SS::Update(char prdA2[MAX_LEN], char fasta[MAX_LEN], int pos, int* begin, int* end)
 {
-  int i, j, k;
-  FILE* fp;
-  char line[5000] = "XXX", aa = 'X';
-  char amino[22] = "XXX";
-  float propensity[21][4] = { 0 };
-  float tmp1 = 0, tmp2 = 0, tmp3 = 0;
+  int i, k, left, right, lo = Len, hi = 1;
+  char local[MAX_LEN + 8];
 
-  if ((fp = fopen(propfile, "r")) == NULL)
+  i = pos + 1;
+  StrA1[i] = fasta[pos];
+  ResidueScore(i);
+  for (k = 0;k < 2;k++)
   {
-    printf("cannot open propensity.txt\n");
-    return(-1);
+    SetPass(k);
+    left = SEG / 2;
+    right = SEG - 1 - SEG / 2;
+    // rows read by the windows of the first network around the mutation
+    int b = i - left - right, e = i + left + right;
+    for (int r = (b < 1 ? 1 : b);r <= (e > Len ? Len : e);r++) ResidueScore1(r, k == 0 ? 2.0 : 1.0);
+    b = i - right < 1 ? 1 : i - right;
+    e = i + left > Len ? Len : i + left;
+    NetRange(b, e);
+    b = b - right < 1 ? 1 : b - right;
+    e = e + left > Len ? Len : e + left;
+    NetRange1(b, e);
+    if (b < lo) lo = b;
+    if (e > hi) hi = e;
   }
-
-  fgets(line, 5000, fp);
-  i = 0;
-  while (!feof(fp))
+  ArgmaxRange(lo, hi);
+
+  // re-smooth with enough unsmoothed context on both sides to reproduce the sequential pass
+  lo = lo - 4 < 1 ? 1 : lo - 4;
+  hi = hi + 4 > Len ? Len : hi + 4;
+  int ctxLo = lo - 6 < 1 ? 1 : lo - 6;
+  int ctxHi = hi + 6 > Len ? Len : hi + 6;
+  memset(local, 0, sizeof(local));
+  memcpy(local + ctxLo + 4, rawSS + ctxLo + 4, ctxHi - ctxLo + 1);
+  SmoothSS(local + 4, ctxLo, ctxHi);
+  memcpy(smoothSS + lo + 4, local + lo + 4, hi - lo + 1);
+
+  for (i = lo;i <= hi;i++)
   {
-    fgets(line, 5000, fp);
-    if (feof(fp)) break;
-    sscanf(line, "%c %f %f %f", &aa, &tmp1, &tmp2, &tmp3);
-    amino[i] = aa;
-    propensity[i][1] = tmp1;
-    propensity[i][2] = tmp2;
-    propensity[i][3] = tmp3;
-    i++;
+    prdA2[i - 1] = smoothSS[i + 4];
   }
-  fclose(fp);
+  *begin = lo - 1;
+  *end = hi - 1;
+}
+
+int SSPrediction::getSeq2SS::Read_score()
+{
+  int i;
 
   for (i = 1;i <= Len;i++)
   {
-    for (j = 0;j < 20;j++) if (StrA1[i] == amino[j]) break;
-    for (k = 0;k < 3;k++)
-    {
-      Score[i][k] = propensity[j][k + 1];
-    }
+    ResidueScore(i);
   }
 
   return(0);
 }
 
 
-int SSPrediction::getSeq2SS::Read_wgt()
+void SSPrediction::getSeq2SS::ResidueScore(int i)
 {
-  int i, j;
-  FILE* fpout = NULL;
+  int j, k;
 
-  fpout = fopen(wgtfile, "r");       //weight file
-  for (i = 0;i < NLAYER1;i++)
-  {       //330
-    for (j = 0;j < NLAYER2;j++)
-    {     //150
-      fscanf(fpout, "%f\n", &w1[i][j]);
-      Dw1[i][j] = 0.0;
-    }
-  }
-  for (i = 0;i < NLAYER2;i++)
-  {       //150
-    for (j = 0;j < NLAYER3;j++)
-    {     //3
-      fscanf(fpout, "%f\n", &w2[i][j]);
-      Dw2[i][j] = 0.0;
-    }
-  }
-  for (i = 0;i < MLAYER1;i++)
-  {       //75
-    for (j = 0;j < MLAYER2;j++)
-    {     //40
-      fscanf(fpout, "%f\n", &v1[i][j]);
-      Dv1[i][j] = 0.0;
-    }
-  }
-  for (i = 0;i < MLAYER2;i++)
-  {       //40
-    for (j = 0;j < MLAYER3;j++)
-    {     //3
-      fscanf(fpout, "%f\n", &v2[i][j]);
-      Dv2[i][j] = 0.0;
-    }
+  for (j = 0;j < 20;j++) if (StrA1[i] == params->amino[j]) break;
+  for (k = 0;k < 3;k++)
+  {
+    Score[i][k] = params->propensity[j][k + 1];
   }
-  fclose(fpout);
-
-  return 0;
 }
 
 /****************************************************************/
 
 int SSPrediction::getSeq2SS::Read_score1(char fasta[MAX_LEN], float divisor)
 {
-  int i, j, aa_num = 0, Len;
-  char* ncbicodes = "XAXCDEFGHIKLMNPQRSTVWXYXXX";
-  float tmp3 = 0;
-
-  utility::Blosum62 bsm;
+  int i, Len;
 
   // read Score1[][]---------------->
   Len = strlen(fasta);
@@ -268,39 +367,51 @@ int SSPrediction::getSeq2SS::Read_score1(char fasta[MAX_LEN], float divisor)
   }
   for (i = 1;i <= Len;i++)
   {
-    aa_num = bsm.aanum(StrA1[i]);
-    Score1[i][0] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[1]));
-    Score1[i][4] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[3]));
-    Score1[i][3] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[4]));
-    Score1[i][6] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[5]));
-    Score1[i][13] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[6]));
-    Score1[i][7] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[7]));
-    Score1[i][8] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[8]));
-    Score1[i][9] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[9]));
-    Score1[i][11] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[10]));
-    Score1[i][10] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[11]));
-    Score1[i][12] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[12]));
-    Score1[i][2] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[13]));
-    Score1[i][14] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[14]));
-    Score1[i][5] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[15]));
-    Score1[i][1] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[16]));
-    Score1[i][15] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[17]));
-    Score1[i][16] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[18]));
-    Score1[i][19] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[19]));
-    Score1[i][17] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[20]));
-    Score1[i][18] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[22]));
-
-    for (j = 0;j < 20;j++)
-    {
-      tmp3 = Score1[i][j] / divisor;
-      Score1[i][j] = tmp3 / sqrt(1.0 + tmp3 * tmp3);
-    }
-    Score1[i][20] = 0;
+    ResidueScore1(i, divisor);
   }
 
   return Len;
 }
 
+
+void SSPrediction::getSeq2SS::ResidueScore1(int i, float divisor)
+{
+  int j, aa_num = 0;
+  char* ncbicodes = "XAXCDEFGHIKLMNPQRSTVWXYXXX";
+  float tmp3 = 0;
+
+  utility::Blosum62 bsm;
+
+  aa_num = bsm.aanum(StrA1[i]);
+  Score1[i][0] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[1]));
+  Score1[i][4] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[3]));
+  Score1[i][3] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[4]));
+  Score1[i][6] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[5]));
+  Score1[i][13] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[6]));
+  Score1[i][7] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[7]));
+  Score1[i][8] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[8]));
+  Score1[i][9] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[9]));
+  Score1[i][11] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[10]));
+  Score1[i][10] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[11]));
+  Score1[i][12] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[12]));
+  Score1[i][2] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[13]));
+  Score1[i][14] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[14]));
+  Score1[i][5] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[15]));
+  Score1[i][1] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[16]));
+  Score1[i][15] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[17]));
+  Score1[i][16] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[18]));
+  Score1[i][19] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[19]));
+  Score1[i][17] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[20]));
+  Score1[i][18] = bsm.aamat(aa_num, bsm.aanum(ncbicodes[22]));
+
+  for (j = 0;j < 20;j++)
+  {
+    tmp3 = Score1[i][j] / divisor;
+    Score1[i][j] = tmp3 / sqrt(1.0 + tmp3 * tmp3);
+  }
+  Score1[i][20] = 0;
+}
+
 /********************************************************************/
 void SSPrediction::getSeq2SS::FeedNet(int I)
 {
@@ -363,15 +474,13 @@ void SSPrediction::getSeq2SS::FeedNet(int I)
 }
 
 /**************************************************************************/
-void SSPrediction::getSeq2SS::Netout()
+// sigmoid hidden layer and output layer, from the hidden-layer sums that the batched first layer left in in2
+void SSPrediction::getSeq2SS::NetoutHidden()
 {
   int i, j;
 
   for (i = 0;i < NLAYER2;i++)
   {
-    in2[i] = 0.0;
-    for (j = 0;j < NLAYER1;j++)
-      in2[i] += w1[j][i] * in1[j];
     out2[i] = 1.0 / (1.0 + exp(-1.0 * in2[i]));
   }
 
@@ -379,7 +488,7 @@ void SSPrediction::getSeq2SS::Netout()
   {
     in3[i] = 0.0;
     for (j = 0;j < NLAYER2;j++)
-      in3[i] += w2[j][i] * out2[j];
+      in3[i] += wgt->w2[j][i] * out2[j];
     out[i] = 1.0 / (1.0 + exp(-1.0 * in3[i]));
   }
 }
@@ -408,7 +517,7 @@ void SSPrediction::getSeq2SS::FeedNet1(int I)
     {
       for (j = 0;j < NLAYER3;j++)
       {
-        im1[k] = nout[i][j];
+        im1[k] = nout[pass][i][j];
         k++;
       }
       im1[k] = 0.0;
@@ -433,7 +542,7 @@ void SSPrediction::getSeq2SS::Netout1()
   {
     im2[i] = 0.0;
     for (j = 0;j < MLAYER1;j++)
-      im2[i] += v1[j][i] * im1[j];
+      im2[i] += wgt->v1[j][i] * im1[j];
     mout2[i] = 1.0 / (1.0 + exp(-1.0 * im2[i]));
   }
 
@@ -441,7 +550,7 @@ void SSPrediction::getSeq2SS::Netout1()
   {
     im3[i] = 0.0;
     for (j = 0;j < MLAYER2;j++)
-      im3[i] += v2[j][i] * mout2[j];
+      im3[i] += wgt->v2[j][i] * mout2[j];
     mout[i] = 1.0 / (1.0 + exp(-1.0 * im3[i]));
   }
 }
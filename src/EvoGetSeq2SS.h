@@ -21,6 +21,25 @@ IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 namespace SSPrediction
 {
+  // weights of one two-layer network (sequence window -> SS, then SS window -> smoothed SS)
+  struct SSNetWeights
+  {
+    float w1[525][150];
+    float w2[150][NLAYER3];
+    float v1[MLAYER1][MLAYER2];
+    float v2[MLAYER2][MLAYER3];
+  };
+
+  // everything the predictor reads from the evolution parameter directory, loaded once and shared read-only
+  struct SSParams
+  {
+    SSNetWeights wgt1; // wgtSS1, window 21
+    SSNetWeights wgt2; // wgtSS2, window 17
+    char amino[22];
+    float propensity[21][4];
+  };
+
+  int SSParamsRead(SSParams* pThis, char path[500]);
 
   class getSeq2SS
   {
@@ -38,30 +57,43 @@ namespace SSPrediction
     #define LenScale 1000 */
 
     /* variable declaration */
-    int Len, SEG, NLAYER1, NLAYER2;
+    int Len, SEG, NLAYER1, NLAYER2, pass;
     char StrA1[MAX_LEN], StrA2[MAX_LEN];
 
     float Score1[MAX_LEN][21], Score[MAX_LEN][4];
-    float nout[MAX_LEN][NLAYER3], tgtout[NLAYER3], mout[MLAYER3];
+    float nout[2][MAX_LEN][NLAYER3], tgtout[NLAYER3], mout[MLAYER3];
+    float pout[2][MAX_LEN][MLAYER3];   // second-network outputs of both passes
+    char rawSS[MAX_LEN + 8];           // argmax and smoothed SS, residue i at [i + 4] so the smoothing look-around stays in bounds
+    char smoothSS[MAX_LEN + 8];
 
     float im1[MLAYER1], im2[MLAYER2], mout2[MLAYER2], im3[MLAYER3];
     float in1[525], in2[150], out2[150], in3[NLAYER3], out[NLAYER3];
+    float batchIn[NET_BATCH][525], batchHidden[NET_BATCH][150];
 
-    float v1[MLAYER1][MLAYER2], Dv1[MLAYER1][MLAYER2];
-    float v2[MLAYER2][MLAYER3], Dv2[MLAYER2][MLAYER3];
-    float w1[525][150], Dw1[525][150];
-    float w2[150][NLAYER3], Dw2[150][NLAYER3];
+    const SSParams* params;
+    const SSNetWeights* wgt;
 
-    char wgtfile[500], propfile[500];
+    void SetPass(int k);
+    void NetRange(int begin, int end);
+    void NetRange1(int begin, int end);
+    void ArgmaxRange(int begin, int end);
 
     /* function declaration */
   public:
     getSeq2SS(char prdA2[MAX_LEN], char fasta[MAX_LEN], char path[500]);
-    int Read_wgt();
+    getSeq2SS(char prdA2[MAX_LEN], char fasta[MAX_LEN], const SSParams* pParams);
+    // keeps the network outputs of the last predicted sequence so that Update() can follow single-site mutations
+    getSeq2SS(const SSParams* pParams);
+    void Predict(char prdA2[MAX_LEN], char fasta[MAX_LEN]);
+    // fasta differs from the last predicted sequence at pos only; prdA2 holds the last prediction and
+    // is rewritten over [*begin, *end], the positions whose SS may have changed
+    void Update(char prdA2[MAX_LEN], char fasta[MAX_LEN], int pos, int* begin, int* end);
     int Read_score1(char fasta[MAX_LEN], float divisor);
     int Read_score();
+    void ResidueScore1(int i, float divisor);
+    void ResidueScore(int i);
     void FeedNet(int I);
-    void Netout();
+    void NetoutHidden();
     void FeedNet1(int I);
     void Netout1();
   };
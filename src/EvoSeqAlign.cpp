@@ -23,6 +23,7 @@ IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #pragma warning(disable:4244)
 #include "EvoSeqAlign.h"
 #include "EvoAminoName.h"
+#include <float.h>
 #include <string.h>
 
 
@@ -32,11 +33,89 @@ namespace Text
 }
 
 
+// score of the cells outside the band; low enough to never be chosen, finite so that adding penalties keeps it finite
+static const float OUT_OF_BAND = -1.0e30f;
+
+
+static inline float Max3(const float d1, const float d2, const float d3)
+{
+  float max;
+
+  if (d1 > d2)
+    max = d1;
+  else
+    max = d2;
+
+  if (d3 > max)
+    max = d3;
+
+  return max;
+}
+
+
+// CONSTRUCTOR: CharSeq::SeqAlign::SeqAlign()		// PURPOSE: an empty aligner whose buffers are reused by Align()
+CharSeq::SeqAlign::SeqAlign()
+{
+  len = 0;
+  prf = NULL;
+  phiT = psiT = phiQ = psiQ = NULL;
+  ownFeatures = false;
+  rows = NULL;
+  capacity = 0;
+  maxScore = 0.0;
+  usedBand = 0;
+}
+
+
 // CONSTRUCTOR: CharSeq::SeqAlign::SeqAlign()
 CharSeq::SeqAlign::SeqAlign(SequenceData dsInfo, char prffile[500], char phipsifile[500], float wss, float wsa, float wang)
 {
-  int i, j;
+  rows = NULL;
+  capacity = 0;
+  init(dsInfo, wss, wsa, wang);
+  ownFeatures = true;
+  readMkPrf(prffile);			// read the profile
+  readPhiPsi(phipsifile);	// read target and designed phi-psi
+  align(SEQ_ALIGN_BAND_AUTO);
+}
+
+
+CharSeq::SeqAlign::SeqAlign(SequenceData dsInfo, float** prfTarget, float* phiTarget, float* psiTarget, float* phiQuery, float* psiQuery, float wss, float wsa, float wang)
+{
+  rows = NULL;
+  capacity = 0;
+  ownFeatures = false;
+  Align(dsInfo, prfTarget, phiTarget, psiTarget, phiQuery, psiQuery, wss, wsa, wang, SEQ_ALIGN_BAND_AUTO);
+}
+
+
+float CharSeq::SeqAlign::Align(SequenceData dsInfo, float** prfTarget, float* phiTarget, float* psiTarget, float* phiQuery, float* psiQuery, float wss, float wsa, float wang, int band)
+{
+  if (ownFeatures)
+  {
+    for (int i = 0; i < len; ++i)
+      delete[] prf[i];
+    delete[] prf;
+    delete[] phiT;
+    delete[] psiT;
+    delete[] phiQ;
+    delete[] psiQ;
+    ownFeatures = false;
+  }
+  init(dsInfo, wss, wsa, wang);
+  prf = prfTarget;
+  phiT = phiTarget;
+  psiT = psiTarget;
+  phiQ = phiQuery;
+  psiQ = psiQuery;
+  align(band);
+
+  return maxScore;
+}
+
 
+void CharSeq::SeqAlign::init(SequenceData dsInfo, float wss, float wsa, float wang)
+{
   len = dsInfo.len;
   weight_ss = wss;
   weight_sa = wsa;
@@ -47,59 +126,122 @@ CharSeq::SeqAlign::SeqAlign(SequenceData dsInfo, char prffile[500], char phipsif
   strcpy(secstr2, dsInfo.ss2);
   strcpy(solacc1, dsInfo.sa1);
   strcpy(solacc2, dsInfo.sa2);
+}
 
-  readMkPrf(prffile);			// read the profile
-  readPhiPsi(phipsifile);	// read target and designed phi-psi
 
-    // initialize alignment matrices
-  D1 = getMtx();
-  for (j = 0; j < len; ++j)
-  {
-    MtxItem tmp(2 * GAP_OPEN_PENALTY + j * GAP_XTN_PENALTY, false, false, false);
-    D1[0][j] = tmp;
-  }
+void CharSeq::SeqAlign::allocRows(int length)
+{
+  if (length <= capacity) return;
 
-  D2 = getMtx();
-  for (i = 0; i < len; ++i)
+  delete[] rows;
+  capacity = length;
+  rows = new float[6 * capacity];
+  for (int k = 0; k < 2; ++k)
   {
-    MtxItem tmp(2 * GAP_OPEN_PENALTY + i * GAP_XTN_PENALTY, false, false, false);
-    D2[i][0] = tmp;
+    D1[k] = rows + (3 * k) * capacity;
+    D2[k] = rows + (3 * k + 1) * capacity;
+    D3[k] = rows + (3 * k + 2) * capacity;
   }
+}
 
-  D3 = getMtx();
-  MtxItem tmp(Score(0, 0), false, false, false);
-  D3[0][0] = tmp;
-  for (j = 1; j < len; ++j)
-  {
-    MtxItem tmp(GAP_OPEN_PENALTY + (j - 1) * GAP_XTN_PENALTY + Score(0, j), false, false, false);
-    D3[0][j] = tmp;
-  }
-  for (i = 1; i < len; ++i)
-  {
-    MtxItem tmp(GAP_OPEN_PENALTY + (i - 1) * GAP_XTN_PENALTY + Score(i, 0), false, false, false);
-    D3[i][0] = tmp;
-  }
 
-  for (i = 1; i < len; ++i)
-  {
-    updateD1(i, 0);
-  }
+// FUNCTION: CharSeq::SeqAlign::exactBand()
+// PURPOSE: returns the narrowest band that contains the optimal alignment.
+// NOTES: an alignment scores at most the sum of the best match score of every target column plus one gap penalty
+//        per unmatched residue. An alignment through a cell with |i - j| > band matches at most len - band - 1 pairs,
+//        so it pays at least 2 * (band + 1) gap penalties; once that bound falls below the score of the no-gap
+//        alignment, no alignment leaving the band can be optimal.
+int CharSeq::SeqAlign::exactBand()
+{
+  const double gap = (GAP_OPEN_PENALTY > GAP_XTN_PENALTY) ? GAP_OPEN_PENALTY : GAP_XTN_PENALTY;
+  if (len <= 1 || gap >= 0.0) return len - 1;
 
-  for (j = 1; j < len; ++j)
+  double extra = fabs(weight_ss) + fabs(weight_sa);
+  double angle = fabs(weight_angle) * 360.0;
+  double bound = 0.0, magnitude = 0.0;
+  for (int j = 0; j < len; ++j)
   {
-    updateD2(0, j);
+    float best = prf[j][0], largest = fabs(prf[j][0]);
+    for (int k = 1; k < AMINOS; ++k)
+    {
+      if (prf[j][k] > best) best = prf[j][k];
+      if (fabs(prf[j][k]) > largest) largest = fabs(prf[j][k]);
+    }
+    double match = best + extra + (weight_angle < 0.0 ? angle : 0.0);
+    if (match > 0.0) bound += match;
+    magnitude += largest + extra + angle - 2.0 * gap;
   }
 
-  // compute optimal alignment
+  float diagonal = Score(0, 0);
+  for (int i = 1; i < len; ++i)
+    diagonal = diagonal + Score(i, i);
+
+  // allowance for the float rounding along an alignment of at most 2 * len steps
+  double slack = 2.0 * len * magnitude * FLT_EPSILON + 1.0e-3;
+  double band = floor((bound - diagonal + slack) / (-2.0 * gap));
+  if (band < 0.0) return 0;
+  if (band >= len - 1) return len - 1;
+  return (int)band;
+}
+
+
+void CharSeq::SeqAlign::align(int band)
+{
+  int i, j, lo, hi;
+
+  allocRows(len);
+  if (band < 0) band = exactBand();
+  if (band > len - 1) band = len - 1;
+  usedBand = band;
+
+  // first row
+  float* cur1 = D1[0], * cur2 = D2[0], * cur3 = D3[0];
+  for (j = 0; j <= band; ++j)
+    cur1[j] = 2 * GAP_OPEN_PENALTY + j * GAP_XTN_PENALTY;
+  cur2[0] = 2 * GAP_OPEN_PENALTY + 0 * GAP_XTN_PENALTY;
+  cur3[0] = Score(0, 0);
+  for (j = 1; j <= band; ++j)
+    cur3[j] = GAP_OPEN_PENALTY + (j - 1) * GAP_XTN_PENALTY + Score(0, j);
+  for (j = 1; j <= band; ++j)
+    cur2[j] = Max3(cur1[j - 1] + GAP_OPEN_PENALTY, cur2[j - 1] + GAP_XTN_PENALTY, cur3[j - 1] + GAP_OPEN_PENALTY);
+  if (band + 1 < len)
+    cur1[band + 1] = cur2[band + 1] = cur3[band + 1] = OUT_OF_BAND;
+
+  // compute optimal alignment row by row; the cells next to the band are marked for the following rows
   for (i = 1; i < len; ++i)
   {
-    for (j = 1; j < len; ++j)
+    const float* prev1 = D1[(i - 1) & 1], * prev2 = D2[(i - 1) & 1], * prev3 = D3[(i - 1) & 1];
+    cur1 = D1[i & 1];
+    cur2 = D2[i & 1];
+    cur3 = D3[i & 1];
+    lo = (i - band > 0) ? i - band : 0;
+    hi = (i + band < len - 1) ? i + band : len - 1;
+
+    if (lo == 0)
+    {
+      cur1[0] = Max3(prev1[0] + GAP_XTN_PENALTY, prev2[0] + GAP_OPEN_PENALTY, prev3[0] + GAP_OPEN_PENALTY);
+      cur2[0] = 2 * GAP_OPEN_PENALTY + i * GAP_XTN_PENALTY;
+      cur3[0] = GAP_OPEN_PENALTY + (i - 1) * GAP_XTN_PENALTY + Score(i, 0);
+      lo = 1;
+    }
+    else
     {
-      updateD1(i, j);
-      updateD2(i, j);
-      updateD3(i, j);
+      cur1[lo - 1] = cur2[lo - 1] = cur3[lo - 1] = OUT_OF_BAND;
     }
+
+    for (j = lo; j <= hi; ++j)
+    {
+      const float score = Score(i, j);
+      cur1[j] = Max3(prev1[j] + GAP_XTN_PENALTY, prev2[j] + GAP_OPEN_PENALTY, prev3[j] + GAP_OPEN_PENALTY);
+      cur2[j] = Max3(cur1[j - 1] + GAP_OPEN_PENALTY, cur2[j - 1] + GAP_XTN_PENALTY, cur3[j - 1] + GAP_OPEN_PENALTY);
+      cur3[j] = Max3(prev1[j - 1] + score, prev2[j - 1] + score, prev3[j - 1] + score);
+    }
+    if (hi + 1 < len)
+      cur1[hi + 1] = cur2[hi + 1] = cur3[hi + 1] = OUT_OF_BAND;
   }
+
+  const int last = (len - 1) & 1;
+  maxScore = Max3(D1[last][len - 1], D2[last][len - 1], D3[last][len - 1]);
 }
 
 
@@ -111,8 +253,6 @@ void CharSeq::SeqAlign::readPhiPsi(char phipsifile[500])
 
   phiT = new float[len];
   psiT = new float[len];
-  phiQ = new float[len];
-  psiQ = new float[len];
 
   fp = fopen(phipsifile, "r");
   if (fp == NULL)
@@ -134,6 +274,19 @@ void CharSeq::SeqAlign::readPhiPsi(char phipsifile[500])
     fclose(fp);
   }
 
+  readQueryPhiPsi();
+}
+
+
+void CharSeq::SeqAlign::readQueryPhiPsi()
+{
+  FILE* fp;
+  int i;
+  float ang;
+
+  phiQ = new float[len];
+  psiQ = new float[len];
+
   fp = fopen("./qphi.txt", "r");
   if (fp == NULL)
   {
@@ -209,27 +362,6 @@ void CharSeq::SeqAlign::readMkPrf(char* prffile)
   fclose(fp);
 }
 
-// CONSTRUCTOR: CharSeq::SeqAlign::MtxItem::MtxItem()
-CharSeq::SeqAlign::MtxItem::MtxItem(const float s, const bool pv1, const bool pv2, const bool pv3)
-{
-  score = s;
-  pvmtx[D1E] = pv1;
-  pvmtx[D2E] = pv2;
-  pvmtx[D3E] = pv3;
-}
-
-// CONSTRUCTOR: CharSeq::SeqAlign::MtxItem::MtxItem()
-// ARGUMENTS:	--> max: maximum value among d1, d2, and d3 ---> d1, d2, d3: scores from D1, D2, and D3, respectively.
-// PURPOSE:	assigns max to score and sets to true the flags of those matrices whose score equals max.
-CharSeq::SeqAlign::MtxItem::MtxItem(const float max, const float d1, const float d2, const float d3)
-{
-  score = max;
-  pvmtx[D1E] = (max == d1) ? true : false;
-  pvmtx[D2E] = (max == d2) ? true : false;
-  pvmtx[D3E] = (max == d3) ? true : false;
-}
-
-
 //	i1 = Query (Template)
 //	i2 = Target (Decoy)
 float CharSeq::SeqAlign::Score(const int i1, const int i2)
@@ -280,122 +412,33 @@ float CharSeq::SeqAlign::Score(const int i1, const int i2)
 }
 
 
-// FUNCTION: CharSeq::SeqAlign::getMtx()		// PURPOSE: returns an empty alignment matrix
-CharSeq::SeqAlign::MtxItem** CharSeq::SeqAlign::getMtx() const
+// FUNCTION: CharSeq::SeqAlign::printMtxInfo() 		// PURPOSE: returns the optimal alignment score
+float CharSeq::SeqAlign::printMtxInfo() const
 {
-  MtxItem** mtx = new MtxItem * [len];
-  for (int i = 0; i < len; ++i)
-    mtx[i] = new MtxItem[len];
-
-  return mtx;
+  return maxScore;
 }
 
 
-// FUNCTION: CharSeq::SeqAlign::updateD1()		// PURPOSE: fills in an item in D1
-// ARGUMENTS:	 ---> i: item's row	 ---> j: item's column
-void CharSeq::SeqAlign::updateD1(const int i, const int j)
+// FUNCTION: CharSeq::SeqAlign::UsedBand() 		// PURPOSE: returns the band of the last alignment (len - 1 for the full matrices)
+int CharSeq::SeqAlign::UsedBand() const
 {
-  const float d1 = D1[i - 1][j].score + GAP_XTN_PENALTY;
-  const float d2 = D2[i - 1][j].score + GAP_OPEN_PENALTY;
-  const float d3 = D3[i - 1][j].score + GAP_OPEN_PENALTY;
-
-  float max;
-
-  if (d1 > d2)
-    max = d1;
-  else
-    max = d2;
-
-  if (d3 > max)
-    max = d3;
-
-  D1[i][j] = MtxItem(max, d1, d2, d3);
-}
-
-// FUNCTION: CharSeq::SeqAlign::updateD2()		// PURPOSE: fills in an item in D2
-// ARGUMENTS:	 ---> i: item's row	---> j: item's column
-void CharSeq::SeqAlign::updateD2(const int i, const int j)
-{
-  const float d1 = D1[i][j - 1].score + GAP_OPEN_PENALTY;
-  const float d2 = D2[i][j - 1].score + GAP_XTN_PENALTY;
-  const float d3 = D3[i][j - 1].score + GAP_OPEN_PENALTY;
-
-  float max;
-
-  if (d1 > d2)
-    max = d1;
-  else
-    max = d2;
-
-  if (d3 > max)
-    max = d3;
-
-  D2[i][j] = MtxItem(max, d1, d2, d3);
-}
-
-// FUNCTION: CharSeq::SeqAlign::updateD3()		// PURPOSE: fills in an item in D3
-// ARGUMENTS:	 ---> i: item's row			---> j: item's column
-void CharSeq::SeqAlign::updateD3(const int i, const int j)
-{
-
-  const float d1 = D1[i - 1][j - 1].score + Score(i, j);
-  const float d2 = D2[i - 1][j - 1].score + Score(i, j);
-  const float d3 = D3[i - 1][j - 1].score + Score(i, j);
-
-  float max;
-
-  if (d1 > d2)
-    max = d1;
-  else
-    max = d2;
-
-  if (d3 > max)
-    max = d3;
-
-  D3[i][j] = MtxItem(max, d1, d2, d3);
-}
-
-// FUNCTION: CharSeq::SeqAlign::printMtxInfo() 		// PURPOSE: prints information from the D matrices, such as the scores and the	"previous" fields.
-float CharSeq::SeqAlign::printMtxInfo() const
-{
-
-  int a, b;
-  float max, d1, d2, d3;
-
-  a = len - 1;
-  b = len - 1;
-  d1 = D1[a][b].score;
-  d2 = D2[a][b].score;
-  d3 = D3[a][b].score;
-
-  if (d1 > d2)
-    max = d1;
-  else
-    max = d2;
-
-  if (d3 > max)
-    max = d3;
-
-  return max;
-  //	printf("%f\n", max);
+  return usedBand;
 }
 
 // DESTRUCTOR: CharSeq::SeqAlign::~SeqAlign() 
 CharSeq::SeqAlign::~SeqAlign()
 {
-  for (int i = 0; i < len; ++i)	delete[] D3[i];
-  delete[] D3;
-  for (int i = 0; i < len; ++i)	delete[] D2[i];
-  delete[] D2;
-  for (int i = 0; i < len; ++i)	delete[] D1[i];
-  delete[] D1;
-  for (int i = 0; i < len; ++i)
-    delete[] prf[i];
-  delete[] prf;
-
-  delete[] phiT;
-  delete[] psiT;
-  delete[] phiQ;
-  delete[] psiQ;
+  delete[] rows;
+  if (ownFeatures)
+  {
+    for (int i = 0; i < len; ++i)
+      delete[] prf[i];
+    delete[] prf;
+
+    delete[] phiT;
+    delete[] psiT;
+    delete[] phiQ;
+    delete[] psiQ;
+  }
 }
 
@@ -34,6 +34,8 @@ IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 namespace CharSeq
 {
+  // band of SeqAlign::Align(): the narrowest band proven to contain the optimal alignment
+  const int SEQ_ALIGN_BAND_AUTO = -1;
 
   class SeqAlign
   {
@@ -44,39 +46,41 @@ namespace CharSeq
     float weight_ss, weight_sa, weight_angle;
     char seq[MAX_LEN], secstr1[MAX_LEN], secstr2[MAX_LEN], solacc1[MAX_LEN], solacc2[MAX_LEN];
     float* phiT, * psiT, * phiQ, * psiQ;
-
-    enum Denum { D1E, D2E, D3E }; // identifiers for the alignment matrices
-
-    // type for any item in an alignment matrix
-    struct MtxItem
-    {
-      float score;  // (optimal) alignment score
-      bool pvmtx[3]; // tells which matrices provided the optimal previous-step sub-score
-
-      MtxItem() {};
-      MtxItem(const float s, const bool pv1, const bool pv2, const bool pv3);
-      MtxItem(const float max, const float d1, const float d2, const float d3);
-    };
-
-    // DX[i][j].score = optimal align. score of s1[0],...,s1[i] and s2[0],...,s2[j]
-    MtxItem** D1; // D1[i][j].score = score of the alignment ending with (s1[i], -)
-    MtxItem** D2; // D2[i][j].score = score of the alignment ending with (-, s2[j])
-    MtxItem** D3; // D3[i][j].score = score of the alignment ending with (s1[i], s2[j])
-
-    MtxItem** getMtx() const;
-
-    void updateD1(const int i, const int j);
-    void updateD2(const int i, const int j);
-    void updateD3(const int i, const int j);
-
+    bool ownFeatures; // false if prf and the phi/psi arrays are borrowed from the caller
+
+    // only the previous and the current rows of the alignment matrices are kept; they are reused by
+    // every alignment of the same object and grow only when a longer sequence is aligned
+    // DX[i][j] = optimal align. score of s1[0],...,s1[i] and s2[0],...,s2[j]
+    // D1: the alignment ends with (s1[i], -), D2: with (-, s2[j]), D3: with (s1[i], s2[j])
+    float* rows;
+    int capacity;
+    float* D1[2];
+    float* D2[2];
+    float* D3[2];
+    float maxScore;
+    int usedBand;
+
+    void allocRows(int length);
     void readMkPrf(char prffile[500]);
     void readPhiPsi(char phipsipath[500]);
+    void readQueryPhiPsi();
+    void init(SequenceData dsInfo, float wss, float wsa, float wang);
+    int exactBand();
+    void align(int band);
     float Score(const int i1, const int i2);
 
   public:
+    SeqAlign();
     SeqAlign(SequenceData dsInfo, char prffile[500], char path[500], float wss, float wsa, float wang);
+    // target profile and target/query phi/psi given in memory; they must outlive the alignment
+    SeqAlign(SequenceData dsInfo, float** prfTarget, float* phiTarget, float* psiTarget, float* phiQuery, float* psiQuery, float wss, float wsa, float wang);
     ~SeqAlign();
+    // aligns again with the buffers of this object; only cells with |i - j| <= band are computed, which gives
+    // the full-matrix score whenever the optimal alignment lies in the band (band = 0 is the no-gap alignment);
+    // SEQ_ALIGN_BAND_AUTO picks the band from a bound on the score of any alignment leaving it
+    float Align(SequenceData dsInfo, float** prfTarget, float* phiTarget, float* psiTarget, float* phiQuery, float* psiQuery, float wss, float wsa, float wang, int band);
     float printMtxInfo() const;
+    int UsedBand() const;
   };
 }
 
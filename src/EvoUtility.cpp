@@ -83,6 +83,57 @@ int utility::Blosum62::aanum(int ch)
   return (isalpha(ch) ? aacvs[ch & 31] : 22);
 }
 
+void utility::LayerBatch(const float* in, int inStride, int rows, const float* w, int wStride, int nin, int nout, float* out, int outStride)
+{
+  int r = 0;
+  for (r = 0;r < rows;r++)
+  {
+    memset(out + r * outStride, 0, sizeof(float) * nout);
+  }
+  // four rows at a time share every loaded weight vector; adding a zero product leaves a sum unchanged,
+  // so windows padded with zeros are skipped only when all four inputs are zero
+  for (r = 0;r + 4 <= rows;r += 4)
+  {
+    const float* x0 = in + r * inStride;
+    const float* x1 = x0 + inStride;
+    const float* x2 = x1 + inStride;
+    const float* x3 = x2 + inStride;
+    float* o0 = out + r * outStride;
+    float* o1 = o0 + outStride;
+    float* o2 = o1 + outStride;
+    float* o3 = o2 + outStride;
+    for (int j = 0;j < nin;j++)
+    {
+      float a0 = x0[j], a1 = x1[j], a2 = x2[j], a3 = x3[j];
+      if (a0 == 0 && a1 == 0 && a2 == 0 && a3 == 0) continue;
+      const float* wj = w + j * wStride;
+#pragma omp simd
+      for (int i = 0;i < nout;i++)
+      {
+        o0[i] += wj[i] * a0;
+        o1[i] += wj[i] * a1;
+        o2[i] += wj[i] * a2;
+        o3[i] += wj[i] * a3;
+      }
+    }
+  }
+  for (;r < rows;r++)
+  {
+    const float* x = in + r * inStride;
+    float* o = out + r * outStride;
+    for (int j = 0;j < nin;j++)
+    {
+      if (x[j] == 0) continue;
+      const float* wj = w + j * wStride;
+#pragma omp simd
+      for (int i = 0;i < nout;i++)
+      {
+        o[i] += wj[i] * x[j];
+      }
+    }
+  }
+}
+
 int Text::ncharLine(FILE* fp)
 {
   int count = 0;
@@ -34,6 +34,7 @@ IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define LAMDA 0.9 //momentum: keep last weight
 #define MAX_LEN 1000//4000
 #define LenScale 1000
+#define NET_BATCH 32 // sequence positions whose first hidden layer is evaluated together
 
 #define	GAP_OPEN_PENALTY -11.0 // gap open penalty
 #define GAP_XTN_PENALTY -11.0 // -1.0 // gap extension penalty (not added to gapo)
@@ -50,6 +51,10 @@ namespace utility
     short aamat(int i, int j);
   };
 
+  // out[r][i] = sum over j of in[r][j] * w[j][i] for a batch of rows, summed in the order of j like the
+  // per-position loops; each row of w is read once for the whole batch
+  void LayerBatch(const float* in, int inStride, int rows, const float* w, int wStride, int nin, int nout, float* out, int outStride);
+
 }
 
 typedef struct _SequenceData
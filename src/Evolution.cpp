@@ -78,14 +78,20 @@ IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "ErrorTracker.h"
 #include "EvoAminoName.h"
 #include "Utility.h"
+#include "Evolution.h"
 
 float wss = 1.58;
 float wsa = 2.45;
 float wang = 1.00;
 
+// beyond this many changed sites the cached predictions are recomputed from scratch
+#define EVOLUTION_CACHE_MAX_UPDATE 4
+
 using namespace CharSeq;
 
 extern float** PROT_PROFILE;
+extern EvolutionScorer* EVO_SCORER;
+extern int EVO_ALIGN_BAND;
 extern char PROGRAM_PATH[MAX_LEN_ONE_LINE_CONTENT + 1];
 extern char TGT_PRF[MAX_LEN_FILE_NAME + 1];
 extern char TGT_SA[MAX_LEN_FILE_NAME + 1];
@@ -216,88 +222,58 @@ float EvolutionScorePrfFromFile(char* seqfile)
 
 float EvolutionScoreAllFromSeq(char* seq)
 {
-  char evolutiondir[500] = "";
-  sprintf(evolutiondir, "%s/evolution", PROGRAM_PATH);
-  //printf("evolution parameter file path is: %s\n", evolutiondir);
-
-  SequenceData dsInfo;
-  dsInfo.len = strlen(seq);
-  dsInfo.seq = new char[dsInfo.len + 1];
-  strcpy(dsInfo.seq, seq);
-
-  dsInfo.ss1 = new char[dsInfo.len + 1];
-  SSPrediction::getSeq2SS SS(dsInfo.ss1, dsInfo.seq, evolutiondir);
-  dsInfo.sa1 = new char[dsInfo.len + 1];
-  SAPrediction::getSeq2SA SA(dsInfo.sa1, dsInfo.seq, dsInfo.ss1, evolutiondir);
-
-  //phi-psi prediction
-  PhiPsiPrediction::getPhiPsi(dsInfo, evolutiondir);
-
-  dsInfo.ss2 = new char[dsInfo.len + 1];
-  FILE* fp = fopen(TGT_SS, "r");
-  fscanf(fp, "%s", dsInfo.ss2);
-  fclose(fp);
-  dsInfo.sa2 = new char[dsInfo.len + 1];
-  fp = fopen(TGT_SA, "r");
-  fscanf(fp, "%s", dsInfo.sa2);
-  fclose(fp);
+  if (EVO_SCORER != NULL && EVO_SCORER->len == (int)strlen(seq))
+  {
+    return EvolutionScorerScoreAll(EVO_SCORER, seq);
+  }
 
+  EvolutionScorer scorer;
+  if (EvolutionScorerCreate(&scorer, strlen(seq)) != Success)
+  {
+    EvolutionScorerDestroy(&scorer);
+    return 0.0;
+  }
+  float score = EvolutionScorerScoreAll(&scorer, seq);
+  EvolutionScorerDestroy(&scorer);
 
-  wsa /= (dsInfo.len * 1.0);    // weight for solvent accessibility
-  wss /= (dsInfo.len * 1.0);    // weight for secondary structure
-  wang /= (dsInfo.len * 180.0);  // weight for phi-psi prediction
+  return score;
+}
 
-  CharSeq::SeqAlign sa(dsInfo, TGT_PRF, TGT_PHIPSI, wss, wsa, wang);
 
-  float max = sa.printMtxInfo();
-  //printf("%f\n",max);
+float EvolutionScorePrfSSSAFromSeq(char* seq)
+{
+  if (EVO_SCORER != NULL && EVO_SCORER->len == (int)strlen(seq))
+  {
+    return EvolutionScorerScorePrfSSSA(EVO_SCORER, seq);
+  }
 
-  delete[] dsInfo.ss1;  delete[] dsInfo.ss2;
-  delete[] dsInfo.sa1;  delete[] dsInfo.sa2;
-  delete[] dsInfo.seq;
+  EvolutionScorer scorer;
+  if (EvolutionScorerCreate(&scorer, strlen(seq)) != Success)
+  {
+    EvolutionScorerDestroy(&scorer);
+    return 0.0;
+  }
+  float score = EvolutionScorerScorePrfSSSA(&scorer, seq);
+  EvolutionScorerDestroy(&scorer);
 
-  return -1.0 * max;
+  return score;
 }
 
 
-float EvolutionScorePrfSSSAFromSeq(char* seq)
+
+float EvolutionScorePrfFromSeq(char* seq)
 {
   char evolutiondir[500] = "";
   sprintf(evolutiondir, "%s/evolution", PROGRAM_PATH);
   //printf("evolution parameter file path is: %s\n", evolutiondir);
 
-  SequenceData dsInfo;
-  dsInfo.len = strlen(seq);
-  dsInfo.seq = new char[dsInfo.len + 1];
-  strcpy(dsInfo.seq, seq);
-
-  dsInfo.ss1 = new char[dsInfo.len + 1];
-  SSPrediction::getSeq2SS SS(dsInfo.ss1, dsInfo.seq, evolutiondir);
-  dsInfo.sa1 = new char[dsInfo.len + 1];
-  SAPrediction::getSeq2SA SA(dsInfo.sa1, dsInfo.seq, dsInfo.ss1, evolutiondir);
-
-  //phi-psi prediction
-  //PhiPsiPrediction::getPhiPsi(dsInfo, evolutiondir);
-
-  dsInfo.ss2 = new char[dsInfo.len + 1];
-  FILE* fp = fopen(TGT_SS, "r");
-  fscanf(fp, "%s", dsInfo.ss2);
-  fclose(fp);
-  dsInfo.sa2 = new char[dsInfo.len + 1];
-  fp = fopen(TGT_SA, "r");
-  fscanf(fp, "%s", dsInfo.sa2);
-  fclose(fp);
-
-
-  wsa /= (dsInfo.len * 1.0);    // weight for solvent accessibility
-  wss /= (dsInfo.len * 1.0);    // weight for secondary structure
-  wang /= (dsInfo.len * 180.0);  // weight for phi-psi prediction
-
+  int len = strlen(seq);
   //read profile
   float** prf;
+  FILE* fp = NULL;
   fp = fopen(TGT_PRF, "r");
-  prf = new float* [dsInfo.len];
-  for (int i = 0; i < dsInfo.len; ++i)
+  prf = new float* [len];
+  for (int i = 0; i < len; ++i)
     prf[i] = new float[AMINOS];
   AminoName map[AMINOS];
   char ami[2];
@@ -307,7 +283,7 @@ float EvolutionScorePrfSSSAFromSeq(char* seq)
     map[i] = charToAmino(ami[0]);
   }
   fscanf(fp, "%*s");
-  for (int i = 0; i < dsInfo.len; ++i)
+  for (int i = 0; i < len; ++i)
   {
     fscanf(fp, "%*s");
     for (int j = 0; j < AMINOS; ++j)
@@ -320,41 +296,49 @@ float EvolutionScorePrfSSSAFromSeq(char* seq)
 
   //calculate profile score without alignment
   float score = 0;
-  for (int i = 0; i < dsInfo.len; i++)
+  for (int i = 0; i < len; i++)
   {
     AminoName map = charToAmino(seq[i]);
     score += prf[i][map];
-    if (dsInfo.ss1[i] == dsInfo.ss2[i]) score += wss * 1.0;
-    else if (dsInfo.ss1[i] == '3' && dsInfo.ss2[i] == '3') score += 0;
-    else score += wss * (-1.0);
-    if (dsInfo.sa1[i] == dsInfo.sa2[i]) score += wsa * 1.0;
-    else if (dsInfo.sa1[i] == '2' && dsInfo.sa2[i] == '2') score += 0;
-    else score += wsa * (-1.0);
   }
 
-  delete[] dsInfo.ss1;  delete[] dsInfo.ss2;
-  delete[] dsInfo.sa1;  delete[] dsInfo.sa2;
-  delete[] dsInfo.seq;
+  for (int i = 0; i < len; i++) delete[] prf[i];
+  delete[] prf;
 
   return -1.0 * score;
 }
 
 
+float EvolutionScoreFromPSSMWithoutAlignment(char* seq)
+{
+  //calculate profile score without alignment
+  int len = strlen(seq);
+  float score = 0;
+  for (int i = 0; i < len; i++)
+  {
+    AminoName map = charToAmino(seq[i]);
+    score += PROT_PROFILE[i][map];
+  }
+
+  return -1.0 * score;
+}
 
-float EvolutionScorePrfFromSeq(char* seq)
+
+// the term of EvolutionScoreFromPSSMWithoutAlignment() contributed by one position
+float EvolutionScoreFromPSSMAtPosition(int pos, char aa)
 {
-  char evolutiondir[500] = "";
-  sprintf(evolutiondir, "%s/evolution", PROGRAM_PATH);
-  //printf("evolution parameter file path is: %s\n", evolutiondir);
+  return -1.0 * PROT_PROFILE[pos][charToAmino(aa)];
+}
 
-  int len = strlen(seq);
-  //read profile
-  float** prf;
-  FILE* fp = NULL;
-  fp = fopen(TGT_PRF, "r");
-  prf = new float* [len];
-  for (int i = 0; i < len; ++i)
-    prf[i] = new float[AMINOS];
+
+static int EvolutionReadTargetProfile(float** prf, int len, char* prffile)
+{
+  FILE* fp = fopen(prffile, "r");
+  if (fp == NULL)
+  {
+    printf("in file %s line %d, cannot read file %s\n", __FILE__, __LINE__, prffile);
+    return IOError;
+  }
   AminoName map[AMINOS];
   char ami[2];
   for (int i = 0; i < AMINOS; ++i)
@@ -374,36 +358,279 @@ float EvolutionScorePrfFromSeq(char* seq)
   }
   fclose(fp);
 
+  return Success;
+}
+
+
+static int EvolutionReadTargetString(char* str, int len, char* file)
+{
+  char format[20] = "";
+  FILE* fp = fopen(file, "r");
+  if (fp == NULL)
+  {
+    printf("in file %s line %d, cannot read file %s\n", __FILE__, __LINE__, file);
+    return IOError;
+  }
+  sprintf(format, "%%%ds", len);
+  fscanf(fp, format, str);
+  fclose(fp);
+
+  return Success;
+}
+
+
+int EvolutionScorerCreate(EvolutionScorer* pThis, int len)
+{
+  char evolutiondir[500] = "";
+  sprintf(evolutiondir, "%s/evolution", PROGRAM_PATH);
+
+  memset(pThis, 0, sizeof(EvolutionScorer));
+  if (len <= 0 || len >= MAX_LEN)
+  {
+    printf("in file %s line %d, sequence length %d is out of the range supported by evolution scoring\n", __FILE__, __LINE__, len);
+    return ValueError;
+  }
+  pThis->len = len;
+
+  pThis->pSSParams = new SSPrediction::SSParams;
+  if (SSPrediction::SSParamsRead(pThis->pSSParams, evolutiondir) != 0) return IOError;
+  pThis->pSAParams = new SAPrediction::SAParams;
+  if (SAPrediction::SAParamsRead(pThis->pSAParams, evolutiondir) != 0) return IOError;
+  pThis->pPhiPsiParams = new PhiPsiPrediction::PhiPsiParams;
+  if (PhiPsiPrediction::PhiPsiParamsRead(pThis->pPhiPsiParams, evolutiondir) != 0) return IOError;
+
+  pThis->prf = new float* [len];
+  for (int i = 0; i < len; ++i) pThis->prf[i] = new float[AMINOS];
+  if (EvolutionReadTargetProfile(pThis->prf, len, TGT_PRF) != Success) return IOError;
+
+  pThis->ss2 = new char[len + 1];
+  pThis->sa2 = new char[len + 1];
+  memset(pThis->ss2, 0, sizeof(char) * (len + 1));
+  memset(pThis->sa2, 0, sizeof(char) * (len + 1));
+  if (EvolutionReadTargetString(pThis->ss2, len, TGT_SS) != Success) return IOError;
+  if (EvolutionReadTargetString(pThis->sa2, len, TGT_SA) != Success) return IOError;
+
+  pThis->phiT = new float[len];
+  pThis->psiT = new float[len];
+  for (int i = 0; i < len; i++) pThis->phiT[i] = pThis->psiT[i] = 0.0;
+  FILE* fp = fopen(TGT_PHIPSI, "r");
+  if (fp != NULL)
+  {
+    int i = 0;
+    float ang1, ang;
+    while (i < len && fscanf(fp, "%f %f", &ang1, &ang) == 2)
+    {
+      pThis->phiT[i] = ang1;
+      pThis->psiT[i] = ang;
+      i++;
+    }
+    if (i != len) printf("error in reading phi-psi file %d of phi-psi length but %d of sequence length\n", i, len);
+    fclose(fp);
+  }
+
+  return Success;
+}
+
+
+int EvolutionScorerDestroy(EvolutionScorer* pThis)
+{
+  if (pThis->prf != NULL)
+  {
+    for (int i = 0; i < pThis->len; i++) delete[] pThis->prf[i];
+    delete[] pThis->prf;
+  }
+  delete[] pThis->phiT;
+  delete[] pThis->psiT;
+  delete[] pThis->ss2;
+  delete[] pThis->sa2;
+  delete pThis->pSSParams;
+  delete pThis->pSAParams;
+  if (pThis->pPhiPsiParams != NULL)
+  {
+    PhiPsiPrediction::PhiPsiParamsFree(pThis->pPhiPsiParams);
+    delete pThis->pPhiPsiParams;
+  }
+  memset(pThis, 0, sizeof(EvolutionScorer));
+
+  return Success;
+}
+
+
+static float EvolutionScorerAlign(EvolutionScorer* pThis, CharSeq::SeqAlign* pAlign, SequenceData dsInfo, float* phiQ, float* psiQ)
+{
+  dsInfo.ss2 = pThis->ss2;
+  dsInfo.sa2 = pThis->sa2;
+  float wsaScaled = wsa / (dsInfo.len * 1.0);     // weight for solvent accessibility
+  float wssScaled = wss / (dsInfo.len * 1.0);     // weight for secondary structure
+  float wangScaled = wang / (dsInfo.len * 180.0); // weight for phi-psi prediction
+  float max = pAlign->Align(dsInfo, pThis->prf, pThis->phiT, pThis->psiT, phiQ, psiQ, wssScaled, wsaScaled, wangScaled, EVO_ALIGN_BAND);
+
+  return -1.0 * max;
+}
+
+
+float EvolutionScorerScoreAll(EvolutionScorer* pThis, char* seq)
+{
+  SequenceData dsInfo;
+  dsInfo.len = pThis->len;
+  dsInfo.seq = seq;
+  dsInfo.ss1 = new char[dsInfo.len + 1];
+  dsInfo.sa1 = new char[dsInfo.len + 1];
+  memset(dsInfo.ss1, 0, sizeof(char) * (dsInfo.len + 1));
+  memset(dsInfo.sa1, 0, sizeof(char) * (dsInfo.len + 1));
+  SSPrediction::getSeq2SS SS(dsInfo.ss1, dsInfo.seq, pThis->pSSParams);
+  SAPrediction::getSeq2SA SA(dsInfo.sa1, dsInfo.seq, dsInfo.ss1, pThis->pSAParams);
+
+  //phi-psi prediction
+  float* phiQ = new float[dsInfo.len];
+  float* psiQ = new float[dsInfo.len];
+  PhiPsiPrediction::getPhiPsi(dsInfo, pThis->pPhiPsiParams, phiQ, psiQ);
+
+  CharSeq::SeqAlign sa;
+  float score = EvolutionScorerAlign(pThis, &sa, dsInfo, phiQ, psiQ);
+
+  delete[] dsInfo.ss1;
+  delete[] dsInfo.sa1;
+  delete[] phiQ;
+  delete[] psiQ;
+
+  return score;
+}
+
+
+float EvolutionScorerScorePrfSSSA(EvolutionScorer* pThis, char* seq)
+{
+  int len = pThis->len;
+  char* ss1 = new char[len + 1];
+  char* sa1 = new char[len + 1];
+  memset(ss1, 0, sizeof(char) * (len + 1));
+  memset(sa1, 0, sizeof(char) * (len + 1));
+  SSPrediction::getSeq2SS SS(ss1, seq, pThis->pSSParams);
+  SAPrediction::getSeq2SA SA(sa1, seq, ss1, pThis->pSAParams);
+
+  float wsaScaled = wsa / (len * 1.0);
+  float wssScaled = wss / (len * 1.0);
+
   //calculate profile score without alignment
   float score = 0;
   for (int i = 0; i < len; i++)
   {
     AminoName map = charToAmino(seq[i]);
-    score += prf[i][map];
+    score += pThis->prf[i][map];
+    if (ss1[i] == pThis->ss2[i]) score += wssScaled * 1.0;
+    else if (ss1[i] == '3' && pThis->ss2[i] == '3') score += 0;
+    else score += wssScaled * (-1.0);
+    if (sa1[i] == pThis->sa2[i]) score += wsaScaled * 1.0;
+    else if (sa1[i] == '2' && pThis->sa2[i] == '2') score += 0;
+    else score += wsaScaled * (-1.0);
   }
 
-  for (int i = 0; i < len; i++) delete[] prf[i];
-  delete[] prf;
+  delete[] ss1;
+  delete[] sa1;
 
   return -1.0 * score;
 }
 
 
-float EvolutionScoreFromPSSMWithoutAlignment(char* seq)
+
+int EvolutionScoreCacheCreate(EvolutionScoreCache* pThis, EvolutionScorer* pScorer)
 {
-  //calculate profile score without alignment
-  int len = strlen(seq);
-  float score = 0;
+  int len = pScorer->len;
+  pThis->pScorer = pScorer;
+  pThis->pSS = new SSPrediction::getSeq2SS(pScorer->pSSParams);
+  pThis->pSA = new SAPrediction::getSeq2SA(pScorer->pSAParams);
+  pThis->pPhiPsi = new PhiPsiPrediction::getPhiPsi(pScorer->pPhiPsiParams, len);
+  pThis->pAlign = new CharSeq::SeqAlign();
+  pThis->seq = new char[len + 1];
+  pThis->ss1 = new char[len + 1];
+  pThis->sa1 = new char[len + 1];
+  pThis->phiQ = new float[len];
+  pThis->psiQ = new float[len];
+  memset(pThis->seq, 0, sizeof(char) * (len + 1));
+  memset(pThis->ss1, 0, sizeof(char) * (len + 1));
+  memset(pThis->sa1, 0, sizeof(char) * (len + 1));
+  for (int k = 0; k < 2; k++)
+  {
+    pThis->scoredSeq[k] = new char[len + 1];
+    memset(pThis->scoredSeq[k], 0, sizeof(char) * (len + 1));
+    pThis->score[k] = 0.0;
+  }
+  pThis->lastScored = 0;
+
+  return Success;
+}
+
+
+int EvolutionScoreCacheDestroy(EvolutionScoreCache* pThis)
+{
+  delete pThis->pSS;
+  delete pThis->pSA;
+  delete pThis->pPhiPsi;
+  delete pThis->pAlign;
+  delete[] pThis->seq;
+  delete[] pThis->ss1;
+  delete[] pThis->sa1;
+  delete[] pThis->phiQ;
+  delete[] pThis->psiQ;
+  for (int k = 0; k < 2; k++) delete[] pThis->scoredSeq[k];
+  memset(pThis, 0, sizeof(EvolutionScoreCache));
+
+  return Success;
+}
+
+
+float EvolutionScoreCacheScoreAll(EvolutionScoreCache* pThis, char* seq)
+{
+  int len = pThis->pScorer->len;
+  if ((int)strlen(seq) != len)
+  {
+    return EvolutionScoreAllFromSeq(seq);
+  }
+  for (int k = 0; k < 2; k++)
+  {
+    if (strcmp(pThis->scoredSeq[k], seq) == 0) return pThis->score[k];
+  }
+
+  SequenceData dsInfo;
+  dsInfo.len = len;
+  dsInfo.seq = pThis->seq;
+  dsInfo.ss1 = pThis->ss1;
+  dsInfo.sa1 = pThis->sa1;
+  int diffCount = 0;
   for (int i = 0; i < len; i++)
   {
-    AminoName map = charToAmino(seq[i]);
-    score += PROT_PROFILE[i][map];
+    if (pThis->seq[i] != seq[i]) diffCount++;
+  }
+  if (pThis->seq[0] == '\0' || diffCount > EVOLUTION_CACHE_MAX_UPDATE)
+  {
+    strcpy(pThis->seq, seq);
+    pThis->pSS->Predict(pThis->ss1, pThis->seq);
+    pThis->pSA->Predict(pThis->sa1, pThis->seq, pThis->ss1);
+    pThis->pPhiPsi->Predict(dsInfo, pThis->phiQ, pThis->psiQ);
+  }
+  else
+  {
+    for (int i = 0; i < len; i++)
+    {
+      if (pThis->seq[i] == seq[i]) continue;
+      int ssBegin, ssEnd;
+      pThis->seq[i] = seq[i];
+      pThis->pSS->Update(pThis->ss1, pThis->seq, i, &ssBegin, &ssEnd);
+      pThis->pSA->Update(pThis->sa1, pThis->seq, pThis->ss1, i, ssBegin, ssEnd);
+      pThis->pPhiPsi->Update(dsInfo, i, ssBegin, ssEnd, pThis->phiQ, pThis->psiQ);
+    }
   }
 
-  return -1.0 * score;
+  float score = EvolutionScorerAlign(pThis->pScorer, pThis->pAlign, dsInfo, pThis->phiQ, pThis->psiQ);
+  pThis->lastScored = 1 - pThis->lastScored;
+  strcpy(pThis->scoredSeq[pThis->lastScored], seq);
+  pThis->score[pThis->lastScored] = score;
+
+  return score;
 }
 
 
+
 int SSPred(char* seqfile)
 {
   char evolutiondir[500] = "";
@@ -426,7 +653,7 @@ int SSPred(char* seqfile)
 
   dsInfo.ss1 = new char[dsInfo.len + 1];
   SSPrediction::getSeq2SS SS(dsInfo.ss1, dsInfo.seq, evolutiondir);
-  dsInfo.ss1[dsInfo.len + 1] = '\0';
+  dsInfo.ss1[dsInfo.len] = '\0';
   FILE* pFile = fopen("SSpred_result.txt", "w");
   for (int i = 0;i < dsInfo.len;i++)
   {
@@ -466,7 +693,7 @@ int SAPred(char* seqfile)
   SSPrediction::getSeq2SS SS(dsInfo.ss1, dsInfo.seq, evolutiondir);
   dsInfo.sa1 = new char[dsInfo.len + 1];
   SAPrediction::getSeq2SA SA(dsInfo.sa1, dsInfo.seq, dsInfo.ss1, evolutiondir);
-  dsInfo.sa1[dsInfo.len + 1] = '\0';
+  dsInfo.sa1[dsInfo.len] = '\0';
   FILE* pFile = fopen("SApred_result.txt", "w");
   for (int i = 0;i < dsInfo.len;i++)
   {
@@ -17,6 +17,55 @@ IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #ifndef EVOLUTION_H
 #define EVOLUTION_H
 
+namespace SSPrediction { struct SSParams; class getSeq2SS; }
+namespace SAPrediction { struct SAParams; class getSeq2SA; }
+namespace PhiPsiPrediction { struct PhiPsiParams; class getPhiPsi; }
+namespace CharSeq { class SeqAlign; }
+
+// network weights and target features loaded once and shared by all evolution scoring calls of a run;
+// it is read-only after creation and can be used by several design trajectories at the same time
+typedef struct _EvolutionScorer
+{
+  int len;
+  float** prf;        // target profile, len x AMINOS
+  float* phiT;        // target phi/psi, zeros if no phi-psi file is given
+  float* psiT;
+  char* ss2;          // target secondary structure and solvent accessibility
+  char* sa2;
+  SSPrediction::SSParams* pSSParams;
+  SAPrediction::SAParams* pSAParams;
+  PhiPsiPrediction::PhiPsiParams* pPhiPsiParams;
+} EvolutionScorer;
+
+int EvolutionScorerCreate(EvolutionScorer* pThis, int len);
+int EvolutionScorerDestroy(EvolutionScorer* pThis);
+float EvolutionScorerScoreAll(EvolutionScorer* pThis, char* seq);
+float EvolutionScorerScorePrfSSSA(EvolutionScorer* pThis, char* seq);
+
+// predictions of the last sequence scored by one design trajectory; when the next sequence differs from it
+// at a few sites, the SS/SA/phi-psi networks are re-run only over the windows those sites reach. The scores
+// of the last two sequences are kept as well, since a Metropolis step scores the current sequence again
+typedef struct _EvolutionScoreCache
+{
+  EvolutionScorer* pScorer;
+  SSPrediction::getSeq2SS* pSS;
+  SAPrediction::getSeq2SA* pSA;
+  PhiPsiPrediction::getPhiPsi* pPhiPsi;
+  CharSeq::SeqAlign* pAlign;  // alignment buffers reused by every score
+  char* seq;          // sequence of the predictions below, empty until the first prediction
+  char* ss1;
+  char* sa1;
+  float* phiQ;
+  float* psiQ;
+  char* scoredSeq[2];
+  float score[2];
+  int lastScored;
+} EvolutionScoreCache;
+
+int EvolutionScoreCacheCreate(EvolutionScoreCache* pThis, EvolutionScorer* pScorer);
+int EvolutionScoreCacheDestroy(EvolutionScoreCache* pThis);
+float EvolutionScoreCacheScoreAll(EvolutionScoreCache* pThis, char* seq);
+
 //the first parameter is the path of the current executable program used to compute evolution score
 //this path is very important, because it is used to determine the location of feature parameters required by the program
 float EvolutionScoreAllFromFile(char* seqfile);
@@ -25,6 +74,7 @@ float EvolutionScorePrfSSSAFromSeq(char* seq);
 float EvolutionScorePrfFromSeq(char* seq);
 float EvolutionScorePrfFromFile(char* seqfile);
 float EvolutionScoreFromPSSMWithoutAlignment(char* seq);
+float EvolutionScoreFromPSSMAtPosition(int pos, char aa);
 
 int SSPred(char* seqfile);
 int SAPred(char* seqfile);
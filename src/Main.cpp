@@ -71,6 +71,7 @@ char TGT_SEQ[MAX_LEN_FILE_NAME + 1] = "seq.txt"; // Sequence file in single-line
 char TGT_PHIPSI[MAX_LEN_FILE_NAME + 1] = "phi-psi.txt"; // Main-chain Phi and Psi angles for input backbone
 //store profile into memory
 float** PROT_PROFILE = NULL;      // Store PSSM into a 2-D float** array
+EvolutionScorer* EVO_SCORER = NULL; // SS/SA network weights and target features shared by all evolution scoring calls
 double WGT_PROFILE = 1.0;       // Energy Weight of Evolutionary Profile
 double WGT_BIND = 1.0;       // Energy Weight of Binding interaction (default: 1.0)
 
@@ -89,6 +90,8 @@ char FILE_BESTSTRUCT[MAX_LEN_FILE_NAME + 1] = "beststruct";
 char FILE_BEST_ALL_SITES[MAX_LEN_FILE_NAME + 1] = "bestsites";
 char FILE_BEST_MUT_SITES[MAX_LEN_FILE_NAME + 1] = "bestmutsites";
 char FILE_BEST_LIG_MOL2[MAX_LEN_FILE_NAME + 1] = "bestlig";
+char FILE_BATCH_SCORES[MAX_LEN_FILE_NAME + 1] = "batch.txt";
+char FILE_ENERGY_MATRIX[MAX_LEN_FILE_NAME + 1] = "energymatrix.txt";
 char PREFIX[MAX_LEN_FILE_NAME + 1] = "UniDesign";
 
 
@@ -100,6 +103,9 @@ char PDB[MAX_LEN_FILE_NAME + 1] = "model_1.pdb";
 char PDBPATH[MAX_LEN_FILE_NAME + 1] = ".";
 char PDBNAME[MAX_LEN_FILE_NAME + 1] = "pdbname.pdb";
 char PDBID[MAX_LEN_FILE_NAME + 1] = "pdb";
+// a list of PDB files scored one after another in a single run
+BOOL FLAG_PDB_LIST = FALSE;
+char PDB_LIST[MAX_LEN_FILE_NAME + 1] = "pdblist.txt";
 // MOL2 for small molecule ligands
 char MOL2[MAX_LEN_FILE_NAME + 1] = "mol2.mol2";
 
@@ -108,6 +114,10 @@ char MOL2[MAX_LEN_FILE_NAME + 1] = "mol2.mol2";
 char DES_CHAINS[10] = "A";
 int  NTRAJ = 1;
 int  NTRAJ_START_NDX = 1;
+// number of threads for self energies, the pair table and independent design trajectories
+int  NTHREADS = 1;
+// number of replicas of the replica-exchange search, 0 for simulated annealing
+int  NREPLICAS = 0;
 // parameters for PPI design
 double CUT_PPI_DIST_SHELL1 = 5.0;
 double CUT_PPI_DIST_SHELL2 = 8.0;
@@ -167,6 +177,7 @@ char PDB2[MAX_LEN_FILE_NAME + 1] = "pdb2.pdb";
 
 // Parameters for OptimizeWeight
 char PDBLIST[MAX_LEN_FILE_NAME + 1] = "pdblist.txt";
+BOOL FLAG_LBFGS = FALSE;
 
 // Parameters for energy score normalization
 int PROT_LEN_NORM = 100;
@@ -185,6 +196,9 @@ BOOL FLAG_ENZYME = FALSE;
 BOOL FLAG_PHYSICS = TRUE;
 BOOL FLAG_EVOLUTION = FALSE;
 BOOL FLAG_EVOPHIPSI = FALSE;
+// band of the evolution profile alignment: -1 picks the narrowest band proven to hold the optimal alignment,
+// 0 aligns without gaps, and a positive value fixes the band (exact only if the optimal alignment lies in it)
+int EVO_ALIGN_BAND = -1;
 
 // restrictions for ProteinDesign
 BOOL FLAG_BBDEP_ROTLIB = TRUE;  // specify a rotamer library for side-chain sampling (default: Dunbrack 2010 bb-dep rotlib)
@@ -200,6 +214,25 @@ BOOL FLAG_RESFILE = FALSE;
 // start a protein design job from the native sequence (input from the given PDB)
 BOOL FLAG_DESIGN_FROM_NATAA = FALSE; // default: start from random; thus this flag is set to FALSE
 
+// pre-compute pairwise rotamer energies between design sites and run simulated annealing by table lookup
+BOOL FLAG_PAIR_TABLE = FALSE;
+
+// the energy matrix file is named by the user instead of <prefix>_energymatrix.txt
+BOOL FLAG_ENERGY_MATRIX = FALSE;
+
+// prune the rotamers of the pair table by dead-end elimination before the sequence search
+BOOL FLAG_DEE = FALSE;
+
+// find the lowest-energy design over the pair table by branch and bound instead of simulated annealing
+BOOL FLAG_EXACT_SEARCH = FALSE;
+double EXACT_TIME_LIMIT = 0.0; // secs, 0 = no limit
+
+// evaluate vdw, electrostatics and desolvation with the batched (SIMD) atom-block kernel instead of atom-by-atom
+BOOL FLAG_ENERGY_SIMD = FALSE;
+
+// write the self-energy and rotamer-list text files of ProteinDesign; they are passed in memory otherwise
+BOOL FLAG_WRITE_SELF_ENERGY = FALSE;
+
 // flag for reading & writing hydrogen atoms
 BOOL FLAG_READ_HYDROGEN = TRUE;
 BOOL FLAG_WRITE_HYDROGEN = TRUE;
@@ -219,6 +252,7 @@ char SUPPORTED_COMMANDS[][30] = {
   "ComputeResPairEnergy",
 
   "ProteinDesign",
+  "GenerateEnergyMatrix",
 
   "AddPolarHydrogen",
   "BuildMutant",
@@ -321,6 +355,17 @@ struct option LONG_OPTS[] = {
   {"resi_pair",            required_argument, NULL,   60},
   {"excl_resi",            required_argument, NULL,   61},
   {"lig_placing",          required_argument, NULL,   62},
+  {"pair_table",           no_argument,       NULL,   64},
+  {"nthreads",             required_argument, NULL,   65},
+  {"energy_simd",          no_argument,       NULL,   66},
+  {"write_selfenergy",     no_argument,       NULL,   67},
+  {"evo_align_band",       required_argument, NULL,   68},
+  {"replica_exchange",     required_argument, NULL,   69},
+  {"dee",                  no_argument,       NULL,   70},
+  {"exact_search",         required_argument, NULL,   71},
+  {"pdb_list",             required_argument, NULL,   72},
+  {"lbfgs",                no_argument,       NULL,   73},
+  {"energy_matrix",        required_argument, NULL,   74},
   {NULL,                   no_argument,       NULL,    0},
 };
 
@@ -672,6 +717,46 @@ int main(int argc, char* argv[])
     case 62:
       strcpy(FILE_LIG_PLACEMENT, optarg);
       break;
+    case 64:
+      FLAG_PAIR_TABLE = TRUE;
+      break;
+    case 65:
+      NTHREADS = atoi(optarg);
+      if (NTHREADS < 1) NTHREADS = 1;
+      break;
+    case 66:
+      FLAG_ENERGY_SIMD = TRUE;
+      break;
+    case 67:
+      FLAG_WRITE_SELF_ENERGY = TRUE;
+      break;
+    case 68:
+      EVO_ALIGN_BAND = atoi(optarg);
+      if (EVO_ALIGN_BAND < -1) EVO_ALIGN_BAND = -1;
+      break;
+    case 69:
+      NREPLICAS = atoi(optarg);
+      if (NREPLICAS < 2) NREPLICAS = 0;
+      break;
+    case 70:
+      FLAG_DEE = TRUE;
+      break;
+    case 71:
+      FLAG_EXACT_SEARCH = TRUE;
+      FLAG_DEE = TRUE;
+      EXACT_TIME_LIMIT = atof(optarg);
+      break;
+    case 72:
+      FLAG_PDB_LIST = TRUE;
+      strcpy(PDB_LIST, optarg);
+      break;
+    case 73:
+      FLAG_LBFGS = TRUE;
+      break;
+    case 74:
+      FLAG_ENERGY_MATRIX = TRUE;
+      strcpy(FILE_ENERGY_MATRIX, optarg);
+      break;
     case 37:
       strcpy(PREFIX, optarg);
       break;
@@ -710,6 +795,8 @@ int main(int argc, char* argv[])
   sprintf(FILE_BEST_ALL_SITES, "%s_bestsites", PREFIX);
   sprintf(FILE_BEST_MUT_SITES, "%s_bestmutsites", PREFIX);
   sprintf(FILE_BEST_LIG_MOL2, "%s_bestlig", PREFIX);
+  sprintf(FILE_BATCH_SCORES, "%s_batch.txt", PREFIX);
+  if (FLAG_ENERGY_MATRIX == FALSE) sprintf(FILE_ENERGY_MATRIX, "%s_energymatrix.txt", PREFIX);
 
   // read atom parameters
   AtomParamsSet atomParam;
@@ -846,13 +933,41 @@ int main(int argc, char* argv[])
   if (FLAG_EVOLUTION == TRUE && strlen(DES_CHAINS) <= 1)
   {
     StructureDeployEvolutionInfo(&structure);
+    if (FLAG_EVOPHIPSI == TRUE)
+    {
+      EVO_SCORER = new EvolutionScorer;
+      if (EvolutionScorerCreate(EVO_SCORER, ChainGetResidueCount(StructureFindChainByName(&structure, DES_CHAINS))) != Success)
+      {
+        printf("evolution scoring data cannot be preloaded, it will be loaded on every call\n");
+        EvolutionScorerDestroy(EVO_SCORER);
+        delete EVO_SCORER;
+        EVO_SCORER = NULL;
+      }
+    }
+  }
+
+  // score a list of structures with the parameters, topologies and tables loaded only once
+  if (FLAG_PDB_LIST == TRUE)
+  {
+    AAppTable aapptable;
+    RamaTable ramatable;
+    AApropensityTableReadFromFile(&aapptable, FILE_AAPROPENSITY);
+    RamaTableReadFromFile(&ramatable, FILE_RAMACHANDRAN);
+    int result = ComputeStructuresInBatch(cmdname, PDB_LIST, &atomParam, &resiTopo, &aapptable, &ramatable,
+      FLAG_BBDEP_ROTLIB == TRUE ? FILE_ROTLIB_BIN : NULL, FLAG_CHAIN_SPLIT == TRUE ? SPLIT_PART1 : NULL, FILE_BATCH_SCORES, NTHREADS);
+    ResiTopoSetDestroy(&resiTopo);
+    AtomParamsSetDestroy(&atomParam);
+    StructureDestroy(&structure);
+    clock_t timeend = clock();
+    SpentTimeShow(timestart, timeend);
+    return result;
   }
 
   ////////////////////////////////////////////
   //            MAIN FUNCTION
   ////////////////////////////////////////////
 #define MAIN_FUNC_PROTEIN_DESIGN
-  if (strcmp(cmdname, "ProteinDesign") == 0)
+  if (strcmp(cmdname, "ProteinDesign") == 0 || strcmp(cmdname, "GenerateEnergyMatrix") == 0)
   {
     // set protein chains for design
     if (strcmp(DES_CHAINS, "") == 0)
@@ -947,16 +1062,44 @@ int main(int argc, char* argv[])
     }
 
     StructureShowDesignSites(&structure);
-    SelfEnergyGenerate2(&structure, &aapptable, &ramatable, FILE_SELF_ENERGY);
-    RotamerList rotList;
-    RotamerListCreateFromStructure(&rotList, &structure);
-    RotamerListWrite(&rotList, FILE_ROTLIST);
-    SelfEnergyReadAndCheck(&structure, &rotList, FILE_SELF_ENERGY);
-    RotamerListWrite(&rotList, FILE_ROTLIST_SEC);
-    RotamerListRead(&rotList, FILE_ROTLIST_SEC);
-    StructureShowDesignSitesAfterRotamerDelete(&structure, &rotList);
-    SimulatedAnnealing(&structure, &rotList);
-    RotamerListDestroy(&rotList);
+    if (strcmp(cmdname, "GenerateEnergyMatrix") == 0)
+    {
+      // the full matrix over all rotamers of the design sites, self energies on the diagonal
+      EnergyMatrix matrix;
+      EnergyMatrixCreate(&matrix);
+      int result = EnergyMatrixGenerateInMemory(&structure, &matrix, NTHREADS);
+      if (!FAILED(result))
+      {
+        int length = (int)strlen(FILE_ENERGY_MATRIX);
+        if (length > 4 && strcmp(FILE_ENERGY_MATRIX + length - 4, ".bin") == 0)
+        {
+          result = EnergyMatrixWriteBinary(&matrix, FILE_ENERGY_MATRIX);
+        }
+        else
+        {
+          result = EnergyMatrixWrite(&matrix, FILE_ENERGY_MATRIX);
+        }
+      }
+      EnergyMatrixDestroy(&matrix);
+      if (FAILED(result))
+      {
+        sprintf(errMsg, "in file %s line %d, failed to generate energy matrix %s", __FILE__, __LINE__, FILE_ENERGY_MATRIX);
+        TraceError(errMsg, result);
+        return result;
+      }
+    }
+    else
+    {
+      SelfEnergyGenerate2(&structure, &aapptable, &ramatable, FLAG_WRITE_SELF_ENERGY ? FILE_SELF_ENERGY : NULL);
+      RotamerList rotList;
+      RotamerListCreateFromStructure(&rotList, &structure);
+      if (FLAG_WRITE_SELF_ENERGY) RotamerListWrite(&rotList, FILE_ROTLIST);
+      SelfEnergyCheck(&structure, &rotList);
+      if (FLAG_WRITE_SELF_ENERGY) RotamerListWrite(&rotList, FILE_ROTLIST_SEC);
+      StructureShowDesignSitesAfterRotamerDelete(&structure, &rotList);
+      SimulatedAnnealing(&structure, &rotList);
+      RotamerListDestroy(&rotList);
+    }
   }
 
   else if (strcmp(cmdname, "ComputeStability") == 0)
@@ -1280,7 +1423,8 @@ int main(int argc, char* argv[])
   
   else if (strcmp(cmdname, "OptimizeWeight") == 0)
   {
-    PNATAA_WeightOptByGradientDescent(PDBLIST);
+    if (FLAG_LBFGS) PNATAA_WeightOptByLBFGS(PDBLIST);
+    else PNATAA_WeightOptByGradientDescent(PDBLIST);
   }
   
   else if (strcmp(cmdname, "CalcPhiPsi") == 0)
@@ -1431,6 +1575,12 @@ int main(int argc, char* argv[])
       for (int i = 0;i < len;i++) delete[] PROT_PROFILE[i];
       delete[] PROT_PROFILE;
     }
+    if (EVO_SCORER != NULL)
+    {
+      EvolutionScorerDestroy(EVO_SCORER);
+      delete EVO_SCORER;
+      EVO_SCORER = NULL;
+    }
   }
   ResiTopoSetDestroy(&resiTopo);
   AtomParamsSetDestroy(&atomParam);
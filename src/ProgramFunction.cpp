@@ -80,6 +80,7 @@ int PrintHelp()
     "                     PLI design    : ProteinDesign --protlig\n"
     "                     enzyme design : ProteinDesign --enzyme\n"
     "                     packing       : ProteinDesign --wildtype_only\n"
+    "                     energy matrix : GenerateEnergyMatrix\n"
     "                   [Enzyme and PLI design module]\n"
     "                     MakeLigParamAndTopo\n"
     "                     MakeLigPoses\n"
@@ -153,6 +154,24 @@ int PrintHelp()
     "   --scrn_by_orientation=arg        screen ligand poses using the rule defined in the arg file\n"
     "   --scrn_by_vdw=arg      screen ligand poses with both internalVDW and backboneVDW ranked in a low percentile, e.g. 25%\n"
     "   --scrn_by_rmsd=arg        screen ligand poses using an RMSD cutoff value (default: 1.0)\n"
+    "   --pair_table              pre-compute pairwise rotamer energies between design sites for fast simulated annealing\n"
+    "   --nthreads=arg            arg is the number of threads for self energies, the pair table and independent design trajectories (default: 1)\n"
+    "   --energy_simd             evaluate non-bonded atom-pair energies with the vectorized (AVX2/AVX-512) batched kernel\n"
+    "   --write_selfenergy        write the self energies and rotamer lists of ProteinDesign to <prefix>_selfenergy.txt, <prefix>_rotlist.txt and <prefix>_rotlistSEC.txt\n"
+    "   --evo_align_band=arg      arg is the band of the evolution profile alignment: -1 = narrowest band proven exact (default),\n"
+    "                             0 = no-gap alignment, n > 0 = fixed band (exact if the optimal alignment lies within it)\n"
+    "   --replica_exchange=arg    arg is the number of replicas (>= 2) of a replica-exchange search used instead of simulated annealing;\n"
+    "                             the replicas of each trajectory run on a temperature ladder over --nthreads threads\n"
+    "   --dee                     remove rotamers that cannot be in the lowest-energy design by dead-end elimination (requires --pair_table)\n"
+    "   --exact_search=arg        find the lowest-energy design over the pair table by branch and bound after dead-end elimination (requires --pair_table);\n"
+    "                             arg is the time limit in CPU seconds (0 = none), after which the best design and a lower bound are reported\n"
+    "   --pdb_list=arg            score every PDB file listed in arg (one per line) by ComputeStability or ComputeBinding in one run,\n"
+    "                             loading the parameters once and using --nthreads threads; one line per structure goes to <prefix>_batch.txt\n"
+    "   --lbfgs                   fit the weights of OptimizeWeight by L-BFGS instead of gradient descent\n"
+    "   --energy_matrix=arg       arg is the energy matrix file written by GenerateEnergyMatrix (default: <prefix>_energymatrix.txt);\n"
+    "                             the design sites and rotamers are set up as by ProteinDesign and the blocks are computed on --nthreads threads;\n"
+    "                             a name ending in .bin selects the binary format. ProteinDesign --pair_table reads the pair table from arg\n"
+    "                             when it matches the design sites and rotamers of the job\n"
     "\n\n", PROGRAM_NAME);
   return Success;
 }
@@ -190,8 +209,18 @@ int PrintOutProgramInformation()
 }
 
 
-int ComputeStructureStability(Structure* pStructure, AAppTable* pAAppTable, RamaTable* pRama, double energyTerms[MAX_ENERGY_TERM])
+// unweighted residue and residue-pair energy terms of a structure, shared by the stability commands and the batch mode
+int StructureStabilityEnergy(Structure* pStructure, AAppTable* pAAppTable, RamaTable* pRama, double energyTerms[MAX_ENERGY_TERM])
 {
+  // residue pairs without any atom pair within the energy cutoff are skipped using a cell grid
+  ResidueGrid grid;
+  ResidueGridCreate(&grid);
+  ResidueGridBuild(&grid, pStructure, ENERGY_DISTANCE_CUTOFF);
+  IntArray* pNbrs = (IntArray*)malloc(sizeof(IntArray) * StructureGetChainCount(pStructure));
+  for (int i = 0; i < StructureGetChainCount(pStructure); i++)
+  {
+    IntArrayCreate(&pNbrs[i], 0);
+  }
   for (int i = 0; i < StructureGetChainCount(pStructure); i++)
   {
     Chain* pChainI = StructureGetChain(pStructure, i);
@@ -206,8 +235,11 @@ int ComputeStructureStability(Structure* pStructure, AAppTable* pAAppTable, Rama
         energyTerms[91] += pResIR->aapp;
         energyTerms[92] += pResIR->rama;
       }
-      for (int is = ir + 1; is < ChainGetResidueCount(pChainI); is++)
+      ResidueGridFindResidueNeighbors(&grid, i, ir, ENERGY_DISTANCE_CUTOFF, pNbrs);
+      for (int n = 0; n < IntArrayGetLength(&pNbrs[i]); n++)
       {
+        int is = IntArrayGet(&pNbrs[i], n);
+        if (is <= ir) continue;
         Residue* pResIS = ChainGetResidue(pChainI, is);
         if (ResidueGetPosInChain(pResIR) + 1 == ResidueGetPosInChain(pResIS))
         {
@@ -221,8 +253,9 @@ int ComputeStructureStability(Structure* pStructure, AAppTable* pAAppTable, Rama
       for (int k = i + 1; k < StructureGetChainCount(pStructure); k++)
       {
         Chain* pChainK = StructureGetChain(pStructure, k);
-        for (int ks = 0; ks < ChainGetResidueCount(pChainK); ks++)
+        for (int n = 0; n < IntArrayGetLength(&pNbrs[k]); n++)
         {
+          int ks = IntArrayGet(&pNbrs[k], n);
           Residue* pResKS = ChainGetResidue(pChainK, ks);
           if (ChainGetType(pChainI) == Type_Chain_SmallMol)
           {
@@ -241,6 +274,20 @@ int ComputeStructureStability(Structure* pStructure, AAppTable* pAAppTable, Rama
     }
   }
 
+  for (int i = 0; i < StructureGetChainCount(pStructure); i++)
+  {
+    IntArrayDestroy(&pNbrs[i]);
+  }
+  free(pNbrs);
+  ResidueGridDestroy(&grid);
+
+  return Success;
+}
+
+
+int ComputeStructureStability(Structure* pStructure, AAppTable* pAAppTable, RamaTable* pRama, double energyTerms[MAX_ENERGY_TERM])
+{
+  StructureStabilityEnergy(pStructure, pAAppTable, pRama, energyTerms);
   EnergyTermWeighting(energyTerms);
   printf("\nStructure energy details:\n");
   EnergyTermShowComplex(energyTerms);
@@ -251,6 +298,15 @@ int ComputeStructureStability(Structure* pStructure, AAppTable* pAAppTable, Rama
 
 int ComputeStructureStabilityByBBdepRotLib(Structure* pStructure, AAppTable* pAAppTable, RamaTable* pRama, BBdepRotamerLib* pRotLib, double energyTerms[MAX_ENERGY_TERM])
 {
+  // residue pairs without any atom pair within the energy cutoff are skipped using a cell grid
+  ResidueGrid grid;
+  ResidueGridCreate(&grid);
+  ResidueGridBuild(&grid, pStructure, ENERGY_DISTANCE_CUTOFF);
+  IntArray* pNbrs = (IntArray*)malloc(sizeof(IntArray) * StructureGetChainCount(pStructure));
+  for (int i = 0; i < StructureGetChainCount(pStructure); i++)
+  {
+    IntArrayCreate(&pNbrs[i], 0);
+  }
   for (int i = 0; i < StructureGetChainCount(pStructure); i++)
   {
     Chain* pChainI = StructureGetChain(pStructure, i);
@@ -267,8 +323,11 @@ int ComputeStructureStabilityByBBdepRotLib(Structure* pStructure, AAppTable* pAA
         energyTerms[92] += pResIR->rama;
         energyTerms[93] += ResidueGetDunbrack(pResIR);
       }
-      for (int is = ir + 1; is < ChainGetResidueCount(pChainI); is++)
+      ResidueGridFindResidueNeighbors(&grid, i, ir, ENERGY_DISTANCE_CUTOFF, pNbrs);
+      for (int n = 0; n < IntArrayGetLength(&pNbrs[i]); n++)
       {
+        int is = IntArrayGet(&pNbrs[i], n);
+        if (is <= ir) continue;
         Residue* pResIS = ChainGetResidue(pChainI, is);
         if (ResidueGetPosInChain(pResIR) + 1 == ResidueGetPosInChain(pResIS))
         {
@@ -282,8 +341,9 @@ int ComputeStructureStabilityByBBdepRotLib(Structure* pStructure, AAppTable* pAA
       for (int k = i + 1; k < StructureGetChainCount(pStructure); k++)
       {
         Chain* pChainK = StructureGetChain(pStructure, k);
-        for (int ks = 0; ks < ChainGetResidueCount(pChainK); ks++)
+        for (int n = 0; n < IntArrayGetLength(&pNbrs[k]); n++)
         {
+          int ks = IntArrayGet(&pNbrs[k], n);
           Residue* pResKS = ChainGetResidue(pChainK, ks);
           if (ChainGetType(pChainI) == Type_Chain_SmallMol)
           {
@@ -302,6 +362,13 @@ int ComputeStructureStabilityByBBdepRotLib(Structure* pStructure, AAppTable* pAA
     }
   }
 
+  for (int i = 0; i < StructureGetChainCount(pStructure); i++)
+  {
+    IntArrayDestroy(&pNbrs[i]);
+  }
+  free(pNbrs);
+  ResidueGridDestroy(&grid);
+
   EnergyTermWeighting(energyTerms);
   printf("\nStructure energy details:\n");
   EnergyTermShowComplex(energyTerms);
@@ -309,13 +376,16 @@ int ComputeStructureStabilityByBBdepRotLib(Structure* pStructure, AAppTable* pAA
 }
 
 
-int ComputeStructureStabilityByBBdepRotLib2(Structure* pStructure, AAppTable* pAAppTable, RamaTable* pRama, char* binLib, double energyTerms[MAX_ENERGY_TERM])
+// Dunbrack energy of the side chains from the binary bb-dep rotamer library, read either from the
+// open file pFileLib or from libImage, the whole file loaded into memory (libSize bytes)
+int StructureDunbrackEnergyFromBinLib(Structure* pStructure, FILE* pFileLib, char* libImage, long libSize, double energyTerms[MAX_ENERGY_TERM])
 {
   // ACDEFGHIKLMNPQRSTVWY, only for regular amino acid
   int xcount[20] = { 0,1,2,3,2,0,2,2,4,2,3,2,2,3,4,1,1,1,2,2 };
   int nrot[20] = { 0,3,18,54,18,0,36,9,73,9,27,36,2,108,75,3,3,3,36,18 };
   int lrot[20] = { 0,129,111,240,448,0,294,330,348,339,421,75,466,132,0,468,471,528,474,510 };
-  FILE* pFileLib = fopen(binLib, "rb");
+  // each rotamer record holds 9 floats: probability, 4 torsions and 4 deviations
+  float records[108 * 9];
   for (int i = 0; i < StructureGetChainCount(pStructure); i++)
   {
     Chain* pChainI = StructureGetChain(pStructure, i);
@@ -333,14 +403,26 @@ int ComputeStructureStabilityByBBdepRotLib2(Structure* pStructure, AAppTable* pA
           }
           int nchi = xcount[aaIdx];
           int binIdx = ((int)(pResiIR->phipsi[0] + 180) / 10) * 36 + (int)(pResiIR->phipsi[1] + 180) / 10;
-          fseek(pFileLib, (1296 * lrot[aaIdx] + binIdx * nrot[aaIdx]) * 36, SEEK_SET);
+          long offset = (long)(1296 * lrot[aaIdx] + binIdx * nrot[aaIdx]) * 36;
+          long recordBytes = nrot[aaIdx] * 36;
+          // records past the end of the library read as zero probability, which stops the scan below
+          memset(records, 0, recordBytes);
+          if (libImage != NULL)
+          {
+            if (offset >= 0 && offset < libSize) memcpy((char*)records, libImage + offset, offset + recordBytes <= libSize ? recordBytes : libSize - offset);
+          }
+          else
+          {
+            fseek(pFileLib, offset, SEEK_SET);
+            fread(records, sizeof(char), recordBytes, pFileLib);
+          }
           int matchIdx = -1;
           double pMin = 10;
           double pMatch;
           for (int rotIdx = 0;rotIdx < nrot[aaIdx];rotIdx++)
           {
-            float p = 0.;
-            fread((char*)&p, sizeof(char), 4, pFileLib);
+            float* pRecord = records + rotIdx * 9;
+            float p = pRecord[0];
             if (p < CUT_EXCL_LOW_PROB_ROT)
             {
               break;
@@ -349,21 +431,13 @@ int ComputeStructureStabilityByBBdepRotLib2(Structure* pStructure, AAppTable* pA
             {
               pMin = p;
             }
-            float val;
             double libtorsions[4] = { 0 };
             double libdeviations[4] = { 0 };
             for (int k = 0;k < nchi;k++)
             {
-              fread((char*)&val, sizeof(char), 4, pFileLib);
-              libtorsions[k] = (float)val;
-            }
-            fseek(pFileLib, (4 - nchi) * 4, SEEK_CUR);
-            for (int k = 0;k < nchi;k++)
-            {
-              fread((char*)&val, sizeof(char), 4, pFileLib);
-              libdeviations[k] = (float)val;
+              libtorsions[k] = pRecord[1 + k];
+              libdeviations[k] = pRecord[5 + k];
             }
-            fseek(pFileLib, (4 - nchi) * 4, SEEK_CUR);
 
             BOOL match = TRUE;
             for (int torIdx = 0; torIdx < DoubleArrayGetLength(&pResiIR->Xs); torIdx++)
@@ -410,65 +484,16 @@ int ComputeStructureStabilityByBBdepRotLib2(Structure* pStructure, AAppTable* pA
       }
     }
   }
-  fclose(pFileLib);
+  return Success;
+}
 
-  for (int i = 0; i < StructureGetChainCount(pStructure); i++)
-  {
-    Chain* pChainI = StructureGetChain(pStructure, i);
-    for (int ir = 0; ir < ChainGetResidueCount(pChainI); ir++)
-    {
-      Residue* pResIR = ChainGetResidue(pChainI, ir);
-      if (ChainGetType(pChainI) == Type_Chain_Protein)
-      {
-        AminoAcidReferenceEnergy(pResIR->name, energyTerms);
-        EnergyIntraResidue(pResIR, energyTerms);
-        AminoAcidPropensityAndRamachandranEnergy(pResIR, pAAppTable, pRama);
-        energyTerms[91] += pResIR->aapp;
-        energyTerms[92] += pResIR->rama;
-      }
-      for (int is = ir + 1;is < ChainGetResidueCount(pChainI);is++)
-      {
-        Residue* pResIS = ChainGetResidue(pChainI, is);
-        if (ResidueGetPosInChain(pResIR) + 1 == ResidueGetPosInChain(pResIS))
-        {
-          EnergyResidueAndNextResidue(pResIR, pResIS, energyTerms);
-        }
-        else
-        {
-          //if (ResidueGetPosInChain(pResIR) == 20 && ResidueGetPosInChain(pResIS) == 30)
-          //{
-          //  getchar();
-          //}
-          EnergyResidueAndOtherResidueSameChain(pResIR, pResIS, energyTerms);
-        }
-        //printf("debug res %s%d%s and res %s%d%s\n", ResidueGetChainName(pResIR), ResidueGetPosInChain(pResIR), ResidueGetName(pResIR),
-        //  ResidueGetChainName(pResIS), ResidueGetPosInChain(pResIS), ResidueGetName(pResIS));
-      }
-      for (int k = i + 1; k < StructureGetChainCount(pStructure); k++)
-      {
-        Chain* pChainK = StructureGetChain(pStructure, k);
-        for (int ks = 0; ks < ChainGetResidueCount(pChainK); ks++)
-        {
-          Residue* pResKS = ChainGetResidue(pChainK, ks);
-          if (ChainGetType(pChainI) == Type_Chain_SmallMol)
-          {
-            EnergyResidueAndLigandResidue(pResKS, pResIR, energyTerms);
-          }
-          else if (ChainGetType(pChainK) == Type_Chain_SmallMol)
-          {
-            EnergyResidueAndLigandResidue(pResIR, pResKS, energyTerms);
-          }
-          else
-          {
-            EnergyResidueAndOtherResidueDiffChain(pResIR, pResKS, energyTerms);
-          }
-          //printf("debug res %s%d%s and res %s%d%s\n", ResidueGetChainName(pResIR), ResidueGetPosInChain(pResIR), ResidueGetName(pResIR),
-          //  ResidueGetChainName(pResKS), ResidueGetPosInChain(pResKS), ResidueGetName(pResKS));
-        }
-      }
-    }
-  }
 
+int ComputeStructureStabilityByBBdepRotLib2(Structure* pStructure, AAppTable* pAAppTable, RamaTable* pRama, char* binLib, double energyTerms[MAX_ENERGY_TERM])
+{
+  FILE* pFileLib = fopen(binLib, "rb");
+  StructureDunbrackEnergyFromBinLib(pStructure, pFileLib, NULL, 0, energyTerms);
+  fclose(pFileLib);
+  StructureStabilityEnergy(pStructure, pAAppTable, pRama, energyTerms);
   EnergyTermWeighting(energyTerms);
   printf("\nStructure energy details:\n");
   EnergyTermShowComplex(energyTerms);
@@ -527,16 +552,17 @@ int ComputeBinding(Structure* pStructure)
 }
 
 
-int ComputeBindingWithChainSplitting(Structure* pStructure, char split1[], char split2[])
+// unweighted interaction energy between the chains in split1 and the other chains; a NULL split1 takes every chain pair
+int StructureBindingEnergy(Structure* pStructure, char split1[], double energyTerms[MAX_ENERGY_TERM])
 {
-  double energyTerms[MAX_ENERGY_TERM] = { 0 };
   for (int i = 0;i < StructureGetChainCount(pStructure);i++)
   {
     Chain* pChainI = StructureGetChain(pStructure, i);
     for (int k = i + 1;k < StructureGetChainCount(pStructure);k++)
     {
       Chain* pChainK = StructureGetChain(pStructure, k);
-      if ((strstr(split1, ChainGetName(pChainI)) != NULL && strstr(split1, ChainGetName(pChainK)) == NULL)
+      if (split1 == NULL
+        || (strstr(split1, ChainGetName(pChainI)) != NULL && strstr(split1, ChainGetName(pChainK)) == NULL)
         || ((strstr(split1, ChainGetName(pChainI)) == NULL && strstr(split1, ChainGetName(pChainK)) != NULL)))
       {
         for (int j = 0; j < ChainGetResidueCount(pChainI); j++)
@@ -562,6 +588,14 @@ int ComputeBindingWithChainSplitting(Structure* pStructure, char split1[], char
       }
     }
   }
+  return Success;
+}
+
+
+int ComputeBindingWithChainSplitting(Structure* pStructure, char split1[], char split2[])
+{
+  double energyTerms[MAX_ENERGY_TERM] = { 0 };
+  StructureBindingEnergy(pStructure, split1, energyTerms);
   EnergyTermWeighting(energyTerms);
   printf("Binding energy details between chain(s) %s and chain(s) %s (DG_bind = DG(stability,complex) - DG(stability,%s) - DG(stability,%s):\n", split1, split2, split1, split2);
   EnergyTermShowComplex(energyTerms);
@@ -569,6 +603,128 @@ int ComputeBindingWithChainSplitting(Structure* pStructure, char split1[], char
 }
 
 
+// score every PDB file listed in pdbList (one per line) with the command ComputeStability or ComputeBinding,
+// reusing the parameters, topologies and tables loaded once by the caller; the structures are spread over
+// nthreads threads and each gets one line in outFile, written in the order of the list
+int ComputeStructuresInBatch(char* command, char* pdbList, AtomParamsSet* pAtomParams, ResiTopoSet* pTopos, AAppTable* pAAppTable, RamaTable* pRama, char* binLib, char* split1, char* outFile, int nthreads)
+{
+  char errMsg[MAX_LEN_ERR_MSG + 1];
+  BOOL stability = strcmp(command, "ComputeStability") == 0 ? TRUE : FALSE;
+  if (stability == FALSE && strcmp(command, "ComputeBinding") != 0)
+  {
+    sprintf(errMsg, "in file %s line %d, command %s cannot be run over a PDB list, use ComputeStability or ComputeBinding", __FILE__, __LINE__, command);
+    TraceError(errMsg, ValueError);
+    return ValueError;
+  }
+  FileReader fr;
+  if (FAILED(FileReaderCreate(&fr, pdbList)))
+  {
+    sprintf(errMsg, "in file %s line %d, failed to read PDB list %s", __FILE__, __LINE__, pdbList);
+    TraceError(errMsg, IOError);
+    return IOError;
+  }
+  StringArray pdbFiles;
+  StringArrayCreate(&pdbFiles);
+  char line[MAX_LEN_ONE_LINE_CONTENT + 1];
+  while (!FAILED(FileReaderGetNextLine(&fr, line)))
+  {
+    char pdbFile[MAX_LEN_ONE_LINE_CONTENT + 1] = "";
+    if (sscanf(line, "%s", pdbFile) == 1 && pdbFile[0] != '#') StringArrayAppend(&pdbFiles, pdbFile);
+  }
+  FileReaderDestroy(&fr);
+
+  // the whole binary rotamer library is read once and shared by all threads
+  char* libImage = NULL;
+  long libSize = 0;
+  if (stability == TRUE && binLib != NULL)
+  {
+    FILE* pFileLib = fopen(binLib, "rb");
+    if (pFileLib == NULL)
+    {
+      sprintf(errMsg, "in file %s line %d, failed to read rotamer library %s", __FILE__, __LINE__, binLib);
+      TraceError(errMsg, IOError);
+      StringArrayDestroy(&pdbFiles);
+      return IOError;
+    }
+    fseek(pFileLib, 0, SEEK_END);
+    libSize = ftell(pFileLib);
+    fseek(pFileLib, 0, SEEK_SET);
+    libImage = (char*)malloc(libSize + 1);
+    libSize = (long)fread(libImage, sizeof(char), libSize, pFileLib);
+    fclose(pFileLib);
+  }
+
+  FILE* pOut = fopen(outFile, "w");
+  if (pOut == NULL)
+  {
+    sprintf(errMsg, "in file %s line %d, failed to open %s for writing", __FILE__, __LINE__, outFile);
+    TraceError(errMsg, IOError);
+    free(libImage);
+    StringArrayDestroy(&pdbFiles);
+    return IOError;
+  }
+  fprintf(pOut, "#%-39s %-8s %12s %12s %12s %12s %12s %12s %12s %12s %12s\n", "pdb", "status", "total",
+    "reference", "intraR", "aapropensity", "ramachandran", "dunbrack", "interS", "interD", "prolig");
+  int pdbCount = StringArrayGetCount(&pdbFiles);
+  int failCount = 0;
+#ifndef _OPENMP
+  nthreads = 1;
+#endif
+  if (nthreads < 1) nthreads = 1;
+#pragma omp parallel for schedule(dynamic) ordered num_threads(nthreads) reduction(+:failCount)
+  for (int n = 0; n < pdbCount; n++)
+  {
+    char* pdbFile = StringArrayGet(&pdbFiles, n);
+    double energyTerms[MAX_ENERGY_TERM] = { 0 };
+    const char* status = "ok";
+    Structure structure;
+    StructureCreate(&structure);
+    if (FAILED(StructureReadPDB(&structure, pdbFile, pAtomParams, pTopos)))
+    {
+      status = "failed";
+      failCount++;
+    }
+    else if (stability == TRUE)
+    {
+      StructureCalcPhiPsi(&structure);
+      if (libImage != NULL) StructureDunbrackEnergyFromBinLib(&structure, NULL, libImage, libSize, energyTerms);
+      StructureStabilityEnergy(&structure, pAAppTable, pRama, energyTerms);
+      EnergyTermWeighting(energyTerms);
+    }
+    else if (StructureGetChainCount(&structure) <= 1)
+    {
+      status = "onechain";
+    }
+    else
+    {
+      StructureBindingEnergy(&structure, StructureGetChainCount(&structure) > 2 ? split1 : NULL, energyTerms);
+      EnergyTermWeighting(energyTerms);
+    }
+    StructureDestroy(&structure);
+
+    double groups[9] = { energyTerms[0], 0.0, 0.0, energyTerms[91], energyTerms[92], energyTerms[93], 0.0, 0.0, 0.0 };
+    for (int t = 1; t <= 20; t++) groups[1] += energyTerms[t];
+    for (int t = 21; t <= 29; t++) groups[2] += energyTerms[t];
+    for (int t = 31; t <= 49; t++) groups[6] += energyTerms[t];
+    for (int t = 51; t <= 69; t++) groups[7] += energyTerms[t];
+    for (int t = 71; t <= 89; t++) groups[8] += energyTerms[t];
+#pragma omp ordered
+    {
+      fprintf(pOut, "%-40s %-8s", pdbFile, status);
+      for (int g = 0; g < 9; g++) fprintf(pOut, " %12.6f", groups[g]);
+      fprintf(pOut, "\n");
+    }
+  }
+  fclose(pOut);
+  printf("%s: scored %d of %d structures from %s with %d thread(s), results written to %s\n",
+    command, pdbCount - failCount, pdbCount, pdbList, nthreads, outFile);
+
+  free(libImage);
+  StringArrayDestroy(&pdbFiles);
+  return Success;
+}
+
+
 //this function is used to build the structure model of mutations
 int BuildMutant(Structure* pStructure, char* mutantfile, BBindRotamerLib* rotlib, AtomParamsSet* atomParams, ResiTopoSet* resiTopos, char* pdbid)
 {
@@ -1990,265 +2146,226 @@ int CompareSidechainsOf2Structures(Structure* pStructure, Structure* pStructure2
   return Success;
 }
 
-int CheckClash0(Structure* pStructure, double clashRatio)
+typedef struct _ClashAtom
 {
-  printf("checking structure clashes with atom pairwise distance < %.2f*(ri+rj)\n", clashRatio);
-  for (int i = 0;i < StructureGetChainCount(pStructure);i++)
+  Atom* pAtom;
+  Residue* pResi;
+  int chnNdx;
+  int resNdx;
+  int atomNdx;
+} ClashAtom;
+
+typedef struct _ClashPair
+{
+  int first;
+  int second;
+  double dist;
+} ClashPair;
+
+static ClashAtom* clashAtomsToSort = NULL;
+
+static int ClashPairCompare(const void* a, const void* b)
+{
+  // order clashes as the residue-pair loops of the original checker reported them
+  ClashAtom* pA1 = &clashAtomsToSort[((ClashPair*)a)->first];
+  ClashAtom* pA2 = &clashAtomsToSort[((ClashPair*)a)->second];
+  ClashAtom* pB1 = &clashAtomsToSort[((ClashPair*)b)->first];
+  ClashAtom* pB2 = &clashAtomsToSort[((ClashPair*)b)->second];
+  int keyA[6] = { pA1->chnNdx, pA2->chnNdx, pA1->resNdx, pA2->resNdx, pA1->atomNdx, pA2->atomNdx };
+  int keyB[6] = { pB1->chnNdx, pB2->chnNdx, pB1->resNdx, pB2->resNdx, pB1->atomNdx, pB2->atomNdx };
+  for (int i = 0; i < 6; i++)
   {
-    Chain* pChainI = StructureGetChain(pStructure, i);
+    if (keyA[i] != keyB[i]) return keyA[i] < keyB[i] ? -1 : 1;
+  }
+  return 0;
+}
 
-    for (int j = 0;j < ChainGetResidueCount(pChainI);j++)
+// report pairs of side-chain heavy atoms from different residues closer than clashRatio*(ri+rj);
+// candidate pairs come from a uniform grid whose cell edge is the largest possible clash distance,
+// so each atom is only compared with the atoms in its own and the 26 surrounding cells
+int StructureCheckClash(Structure* pStructure, double clashRatio)
+{
+  printf("checking structure clashes with atom pairwise distance < %.2f*(ri+rj)\n", clashRatio);
+  int atomCount = 0;
+  for (int i = 0; i < StructureGetChainCount(pStructure); i++)
+  {
+    Chain* pChain = StructureGetChain(pStructure, i);
+    for (int j = 0; j < ChainGetResidueCount(pChain); j++)
     {
-      Residue* pResiIJ = ChainGetResidue(pChainI, j);
-      for (int j2 = j + 1;j2 < ChainGetResidueCount(pChainI);j2++)
-      {
-        Residue* pResiIJ2 = ChainGetResidue(pChainI, j2);
-        for (int atom1 = 0;atom1 < ResidueGetAtomCount(pResiIJ);atom1++)
-        {
-          Atom* pAtom1 = ResidueGetAtom(pResiIJ, atom1);
-          if (pAtom1->isBBAtom || AtomIsHydrogen(pAtom1)) continue;
-          for (int atom2 = 0;atom2 < ResidueGetAtomCount(pResiIJ2);atom2++)
-          {
-            Atom* pAtom2 = ResidueGetAtom(pResiIJ2, atom2);
-            if (pAtom2->isBBAtom || AtomIsHydrogen(pAtom2)) continue;
-            double dist = XYZDistance(&pAtom1->xyz, &pAtom2->xyz);
-            if (dist < clashRatio * (pAtom1->vdw_radius + pAtom2->vdw_radius))
-            {
-              printf("protein residue %s%d%s atom %s and protein residue %s%d%s atom %s has clash, dist=%f\n",
-                AtomGetChainName(pAtom1), AtomGetPosInChain(pAtom1), ResidueGetName(pResiIJ), AtomGetName(pAtom1),
-                AtomGetChainName(pAtom2), AtomGetPosInChain(pAtom2), ResidueGetName(pResiIJ2), AtomGetName(pAtom2),
-                dist);
-            }
-          }
-        }
-      }
+      atomCount += ResidueGetAtomCount(ChainGetResidue(pChain, j));
     }
-
-    for (int k = i + 1;k < StructureGetChainCount(pStructure);k++)
+  }
+  ClashAtom* atoms = (ClashAtom*)malloc(sizeof(ClashAtom) * (atomCount + 1));
+  atomCount = 0;
+  double maxRadius = 0.0;
+  for (int i = 0; i < StructureGetChainCount(pStructure); i++)
+  {
+    Chain* pChain = StructureGetChain(pStructure, i);
+    for (int j = 0; j < ChainGetResidueCount(pChain); j++)
     {
-      Chain* pChainK = StructureGetChain(pStructure, k);
-      for (int j = 0;j < ChainGetResidueCount(pChainI);j++)
-      {
-        Residue* pResiIJ = ChainGetResidue(pChainI, j);
-        for (int l = 0;l < ChainGetResidueCount(pChainK);l++)
-        {
-          Residue* pResiKL = ChainGetResidue(pChainK, l);
-          for (int atom1 = 0;atom1 < ResidueGetAtomCount(pResiIJ);atom1++)
-          {
-            Atom* pAtom1 = ResidueGetAtom(pResiIJ, atom1);
-            if (pAtom1->isBBAtom || AtomIsHydrogen(pAtom1)) continue;
-            for (int atom2 = 0;atom2 < ResidueGetAtomCount(pResiKL);atom2++)
-            {
-              Atom* pAtom2 = ResidueGetAtom(pResiKL, atom2);
-              if (pAtom2->isBBAtom || AtomIsHydrogen(pAtom2)) continue;
-              double dist = XYZDistance(&pAtom1->xyz, &pAtom2->xyz);
-              if (dist < clashRatio * (pAtom1->vdw_radius + pAtom2->vdw_radius))
-              {
-                if (ChainGetType(pChainI) == Type_Chain_SmallMol)
-                {
-                  printf("ligand residue %s%d%s atom %s and protein residue %s%d%s atom %s has clash, dist=%f\n",
-                    AtomGetChainName(pAtom1), AtomGetPosInChain(pAtom1), ResidueGetName(pResiIJ), AtomGetName(pAtom1),
-                    AtomGetChainName(pAtom2), AtomGetPosInChain(pAtom2), ResidueGetName(pResiKL), AtomGetName(pAtom2),
-                    dist);
-                }
-                else if (ChainGetType(pChainK) == Type_Chain_SmallMol)
-                {
-                  printf("protein residue %s%d%s atom %s and ligand residue %s%d%s atom %s has clash, dist=%f\n",
-                    AtomGetChainName(pAtom1), AtomGetPosInChain(pAtom1), ResidueGetName(pResiIJ), AtomGetName(pAtom1),
-                    AtomGetChainName(pAtom2), AtomGetPosInChain(pAtom2), ResidueGetName(pResiKL), AtomGetName(pAtom2),
-                    dist);
-                }
-                else
-                {
-                  printf("protein residue %s%d%s atom %s and protein residue %s%d%s atom %s has clash, dist=%f\n",
-                    AtomGetChainName(pAtom1), AtomGetPosInChain(pAtom1), ResidueGetName(pResiIJ), AtomGetName(pAtom1),
-                    AtomGetChainName(pAtom2), AtomGetPosInChain(pAtom2), ResidueGetName(pResiKL), AtomGetName(pAtom2),
-                    dist);
-                }
-              }
-            }
-          }
-        }
+      Residue* pResi = ChainGetResidue(pChain, j);
+      for (int k = 0; k < ResidueGetAtomCount(pResi); k++)
+      {
+        Atom* pAtom = ResidueGetAtom(pResi, k);
+        if (pAtom->isBBAtom || AtomIsHydrogen(pAtom)) continue;
+        atoms[atomCount].pAtom = pAtom;
+        atoms[atomCount].pResi = pResi;
+        atoms[atomCount].chnNdx = i;
+        atoms[atomCount].resNdx = j;
+        atoms[atomCount].atomNdx = k;
+        if (pAtom->vdw_radius > maxRadius) maxRadius = pAtom->vdw_radius;
+        atomCount++;
       }
     }
   }
 
-  return Success;
-}
-
-int CheckClash1(Structure* pStructure, double clashRatio)
-{
-  printf("checking structure clashes with atom pairwise distance < %.2f*(ri+rj)\n", clashRatio);
-  for (int i = 0;i < StructureGetChainCount(pStructure);i++)
+  int pairCount = 0, pairCapacity = 64;
+  ClashPair* pairs = (ClashPair*)malloc(sizeof(ClashPair) * pairCapacity);
+  if (atomCount > 0)
   {
-    Chain* pChainI = StructureGetChain(pStructure, i);
+    XYZ lower = atoms[0].pAtom->xyz, upper = atoms[0].pAtom->xyz;
+    for (int a = 1; a < atomCount; a++)
+    {
+      XYZ* pXyz = &atoms[a].pAtom->xyz;
+      if (pXyz->X < lower.X) lower.X = pXyz->X;
+      if (pXyz->Y < lower.Y) lower.Y = pXyz->Y;
+      if (pXyz->Z < lower.Z) lower.Z = pXyz->Z;
+      if (pXyz->X > upper.X) upper.X = pXyz->X;
+      if (pXyz->Y > upper.Y) upper.Y = pXyz->Y;
+      if (pXyz->Z > upper.Z) upper.Z = pXyz->Z;
+    }
+    // keep the grid no larger than a few cells per atom for sparse or far-apart chains
+    double cellSize = 2.0 * clashRatio * maxRadius;
+    if (cellSize < 1.0) cellSize = 1.0;
+    int nx, ny, nz;
+    while (TRUE)
+    {
+      nx = (int)((upper.X - lower.X) / cellSize) + 1;
+      ny = (int)((upper.Y - lower.Y) / cellSize) + 1;
+      nz = (int)((upper.Z - lower.Z) / cellSize) + 1;
+      if ((double)nx * ny * nz <= 8.0 * atomCount + 1000.0) break;
+      cellSize *= 1.25;
+    }
 
-    for (int j = 0;j < ChainGetResidueCount(pChainI);j++)
+    int cellCount = nx * ny * nz;
+    int* cellOfAtom = (int*)malloc(sizeof(int) * atomCount);
+    int* cellStart = (int*)calloc(cellCount + 1, sizeof(int));
+    int* cellAtoms = (int*)malloc(sizeof(int) * atomCount);
+    for (int a = 0; a < atomCount; a++)
     {
-      Residue* pResiIJ = ChainGetResidue(pChainI, j);
-      for (int j2 = j + 1;j2 < ChainGetResidueCount(pChainI);j2++)
-      {
-        Residue* pResiIJ2 = ChainGetResidue(pChainI, j2);
-        for (int atom1 = 0;atom1 < ResidueGetAtomCount(pResiIJ);atom1++)
-        {
-          Atom* pAtom1 = ResidueGetAtom(pResiIJ, atom1);
-          if (pAtom1->isBBAtom || AtomIsHydrogen(pAtom1)) continue;
-          for (int atom2 = 0;atom2 < ResidueGetAtomCount(pResiIJ2);atom2++)
-          {
-            Atom* pAtom2 = ResidueGetAtom(pResiIJ2, atom2);
-            if (pAtom2->isBBAtom || AtomIsHydrogen(pAtom2)) continue;
-            double dist = XYZDistance(&pAtom1->xyz, &pAtom2->xyz);
-            if (dist < clashRatio * (pAtom1->vdw_radius + pAtom2->vdw_radius))
-            {
-              printf("protein residue %s%d%s atom %s and protein residue %s%d%s atom %s has clash, dist=%f\n",
-                AtomGetChainName(pAtom1), AtomGetPosInChain(pAtom1), ResidueGetName(pResiIJ), AtomGetName(pAtom1),
-                AtomGetChainName(pAtom2), AtomGetPosInChain(pAtom2), ResidueGetName(pResiIJ2), AtomGetName(pAtom2),
-                dist);
-            }
-          }
-        }
-      }
+      XYZ* pXyz = &atoms[a].pAtom->xyz;
+      int cx = (int)((pXyz->X - lower.X) / cellSize);
+      int cy = (int)((pXyz->Y - lower.Y) / cellSize);
+      int cz = (int)((pXyz->Z - lower.Z) / cellSize);
+      cellOfAtom[a] = (cx * ny + cy) * nz + cz;
+      cellStart[cellOfAtom[a] + 1]++;
     }
+    for (int c = 0; c < cellCount; c++) cellStart[c + 1] += cellStart[c];
+    int* cellFill = (int*)malloc(sizeof(int) * cellCount);
+    memcpy(cellFill, cellStart, sizeof(int) * cellCount);
+    for (int a = 0; a < atomCount; a++) cellAtoms[cellFill[cellOfAtom[a]]++] = a;
 
-    for (int k = i + 1;k < StructureGetChainCount(pStructure);k++)
+    for (int a = 0; a < atomCount; a++)
     {
-      Chain* pChainK = StructureGetChain(pStructure, k);
-      for (int j = 0;j < ChainGetResidueCount(pChainI);j++)
+      Atom* pAtom1 = atoms[a].pAtom;
+      int cx = cellOfAtom[a] / (ny * nz), cy = (cellOfAtom[a] / nz) % ny, cz = cellOfAtom[a] % nz;
+      for (int x = cx - 1; x <= cx + 1; x++)
       {
-        Residue* pResiIJ = ChainGetResidue(pChainI, j);
-        for (int l = 0;l < ChainGetResidueCount(pChainK);l++)
+        if (x < 0 || x >= nx) continue;
+        for (int y = cy - 1; y <= cy + 1; y++)
         {
-          Residue* pResiKL = ChainGetResidue(pChainK, l);
-          for (int atom1 = 0;atom1 < ResidueGetAtomCount(pResiIJ);atom1++)
+          if (y < 0 || y >= ny) continue;
+          for (int z = cz - 1; z <= cz + 1; z++)
           {
-            Atom* pAtom1 = ResidueGetAtom(pResiIJ, atom1);
-            if (pAtom1->isBBAtom || AtomIsHydrogen(pAtom1)) continue;
-            for (int atom2 = 0;atom2 < ResidueGetAtomCount(pResiKL);atom2++)
+            if (z < 0 || z >= nz) continue;
+            int c = (x * ny + y) * nz + z;
+            for (int n = cellStart[c]; n < cellStart[c + 1]; n++)
             {
-              Atom* pAtom2 = ResidueGetAtom(pResiKL, atom2);
-              if (pAtom2->isBBAtom || AtomIsHydrogen(pAtom2)) continue;
+              int b = cellAtoms[n];
+              if (b <= a || atoms[b].pResi == atoms[a].pResi) continue;
+              Atom* pAtom2 = atoms[b].pAtom;
               double dist = XYZDistance(&pAtom1->xyz, &pAtom2->xyz);
               if (dist < clashRatio * (pAtom1->vdw_radius + pAtom2->vdw_radius))
               {
-                if (ChainGetType(pChainI) == Type_Chain_SmallMol)
-                {
-                  printf("ligand residue %s%d%s atom %s and protein residue %s%d%s atom %s has clash, dist=%f\n",
-                    AtomGetChainName(pAtom1), AtomGetPosInChain(pAtom1), ResidueGetName(pResiIJ), AtomGetName(pAtom1),
-                    AtomGetChainName(pAtom2), AtomGetPosInChain(pAtom2), ResidueGetName(pResiKL), AtomGetName(pAtom2),
-                    dist);
-                }
-                else if (ChainGetType(pChainK) == Type_Chain_SmallMol)
+                if (pairCount == pairCapacity)
                 {
-                  printf("protein residue %s%d%s atom %s and ligand residue %s%d%s atom %s has clash, dist=%f\n",
-                    AtomGetChainName(pAtom1), AtomGetPosInChain(pAtom1), ResidueGetName(pResiIJ), AtomGetName(pAtom1),
-                    AtomGetChainName(pAtom2), AtomGetPosInChain(pAtom2), ResidueGetName(pResiKL), AtomGetName(pAtom2),
-                    dist);
-                }
-                else
-                {
-                  printf("protein residue %s%d%s atom %s and protein residue %s%d%s atom %s has clash, dist=%f\n",
-                    AtomGetChainName(pAtom1), AtomGetPosInChain(pAtom1), ResidueGetName(pResiIJ), AtomGetName(pAtom1),
-                    AtomGetChainName(pAtom2), AtomGetPosInChain(pAtom2), ResidueGetName(pResiKL), AtomGetName(pAtom2),
-                    dist);
+                  pairCapacity *= 2;
+                  pairs = (ClashPair*)realloc(pairs, sizeof(ClashPair) * pairCapacity);
                 }
+                pairs[pairCount].first = a;
+                pairs[pairCount].second = b;
+                pairs[pairCount].dist = dist;
+                pairCount++;
               }
             }
           }
         }
       }
     }
+    free(cellFill);
+    free(cellAtoms);
+    free(cellStart);
+    free(cellOfAtom);
   }
 
-  return Success;
-}
-
-
-int CheckClash2(Structure* pStructure, double clashRatio)
-{
-  printf("checking structure clashes with atom pairwise distance < %.2f*(ri+rj)\n", clashRatio);
-  for (int i = 0;i < StructureGetChainCount(pStructure);i++)
+  clashAtomsToSort = atoms;
+  qsort(pairs, pairCount, sizeof(ClashPair), ClashPairCompare);
+  clashAtomsToSort = NULL;
+  int intraChainCount = 0, ligandCount = 0;
+  for (int p = 0; p < pairCount; p++)
   {
-    Chain* pChainI = StructureGetChain(pStructure, i);
-
-    for (int j = 0;j < ChainGetResidueCount(pChainI);j++)
+    ClashAtom* pFirst = &atoms[pairs[p].first];
+    ClashAtom* pSecond = &atoms[pairs[p].second];
+    Atom* pAtom1 = pFirst->pAtom;
+    Atom* pAtom2 = pSecond->pAtom;
+    Type_Chain typeI = ChainGetType(StructureGetChain(pStructure, pFirst->chnNdx));
+    Type_Chain typeK = ChainGetType(StructureGetChain(pStructure, pSecond->chnNdx));
+    const char* type1 = "protein";
+    const char* type2 = "protein";
+    if (pFirst->chnNdx == pSecond->chnNdx)
     {
-      Residue* pResiIJ = ChainGetResidue(pChainI, j);
-      for (int j2 = j + 1;j2 < ChainGetResidueCount(pChainI);j2++)
-      {
-        Residue* pResiIJ2 = ChainGetResidue(pChainI, j2);
-        for (int atom1 = 0;atom1 < ResidueGetAtomCount(pResiIJ);atom1++)
-        {
-          Atom* pAtom1 = ResidueGetAtom(pResiIJ, atom1);
-          if (pAtom1->isBBAtom || AtomIsHydrogen(pAtom1)) continue;
-          for (int atom2 = 0;atom2 < ResidueGetAtomCount(pResiIJ2);atom2++)
-          {
-            Atom* pAtom2 = ResidueGetAtom(pResiIJ2, atom2);
-            if (pAtom2->isBBAtom || AtomIsHydrogen(pAtom2)) continue;
-            double dist = XYZDistance(&pAtom1->xyz, &pAtom2->xyz);
-            if (dist < clashRatio * (pAtom1->vdw_radius + pAtom2->vdw_radius))
-            {
-              printf("protein residue %s%d%s atom %s and protein residue %s%d%s atom %s has clash, dist=%f\n",
-                AtomGetChainName(pAtom1), AtomGetPosInChain(pAtom1), ResidueGetName(pResiIJ), AtomGetName(pAtom1),
-                AtomGetChainName(pAtom2), AtomGetPosInChain(pAtom2), ResidueGetName(pResiIJ2), AtomGetName(pAtom2),
-                dist);
-            }
-          }
-        }
-      }
+      intraChainCount++;
     }
-
-    for (int k = i + 1;k < StructureGetChainCount(pStructure);k++)
+    else if (typeI == Type_Chain_SmallMol)
     {
-      Chain* pChainK = StructureGetChain(pStructure, k);
-      for (int j = 0;j < ChainGetResidueCount(pChainI);j++)
-      {
-        Residue* pResiIJ = ChainGetResidue(pChainI, j);
-        for (int l = 0;l < ChainGetResidueCount(pChainK);l++)
-        {
-          Residue* pResiKL = ChainGetResidue(pChainK, l);
-          for (int atom1 = 0;atom1 < ResidueGetAtomCount(pResiIJ);atom1++)
-          {
-            Atom* pAtom1 = ResidueGetAtom(pResiIJ, atom1);
-            if (pAtom1->isBBAtom || AtomIsHydrogen(pAtom1)) continue;
-            for (int atom2 = 0;atom2 < ResidueGetAtomCount(pResiKL);atom2++)
-            {
-              Atom* pAtom2 = ResidueGetAtom(pResiKL, atom2);
-              if (pAtom2->isBBAtom || AtomIsHydrogen(pAtom2)) continue;
-              double dist = XYZDistance(&pAtom1->xyz, &pAtom2->xyz);
-              if (dist < clashRatio * (pAtom1->vdw_radius + pAtom2->vdw_radius))
-              {
-                if (ChainGetType(pChainI) == Type_Chain_SmallMol)
-                {
-                  printf("ligand residue %s%d%s atom %s and protein residue %s%d%s atom %s has clash, dist=%f\n",
-                    AtomGetChainName(pAtom1), AtomGetPosInChain(pAtom1), ResidueGetName(pResiIJ), AtomGetName(pAtom1),
-                    AtomGetChainName(pAtom2), AtomGetPosInChain(pAtom2), ResidueGetName(pResiKL), AtomGetName(pAtom2),
-                    dist);
-                }
-                else if (ChainGetType(pChainK) == Type_Chain_SmallMol)
-                {
-                  printf("protein residue %s%d%s atom %s and ligand residue %s%d%s atom %s has clash, dist=%f\n",
-                    AtomGetChainName(pAtom1), AtomGetPosInChain(pAtom1), ResidueGetName(pResiIJ), AtomGetName(pAtom1),
-                    AtomGetChainName(pAtom2), AtomGetPosInChain(pAtom2), ResidueGetName(pResiKL), AtomGetName(pAtom2),
-                    dist);
-                }
-                else
-                {
-                  printf("protein residue %s%d%s atom %s and protein residue %s%d%s atom %s has clash, dist=%f\n",
-                    AtomGetChainName(pAtom1), AtomGetPosInChain(pAtom1), ResidueGetName(pResiIJ), AtomGetName(pAtom1),
-                    AtomGetChainName(pAtom2), AtomGetPosInChain(pAtom2), ResidueGetName(pResiKL), AtomGetName(pAtom2),
-                    dist);
-                }
-              }
-            }
-          }
-        }
-      }
+      type1 = "ligand";
+      ligandCount++;
+    }
+    else if (typeK == Type_Chain_SmallMol)
+    {
+      type2 = "ligand";
+      ligandCount++;
     }
+    printf("%s residue %s%d%s atom %s and %s residue %s%d%s atom %s has clash, dist=%f\n",
+      type1, AtomGetChainName(pAtom1), AtomGetPosInChain(pAtom1), ResidueGetName(pFirst->pResi), AtomGetName(pAtom1),
+      type2, AtomGetChainName(pAtom2), AtomGetPosInChain(pAtom2), ResidueGetName(pSecond->pResi), AtomGetName(pAtom2),
+      pairs[p].dist);
   }
+  printf("clash_summary: ratio=%.2f atoms=%d clashes=%d intra_chain=%d inter_chain=%d ligand=%d\n",
+    clashRatio, atomCount, pairCount, intraChainCount, pairCount - intraChainCount, ligandCount);
 
+  free(pairs);
+  free(atoms);
   return Success;
 }
 
+// the three modes differ only in the atom radii read from their parameter files
+int CheckClash0(Structure* pStructure, double clashRatio)
+{
+  return StructureCheckClash(pStructure, clashRatio);
+}
+
+int CheckClash1(Structure* pStructure, double clashRatio)
+{
+  return StructureCheckClash(pStructure, clashRatio);
+}
+
+
+int CheckClash2(Structure* pStructure, double clashRatio)
+{
+  return StructureCheckClash(pStructure, clashRatio);
+}
+
 
 int StructureGetAminoAcidComposition(Structure* pStructure, int* aas)
 {
@@ -29,8 +29,12 @@ int ComputeStructureStability(Structure* pStructure, AAppTable* pAAppTable, Rama
 int ComputeStructureStabilityByBBdepRotLib(Structure* pStructure, AAppTable* pAAppTable, RamaTable* pRama, BBdepRotamerLib* pRotLib, double energyTerms[MAX_ENERGY_TERM]);
 int ComputeStructureStabilityByBBdepRotLib2(Structure* pStructure, AAppTable* pAAppTable, RamaTable* pRama, char* dunlibfile, double energyTerms[MAX_ENERGY_TERM]);
 
+int StructureStabilityEnergy(Structure* pStructure, AAppTable* pAAppTable, RamaTable* pRama, double energyTerms[MAX_ENERGY_TERM]);
+int StructureDunbrackEnergyFromBinLib(Structure* pStructure, FILE* pFileLib, char* libImage, long libSize, double energyTerms[MAX_ENERGY_TERM]);
+int StructureBindingEnergy(Structure* pStructure, char split1[], double energyTerms[MAX_ENERGY_TERM]);
 int ComputeBinding(Structure* pStructure);
 int ComputeBindingWithChainSplitting(Structure* pStructure, char split1[], char split2[]);
+int ComputeStructuresInBatch(char* command, char* pdbList, AtomParamsSet* pAtomParams, ResiTopoSet* pTopos, AAppTable* pAAppTable, RamaTable* pRama, char* binLib, char* split1, char* outFile, int nthreads);
 
 int BuildMutant(Structure* pStructure, char* mutantfile, BBindRotamerLib* rotlib, AtomParamsSet* atomParams, ResiTopoSet* resiTopos, char* pdbid);
 int BuildMutantByBBdepRotLib(Structure* pStructure, char* mutantfile, BBdepRotamerLib* pBBdepRotLib, AtomParamsSet* atomParams, ResiTopoSet* resiTopos, char* pdbid);
@@ -55,6 +59,7 @@ int CheckRotamerInBBdepRotLib(Structure* pStructure, BBdepRotamerLib* pRotLib, R
 int FindMinRmsdRotFromRotLib(Structure* pStructure, char* pdbid);
 int CompareSidechainsOf2Structures(Structure* pStructure, Structure* pStructure2, FILE* pTorsion, FILE* pRmsd);
 
+int StructureCheckClash(Structure* pStructure, double clashRatio);
 int CheckClash0(Structure* pStructure, double clashRatio);
 int CheckClash1(Structure* pStructure, double clashRatio);
 int CheckClash2(Structure* pStructure, double clashRatio);
@@ -24,6 +24,9 @@ IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 extern BOOL FLAG_EVOLUTION;
 extern BOOL FLAG_PHYSICS;
@@ -34,8 +37,16 @@ extern BOOL FLAG_ENZYME;
 extern BOOL FLAG_MOL2;
 extern BOOL FLAG_EVOPHIPSI;
 extern BOOL FLAG_DESIGN_FROM_NATAA;
+extern BOOL FLAG_PAIR_TABLE;
+extern BOOL FLAG_ENERGY_MATRIX;
+extern BOOL FLAG_DEE;
+extern BOOL FLAG_EXACT_SEARCH;
+extern double EXACT_TIME_LIMIT;
+
+extern EvolutionScorer* EVO_SCORER;
 
 extern char FILE_BESTSEQS[MAX_LEN_FILE_NAME + 1];
+extern char FILE_ENERGY_MATRIX[MAX_LEN_FILE_NAME + 1];
 extern char FILE_BESTSTRUCT[MAX_LEN_FILE_NAME + 1];
 extern char FILE_BEST_ALL_SITES[MAX_LEN_FILE_NAME + 1];
 extern char FILE_BEST_MUT_SITES[MAX_LEN_FILE_NAME + 1];
@@ -47,6 +58,8 @@ extern char FILE_CATACONS[MAX_LEN_FILE_NAME + 1];
 extern int PROT_LEN_NORM;
 extern int NTRAJ;
 extern int NTRAJ_START_NDX;
+extern int NTHREADS;
+extern int NREPLICAS;
 
 extern char PDBID[MAX_LEN_FILE_NAME + 1];
 extern char DES_CHAINS[MAX_LEN_ONE_LINE_CONTENT + 1];
@@ -191,19 +204,147 @@ int DesignSiteShowRotamerTypeAndCount(RotamerList* pList, Structure* pStructure,
 }
 
 
-int SequenceRandomSiteIndex(int* mutSiteIndex, int designSiteCount)
+// bounding sphere of the side-chain atoms of one rotamer; the rotamer-rotamer energies skip the backbone atoms
+static double RotamerSidechainBoundingSphere(Rotamer* pRot, XYZ* pCenter)
+{
+  pCenter->X = pCenter->Y = pCenter->Z = 0.0;
+  int atomCount = 0;
+  for (int a = 0; a < RotamerGetAtomCount(pRot); a++)
+  {
+    Atom* pAtom = RotamerGetAtom(pRot, a);
+    if (pAtom->isXyzValid == FALSE || pAtom->isBBAtom == TRUE) continue;
+    pCenter->X += pAtom->xyz.X;
+    pCenter->Y += pAtom->xyz.Y;
+    pCenter->Z += pAtom->xyz.Z;
+    atomCount++;
+  }
+  if (atomCount == 0)
+  {
+    return -1.0;
+  }
+  pCenter->X /= atomCount;
+  pCenter->Y /= atomCount;
+  pCenter->Z /= atomCount;
+  double radius = 0.0;
+  for (int a = 0; a < RotamerGetAtomCount(pRot); a++)
+  {
+    Atom* pAtom = RotamerGetAtom(pRot, a);
+    if (pAtom->isXyzValid == FALSE || pAtom->isBBAtom == TRUE) continue;
+    double distance = XYZDistance(pCenter, &pAtom->xyz);
+    if (distance > radius) radius = distance;
+  }
+  return radius;
+}
+
+
+int StructureBuildDesignSiteGraph(Structure* pStruct)
+{
+  // a sphere around every rotamer, and one around all rotamers of a site for the first test
+  int siteCount = StructureGetDesignSiteCount(pStruct);
+  XYZ** rotCenters = (XYZ**)malloc(sizeof(XYZ*) * (siteCount > 0 ? siteCount : 1));
+  double** rotRadii = (double**)malloc(sizeof(double*) * (siteCount > 0 ? siteCount : 1));
+  XYZ* centers = (XYZ*)malloc(sizeof(XYZ) * (siteCount > 0 ? siteCount : 1));
+  double* radii = (double*)malloc(sizeof(double) * (siteCount > 0 ? siteCount : 1));
+  for (int i = 0; i < siteCount; i++)
+  {
+    RotamerSet* pSet = DesignSiteGetRotamers(StructureGetDesignSite(pStruct, i));
+    int rotCount = RotamerSetGetCount(pSet);
+    rotCenters[i] = (XYZ*)malloc(sizeof(XYZ) * (rotCount > 0 ? rotCount : 1));
+    rotRadii[i] = (double*)malloc(sizeof(double) * (rotCount > 0 ? rotCount : 1));
+    centers[i].X = centers[i].Y = centers[i].Z = 0.0;
+    int sphereCount = 0;
+    for (int j = 0; j < rotCount; j++)
+    {
+      Rotamer* pRot = RotamerSetGet(pSet, j);
+      RotamerRestore(pRot, pSet);
+      rotRadii[i][j] = RotamerSidechainBoundingSphere(pRot, &rotCenters[i][j]);
+      RotamerExtract(pRot);
+      if (rotRadii[i][j] < 0) continue;
+      centers[i].X += rotCenters[i][j].X;
+      centers[i].Y += rotCenters[i][j].Y;
+      centers[i].Z += rotCenters[i][j].Z;
+      sphereCount++;
+    }
+    radii[i] = -1.0;
+    if (sphereCount == 0)
+    {
+      // no side-chain atoms (e.g. glycine only), the site cannot interact with anything
+      continue;
+    }
+    centers[i].X /= sphereCount;
+    centers[i].Y /= sphereCount;
+    centers[i].Z /= sphereCount;
+    for (int j = 0; j < rotCount; j++)
+    {
+      if (rotRadii[i][j] < 0) continue;
+      double radius = XYZDistance(&centers[i], &rotCenters[i][j]) + rotRadii[i][j];
+      if (radius > radii[i]) radii[i] = radius;
+    }
+  }
+
+  // rotamer pairs farther apart than the energy cutoff have zero interaction energy
+  double cutoff = ENERGY_DISTANCE_CUTOFF + DESIGN_SITE_GRAPH_MARGIN;
+  int edgeCount = 0;
+  for (int i = 0; i < siteCount; i++)
+  {
+    IntArrayResize(&StructureGetDesignSite(pStruct, i)->nbrNdxs, 0);
+  }
+  for (int i = 0; i < siteCount; i++)
+  {
+    if (radii[i] < 0) continue;
+    int rotCountI = RotamerSetGetCount(DesignSiteGetRotamers(StructureGetDesignSite(pStruct, i)));
+    for (int k = i + 1; k < siteCount; k++)
+    {
+      if (radii[k] < 0 || XYZDistance(&centers[i], &centers[k]) > radii[i] + radii[k] + cutoff) continue;
+      int rotCountK = RotamerSetGetCount(DesignSiteGetRotamers(StructureGetDesignSite(pStruct, k)));
+      BOOL linked = FALSE;
+      for (int j = 0; j < rotCountI && linked == FALSE; j++)
+      {
+        if (rotRadii[i][j] < 0 || XYZDistance(&rotCenters[i][j], &centers[k]) > rotRadii[i][j] + radii[k] + cutoff) continue;
+        for (int s = 0; s < rotCountK; s++)
+        {
+          if (rotRadii[k][s] >= 0 && XYZDistance(&rotCenters[i][j], &rotCenters[k][s]) <= rotRadii[i][j] + rotRadii[k][s] + cutoff)
+          {
+            linked = TRUE;
+            break;
+          }
+        }
+      }
+      if (linked == TRUE)
+      {
+        IntArrayAppend(&StructureGetDesignSite(pStruct, i)->nbrNdxs, k);
+        IntArrayAppend(&StructureGetDesignSite(pStruct, k)->nbrNdxs, i);
+        edgeCount++;
+      }
+    }
+  }
+  printf("%d out of %d design site pairs are within interaction range\n", edgeCount, siteCount * (siteCount - 1) / 2);
+  for (int i = 0; i < siteCount; i++)
+  {
+    free(rotCenters[i]);
+    free(rotRadii[i]);
+  }
+  free(rotCenters);
+  free(rotRadii);
+  free(centers);
+  free(radii);
+  return Success;
+}
+
+
+int SequenceRandomSiteIndex(int* mutSiteIndex, int designSiteCount, RandomGenerator* pRand)
 {
-  *mutSiteIndex = rand() % designSiteCount;
+  *mutSiteIndex = RandomGeneratorInt(pRand, designSiteCount);
   return Success;
 }
 
 
-int SequenceRandRotamerIndex(Structure* pStruct, RotamerList* pList, StringArray** ppRotTypes, IntArray** ppRotCounts, int siteNdx, int* rotNdx)
+int SequenceRandRotamerIndex(Structure* pStruct, RotamerList* pList, StringArray** ppRotTypes, IntArray** ppRotCounts, int siteNdx, int* rotNdx, RandomGenerator* pRand)
 {
   StringArray* pStringArray = *ppRotTypes;
   IntArray* pIntArray = *ppRotCounts;
-  int typeIndex = rand() % IntArrayGetLength(&pIntArray[siteNdx]);
-  int indexInType = rand() % IntArrayGet(&pIntArray[siteNdx], typeIndex);
+  int typeIndex = RandomGeneratorInt(pRand, IntArrayGetLength(&pIntArray[siteNdx]));
+  int indexInType = RandomGeneratorInt(pRand, IntArrayGet(&pIntArray[siteNdx], typeIndex));
   int typeflag = 0;
   for (int i = 0; i < pList->rotamerCount[siteNdx]; i++)
   {
@@ -234,7 +375,7 @@ int SequenceUpdateSingleSite(Sequence* pSeq, int siteNdx, int rotNdx)
 }
 
 
-int SequenceGenRandomSeed(Sequence* pSeq, RotamerList* pList)
+int SequenceGenRandomSeed(Sequence* pSeq, RotamerList* pList, RandomGenerator* pRand)
 {
   SequenceDestroy(pSeq);
   SequenceCreate(pSeq);
@@ -245,7 +386,7 @@ int SequenceGenRandomSeed(Sequence* pSeq, RotamerList* pList)
   IntArrayResize(&pSeq->rotNdxs, pSeq->desSiteCount);
   for (int i = 0; i < pSeq->desSiteCount; i++)
   {
-    int j = rand() % pList->remainRotamerCount[i];
+    int j = RandomGeneratorInt(pRand, pList->remainRotamerCount[i]);
     int trueJ;
     RotamerOriginalIndexGet(pList, i, j, &trueJ);
     IntArraySet(&pSeq->rotNdxs, i, trueJ);
@@ -549,209 +690,1197 @@ int SequenceEnergy(Structure* pStruct, Sequence* pSeq)
 }
 
 
-int EnergyDifferenceUponSingleMutation(Structure* pStruct, Sequence* pSeq, int mutSiteNdx, int mutRotNdx, double* dtot, double* dphy, double* dbin, double* devo)
+int PairEnergyTableCreate(PairEnergyTable* pThis)
 {
-  double phyBefore = 0;
-  double phyAfter = 0;
-  double binBefore = 0;
-  double binAfter = 0;
+  EnergyMatrixCreate(&pThis->phy);
+  EnergyMatrixCreate(&pThis->bin);
+  pThis->reducedNdx = NULL;
+  return Success;
+}
 
-  if (FLAG_PHYSICS == TRUE)
+
+void PairEnergyTableDestroy(PairEnergyTable* pThis)
+{
+  if (pThis->reducedNdx != NULL)
   {
-    DesignSite* pCurSite = StructureGetDesignSite(pStruct, mutSiteNdx);
-    RotamerSet* pCurSet = DesignSiteGetRotamers(pCurSite);
-    Chain* pCurChain = StructureGetChain(pStruct, pCurSite->chnNdx);
-    Rotamer* pCurRot = RotamerSetGet(pCurSet, IntArrayGet(&pSeq->rotNdxs, mutSiteNdx));
-    Rotamer* pNewRot = RotamerSetGet(pCurSet, mutRotNdx);
-    RotamerRestore(pCurRot, pCurSet);
-    RotamerRestore(pNewRot, pCurSet);
-    phyBefore += pCurRot->selfEnergy;
-    phyAfter += pNewRot->selfEnergy;
-    if (FLAG_MONOMER == FALSE)
+    for (int i = 0; i < pThis->phy.designSiteCount; i++)
     {
-      binBefore += pCurRot->selfEnergyBin;
-      binAfter += pNewRot->selfEnergyBin;
+      free(pThis->reducedNdx[i]);
     }
-    double energyTermsExBind1[MAX_ENERGY_TERM] = { 0 };
-    double energyTermsExBind2[MAX_ENERGY_TERM] = { 0 };
-    double energyTermsBind1[MAX_ENERGY_TERM] = { 0 };
-    double energyTermsBind2[MAX_ENERGY_TERM] = { 0 };
-    for (int i = 0; i < StructureGetDesignSiteCount(pStruct); i++)
+    free(pThis->reducedNdx);
+    pThis->reducedNdx = NULL;
+  }
+  EnergyMatrixDestroy(&pThis->phy);
+  EnergyMatrixDestroy(&pThis->bin);
+  pThis->phy.designSiteCount = 0;
+  pThis->bin.designSiteCount = 0;
+}
+
+
+// fills one selected block of the pair energy table; pStruct may be a per-thread design view
+static int PairEnergyTableBlockGenerate(PairEnergyTable* pThis, EnergyMatrixBlock* pBlock, Structure* pStruct, RotamerList* pList, int i, int k)
+{
+  DesignSite* pSiteI = StructureGetDesignSite(pStruct, i);
+  DesignSite* pSiteK = StructureGetDesignSite(pStruct, k);
+  RotamerSet* pSetI = DesignSiteGetRotamers(pSiteI);
+  RotamerSet* pSetK = DesignSiteGetRotamers(pSiteK);
+  Chain* pChainI = StructureGetChain(pStruct, pSiteI->chnNdx);
+  Chain* pChainK = StructureGetChain(pStruct, pSiteK->chnNdx);
+  for (int s = 0; s < pList->rotamerCount[k]; s++)
+  {
+    if (pList->remainFlag[k][s] == TRUE)
+    {
+      RotamerRestore(RotamerSetGet(pSetK, s), pSetK);
+    }
+  }
+  BOOL interacting = FALSE;
+  for (int j = 0; j < pList->rotamerCount[i]; j++)
+  {
+    if (pList->remainFlag[i][j] == FALSE)
+    {
+      continue;
+    }
+    Rotamer* pRotIJ = RotamerSetGet(pSetI, j);
+    RotamerRestore(pRotIJ, pSetI);
+    for (int s = 0; s < pList->rotamerCount[k]; s++)
     {
-      if (i == mutSiteNdx)
+      if (pList->remainFlag[k][s] == FALSE)
       {
         continue;
       }
-      DesignSite* pSiteI = StructureGetDesignSite(pStruct, i);
-      RotamerSet* pSetI = DesignSiteGetRotamers(pSiteI);
-      Rotamer* pRotI = RotamerSetGet(pSetI, IntArrayGet(&pSeq->rotNdxs, i));
-      Chain* pChainI = StructureGetChain(pStruct, pSiteI->chnNdx);
-      RotamerRestore(pRotI, pSetI);
-      if (pCurSite->chnNdx == pSiteI->chnNdx)
+      Rotamer* pRotKS = RotamerSetGet(pSetK, s);
+      double energyTerms[MAX_ENERGY_TERM] = { 0 };
+      if (pSiteI->chnNdx == pSiteK->chnNdx)
       {
-        if (ChainGetType(pChainI) == Type_Chain_Protein)
-        {
-          EnergyRotamerAndRotamerSameChain(pRotI, pCurRot, energyTermsExBind1);
-          EnergyRotamerAndRotamerSameChain(pRotI, pNewRot, energyTermsExBind2);
-        }
+        EnergyRotamerAndRotamerSameChain(pRotIJ, pRotKS, energyTerms);
+      }
+      else if (ChainGetType(pChainK) == Type_Chain_SmallMol)
+      {
+        EnergyRotamerAndLigandRotamer(pRotIJ, pRotKS, energyTerms);
+      }
+      else if (ChainGetType(pChainI) == Type_Chain_SmallMol)
+      {
+        EnergyRotamerAndLigandRotamer(pRotKS, pRotIJ, energyTerms);
       }
       else
       {
-        if (ChainGetType(pChainI) == Type_Chain_SmallMol)
-        {
-          double energyTermsPL1[MAX_ENERGY_TERM] = { 0 };
-          double energyTermsPL2[MAX_ENERGY_TERM] = { 0 };
-          EnergyRotamerAndLigandRotamer(pCurRot, pRotI, energyTermsPL1);
-          EnergyRotamerAndLigandRotamer(pNewRot, pRotI, energyTermsPL2);
-          //for (int index = 0; index < MAX_ENERGY_TERM; index++)
-          //{
-          //  energyTermsExBind1[index] += energyTermsPL1[index];
-          //  energyTermsExBind2[index] += energyTermsPL2[index];
-          //}
-          if ((strstr(DES_CHAINS, ChainGetName(pChainI)) != NULL && strstr(DES_CHAINS, ChainGetName(pCurChain)) == NULL)
-            || (strstr(DES_CHAINS, ChainGetName(pChainI)) == NULL && strstr(DES_CHAINS, ChainGetName(pCurChain)) != NULL))
-          {
-            if (FLAG_PROT_LIG == TRUE || FLAG_ENZYME == TRUE)
-            {
-              for (int index = 0; index < MAX_ENERGY_TERM; index++)
-              {
-                energyTermsBind1[index] += energyTermsPL1[index];
-                energyTermsBind2[index] += energyTermsPL2[index];
-              }
-            }
-          }
-        }
-        else if (ChainGetType(pCurChain) == Type_Chain_SmallMol)
-        {
-          double energyTermsPL1[MAX_ENERGY_TERM] = { 0 };
-          double energyTermsPL2[MAX_ENERGY_TERM] = { 0 };
-          EnergyRotamerAndLigandRotamer(pRotI, pCurRot, energyTermsPL1);
-          EnergyRotamerAndLigandRotamer(pRotI, pNewRot, energyTermsPL2);
-          //for (int index = 0; index < MAX_ENERGY_TERM; index++)
-          //{
-          //  energyTermsExBind1[index] += energyTermsPL1[index];
-          //  energyTermsExBind2[index] += energyTermsPL2[index];
-          //}
-          if ((strstr(DES_CHAINS, ChainGetName(pChainI)) != NULL && strstr(DES_CHAINS, ChainGetName(pCurChain)) == NULL)
-            || (strstr(DES_CHAINS, ChainGetName(pChainI)) == NULL && strstr(DES_CHAINS, ChainGetName(pCurChain)) != NULL))
-          {
-            if (FLAG_PROT_LIG == TRUE || FLAG_ENZYME == TRUE)
-            {
-              for (int index = 0; index < MAX_ENERGY_TERM; index++)
-              {
-                energyTermsBind1[index] += energyTermsPL1[index];
-                energyTermsBind2[index] += energyTermsPL2[index];
-              }
-            }
-          }
-        }
-        //else if ( (ChainGetType(pChainI) == Type_Chain_Protein || ChainGetType(pChainI) == Type_Chain_DNA || ChainGetType(pChainI) == Type_Chain_RNA || ChainGetType(pChainI) == Type_Chain_Water)
-        //  && (ChainGetType(pCurChain) == Type_Chain_Protein || ChainGetType(pCurChain) == Type_Chain_DNA || ChainGetType(pCurChain) == Type_Chain_RNA || ChainGetType(pCurChain) == Type_Chain_Water) )
-        else
-        {
-          double energyTermsDC1[MAX_ENERGY_TERM] = { 0 };
-          double energyTermsDC2[MAX_ENERGY_TERM] = { 0 };
-          EnergyRotamerAndRotamerDiffChain(pRotI, pCurRot, energyTermsDC1);
-          EnergyRotamerAndRotamerDiffChain(pRotI, pNewRot, energyTermsDC2);
-          //for (int index = 0; index < MAX_ENERGY_TERM; index++)
-          //{
-          //  energyTermsExBind1[index] += energyTermsDC1[index];
-          //  energyTermsExBind2[index] += energyTermsDC2[index];
-          //}
-          if ((strstr(DES_CHAINS, ChainGetName(pChainI)) != NULL && strstr(DES_CHAINS, ChainGetName(pCurChain)) == NULL)
-            || (strstr(DES_CHAINS, ChainGetName(pChainI)) == NULL && strstr(DES_CHAINS, ChainGetName(pCurChain)) != NULL))
-          {
-            if (FLAG_PPI == TRUE)
-            {
-              for (int index = 0; index < MAX_ENERGY_TERM; index++)
-              {
-                energyTermsBind1[index] += energyTermsDC1[index];
-                energyTermsBind2[index] += energyTermsDC2[index];
-              }
-            }
-          }
-        }
+        EnergyRotamerAndRotamerDiffChain(pRotIJ, pRotKS, energyTerms);
+      }
+      EnergyTermWeighting(energyTerms);
+      *EnergyMatrixBlockGet(pBlock, pThis->reducedNdx[i][j], pThis->reducedNdx[k][s]) = energyTerms[0];
+      if (energyTerms[0] != 0.0)
+      {
+        interacting = TRUE;
       }
-      RotamerExtract(pRotI);
     }
-    EnergyTermWeighting(energyTermsExBind1);
-    EnergyTermWeighting(energyTermsExBind2);
-    phyBefore += energyTermsExBind1[0];
-    phyAfter += energyTermsExBind2[0];
-    *dphy = phyAfter - phyBefore;
-
-    if (FLAG_MONOMER == FALSE)
+    RotamerExtract(pRotIJ);
+  }
+  for (int s = 0; s < pList->rotamerCount[k]; s++)
+  {
+    if (pList->remainFlag[k][s] == TRUE)
     {
-      EnergyTermWeighting(energyTermsBind1);
-      EnergyTermWeighting(energyTermsBind2);
-      binBefore += energyTermsBind1[0];
-      binAfter += energyTermsBind2[0];
-      *dbin = binAfter - binBefore;
+      RotamerExtract(RotamerSetGet(pSetK, s));
     }
+  }
+  if (interacting == FALSE)
+  {
+    // far-apart sites, keep the block empty
+    free(pBlock->energyIK);
+    pBlock->energyIK = NULL;
+  }
+  return Success;
+}
 
-    RotamerExtract(pCurRot);
-    RotamerExtract(pNewRot);
+
+// copies the blocks of the jobs from a full energy matrix over all rotamers; nothing is changed if the
+// matrix does not match the design sites and rotamers of pList
+static int PairEnergyTableBlocksLoad(PairEnergyTable* pThis, RotamerList* pList, Job* jobs, int jobCount, char* energyMatrixFile)
+{
+  char errMsg[MAX_LEN_ERR_MSG + 1];
+  EnergyMatrix matrix;
+  EnergyMatrixCreate(&matrix);
+  int result = EnergyMatrixRead(&matrix, energyMatrixFile);
+  if (FAILED(result))
+  {
+    EnergyMatrixDestroy(&matrix);
+    return result;
+  }
+  if (matrix.designSiteCount != pList->desSiteCount)
+  {
+    result = ValueError;
+  }
+  for (int i = 0; result == Success && i < pList->desSiteCount; i++)
+  {
+    if (EnergyMatrixGetRotamerCount(&matrix, i) != pList->rotamerCount[i])
+    {
+      result = ValueError;
+    }
+  }
+  for (int n = 0; result == Success && n < jobCount; n++)
+  {
+    EnergyMatrixBlock* pSource = EnergyMatrixGetBlock(&matrix, jobs[n].designSiteI, jobs[n].designSiteK);
+    if (pSource->energyIK != NULL && (pSource->RotamerCountSiteI != pList->rotamerCount[jobs[n].designSiteI] ||
+      pSource->RotamerCountSiteK != pList->rotamerCount[jobs[n].designSiteK]))
+    {
+      result = ValueError;
+    }
+  }
+  if (FAILED(result))
+  {
+    sprintf(errMsg, "in file %s line %d, energy matrix %s does not match the design sites and rotamers of this job", __FILE__, __LINE__, energyMatrixFile);
+    TraceError(errMsg, result);
+    EnergyMatrixDestroy(&matrix);
+    return result;
   }
 
-  if (FLAG_EVOLUTION == TRUE)
+  for (int n = 0; n < jobCount; n++)
   {
-    double evoBefore = 0;
-    double evoAfter = 0;
-    DesignSite* pCurSite = StructureGetDesignSite(pStruct, mutSiteNdx);
-    RotamerSet* pCurSet = DesignSiteGetRotamers(pCurSite);
-    Rotamer* pCurRot = RotamerSetGet(pCurSet, IntArrayGet(&pSeq->rotNdxs, mutSiteNdx));
-    Rotamer* pNewRot = RotamerSetGet(pCurSet, mutRotNdx);
-    if (RotamerAndRotamerInSameType(pCurRot, pNewRot) == FALSE)
+    int i = jobs[n].designSiteI;
+    int k = jobs[n].designSiteK;
+    EnergyMatrixBlock* pSource = EnergyMatrixGetBlock(&matrix, i, k);
+    EnergyMatrixBlock* pBlock = EnergyMatrixGetBlock(&pThis->phy, i, k);
+    if (pBlock->energyIK == NULL) pBlock = EnergyMatrixGetBlock(&pThis->bin, i, k);
+    BOOL interacting = FALSE;
+    for (int j = 0; j < pList->rotamerCount[i]; j++)
     {
-      char seq1[MAX_SEQ_LEN];
-      StructureGetWholeSequence(pStruct, pSeq, seq1);
-      char seq2[MAX_SEQ_LEN];
-      Sequence newSeq;
-      SequenceCreate(&newSeq);
-      SequenceCopy(&newSeq, pSeq);
-      IntArraySet(&newSeq.rotNdxs, mutSiteNdx, mutRotNdx);
-      StructureGetWholeSequence(pStruct, &newSeq, seq2);
-      if (FLAG_EVOPHIPSI)
+      if (pList->remainFlag[i][j] == FALSE)
       {
-        evoBefore += EvolutionScoreAllFromSeq(seq1);
-        evoAfter += EvolutionScoreAllFromSeq(seq2);
+        continue;
       }
-      else
+      for (int s = 0; s < pList->rotamerCount[k]; s++)
       {
-        evoBefore += EvolutionScoreFromPSSMWithoutAlignment(seq1);
-        evoAfter += EvolutionScoreFromPSSMWithoutAlignment(seq2);
+        if (pList->remainFlag[k][s] == FALSE)
+        {
+          continue;
+        }
+        double energy = pSource->energyIK != NULL ? *EnergyMatrixBlockGet(pSource, j, s) : 0.0;
+        *EnergyMatrixBlockGet(pBlock, pThis->reducedNdx[i][j], pThis->reducedNdx[k][s]) = energy;
+        if (energy != 0.0)
+        {
+          interacting = TRUE;
+        }
       }
-      SequenceDestroy(&newSeq);
     }
-    *devo = evoAfter - evoBefore;
+    if (interacting == FALSE)
+    {
+      free(pBlock->energyIK);
+      pBlock->energyIK = NULL;
+    }
   }
-
-  *dtot = WGT_PROFILE * (*devo) + *dphy + WGT_BIND * (*dbin);
-
+  EnergyMatrixDestroy(&matrix);
   return Success;
 }
 
 
-int Metropolis(Sequence* pSeq, Sequence* pBest, Structure* pStruct, RotamerList* pList, StringArray** ppRotType, IntArray** ppRotCount, int* seqNdx, double temp, int stepCount, FILE* pFileRot, FILE* pFileSeq)
+int PairEnergyTableGenerate(PairEnergyTable* pThis, Structure* pStruct, RotamerList* pList, char* energyMatrixFile)
 {
-  int nacc = 0;
-  for (int i = 0; i < stepCount; i++)
+  int siteCount = pList->desSiteCount;
+  pThis->phy.designSiteCount = siteCount;
+  pThis->bin.designSiteCount = siteCount;
+  pThis->phy.blocks = (EnergyMatrixBlock*)malloc(sizeof(EnergyMatrixBlock) * siteCount * siteCount);
+  pThis->bin.blocks = (EnergyMatrixBlock*)malloc(sizeof(EnergyMatrixBlock) * siteCount * siteCount);
+  for (int i = 0; i < siteCount * siteCount; i++)
   {
-    int   mutSiteNdx;
-    int   mutRotNdx;
-    SequenceRandomSiteIndex(&mutSiteNdx, StructureGetDesignSiteCount(pStruct));
-    SequenceRandRotamerIndex(pStruct, pList, ppRotType, ppRotCount, mutSiteNdx, &mutRotNdx);
-    double dtot = 0, dphy = 0, devo = 0, dbin = 0;
-    EnergyDifferenceUponSingleMutation(pStruct, pSeq, mutSiteNdx, mutRotNdx, &dtot, &dphy, &dbin, &devo);
-    if (exp(-1.0 * dtot / temp) > (double)(rand() + 1.0) / (RAND_MAX + 1.0))
+    EnergyMatrixBlockCreate(&pThis->phy.blocks[i]);
+    EnergyMatrixBlockCreate(&pThis->bin.blocks[i]);
+  }
+  pThis->reducedNdx = (int**)malloc(sizeof(int*) * siteCount);
+  for (int i = 0; i < siteCount; i++)
+  {
+    pThis->reducedNdx[i] = (int*)malloc(sizeof(int) * pList->rotamerCount[i]);
+    int reduced = 0;
+    for (int j = 0; j < pList->rotamerCount[i]; j++)
     {
-      SequenceUpdateSingleSite(pSeq, mutSiteNdx, mutRotNdx);
-      pSeq->etot += dtot;
-      pSeq->ephy += dphy;
-      pSeq->ebin += dbin;
-      pSeq->eevo += devo;
-      if (pSeq->etot < pBest->etot)
-      {
+      pThis->reducedNdx[i][j] = pList->remainFlag[i][j] == TRUE ? reduced++ : -1;
+    }
+  }
+
+  // select the blocks to compute; each selected block becomes one job
+  int jobCount = 0;
+  Job* jobs = (Job*)malloc(sizeof(Job) * (siteCount > 1 ? siteCount * (siteCount - 1) / 2 : 1));
+  BOOL* linked = (BOOL*)malloc(sizeof(BOOL) * siteCount);
+  for (int i = 0; i < siteCount; i++)
+  {
+    DesignSite* pSiteI = StructureGetDesignSite(pStruct, i);
+    Chain* pChainI = StructureGetChain(pStruct, pSiteI->chnNdx);
+    for (int k = 0; k < siteCount; k++) linked[k] = FALSE;
+    for (int n = 0; n < IntArrayGetLength(&pSiteI->nbrNdxs); n++) linked[IntArrayGet(&pSiteI->nbrNdxs, n)] = TRUE;
+    for (int k = i; k < siteCount; k++)
+    {
+      EnergyMatrixBlock* pPhyBlock = EnergyMatrixGetBlock(&pThis->phy, i, k);
+      EnergyMatrixBlock* pBinBlock = EnergyMatrixGetBlock(&pThis->bin, i, k);
+      pPhyBlock->DesignSiteI = pBinBlock->DesignSiteI = i;
+      pPhyBlock->DesignSiteK = pBinBlock->DesignSiteK = k;
+      pPhyBlock->RotamerCountSiteI = pBinBlock->RotamerCountSiteI = pList->remainRotamerCount[i];
+      pPhyBlock->RotamerCountSiteK = pBinBlock->RotamerCountSiteK = pList->remainRotamerCount[k];
+      if (k == i || linked[k] == FALSE)
+      {
+        // self energies are kept on the rotamers; sites out of range do not interact
+        continue;
+      }
+
+      DesignSite* pSiteK = StructureGetDesignSite(pStruct, k);
+      Chain* pChainK = StructureGetChain(pStruct, pSiteK->chnNdx);
+      // follow the same rules as EnergyDifferenceUponSingleMutation()
+      EnergyMatrixBlock* pBlock = NULL;
+      if (pSiteI->chnNdx == pSiteK->chnNdx)
+      {
+        if (ChainGetType(pChainI) == Type_Chain_Protein)
+        {
+          pBlock = pPhyBlock;
+        }
+      }
+      else if (FLAG_MONOMER == FALSE)
+      {
+        if ((strstr(DES_CHAINS, ChainGetName(pChainI)) != NULL && strstr(DES_CHAINS, ChainGetName(pChainK)) == NULL)
+          || (strstr(DES_CHAINS, ChainGetName(pChainI)) == NULL && strstr(DES_CHAINS, ChainGetName(pChainK)) != NULL))
+        {
+          if (ChainGetType(pChainI) == Type_Chain_SmallMol || ChainGetType(pChainK) == Type_Chain_SmallMol)
+          {
+            if (FLAG_PROT_LIG == TRUE || FLAG_ENZYME == TRUE)
+            {
+              pBlock = pBinBlock;
+            }
+          }
+          else if (FLAG_PPI == TRUE)
+          {
+            pBlock = pBinBlock;
+          }
+        }
+      }
+      if (pBlock == NULL || pBlock->RotamerCountSiteI == 0 || pBlock->RotamerCountSiteK == 0)
+      {
+        continue;
+      }
+
+      pBlock->energyIK = (double*)malloc(sizeof(double) * pBlock->RotamerCountSiteI * pBlock->RotamerCountSiteK);
+      jobs[jobCount].computationAmount = (double)pBlock->RotamerCountSiteI * pBlock->RotamerCountSiteK;
+      jobs[jobCount].designSiteI = i;
+      jobs[jobCount].designSiteK = k;
+      jobs[jobCount].rotamerPartitionIndexOnSiteI = 0;
+      jobs[jobCount].rotamerPartitionIndexOnSiteK = 0;
+      jobCount++;
+    }
+  }
+  free(linked);
+
+  if (energyMatrixFile != NULL && !FAILED(PairEnergyTableBlocksLoad(pThis, pList, jobs, jobCount, energyMatrixFile)))
+  {
+    printf("read pairwise rotamer energies between design sites from %s\n", energyMatrixFile);
+  }
+  else
+  {
+    printf("computing pairwise rotamer energies between design sites\n");
+    // the blocks are independent; workers pull jobs from a work-stealing scheduler
+    int nthreads = NTHREADS;
+#ifndef _OPENMP
+    nthreads = 1;
+#endif
+    if (nthreads > jobCount) nthreads = jobCount;
+    if (nthreads < 1) nthreads = 1;
+    JobScheduler scheduler;
+    JobSchedulerCreate(&scheduler, jobs, jobCount, nthreads);
+#pragma omp parallel num_threads(nthreads)
+    {
+      int slotIndex = 0;
+#ifdef _OPENMP
+      slotIndex = omp_get_thread_num();
+#endif
+      Structure view;
+      Structure* pView = pStruct;
+      if (nthreads > 1)
+      {
+        StructureDesignViewCreate(&view, pStruct);
+        pView = &view;
+      }
+      Job job;
+      while (JobSchedulerNext(&scheduler, slotIndex, &job))
+      {
+        // exactly one of the two blocks was allocated for this site pair
+        EnergyMatrixBlock* pBlock = EnergyMatrixGetBlock(&pThis->phy, job.designSiteI, job.designSiteK);
+        if (pBlock->energyIK == NULL) pBlock = EnergyMatrixGetBlock(&pThis->bin, job.designSiteI, job.designSiteK);
+        PairEnergyTableBlockGenerate(pThis, pBlock, pView, pList, job.designSiteI, job.designSiteK);
+      }
+      if (nthreads > 1)
+      {
+        StructureDesignViewDestroy(&view);
+      }
+    }
+    JobSchedulerDestroy(&scheduler);
+  }
+
+  int blockCount = 0;
+  for (int j = 0; j < jobCount; j++)
+  {
+    if (EnergyMatrixGetBlock(&pThis->phy, jobs[j].designSiteI, jobs[j].designSiteK)->energyIK != NULL ||
+      EnergyMatrixGetBlock(&pThis->bin, jobs[j].designSiteI, jobs[j].designSiteK)->energyIK != NULL)
+    {
+      blockCount++;
+    }
+  }
+  free(jobs);
+  printf("%d out of %d design site pairs are interacting\n", blockCount, siteCount * (siteCount - 1) / 2);
+
+  return Success;
+}
+
+
+double PairEnergyTableGet(EnergyMatrix* pMatrix, int designSiteI, int designSiteK, int reducedIJ, int reducedKS)
+{
+  if (designSiteI > designSiteK)
+  {
+    int swap = designSiteI;
+    designSiteI = designSiteK;
+    designSiteK = swap;
+
+    swap = reducedIJ;
+    reducedIJ = reducedKS;
+    reducedKS = swap;
+  }
+  EnergyMatrixBlock* pBlock = EnergyMatrixGetBlock(pMatrix, designSiteI, designSiteK);
+  if (pBlock->energyIK == NULL)
+  {
+    return 0.0;
+  }
+  return *EnergyMatrixBlockGet(pBlock, reducedIJ, reducedKS);
+}
+
+
+// one interacting site pair seen from design site i; the pair energy between the reduced
+// rotamers r (site i) and s (neighbor site) is weight * energy[r * rowStride + s * colStride]
+typedef struct _PairTableNeighbor
+{
+  int site;
+  double weight;
+  double* energy;
+  int rowStride;
+  int colStride;
+} PairTableNeighbor;
+
+
+// the per-rotamer terms of the table energy, the same as in EnergyDifferenceUponSingleMutationByTable()
+static void PairEnergyTableUnaryEnergies(PairEnergyTable* pThis, Structure* pStruct, RotamerList* pList, int i, double* unary)
+{
+  DesignSite* pSite = StructureGetDesignSite(pStruct, i);
+  RotamerSet* pSet = DesignSiteGetRotamers(pSite);
+  for (int j = 0; j < pList->rotamerCount[i]; j++)
+  {
+    int r = pThis->reducedNdx[i][j];
+    if (r == -1) continue;
+    Rotamer* pRot = RotamerSetGet(pSet, j);
+    unary[r] = pRot->selfEnergy;
+    if (FLAG_MONOMER == FALSE) unary[r] += WGT_BIND * pRot->selfEnergyBin;
+    if (FLAG_EVOLUTION == TRUE && pSite->seqNdx >= 0)
+    {
+      unary[r] += WGT_PROFILE * EvolutionScoreFromPSSMAtPosition(pSite->seqNdx, AA3ToAA1(RotamerGetType(pRot)));
+    }
+  }
+}
+
+
+// collects the sites interacting with site i; 'neighbors' must hold designSiteCount entries
+static int PairEnergyTableNeighbors(PairEnergyTable* pThis, int i, PairTableNeighbor* neighbors)
+{
+  int neighborCount = 0;
+  for (int k = 0; k < pThis->phy.designSiteCount; k++)
+  {
+    if (k == i) continue;
+    int lo = i < k ? i : k;
+    int hi = i < k ? k : i;
+    EnergyMatrixBlock* pBlock = EnergyMatrixGetBlock(&pThis->phy, lo, hi);
+    double weight = 1.0;
+    if (pBlock->energyIK == NULL)
+    {
+      pBlock = EnergyMatrixGetBlock(&pThis->bin, lo, hi);
+      weight = WGT_BIND;
+    }
+    if (pBlock->energyIK == NULL) continue;
+    PairTableNeighbor* pNeighbor = &neighbors[neighborCount++];
+    pNeighbor->site = k;
+    pNeighbor->weight = weight;
+    pNeighbor->energy = pBlock->energyIK;
+    pNeighbor->rowStride = i < k ? pBlock->RotamerCountSiteK : 1;
+    pNeighbor->colStride = i < k ? 1 : pBlock->RotamerCountSiteK;
+  }
+  return neighborCount;
+}
+
+
+int PairEnergyTableDeadEndElimination(PairEnergyTable* pThis, Structure* pStruct, RotamerList* pList)
+{
+  int siteCount = pList->desSiteCount;
+  int* count = (int*)malloc(sizeof(int) * siteCount);
+  double** unary = (double**)malloc(sizeof(double*) * siteCount);
+  BOOL** alive = (BOOL**)malloc(sizeof(BOOL*) * siteCount);
+  int** aliveNdx = (int**)malloc(sizeof(int*) * siteCount);
+  int* aliveCount = (int*)malloc(sizeof(int) * siteCount);
+  PairTableNeighbor** neighbors = (PairTableNeighbor**)malloc(sizeof(PairTableNeighbor*) * siteCount);
+  int* neighborCount = (int*)malloc(sizeof(int) * siteCount);
+  int totalCount = 0;
+  for (int i = 0; i < siteCount; i++)
+  {
+    count[i] = pList->remainRotamerCount[i];
+    totalCount += count[i];
+    unary[i] = (double*)malloc(sizeof(double) * count[i]);
+    PairEnergyTableUnaryEnergies(pThis, pStruct, pList, i, unary[i]);
+    alive[i] = (BOOL*)malloc(sizeof(BOOL) * count[i]);
+    for (int r = 0; r < count[i]; r++) alive[i][r] = TRUE;
+    aliveNdx[i] = (int*)malloc(sizeof(int) * count[i]);
+    neighbors[i] = (PairTableNeighbor*)malloc(sizeof(PairTableNeighbor) * siteCount);
+    neighborCount[i] = PairEnergyTableNeighbors(pThis, i, neighbors[i]);
+  }
+
+  int nthreads = NTHREADS;
+#ifndef _OPENMP
+  nthreads = 1;
+#endif
+  int passCount = 0;
+  int deadCount = 0;
+  while (TRUE)
+  {
+    // a pass eliminates against the rotamers that were alive at its start on the other sites,
+    // so that the sites can be processed in parallel
+    for (int i = 0; i < siteCount; i++)
+    {
+      aliveCount[i] = 0;
+      for (int r = 0; r < count[i]; r++)
+      {
+        if (alive[i][r] == TRUE) aliveNdx[i][aliveCount[i]++] = r;
+      }
+    }
+    passCount++;
+    int passDeadCount = 0;
+#pragma omp parallel for schedule(dynamic) num_threads(nthreads) reduction(+:passDeadCount)
+    for (int i = 0; i < siteCount; i++)
+    {
+      if (aliveCount[i] <= 1) continue;
+      int nn = neighborCount[i];
+      PairTableNeighbor* pNbrs = neighbors[i];
+      // minPair[t * nn + n]: min over s at neighbor n of P(r, s) - P(t, s); gold[t]: Goldstein sum of t
+      double* minPair = (double*)malloc(sizeof(double) * count[i] * (nn > 0 ? nn : 1));
+      double* gold = (double*)malloc(sizeof(double) * count[i]);
+      int* cands = (int*)malloc(sizeof(int) * count[i]);
+      int siteAlive = aliveCount[i];
+      for (int a = 0; a < aliveCount[i] && siteAlive > 1; a++)
+      {
+        int r = aliveNdx[i][a];
+        int candCount = 0;
+        for (int b = 0; b < aliveCount[i]; b++)
+        {
+          int t = aliveNdx[i][b];
+          if (t != r && alive[i][t] == TRUE) cands[candCount++] = t;
+        }
+
+        BOOL dead = FALSE;
+        for (int c = 0; c < candCount && dead == FALSE; c++)
+        {
+          int t = cands[c];
+          double g = unary[i][r] - unary[i][t];
+          for (int n = 0; n < nn; n++)
+          {
+            PairTableNeighbor* pNbr = &pNbrs[n];
+            double* pR = pNbr->energy + (long long)r * pNbr->rowStride;
+            double* pT = pNbr->energy + (long long)t * pNbr->rowStride;
+            int* sNdx = aliveNdx[pNbr->site];
+            double m = 1e30;
+            for (int b = 0; b < aliveCount[pNbr->site]; b++)
+            {
+              long long off = (long long)sNdx[b] * pNbr->colStride;
+              double d = pR[off] - pT[off];
+              if (d < m) m = d;
+            }
+            m *= pNbr->weight;
+            minPair[t * nn + n] = m;
+            g += m;
+          }
+          gold[t] = g;
+          if (g > DEE_ENERGY_TOLERANCE) dead = TRUE;
+        }
+
+        // split at neighbor v: for every rotamer u at v some t beats r with v fixed at u
+        for (int v = 0; v < nn && dead == FALSE && candCount > 0; v++)
+        {
+          PairTableNeighbor* pNbr = &pNbrs[v];
+          double* pR = pNbr->energy + (long long)r * pNbr->rowStride;
+          BOOL split = TRUE;
+          for (int b = 0; b < aliveCount[pNbr->site] && split == TRUE; b++)
+          {
+            long long off = (long long)aliveNdx[pNbr->site][b] * pNbr->colStride;
+            BOOL found = FALSE;
+            for (int c = 0; c < candCount; c++)
+            {
+              int t = cands[c];
+              double* pT = pNbr->energy + (long long)t * pNbr->rowStride;
+              if (gold[t] - minPair[t * nn + v] + pNbr->weight * (pR[off] - pT[off]) > DEE_ENERGY_TOLERANCE)
+              {
+                found = TRUE;
+                break;
+              }
+            }
+            if (found == FALSE) split = FALSE;
+          }
+          if (split == TRUE) dead = TRUE;
+        }
+
+        if (dead == TRUE)
+        {
+          alive[i][r] = FALSE;
+          siteAlive--;
+          passDeadCount++;
+        }
+      }
+      free(minPair);
+      free(gold);
+      free(cands);
+    }
+    deadCount += passDeadCount;
+    if (passDeadCount == 0) break;
+  }
+  printf("dead-end elimination removed %d out of %d rotamers in %d passes\n", deadCount, totalCount, passCount);
+
+  int result = Success;
+  if (deadCount > 0)
+  {
+    IntArray dels;
+    IntArrayCreate(&dels, 0);
+    for (int i = 0; i < siteCount; i++)
+    {
+      for (int r = 0; r < count[i]; r++)
+      {
+        if (alive[i][r] == FALSE)
+        {
+          IntArrayAppend(&dels, i);
+          IntArrayAppend(&dels, r);
+        }
+      }
+    }
+    // both matrices are indexed by the same reduced indexes; the bin matrix gets a list of its own
+    RotamerList binList;
+    RotamerListCreateFromEnergyMatrix(&binList, &pThis->bin);
+    result = RotamerListAndEnergyMatrixDelete(&binList, &pThis->bin, &dels);
+    RotamerListDestroy(&binList);
+    if (!FAILED(result))
+    {
+      result = RotamerListAndEnergyMatrixDelete(pList, &pThis->phy, &dels);
+    }
+    IntArrayDestroy(&dels);
+
+    for (int i = 0; i < siteCount; i++)
+    {
+      int reduced = 0;
+      for (int j = 0; j < pList->rotamerCount[i]; j++)
+      {
+        pThis->reducedNdx[i][j] = pList->remainFlag[i][j] == TRUE ? reduced++ : -1;
+      }
+      pList->remainRotamerCount[i] = reduced;
+    }
+  }
+
+  for (int i = 0; i < siteCount; i++)
+  {
+    free(unary[i]);
+    free(alive[i]);
+    free(aliveNdx[i]);
+    free(neighbors[i]);
+  }
+  free(count);
+  free(unary);
+  free(alive);
+  free(aliveNdx);
+  free(aliveCount);
+  free(neighbors);
+  free(neighborCount);
+
+  return result;
+}
+
+
+typedef struct _ExactSearchChild
+{
+  double bound;
+  int rot;
+} ExactSearchChild;
+
+
+static int ExactSearchChildCompare(const void* a, const void* b)
+{
+  double da = ((const ExactSearchChild*)a)->bound;
+  double db = ((const ExactSearchChild*)b)->bound;
+  return da < db ? -1 : (da > db ? 1 : 0);
+}
+
+
+// adds (sign = 1) or removes (sign = -1) the pair energies of rotamer s at site j to the
+// partial energies of the neighbor sites that come later in the search order
+static void ExactSearchUpdatePartial(PairTableNeighbor* pNbrs, int nn, int* pos, int* count, double** partial, int j, int s, double sign)
+{
+  for (int n = 0; n < nn; n++)
+  {
+    PairTableNeighbor* pNbr = &pNbrs[n];
+    int k = pNbr->site;
+    if (pos[k] < pos[j]) continue;
+    double* pRow = pNbr->energy + (long long)s * pNbr->rowStride;
+    double w = sign * pNbr->weight;
+    for (int t = 0; t < count[k]; t++)
+    {
+      partial[k][t] += w * pRow[(long long)t * pNbr->colStride];
+    }
+  }
+}
+
+
+// iterated conditional modes: moves every site to its best rotamer given the others until no move
+// lowers the energy; returns the table energy of the final assignment
+static double ExactSearchPolish(PairTableNeighbor** neighbors, int* neighborCount, int* count, double** unary, int siteCount, int* assign)
+{
+  BOOL changed = TRUE;
+  while (changed == TRUE)
+  {
+    changed = FALSE;
+    for (int i = 0; i < siteCount; i++)
+    {
+      int bestRot = assign[i];
+      double bestEnergy = 0.0;
+      for (int r = 0; r < count[i]; r++)
+      {
+        double e = unary[i][r];
+        for (int n = 0; n < neighborCount[i]; n++)
+        {
+          PairTableNeighbor* pNbr = &neighbors[i][n];
+          e += pNbr->weight * pNbr->energy[(long long)r * pNbr->rowStride + (long long)assign[pNbr->site] * pNbr->colStride];
+        }
+        if (r == assign[i]) e -= 1e-9;
+        if (r == 0 || e < bestEnergy)
+        {
+          bestEnergy = e;
+          bestRot = r;
+        }
+      }
+      if (bestRot != assign[i])
+      {
+        assign[i] = bestRot;
+        changed = TRUE;
+      }
+    }
+  }
+  double energy = 0.0;
+  for (int i = 0; i < siteCount; i++)
+  {
+    energy += unary[i][assign[i]];
+    for (int n = 0; n < neighborCount[i]; n++)
+    {
+      PairTableNeighbor* pNbr = &neighbors[i][n];
+      if (pNbr->site < i) continue;
+      energy += pNbr->weight * pNbr->energy[(long long)assign[i] * pNbr->rowStride + (long long)assign[pNbr->site] * pNbr->colStride];
+    }
+  }
+  return energy;
+}
+
+
+int PairEnergyTableExactSearch(PairEnergyTable* pThis, Structure* pStruct, RotamerList* pList, double timeLimit, IntArray* pRotNdxs, double* pEnergy, double* pLowerBound)
+{
+  int siteCount = pList->desSiteCount;
+  int* count = (int*)malloc(sizeof(int) * siteCount);
+  double** unary = (double**)malloc(sizeof(double*) * siteCount);
+  double** partial = (double**)malloc(sizeof(double*) * siteCount);
+  double** future = (double**)malloc(sizeof(double*) * siteCount);
+  PairTableNeighbor** neighbors = (PairTableNeighbor**)malloc(sizeof(PairTableNeighbor*) * siteCount);
+  int* neighborCount = (int*)malloc(sizeof(int) * siteCount);
+  int* order = (int*)malloc(sizeof(int) * siteCount);
+  int* pos = (int*)malloc(sizeof(int) * siteCount);
+  for (int i = 0; i < siteCount; i++)
+  {
+    count[i] = pList->remainRotamerCount[i];
+    // partial[i][s]: unary energy of s plus its pair energies with the assigned sites
+    unary[i] = (double*)malloc(sizeof(double) * count[i]);
+    PairEnergyTableUnaryEnergies(pThis, pStruct, pList, i, unary[i]);
+    partial[i] = (double*)malloc(sizeof(double) * count[i]);
+    memcpy(partial[i], unary[i], sizeof(double) * count[i]);
+    neighbors[i] = (PairTableNeighbor*)malloc(sizeof(PairTableNeighbor) * siteCount);
+    neighborCount[i] = PairEnergyTableNeighbors(pThis, i, neighbors[i]);
+  }
+
+  // sites with fewer rotamers are assigned first
+  for (int i = 0; i < siteCount; i++)
+  {
+    int d = i;
+    while (d > 0 && count[order[d - 1]] > count[i])
+    {
+      order[d] = order[d - 1];
+      d--;
+    }
+    order[d] = i;
+  }
+  for (int d = 0; d < siteCount; d++) pos[order[d]] = d;
+
+  // future[j][s]: lower bound of the pair energies of s with the sites after j in the order
+  for (int j = 0; j < siteCount; j++)
+  {
+    future[j] = (double*)malloc(sizeof(double) * count[j]);
+    for (int s = 0; s < count[j]; s++)
+    {
+      future[j][s] = 0.0;
+      for (int n = 0; n < neighborCount[j]; n++)
+      {
+        PairTableNeighbor* pNbr = &neighbors[j][n];
+        int k = pNbr->site;
+        if (pos[k] < pos[j]) continue;
+        double* pRow = pNbr->energy + (long long)s * pNbr->rowStride;
+        double m = 1e30;
+        for (int t = 0; t < count[k]; t++)
+        {
+          double e = pNbr->weight * pRow[(long long)t * pNbr->colStride];
+          if (e < m) m = e;
+        }
+        future[j][s] += m;
+      }
+    }
+  }
+
+  // depth-first branch and bound; level d assigns site order[d] and keeps its children sorted by bound
+  ExactSearchChild** children = (ExactSearchChild**)malloc(sizeof(ExactSearchChild*) * siteCount);
+  int* next = (int*)malloc(sizeof(int) * siteCount);
+  double* gLevel = (double*)malloc(sizeof(double) * (siteCount + 1));
+  int* assign = (int*)malloc(sizeof(int) * siteCount);
+  int* bestAssign = (int*)malloc(sizeof(int) * siteCount);
+  int* polished = (int*)malloc(sizeof(int) * siteCount);
+  for (int d = 0; d < siteCount; d++)
+  {
+    children[d] = (ExactSearchChild*)malloc(sizeof(ExactSearchChild) * count[order[d]]);
+    next[d] = count[order[d]];
+  }
+
+  double best = 1e30;
+  double g = 0.0;
+  long long nodeCount = 0;
+  long long leafCount = 0;
+  BOOL timeout = FALSE;
+  clock_t timeStart = clock();
+  int d = 0;
+  BOOL expand = TRUE;
+  while (d >= 0)
+  {
+    if (expand == TRUE)
+    {
+      expand = FALSE;
+      if (d == siteCount)
+      {
+        leafCount++;
+        // a leaf seldom is a local minimum, polishing it tightens the pruning bound
+        memcpy(polished, assign, sizeof(int) * siteCount);
+        double e = ExactSearchPolish(neighbors, neighborCount, count, unary, siteCount, polished);
+        if (e > g)
+        {
+          memcpy(polished, assign, sizeof(int) * siteCount);
+          e = g;
+        }
+        if (e < best)
+        {
+          best = e;
+          memcpy(bestAssign, polished, sizeof(int) * siteCount);
+        }
+      }
+      else
+      {
+        // bound of the node: the assigned energy plus the best case of every unassigned site
+        double rest = 0.0;
+        for (int e = d + 1; e < siteCount; e++)
+        {
+          int k = order[e];
+          double m = 1e30;
+          for (int t = 0; t < count[k]; t++)
+          {
+            if (partial[k][t] + future[k][t] < m) m = partial[k][t] + future[k][t];
+          }
+          rest += m;
+        }
+        int j = order[d];
+        for (int s = 0; s < count[j]; s++)
+        {
+          children[d][s].bound = g + partial[j][s] + future[j][s] + rest;
+          children[d][s].rot = s;
+        }
+        qsort(children[d], count[j], sizeof(ExactSearchChild), ExactSearchChildCompare);
+        next[d] = 0;
+        continue;
+      }
+    }
+    else if (d < siteCount && next[d] < count[order[d]] && children[d][next[d]].bound < best)
+    {
+      if ((++nodeCount & 1023) == 0 && timeLimit > 0 && best < 1e30 && (double)(clock() - timeStart) / CLOCKS_PER_SEC > timeLimit)
+      {
+        timeout = TRUE;
+        break;
+      }
+      int j = order[d];
+      int s = children[d][next[d]++].rot;
+      assign[j] = s;
+      gLevel[d] = g;
+      g += partial[j][s];
+      ExactSearchUpdatePartial(neighbors[j], neighborCount[j], pos, count, partial, j, s, 1.0);
+      d++;
+      expand = TRUE;
+      continue;
+    }
+
+    // the level is exhausted or pruned: undo the assignment that led to it
+    if (d < siteCount) next[d] = count[order[d]];
+    d--;
+    if (d >= 0)
+    {
+      int j = order[d];
+      ExactSearchUpdatePartial(neighbors[j], neighborCount[j], pos, count, partial, j, assign[j], -1.0);
+      g = gLevel[d];
+    }
+  }
+
+  // the children left on the stack are sorted, so the first unexplored one of every level bounds its subtrees
+  double lowerBound = best;
+  if (timeout == TRUE)
+  {
+    for (int e = 0; e <= d && e < siteCount; e++)
+    {
+      if (next[e] < count[order[e]] && children[e][next[e]].bound < lowerBound)
+      {
+        lowerBound = children[e][next[e]].bound;
+      }
+    }
+  }
+  printf("exact search: %lld nodes, %lld leaves, %.2f secs%s\n", nodeCount, leafCount,
+    (double)(clock() - timeStart) / CLOCKS_PER_SEC, timeout == TRUE ? " (time limit reached)" : "");
+
+  IntArrayResize(pRotNdxs, siteCount);
+  for (int i = 0; i < siteCount; i++)
+  {
+    for (int j = 0; j < pList->rotamerCount[i]; j++)
+    {
+      if (pThis->reducedNdx[i][j] == bestAssign[i])
+      {
+        IntArraySet(pRotNdxs, i, j);
+        break;
+      }
+    }
+  }
+  *pEnergy = best;
+  *pLowerBound = lowerBound;
+
+  for (int i = 0; i < siteCount; i++)
+  {
+    free(unary[i]);
+    free(partial[i]);
+    free(future[i]);
+    free(neighbors[i]);
+    free(children[i]);
+  }
+  free(count);
+  free(unary);
+  free(partial);
+  free(future);
+  free(neighbors);
+  free(neighborCount);
+  free(order);
+  free(pos);
+  free(children);
+  free(next);
+  free(gLevel);
+  free(assign);
+  free(bestAssign);
+  free(polished);
+
+  return Success;
+}
+
+
+int EnergyDifferenceUponSingleMutation(Structure* pStruct, Sequence* pSeq, int mutSiteNdx, int mutRotNdx, EvolutionScoreCache* pEvoCache, double* dtot, double* dphy, double* dbin, double* devo)
+{
+  double phyBefore = 0;
+  double phyAfter = 0;
+  double binBefore = 0;
+  double binAfter = 0;
+
+  if (FLAG_PHYSICS == TRUE)
+  {
+    DesignSite* pCurSite = StructureGetDesignSite(pStruct, mutSiteNdx);
+    RotamerSet* pCurSet = DesignSiteGetRotamers(pCurSite);
+    Chain* pCurChain = StructureGetChain(pStruct, pCurSite->chnNdx);
+    Rotamer* pCurRot = RotamerSetGet(pCurSet, IntArrayGet(&pSeq->rotNdxs, mutSiteNdx));
+    Rotamer* pNewRot = RotamerSetGet(pCurSet, mutRotNdx);
+    RotamerRestore(pCurRot, pCurSet);
+    RotamerRestore(pNewRot, pCurSet);
+    phyBefore += pCurRot->selfEnergy;
+    phyAfter += pNewRot->selfEnergy;
+    if (FLAG_MONOMER == FALSE)
+    {
+      binBefore += pCurRot->selfEnergyBin;
+      binAfter += pNewRot->selfEnergyBin;
+    }
+    double energyTermsExBind1[MAX_ENERGY_TERM] = { 0 };
+    double energyTermsExBind2[MAX_ENERGY_TERM] = { 0 };
+    double energyTermsBind1[MAX_ENERGY_TERM] = { 0 };
+    double energyTermsBind2[MAX_ENERGY_TERM] = { 0 };
+    // only the linked sites contribute pair energies
+    IntArray* pNbrs = &pCurSite->nbrNdxs;
+    for (int n = 0; n < IntArrayGetLength(pNbrs); n++)
+    {
+      int i = IntArrayGet(pNbrs, n);
+      DesignSite* pSiteI = StructureGetDesignSite(pStruct, i);
+      RotamerSet* pSetI = DesignSiteGetRotamers(pSiteI);
+      Rotamer* pRotI = RotamerSetGet(pSetI, IntArrayGet(&pSeq->rotNdxs, i));
+      Chain* pChainI = StructureGetChain(pStruct, pSiteI->chnNdx);
+      RotamerRestore(pRotI, pSetI);
+      if (pCurSite->chnNdx == pSiteI->chnNdx)
+      {
+        if (ChainGetType(pChainI) == Type_Chain_Protein)
+        {
+          EnergyRotamerAndRotamerSameChain(pRotI, pCurRot, energyTermsExBind1);
+          EnergyRotamerAndRotamerSameChain(pRotI, pNewRot, energyTermsExBind2);
+        }
+      }
+      else
+      {
+        if (ChainGetType(pChainI) == Type_Chain_SmallMol)
+        {
+          double energyTermsPL1[MAX_ENERGY_TERM] = { 0 };
+          double energyTermsPL2[MAX_ENERGY_TERM] = { 0 };
+          EnergyRotamerAndLigandRotamer(pCurRot, pRotI, energyTermsPL1);
+          EnergyRotamerAndLigandRotamer(pNewRot, pRotI, energyTermsPL2);
+          //for (int index = 0; index < MAX_ENERGY_TERM; index++)
+          //{
+          //  energyTermsExBind1[index] += energyTermsPL1[index];
+          //  energyTermsExBind2[index] += energyTermsPL2[index];
+          //}
+          if ((strstr(DES_CHAINS, ChainGetName(pChainI)) != NULL && strstr(DES_CHAINS, ChainGetName(pCurChain)) == NULL)
+            || (strstr(DES_CHAINS, ChainGetName(pChainI)) == NULL && strstr(DES_CHAINS, ChainGetName(pCurChain)) != NULL))
+          {
+            if (FLAG_PROT_LIG == TRUE || FLAG_ENZYME == TRUE)
+            {
+              for (int index = 0; index < MAX_ENERGY_TERM; index++)
+              {
+                energyTermsBind1[index] += energyTermsPL1[index];
+                energyTermsBind2[index] += energyTermsPL2[index];
+              }
+            }
+          }
+        }
+        else if (ChainGetType(pCurChain) == Type_Chain_SmallMol)
+        {
+          double energyTermsPL1[MAX_ENERGY_TERM] = { 0 };
+          double energyTermsPL2[MAX_ENERGY_TERM] = { 0 };
+          EnergyRotamerAndLigandRotamer(pRotI, pCurRot, energyTermsPL1);
+          EnergyRotamerAndLigandRotamer(pRotI, pNewRot, energyTermsPL2);
+          //for (int index = 0; index < MAX_ENERGY_TERM; index++)
+          //{
+          //  energyTermsExBind1[index] += energyTermsPL1[index];
+          //  energyTermsExBind2[index] += energyTermsPL2[index];
+          //}
+          if ((strstr(DES_CHAINS, ChainGetName(pChainI)) != NULL && strstr(DES_CHAINS, ChainGetName(pCurChain)) == NULL)
+            || (strstr(DES_CHAINS, ChainGetName(pChainI)) == NULL && strstr(DES_CHAINS, ChainGetName(pCurChain)) != NULL))
+          {
+            if (FLAG_PROT_LIG == TRUE || FLAG_ENZYME == TRUE)
+            {
+              for (int index = 0; index < MAX_ENERGY_TERM; index++)
+              {
+                energyTermsBind1[index] += energyTermsPL1[index];
+                energyTermsBind2[index] += energyTermsPL2[index];
+              }
+            }
+          }
+        }
+        //else if ( (ChainGetType(pChainI) == Type_Chain_Protein || ChainGetType(pChainI) == Type_Chain_DNA || ChainGetType(pChainI) == Type_Chain_RNA || ChainGetType(pChainI) == Type_Chain_Water)
+        //  && (ChainGetType(pCurChain) == Type_Chain_Protein || ChainGetType(pCurChain) == Type_Chain_DNA || ChainGetType(pCurChain) == Type_Chain_RNA || ChainGetType(pCurChain) == Type_Chain_Water) )
+        else
+        {
+          double energyTermsDC1[MAX_ENERGY_TERM] = { 0 };
+          double energyTermsDC2[MAX_ENERGY_TERM] = { 0 };
+          EnergyRotamerAndRotamerDiffChain(pRotI, pCurRot, energyTermsDC1);
+          EnergyRotamerAndRotamerDiffChain(pRotI, pNewRot, energyTermsDC2);
+          //for (int index = 0; index < MAX_ENERGY_TERM; index++)
+          //{
+          //  energyTermsExBind1[index] += energyTermsDC1[index];
+          //  energyTermsExBind2[index] += energyTermsDC2[index];
+          //}
+          if ((strstr(DES_CHAINS, ChainGetName(pChainI)) != NULL && strstr(DES_CHAINS, ChainGetName(pCurChain)) == NULL)
+            || (strstr(DES_CHAINS, ChainGetName(pChainI)) == NULL && strstr(DES_CHAINS, ChainGetName(pCurChain)) != NULL))
+          {
+            if (FLAG_PPI == TRUE)
+            {
+              for (int index = 0; index < MAX_ENERGY_TERM; index++)
+              {
+                energyTermsBind1[index] += energyTermsDC1[index];
+                energyTermsBind2[index] += energyTermsDC2[index];
+              }
+            }
+          }
+        }
+      }
+      RotamerExtract(pRotI);
+    }
+    EnergyTermWeighting(energyTermsExBind1);
+    EnergyTermWeighting(energyTermsExBind2);
+    phyBefore += energyTermsExBind1[0];
+    phyAfter += energyTermsExBind2[0];
+    *dphy = phyAfter - phyBefore;
+
+    if (FLAG_MONOMER == FALSE)
+    {
+      EnergyTermWeighting(energyTermsBind1);
+      EnergyTermWeighting(energyTermsBind2);
+      binBefore += energyTermsBind1[0];
+      binAfter += energyTermsBind2[0];
+      *dbin = binAfter - binBefore;
+    }
+
+    RotamerExtract(pCurRot);
+    RotamerExtract(pNewRot);
+  }
+
+  if (FLAG_EVOLUTION == TRUE)
+  {
+    EvolutionDifferenceUponSingleMutation(pStruct, pSeq, mutSiteNdx, mutRotNdx, pEvoCache, devo);
+  }
+
+  *dtot = WGT_PROFILE * (*devo) + *dphy + WGT_BIND * (*dbin);
+
+  return Success;
+}
+
+
+int EnergyDifferenceUponSingleMutationByTable(PairEnergyTable* pTable, Structure* pStruct, Sequence* pSeq, int mutSiteNdx, int mutRotNdx, EvolutionScoreCache* pEvoCache, double* dtot, double* dphy, double* dbin, double* devo)
+{
+  if (FLAG_PHYSICS == TRUE)
+  {
+    int curNdx = pTable->reducedNdx[mutSiteNdx][IntArrayGet(&pSeq->rotNdxs, mutSiteNdx)];
+    int newNdx = pTable->reducedNdx[mutSiteNdx][mutRotNdx];
+    if (curNdx == -1 || newNdx == -1)
+    {
+      // the rotamer has been deleted from the table (e.g. a native seed), compute it on the fly
+      return EnergyDifferenceUponSingleMutation(pStruct, pSeq, mutSiteNdx, mutRotNdx, pEvoCache, dtot, dphy, dbin, devo);
+    }
+    // only the linked sites contribute pair energies
+    IntArray* pNbrs = &StructureGetDesignSite(pStruct, mutSiteNdx)->nbrNdxs;
+    for (int n = 0; n < IntArrayGetLength(pNbrs); n++)
+    {
+      int i = IntArrayGet(pNbrs, n);
+      if (pTable->reducedNdx[i][IntArrayGet(&pSeq->rotNdxs, i)] == -1)
+      {
+        return EnergyDifferenceUponSingleMutation(pStruct, pSeq, mutSiteNdx, mutRotNdx, pEvoCache, dtot, dphy, dbin, devo);
+      }
+    }
+
+    RotamerSet* pCurSet = DesignSiteGetRotamers(StructureGetDesignSite(pStruct, mutSiteNdx));
+    Rotamer* pCurRot = RotamerSetGet(pCurSet, IntArrayGet(&pSeq->rotNdxs, mutSiteNdx));
+    Rotamer* pNewRot = RotamerSetGet(pCurSet, mutRotNdx);
+    double phyBefore = pCurRot->selfEnergy;
+    double phyAfter = pNewRot->selfEnergy;
+    double binBefore = 0;
+    double binAfter = 0;
+    if (FLAG_MONOMER == FALSE)
+    {
+      binBefore += pCurRot->selfEnergyBin;
+      binAfter += pNewRot->selfEnergyBin;
+    }
+    for (int n = 0; n < IntArrayGetLength(pNbrs); n++)
+    {
+      int i = IntArrayGet(pNbrs, n);
+      int ndxI = pTable->reducedNdx[i][IntArrayGet(&pSeq->rotNdxs, i)];
+      phyBefore += PairEnergyTableGet(&pTable->phy, mutSiteNdx, i, curNdx, ndxI);
+      phyAfter += PairEnergyTableGet(&pTable->phy, mutSiteNdx, i, newNdx, ndxI);
+      if (FLAG_MONOMER == FALSE)
+      {
+        binBefore += PairEnergyTableGet(&pTable->bin, mutSiteNdx, i, curNdx, ndxI);
+        binAfter += PairEnergyTableGet(&pTable->bin, mutSiteNdx, i, newNdx, ndxI);
+      }
+    }
+    *dphy = phyAfter - phyBefore;
+    if (FLAG_MONOMER == FALSE)
+    {
+      *dbin = binAfter - binBefore;
+    }
+  }
+
+  if (FLAG_EVOLUTION == TRUE)
+  {
+    EvolutionDifferenceUponSingleMutation(pStruct, pSeq, mutSiteNdx, mutRotNdx, pEvoCache, devo);
+  }
+
+  *dtot = WGT_PROFILE * (*devo) + *dphy + WGT_BIND * (*dbin);
+
+  return Success;
+}
+
+
+int EvolutionDifferenceUponSingleMutation(Structure* pStruct, Sequence* pSeq, int mutSiteNdx, int mutRotNdx, EvolutionScoreCache* pEvoCache, double* devo)
+{
+  double evoBefore = 0;
+  double evoAfter = 0;
+  DesignSite* pCurSite = StructureGetDesignSite(pStruct, mutSiteNdx);
+  RotamerSet* pCurSet = DesignSiteGetRotamers(pCurSite);
+  Rotamer* pCurRot = RotamerSetGet(pCurSet, IntArrayGet(&pSeq->rotNdxs, mutSiteNdx));
+  Rotamer* pNewRot = RotamerSetGet(pCurSet, mutRotNdx);
+  if (RotamerAndRotamerInSameType(pCurRot, pNewRot) == FALSE)
+  {
+    if (FLAG_EVOPHIPSI)
+    {
+      char seq1[MAX_SEQ_LEN];
+      StructureGetWholeSequence(pStruct, pSeq, seq1);
+      char seq2[MAX_SEQ_LEN];
+      Sequence newSeq;
+      SequenceCreate(&newSeq);
+      SequenceCopy(&newSeq, pSeq);
+      IntArraySet(&newSeq.rotNdxs, mutSiteNdx, mutRotNdx);
+      StructureGetWholeSequence(pStruct, &newSeq, seq2);
+      if (pEvoCache != NULL)
+      {
+        evoBefore += EvolutionScoreCacheScoreAll(pEvoCache, seq1);
+        evoAfter += EvolutionScoreCacheScoreAll(pEvoCache, seq2);
+      }
+      else
+      {
+        evoBefore += EvolutionScoreAllFromSeq(seq1);
+        evoAfter += EvolutionScoreAllFromSeq(seq2);
+      }
+      SequenceDestroy(&newSeq);
+    }
+    else if (pCurSite->seqNdx >= 0)
+    {
+      // the PSSM term is a sum over positions, only the mutated one changes
+      evoBefore += EvolutionScoreFromPSSMAtPosition(pCurSite->seqNdx, AA3ToAA1(RotamerGetType(pCurRot)));
+      evoAfter += EvolutionScoreFromPSSMAtPosition(pCurSite->seqNdx, AA3ToAA1(RotamerGetType(pNewRot)));
+    }
+  }
+  *devo = evoAfter - evoBefore;
+  return Success;
+}
+
+
+int Metropolis(Sequence* pSeq, Sequence* pBest, Structure* pStruct, RotamerList* pList, StringArray** ppRotType, IntArray** ppRotCount, int* seqNdx, double temp, int stepCount, FILE* pFileRot, FILE* pFileSeq, PairEnergyTable* pTable, EvolutionScoreCache* pEvoCache, RandomGenerator* pRand)
+{
+  int nacc = 0;
+  for (int i = 0; i < stepCount; i++)
+  {
+    int   mutSiteNdx;
+    int   mutRotNdx;
+    SequenceRandomSiteIndex(&mutSiteNdx, StructureGetDesignSiteCount(pStruct), pRand);
+    SequenceRandRotamerIndex(pStruct, pList, ppRotType, ppRotCount, mutSiteNdx, &mutRotNdx, pRand);
+    double dtot = 0, dphy = 0, devo = 0, dbin = 0;
+    if (pTable != NULL)
+    {
+      EnergyDifferenceUponSingleMutationByTable(pTable, pStruct, pSeq, mutSiteNdx, mutRotNdx, pEvoCache, &dtot, &dphy, &dbin, &devo);
+    }
+    else
+    {
+      EnergyDifferenceUponSingleMutation(pStruct, pSeq, mutSiteNdx, mutRotNdx, pEvoCache, &dtot, &dphy, &dbin, &devo);
+    }
+    if (exp(-1.0 * dtot / temp) > RandomGeneratorReal(pRand))
+    {
+      SequenceUpdateSingleSite(pSeq, mutSiteNdx, mutRotNdx);
+      pSeq->etot += dtot;
+      pSeq->ephy += dphy;
+      pSeq->ebin += dbin;
+      pSeq->eevo += devo;
+      if (pSeq->etot < pBest->etot)
+      {
         SequenceCopy(pBest, pSeq);
       }
       nacc++;
@@ -942,46 +2071,18 @@ int SequenceEnergyWithCataCons(Structure* pStruct, Sequence* pSeq, CataConsSiteP
 }
 
 
-int EnergyChangeUponSingleMutationWithCataCons(Structure* pStruct, Sequence* pSeq, int mutSiteNdx, int mutRotNdx, double* dtot, double* dphy, double* dbin, double* devo, int* dcons, CataConsSitePairArray* pConsArray)
+int EnergyChangeUponSingleMutationWithCataCons(Structure* pStruct, Sequence* pSeq, int mutSiteNdx, int mutRotNdx, EvolutionScoreCache* pEvoCache, double* dtot, double* dphy, double* dbin, double* devo, int* dcons, CataConsSitePairArray* pConsArray)
 {
   double phyBefore = 0;
   double phyAfter = 0;
   double binBefore = 0;
   double binAfter = 0;
-  double evoBefore = 0;
-  double evoAfter = 0;
   int nConsBefore = 0;
   int nConsAfter = 0;
 
   if (FLAG_EVOLUTION == TRUE)
   {
-    DesignSite* pCurSite = StructureGetDesignSite(pStruct, mutSiteNdx);
-    RotamerSet* pCurSet = DesignSiteGetRotamers(pCurSite);
-    Rotamer* pCurRot = RotamerSetGet(pCurSet, IntArrayGet(&pSeq->rotNdxs, mutSiteNdx));
-    Rotamer* pNewRot = RotamerSetGet(pCurSet, mutRotNdx);
-    if (RotamerAndRotamerInSameType(pCurRot, pNewRot) == FALSE)
-    {
-      char seq1[MAX_SEQ_LEN];
-      StructureGetWholeSequence(pStruct, pSeq, seq1);
-      char seq2[MAX_SEQ_LEN];
-      Sequence newSeq;
-      SequenceCreate(&newSeq);
-      SequenceCopy(&newSeq, pSeq);
-      IntArraySet(&newSeq.rotNdxs, mutSiteNdx, mutRotNdx);
-      StructureGetWholeSequence(pStruct, &newSeq, seq2);
-      if (FLAG_EVOPHIPSI == TRUE)
-      {
-        evoBefore += EvolutionScoreAllFromSeq(seq1);
-        evoAfter += EvolutionScoreAllFromSeq(seq2);
-      }
-      else
-      {
-        evoBefore += EvolutionScoreFromPSSMWithoutAlignment(seq1);
-        evoAfter += EvolutionScoreFromPSSMWithoutAlignment(seq2);
-      }
-      SequenceDestroy(&newSeq);
-    }
-    *devo = evoAfter - evoBefore;
+    EvolutionDifferenceUponSingleMutation(pStruct, pSeq, mutSiteNdx, mutRotNdx, pEvoCache, devo);
   }
 
   if (FLAG_PHYSICS == TRUE)
@@ -1004,12 +2105,11 @@ int EnergyChangeUponSingleMutationWithCataCons(Structure* pStruct, Sequence* pSe
     double energyTermsBind1[MAX_ENERGY_TERM] = { 0 };
     double energyTermsBind2[MAX_ENERGY_TERM] = { 0 };
 
-    for (int i = 0; i < StructureGetDesignSiteCount(pStruct); i++)
+    // only the linked sites contribute pair energies
+    IntArray* pNbrs = &pCurSite->nbrNdxs;
+    for (int n = 0; n < IntArrayGetLength(pNbrs); n++)
     {
-      if (i == mutSiteNdx)
-      {
-        continue;
-      }
+      int i = IntArrayGet(pNbrs, n);
       DesignSite* pSiteI = StructureGetDesignSite(pStruct, i);
       RotamerSet* pSetI = DesignSiteGetRotamers(pSiteI);
       Rotamer* pRotamerI = RotamerSetGet(pSetI, IntArrayGet(&pSeq->rotNdxs, i));
@@ -1170,19 +2270,19 @@ int EnergyChangeUponSingleMutationWithCataCons(Structure* pStruct, Sequence* pSe
 
 
 
-int MetropolisWithCataCons(Sequence* pOld, Sequence* pBest, Structure* pStructure, RotamerList* pList, StringArray** ppRotType, IntArray** ppRotCount, int* seqNdx, double temp, int stepCount, FILE* pFileRot, FILE* pFileSeq, CataConsSitePairArray* pConsArray)
+int MetropolisWithCataCons(Sequence* pOld, Sequence* pBest, Structure* pStructure, RotamerList* pList, StringArray** ppRotType, IntArray** ppRotCount, int* seqNdx, double temp, int stepCount, FILE* pFileRot, FILE* pFileSeq, CataConsSitePairArray* pConsArray, EvolutionScoreCache* pEvoCache, RandomGenerator* pRand)
 {
   int nacc = 0;
   for (int i = 0; i < stepCount; i++)
   {
     int mutSiteNdx;
     int mutRotNdx;
-    SequenceRandomSiteIndex(&mutSiteNdx, StructureGetDesignSiteCount(pStructure));
-    SequenceRandRotamerIndex(pStructure, pList, ppRotType, ppRotCount, mutSiteNdx, &mutRotNdx);
+    SequenceRandomSiteIndex(&mutSiteNdx, StructureGetDesignSiteCount(pStructure), pRand);
+    SequenceRandRotamerIndex(pStructure, pList, ppRotType, ppRotCount, mutSiteNdx, &mutRotNdx, pRand);
     double dtot = 0, dphy = 0, devo = 0, dbin = 0;
     int dcons = 0;
-    EnergyChangeUponSingleMutationWithCataCons(pStructure, pOld, mutSiteNdx, mutRotNdx, &dtot, &dphy, &dbin, &devo, &dcons, pConsArray);
-    if (exp(-1.0 * dtot / temp) > (double)(rand() + 1.0) / (RAND_MAX + 1.0))
+    EnergyChangeUponSingleMutationWithCataCons(pStructure, pOld, mutSiteNdx, mutRotNdx, pEvoCache, &dtot, &dphy, &dbin, &devo, &dcons, pConsArray);
+    if (exp(-1.0 * dtot / temp) > RandomGeneratorReal(pRand))
     {
       SequenceUpdateSingleSite(pOld, mutSiteNdx, mutRotNdx);
       pOld->etot += dtot;
@@ -1205,49 +2305,402 @@ int MetropolisWithCataCons(Sequence* pOld, Sequence* pBest, Structure* pStructur
 }
 
 
-int SimulatedAnnealing(Structure* pStruct, RotamerList* pList)
+int StructureLoadCataCons(Structure* pStruct, CataConsSitePairArray* pConsArray, char* consfile)
 {
-  int result = Success;
   char errMsg[MAX_LEN_ERR_MSG + 1];
-  srand((unsigned int)time(NULL));
+  int result = CataConsSitePairArrayCreate(pConsArray, consfile);
+  if (FAILED(result))
+  {
+    sprintf(errMsg, "in file %s line %d, failed to create catalytic constraints from file %s",
+      __FILE__, __LINE__, consfile);
+    TraceError(errMsg, ValueError);
+    return ValueError;
+  }
+  for (int i = 0;i < CataConsSitePairArrayGetCount(pConsArray);i++)
+  {
+    result = StructureDeployCataConsSitePair(pStruct, CataConsSitePairArrayGet(pConsArray, i));
+    if (FAILED(result))
+    {
+      sprintf(errMsg, "in file %s line %d, failed to deploy catalytic constraints",
+        __FILE__, __LINE__);
+      TraceError(errMsg, ValueError);
+      return ValueError;
+    }
+  }
+  return Success;
+}
 
-  StringArray* pRotTypes = (StringArray*)malloc(sizeof(StringArray) * pList->desSiteCount);
-  IntArray* pRotCounts = (IntArray*)malloc(sizeof(IntArray) * pList->desSiteCount);
-  DesignSiteShowRotamerTypeAndCount(pList, pStruct, &pRotTypes, &pRotCounts);
-  int remainCount = 0;
-  for (int i = 0; i < pList->desSiteCount; i++)
+
+int SequenceGenTrajectorySeed(Structure* pStruct, RotamerList* pList, CataConsSitePairArray* pConsArray, Sequence* pSeq, RandomGenerator* pRand)
+{
+  if (FLAG_DESIGN_FROM_NATAA == TRUE)
   {
-    remainCount += pList->remainRotamerCount[i];
+    SequenceGenNativeSeqSeed(pStruct, pList, pSeq);
+  }
+  else
+  {
+    SequenceGenRandomSeed(pSeq, pList, pRand);
+  }
+  // the template energy temporarily invalidates the side-chain atoms of the shared design residues
+#pragma omp critical (SequenceTemplate)
+  {
+    if (FLAG_ENZYME == TRUE)
+    {
+      SequenceEnergyWithCataCons(pStruct, pSeq, pConsArray);
+    }
+    else
+    {
+      SequenceEnergy(pStruct, pSeq);
+    }
+  }
+  return Success;
+}
+
+
+int DesignWriteBestSequence(Structure* pStruct, Sequence* pBest, int trajNdx, FILE* pFileBestSeq)
+{
+  // write the lowest-energy sequence
+  char BEST_STRUCT_ITER[MAX_LEN_FILE_NAME + 1];
+  sprintf(BEST_STRUCT_ITER, "%s%04d.pdb", FILE_BESTSTRUCT, trajNdx);
+  strcpy(pBest->fileToSaveThisSeq, BEST_STRUCT_ITER);
+#pragma omp critical (BestSeqFile)
+  {
+    SequenceWriteDesignFasta(pBest, pStruct, trajNdx, pFileBestSeq);
+    fflush(pFileBestSeq);
+  }
+
+  // write the lowest-energy protein structure, protein design sites, and corresponding ligand pose
+  DesignShowMinEnergyDesignStructure(pStruct, pBest, BEST_STRUCT_ITER);
+  char BEST_DESSITE_ITER[MAX_LEN_FILE_NAME + 1];
+  sprintf(BEST_DESSITE_ITER, "%s%04d.pdb", FILE_BEST_ALL_SITES, trajNdx);
+  DesignShowMinEnergyDesignSites(pStruct, pBest, BEST_DESSITE_ITER);
+
+  char BEST_MUTSITE_ITER[MAX_LEN_FILE_NAME + 1];
+  sprintf(BEST_MUTSITE_ITER, "%s%04d.pdb", FILE_BEST_MUT_SITES, trajNdx);
+  DesignShowMinEnergyDesignMutableSites(pStruct, pBest, BEST_MUTSITE_ITER);
+
+  if (FLAG_MOL2 == TRUE)
+  {
+    char BEST_MOL2_ITER[MAX_LEN_FILE_NAME + 1];
+    sprintf(BEST_MOL2_ITER, "%s%04d.mol2", FILE_BEST_LIG_MOL2, trajNdx);
+    DesignShowMinEnergyDesignLigand(pStruct, pBest, BEST_MOL2_ITER);
+  }
+  return Success;
+}
+
+
+int SimulatedAnnealingTrajectory(Structure* pStruct, RotamerList* pList, StringArray** ppRotTypes, IntArray** ppRotCounts, int stepCount, CataConsSitePairArray* pConsArray, PairEnergyTable* pTable, RandomGenerator* pRand, int trajNdx, FILE* pFileBestSeq)
+{
+  printf("search for independent design trajectory #%d\n", trajNdx);
+  Sequence oldSeq, bestSeq;
+  SequenceCreate(&oldSeq);
+  SequenceCreate(&bestSeq);
+  SequenceGenTrajectorySeed(pStruct, pList, pConsArray, &oldSeq, pRand);
+  SequenceCopy(&bestSeq, &oldSeq);
+
+  // the evolution predictions of the current sequence are kept, so a step only re-runs the networks around the mutation
+  EvolutionScoreCache evoCache;
+  EvolutionScoreCache* pEvoCache = NULL;
+  if (FLAG_EVOLUTION == TRUE && FLAG_EVOPHIPSI == TRUE && EVO_SCORER != NULL)
+  {
+    EvolutionScoreCacheCreate(&evoCache, EVO_SCORER);
+    pEvoCache = &evoCache;
+  }
+
+  int seqIndex = 0;
+  // record decoy sequences and selected rots
+  FILE* pFileRotDecoys = NULL;
+  FILE* pFileSeqDecoys = NULL;
+  //char ROT_FILE_ITER[MAX_LEN_FILE_NAME+1];
+  //char SEQ_FILE_ITER[MAX_LEN_FILE_NAME+1];
+  //sprintf(ROT_FILE_ITER,"%s%04d.txt",FILE_DESROT_NDX,trajNdx);
+  //FILE* pFileRotDecoys=fopen(ROT_FILE_ITER,"w");
+  //sprintf(SEQ_FILE_ITER,"%s%04d.txt",FILE_DESSEQS,trajNdx);
+  //FILE* pFileSeqDecoys=fopen(SEQ_FILE_ITER,"w");
+  //SequenceCopy(&bestSeq,&oldSeq);
+  //SequenceWriteDesignRotamer(&bestSeq,pStruct,seqNdx,pFileRotDecoys);
+  //SequenceWriteDesignFasta(&bestSeq,pStruct,seqNdx,pFileSeqDecoys);
+  seqIndex++;
+  //clock_t start = clock();
+  for (int cycle = 1; cycle <= SA_CYCLE; cycle++)
+  {
+    printf("simulated annealing cycle %3d\n", cycle);
+    //double t=SA_TMAX/pow(cycle,2.0);
+    double t = SA_TMAX / cycle;
+    while (t > SA_TMIN)
+    {
+      if (FLAG_ENZYME == TRUE)
+      {
+        MetropolisWithCataCons(&oldSeq, &bestSeq, pStruct, pList, ppRotTypes, ppRotCounts, &seqIndex, t, stepCount, pFileRotDecoys, pFileSeqDecoys, pConsArray, pEvoCache, pRand);
+      }
+      else
+      {
+        Metropolis(&oldSeq, &bestSeq, pStruct, pList, ppRotTypes, ppRotCounts, &seqIndex, t, stepCount, pFileRotDecoys, pFileSeqDecoys, pTable, pEvoCache, pRand);
+      }
+      t *= SA_DECREASE_FAC;
+    }
+  }
+  if (pFileRotDecoys != NULL)
+  {
+    fclose(pFileRotDecoys);
+  }
+  if (pFileSeqDecoys != NULL)
+  {
+    fclose(pFileSeqDecoys);
+  }
+
+  //clock_t end = clock();
+  //printf("elapsed time for simulated annealing: %f sec\n", (double)(end - start) / CLOCKS_PER_SEC);
+
+  DesignWriteBestSequence(pStruct, &bestSeq, trajNdx, pFileBestSeq);
+
+  if (pEvoCache != NULL)
+  {
+    EvolutionScoreCacheDestroy(pEvoCache);
+  }
+  SequenceDestroy(&oldSeq);
+  SequenceDestroy(&bestSeq);
+  return Success;
+}
+
+
+int ReplicaExchangeTrajectory(Structure* pStruct, RotamerList* pList, StringArray** ppRotTypes, IntArray** ppRotCounts, int stepCount, CataConsSitePairArray* pConsArray, PairEnergyTable* pTable, unsigned long long seed, int trajNdx, int nthreads, FILE* pFileBestSeq)
+{
+  int replicaCount = NREPLICAS;
+  printf("search for design trajectory #%d by replica exchange with %d replicas\n", trajNdx, replicaCount);
+  Sequence* pSeqs = (Sequence*)malloc(sizeof(Sequence) * replicaCount);
+  Sequence* pBests = (Sequence*)malloc(sizeof(Sequence) * replicaCount);
+  RandomGenerator* pRands = (RandomGenerator*)malloc(sizeof(RandomGenerator) * replicaCount);
+  EvolutionScoreCache* pEvoCaches = (EvolutionScoreCache*)malloc(sizeof(EvolutionScoreCache) * replicaCount);
+  int* seqIndexes = (int*)malloc(sizeof(int) * replicaCount);
+  double* temps = (double*)malloc(sizeof(double) * replicaCount);
+  int* replicaAt = (int*)malloc(sizeof(int) * replicaCount); // replica currently at each temperature
+  int* swapTried = (int*)malloc(sizeof(int) * replicaCount);
+  int* swapAccepted = (int*)malloc(sizeof(int) * replicaCount);
+  BOOL useEvoCache = (FLAG_EVOLUTION == TRUE && FLAG_EVOPHIPSI == TRUE && EVO_SCORER != NULL) ? TRUE : FALSE;
+  for (int k = 0; k < replicaCount; k++)
+  {
+    // geometric temperature ladder
+    temps[k] = REX_TMIN * pow(REX_TMAX / REX_TMIN, (double)k / (replicaCount - 1));
+    replicaAt[k] = k;
+    seqIndexes[k] = 0;
+    swapTried[k] = 0;
+    swapAccepted[k] = 0;
+    SequenceCreate(&pSeqs[k]);
+    SequenceCreate(&pBests[k]);
+    // a replica keeps its generator and evolution cache when it moves to another temperature,
+    // so the result does not depend on the number of threads
+    RandomGeneratorSeed(&pRands[k], seed + (unsigned long long)trajNdx * (replicaCount + 1) + k);
+    if (useEvoCache == TRUE)
+    {
+      EvolutionScoreCacheCreate(&pEvoCaches[k], EVO_SCORER);
+    }
+  }
+  RandomGenerator swapRand;
+  RandomGeneratorSeed(&swapRand, seed + (unsigned long long)trajNdx * (replicaCount + 1) + replicaCount);
+
+  if (nthreads > replicaCount)
+  {
+    nthreads = replicaCount;
+  }
+#ifndef _OPENMP
+  nthreads = 1;
+#endif
+  if (nthreads < 1)
+  {
+    nthreads = 1;
+  }
+#pragma omp parallel num_threads(nthreads)
+  {
+    Structure view;
+    Structure* pThreadStruct = pStruct;
+    CataConsSitePairArray threadConsArray;
+    CataConsSitePairArray* pThreadConsArray = pConsArray;
+    if (nthreads > 1)
+    {
+      StructureDesignViewCreate(&view, pStruct);
+      pThreadStruct = &view;
+      if (FLAG_ENZYME == TRUE)
+      {
+        StructureLoadCataCons(&view, &threadConsArray, FILE_CATACONS);
+        pThreadConsArray = &threadConsArray;
+      }
+    }
+#pragma omp for schedule(static)
+    for (int k = 0; k < replicaCount; k++)
+    {
+      SequenceGenTrajectorySeed(pThreadStruct, pList, pThreadConsArray, &pSeqs[k], &pRands[k]);
+      SequenceCopy(&pBests[k], &pSeqs[k]);
+    }
+    for (int round = 0; round < REX_ROUND; round++)
+    {
+#pragma omp for schedule(static)
+      for (int k = 0; k < replicaCount; k++)
+      {
+        int r = replicaAt[k];
+        EvolutionScoreCache* pEvoCache = (useEvoCache == TRUE) ? &pEvoCaches[r] : NULL;
+        if (FLAG_ENZYME == TRUE)
+        {
+          MetropolisWithCataCons(&pSeqs[r], &pBests[r], pThreadStruct, pList, ppRotTypes, ppRotCounts, &seqIndexes[r], temps[k], stepCount, NULL, NULL, pThreadConsArray, pEvoCache, &pRands[r]);
+        }
+        else
+        {
+          Metropolis(&pSeqs[r], &pBests[r], pThreadStruct, pList, ppRotTypes, ppRotCounts, &seqIndexes[r], temps[k], stepCount, NULL, NULL, pTable, pEvoCache, &pRands[r]);
+        }
+      }
+#pragma omp single
+      {
+        // neighbouring temperatures exchange their replicas, the even and the odd pairs in turn
+        for (int k = round % 2; k + 1 < replicaCount; k += 2)
+        {
+          int ri = replicaAt[k];
+          int rj = replicaAt[k + 1];
+          double delta = (1.0 / temps[k] - 1.0 / temps[k + 1]) * (pSeqs[ri].etot - pSeqs[rj].etot);
+          swapTried[k]++;
+          if (delta >= 0 || exp(delta) > RandomGeneratorReal(&swapRand))
+          {
+            replicaAt[k] = rj;
+            replicaAt[k + 1] = ri;
+            swapAccepted[k]++;
+          }
+        }
+      }
+    }
+    if (nthreads > 1)
+    {
+      if (FLAG_ENZYME == TRUE)
+      {
+        CataConsSitePairArrayDestroy(&threadConsArray);
+      }
+      StructureDesignViewDestroy(&view);
+    }
   }
-  printf("total remained rotamer count: %d\n", remainCount);
-  remainCount = remainCount < METROPOLIS_STEP ? remainCount : METROPOLIS_STEP;
-  printf("set the number of monte carlo moves at each temperature to %d\n", remainCount);
+
+  int bestNdx = 0;
+  for (int k = 0; k < replicaCount; k++)
+  {
+    if (pBests[k].etot < pBests[bestNdx].etot)
+    {
+      bestNdx = k;
+    }
+    if (k + 1 < replicaCount)
+    {
+      printf("exchange ratio = %12.6f between temp = %12.6f and temp = %12.6f\n",
+        swapTried[k] != 0 ? (float)swapAccepted[k] / swapTried[k] : 0.0, temps[k], temps[k + 1]);
+    }
+  }
+  printf("lowest energy %f found by replica %d of design trajectory #%d\n", pBests[bestNdx].etot, bestNdx, trajNdx);
+  DesignWriteBestSequence(pStruct, &pBests[bestNdx], trajNdx, pFileBestSeq);
+
+  for (int k = 0; k < replicaCount; k++)
+  {
+    if (useEvoCache == TRUE)
+    {
+      EvolutionScoreCacheDestroy(&pEvoCaches[k]);
+    }
+    SequenceDestroy(&pSeqs[k]);
+    SequenceDestroy(&pBests[k]);
+  }
+  free(pSeqs);
+  free(pBests);
+  free(pRands);
+  free(pEvoCaches);
+  free(seqIndexes);
+  free(temps);
+  free(replicaAt);
+  free(swapTried);
+  free(swapAccepted);
+  return Success;
+}
+
+
+int SimulatedAnnealing(Structure* pStruct, RotamerList* pList)
+{
+  int result = Success;
+  // each trajectory draws from its own generator seeded with (seed + trajectory index),
+  // so that the result of a trajectory does not depend on the thread that runs it
+  unsigned long long seed = (unsigned long long)time(NULL);
 
   CataConsSitePairArray consArray;
   if (FLAG_ENZYME == TRUE)
   {
-    result = CataConsSitePairArrayCreate(&consArray, FILE_CATACONS);
+    result = StructureLoadCataCons(pStruct, &consArray, FILE_CATACONS);
     if (FAILED(result))
     {
-      sprintf(errMsg, "in file %s line %d, failed to create catalytic constraints from file %s",
-        __FILE__, __LINE__, FILE_CATACONS);
-      result = ValueError;
       return result;
     }
-    for (int i = 0;i < CataConsSitePairArrayGetCount(&consArray);i++)
+  }
+
+  if (FLAG_EVOLUTION == TRUE)
+  {
+    StructureMapDesignSitesToWholeSequence(pStruct);
+  }
+  StructureBuildDesignSiteGraph(pStruct);
+
+  PairEnergyTable pairTable;
+  PairEnergyTable* pTable = NULL;
+  PairEnergyTableCreate(&pairTable);
+  if (FLAG_PAIR_TABLE == TRUE && FLAG_PHYSICS == TRUE)
+  {
+    if (FLAG_ENZYME == TRUE)
+    {
+      printf("pairwise energy table is not supported for enzyme design, energies will be computed on the fly\n");
+    }
+    else
+    {
+      PairEnergyTableGenerate(&pairTable, pStruct, pList, FLAG_ENERGY_MATRIX == TRUE ? FILE_ENERGY_MATRIX : NULL);
+      pTable = &pairTable;
+    }
+  }
+  if (FLAG_DEE == TRUE)
+  {
+    if (pTable == NULL)
+    {
+      printf("dead-end elimination requires the pairwise energy table (--pair_table), skipped\n");
+    }
+    else if (FLAG_EVOLUTION == TRUE && FLAG_EVOPHIPSI == TRUE)
+    {
+      printf("the phi/psi evolution score is not pairwise decomposable, dead-end elimination skipped\n");
+    }
+    else
     {
-      result = StructureDeployCataConsSitePair(pStruct, CataConsSitePairArrayGet(&consArray, i));
+      result = PairEnergyTableDeadEndElimination(pTable, pStruct, pList);
       if (FAILED(result))
       {
-        sprintf(errMsg, "in file %s line %d, failed to deploy catalytic constraints",
-          __FILE__, __LINE__);
-        result = ValueError;
         return result;
       }
     }
   }
 
-  printf("searching sequences using monte-carlo simulated annealing optimization\n");
+  StringArray* pRotTypes = (StringArray*)malloc(sizeof(StringArray) * pList->desSiteCount);
+  IntArray* pRotCounts = (IntArray*)malloc(sizeof(IntArray) * pList->desSiteCount);
+  DesignSiteShowRotamerTypeAndCount(pList, pStruct, &pRotTypes, &pRotCounts);
+  int remainCount = 0;
+  for (int i = 0; i < pList->desSiteCount; i++)
+  {
+    remainCount += pList->remainRotamerCount[i];
+  }
+  printf("total remained rotamer count: %d\n", remainCount);
+  remainCount = remainCount < METROPOLIS_STEP ? remainCount : METROPOLIS_STEP;
+  printf("set the number of monte carlo moves at each temperature to %d\n", remainCount);
+
+  int nthreads = NTHREADS;
+  if (nthreads > NTRAJ - NTRAJ_START_NDX + 1)
+  {
+    nthreads = NTRAJ - NTRAJ_START_NDX + 1;
+  }
+#ifndef _OPENMP
+  nthreads = 1;
+#endif
+  if (nthreads < 1)
+  {
+    nthreads = 1;
+  }
+
+  if (FLAG_EXACT_SEARCH == FALSE)
+  {
+    printf("searching sequences using monte-carlo simulated annealing optimization\n");
+  }
   char BEST_SEQ_IDX[MAX_LEN_FILE_NAME + 1];
   sprintf(BEST_SEQ_IDX, "%s.txt", FILE_BESTSEQS);
   FILE* pFileBestSeq = NULL;
@@ -1273,105 +2726,90 @@ int SimulatedAnnealing(Structure* pStruct, RotamerList* pList)
   }
 
   fflush(pFileBestSeq);
-  for (int i = NTRAJ_START_NDX;i <= NTRAJ;i++)
+  BOOL exactSearch = FALSE;
+  if (FLAG_EXACT_SEARCH == TRUE)
   {
-    printf("search for independent design trajectory #%d\n", i);
-    Sequence oldSeq, bestSeq;
-    SequenceCreate(&oldSeq);
-    SequenceCreate(&bestSeq);
-    if (FLAG_DESIGN_FROM_NATAA == TRUE)
+    if (pTable == NULL)
     {
-      SequenceGenNativeSeqSeed(pStruct, pList, &oldSeq);
+      printf("the exact search requires the pairwise energy table (--pair_table), simulated annealing is used instead\n");
+    }
+    else if (FLAG_EVOLUTION == TRUE && FLAG_EVOPHIPSI == TRUE)
+    {
+      printf("the phi/psi evolution score is not pairwise decomposable, simulated annealing is used instead of the exact search\n");
     }
     else
     {
-      SequenceGenRandomSeed(&oldSeq, pList);
+      exactSearch = TRUE;
     }
-    if (FLAG_ENZYME == TRUE)
+  }
+  if (exactSearch == TRUE)
+  {
+    // deterministic: a single trajectory with the global minimum of the table energy, or the best
+    // sequence found within the time limit together with a lower bound of the minimum
+    Sequence bestSeq;
+    SequenceCreate(&bestSeq);
+    bestSeq.desSiteCount = pList->desSiteCount;
+    double tableEnergy = 0.0;
+    double lowerBound = 0.0;
+    PairEnergyTableExactSearch(pTable, pStruct, pList, EXACT_TIME_LIMIT, &bestSeq.rotNdxs, &tableEnergy, &lowerBound);
+    SequenceEnergy(pStruct, &bestSeq);
+    printf("exact search: table energy %f, lower bound %f, gap %f\n", tableEnergy, lowerBound, tableEnergy - lowerBound);
+    DesignWriteBestSequence(pStruct, &bestSeq, NTRAJ_START_NDX, pFileBestSeq);
+    SequenceDestroy(&bestSeq);
+  }
+  else if (NREPLICAS >= 2)
+  {
+    // the replicas of a trajectory share the threads, the trajectories run one after another
+    for (int i = NTRAJ_START_NDX;i <= NTRAJ;i++)
     {
-      SequenceEnergyWithCataCons(pStruct, &oldSeq, &consArray);
+      ReplicaExchangeTrajectory(pStruct, pList, &pRotTypes, &pRotCounts, remainCount, &consArray, pTable, seed, i, NTHREADS, pFileBestSeq);
     }
-    else
+  }
+  else
+  {
+    if (nthreads > 1)
+    {
+      printf("running independent design trajectories on %d threads\n", nthreads);
+    }
+#pragma omp parallel num_threads(nthreads)
     {
-      SequenceEnergy(pStruct, &oldSeq);
-    }
-    SequenceCopy(&bestSeq, &oldSeq);
-
-    int seqIndex = 0;
-    // record decoy sequences and selected rots
-    FILE* pFileRotDecoys = NULL;
-    FILE* pFileSeqDecoys = NULL;
-    //char ROT_FILE_ITER[MAX_LEN_FILE_NAME+1];
-    //char SEQ_FILE_ITER[MAX_LEN_FILE_NAME+1];
-    //sprintf(ROT_FILE_ITER,"%s%04d.txt",FILE_DESROT_NDX,i);
-    //FILE* pFileRotDecoys=fopen(ROT_FILE_ITER,"w");
-    //sprintf(SEQ_FILE_ITER,"%s%04d.txt",FILE_DESSEQS,i);
-    //FILE* pFileSeqDecoys=fopen(SEQ_FILE_ITER,"w");
-    //SequenceCopy(&bestSeq,&oldSeq);
-    //SequenceWriteDesignRotamer(&bestSeq,pStruct,seqNdx,pFileRotDecoys);
-    //SequenceWriteDesignFasta(&bestSeq,pStruct,seqNdx,pFileSeqDecoys);
-    seqIndex++;
-    //clock_t start = clock();
-    for (int cycle = 1; cycle <= SA_CYCLE; cycle++)
-    {
-      printf("simulated annealing cycle %3d\n", cycle);
-      //double t=SA_TMAX/pow(cycle,2.0);
-      double t = SA_TMAX / cycle;
-      while (t > SA_TMIN)
+      // with a single thread, the trajectories run directly on the input structure
+      Structure view;
+      Structure* pThreadStruct = pStruct;
+      CataConsSitePairArray threadConsArray;
+      CataConsSitePairArray* pThreadConsArray = &consArray;
+      if (nthreads > 1)
       {
+        StructureDesignViewCreate(&view, pStruct);
+        pThreadStruct = &view;
         if (FLAG_ENZYME == TRUE)
         {
-          MetropolisWithCataCons(&oldSeq, &bestSeq, pStruct, pList, &pRotTypes, &pRotCounts, &seqIndex, t, remainCount, pFileRotDecoys, pFileSeqDecoys, &consArray);
+          // pseudo atoms of the constraints are written while checking, so every thread has its own copy
+          StructureLoadCataCons(&view, &threadConsArray, FILE_CATACONS);
+          pThreadConsArray = &threadConsArray;
         }
-        else
+      }
+#pragma omp for schedule(dynamic)
+      for (int i = NTRAJ_START_NDX;i <= NTRAJ;i++)
+      {
+        RandomGenerator randGen;
+        RandomGeneratorSeed(&randGen, seed + i);
+        SimulatedAnnealingTrajectory(pThreadStruct, pList, &pRotTypes, &pRotCounts, remainCount, pThreadConsArray, pTable, &randGen, i, pFileBestSeq);
+      }
+      if (nthreads > 1)
+      {
+        if (FLAG_ENZYME == TRUE)
         {
-          Metropolis(&oldSeq, &bestSeq, pStruct, pList, &pRotTypes, &pRotCounts, &seqIndex, t, remainCount, pFileRotDecoys, pFileSeqDecoys);
+          CataConsSitePairArrayDestroy(&threadConsArray);
         }
-        t *= SA_DECREASE_FAC;
+        StructureDesignViewDestroy(&view);
       }
     }
-    if (pFileRotDecoys != NULL)
-    {
-      fclose(pFileRotDecoys);
-    }
-    if (pFileSeqDecoys != NULL)
-    {
-      fclose(pFileSeqDecoys);
-    }
-
-    //clock_t end = clock();
-    //printf("elapsed time for simulated annealing: %f sec\n", (double)(end - start) / CLOCKS_PER_SEC);
-
-    // write the lowest-energy sequence
-    char BEST_STRUCT_ITER[MAX_LEN_FILE_NAME + 1];
-    sprintf(BEST_STRUCT_ITER, "%s%04d.pdb", FILE_BESTSTRUCT, i);
-    strcpy(bestSeq.fileToSaveThisSeq, BEST_STRUCT_ITER);
-    SequenceWriteDesignFasta(&bestSeq, pStruct, i, pFileBestSeq);
-    fflush(pFileBestSeq);
-
-    // write the lowest-energy protein structure, protein design sites, and corresponding ligand pose
-    DesignShowMinEnergyDesignStructure(pStruct, &bestSeq, BEST_STRUCT_ITER);
-    char BEST_DESSITE_ITER[MAX_LEN_FILE_NAME + 1];
-    sprintf(BEST_DESSITE_ITER, "%s%04d.pdb", FILE_BEST_ALL_SITES, i);
-    DesignShowMinEnergyDesignSites(pStruct, &bestSeq, BEST_DESSITE_ITER);
-
-    char BEST_MUTSITE_ITER[MAX_LEN_FILE_NAME + 1];
-    sprintf(BEST_MUTSITE_ITER, "%s%04d.pdb", FILE_BEST_MUT_SITES, i);
-    DesignShowMinEnergyDesignMutableSites(pStruct, &bestSeq, BEST_MUTSITE_ITER);
-
-    if (FLAG_MOL2 == TRUE)
-    {
-      char BEST_MOL2_ITER[MAX_LEN_FILE_NAME + 1];
-      sprintf(BEST_MOL2_ITER, "%s%04d.mol2", FILE_BEST_LIG_MOL2, i);
-      DesignShowMinEnergyDesignLigand(pStruct, &bestSeq, BEST_MOL2_ITER);
-    }
-
-    SequenceDestroy(&oldSeq);
-    SequenceDestroy(&bestSeq);
   }
   fclose(pFileBestSeq);
 
   // release memory
+  PairEnergyTableDestroy(&pairTable);
   if (FLAG_ENZYME == TRUE)
   {
     CataConsSitePairArrayDestroy(&consArray);
@@ -1386,4 +2824,3 @@ int SimulatedAnnealing(Structure* pStruct, RotamerList* pList)
 
   return Success;
 }
-
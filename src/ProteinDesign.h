@@ -21,6 +21,7 @@ IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "EnergyMatrix.h"
 #include "SmallMol.h"
 #include "Sequence.h"
+#include "Evolution.h"
 
 // simulated annealing
 #define SA_CYCLE         3
@@ -29,27 +30,74 @@ IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define	SA_DECREASE_FAC  0.8
 #define METROPOLIS_STEP  20000
 
+// replica exchange (--replica_exchange=n): n Metropolis walkers on a geometric temperature ladder
+// from REX_TMIN to REX_TMAX try to swap with their neighbours after every round of moves
+#define REX_TMIN         0.1
+#define REX_TMAX         20.0
+#define REX_ROUND        150
+
+// a rotamer is eliminated by dead-end elimination only if it is worse by more than this
+#define DEE_ENERGY_TOLERANCE 1.0e-6
+
+// extra distance (in Angstrom) added to the energy cutoff when linking design sites
+#define DESIGN_SITE_GRAPH_MARGIN 0.5
+
+// pre-computed pairwise energies between the remaining rotamers of design sites, used by
+// the simulated annealing in table-lookup mode (--pair_table).
+// blocks are indexed by the reduced rotamer index; the block of a non-interacting site pair
+// is left empty (energyIK == NULL) and contributes zero
+typedef struct _PairEnergyTable
+{
+  EnergyMatrix phy;  // weighted pair energy counted in the physical energy (same chain)
+  EnergyMatrix bin;  // weighted pair energy counted in the binding energy (different chains)
+  int** reducedNdx;  // original rotamer index => reduced index, -1 for deleted rotamers
+} PairEnergyTable;
+
+int PairEnergyTableCreate(PairEnergyTable* pThis);
+void PairEnergyTableDestroy(PairEnergyTable* pThis);
+// the selected blocks are copied from 'energyMatrixFile' (may be NULL) when it was written by GenerateEnergyMatrix
+// for the same design sites and rotamers, and are computed otherwise
+int PairEnergyTableGenerate(PairEnergyTable* pThis, Structure* pStructure, RotamerList* pList, char* energyMatrixFile);
+double PairEnergyTableGet(EnergyMatrix* pMatrix, int designSiteI, int designSiteK, int reducedIJ, int reducedKS);
+// dead-end elimination (--dee): removes the rotamers that cannot be part of the global minimum of the
+// table energy by the Goldstein and split (one split site) criteria, from pList and both matrices
+int PairEnergyTableDeadEndElimination(PairEnergyTable* pThis, Structure* pStructure, RotamerList* pList);
+// exact search (--exact_search): depth-first branch and bound over the table energy, each leaf polished by
+// iterated conditional modes; returns the lowest-energy rotamers and their table energy, which equals the
+// lower bound unless 'timeLimit' is reached ('timeLimit' is CPU time in secs measured by clock(), <= 0 for none)
+int PairEnergyTableExactSearch(PairEnergyTable* pThis, Structure* pStructure, RotamerList* pList, double timeLimit, IntArray* pRotNdxs, double* pEnergy, double* pLowerBound);
+
 int SitePairConsDeploy(CataConsSitePairArray* pSitePairArray, Structure* pStructure);
 int EnergyMatrixUpdateForCataCons(EnergyMatrix* pMatrix, RotamerList* pList, CataConsSitePair* pSitePair, Structure* pStructure);
 int EnergyMatrixUpdateForCataConsArray(EnergyMatrix* pMatrix, RotamerList* pList, CataConsSitePairArray* pSitePairArray, Structure* pStructure);
 int DesignSiteShowRotamerTypeAndCount(RotamerList* pList, Structure* pStructure, StringArray** ppRotamerType, IntArray** ppRotamerCount);
+// links the design sites whose rotamer bounding spheres come within the energy cutoff (DesignSite::nbrNdxs);
+// the pair energies of the rotamers of unlinked sites are zero
+int StructureBuildDesignSiteGraph(Structure* pStructure);
 
-int SequenceRandomSiteIndex(int* mutSiteIndex, int designSiteCount);
-int SequenceRandRotamerIndex(Structure* pStructure, RotamerList* pList, StringArray** ppRotamerType, IntArray** ppRotamerCount, int siteIndex, int* rotIndex);
+int SequenceRandomSiteIndex(int* mutSiteIndex, int designSiteCount, RandomGenerator* pRand);
+int SequenceRandRotamerIndex(Structure* pStructure, RotamerList* pList, StringArray** ppRotamerType, IntArray** ppRotamerCount, int siteIndex, int* rotIndex, RandomGenerator* pRand);
 int SequenceUpdateSingleSite(Sequence* pThis, int mutationSiteIndex, int mutationRotamerIndex);
 
-int SequenceGenRandomSeed(Sequence* pThis, RotamerList* pList);
+int SequenceGenRandomSeed(Sequence* pThis, RotamerList* pList, RandomGenerator* pRand);
 int SequenceGenInitialSeqSeed(Structure* pStructure, RotamerList* pList, Sequence* pThis);
 int SequenceGenNativeSeqSeed(Structure* pStructure, RotamerList* pList, Sequence* pSequence);
 
 int SequenceTemplateEnergy(Structure* pStructure, Sequence* pSequence, double energyTerms[MAX_ENERGY_TERM], double energyTermsBind[MAX_ENERGY_TERM]);
 int SequenceEnergy(Structure* pStructure, Sequence* pSequence);
-int EnergyDifferenceUponSingleMutation(Structure* pStructure, Sequence* pSequence, int mutSiteIndex, int mutRotIndex, double* dtot, double* dphy, double* dbin, double* devo);
-int Metropolis(Sequence* pOld, Sequence* pBest, Structure* pStructure, RotamerList* pList, StringArray** ppRotamerType, IntArray** ppRotamerCount, int* seqIndex, double temp, int stepCount, FILE* fp, FILE* fp2);
+int EvolutionDifferenceUponSingleMutation(Structure* pStructure, Sequence* pSequence, int mutSiteIndex, int mutRotIndex, EvolutionScoreCache* pEvoCache, double* devo);
+int EnergyDifferenceUponSingleMutation(Structure* pStructure, Sequence* pSequence, int mutSiteIndex, int mutRotIndex, EvolutionScoreCache* pEvoCache, double* dtot, double* dphy, double* dbin, double* devo);
+int EnergyDifferenceUponSingleMutationByTable(PairEnergyTable* pTable, Structure* pStructure, Sequence* pSequence, int mutSiteIndex, int mutRotIndex, EvolutionScoreCache* pEvoCache, double* dtot, double* dphy, double* dbin, double* devo);
+int Metropolis(Sequence* pOld, Sequence* pBest, Structure* pStructure, RotamerList* pList, StringArray** ppRotamerType, IntArray** ppRotamerCount, int* seqIndex, double temp, int stepCount, FILE* fp, FILE* fp2, PairEnergyTable* pTable, EvolutionScoreCache* pEvoCache, RandomGenerator* pRand);
 int SequenceEnergyWithCataCons(Structure* pStructure, Sequence* pSequence, CataConsSitePairArray* pConsArray);
-int EnergyChangeUponSingleMutationWithCataCons(Structure* pStruct, Sequence* pSeq, int mutSiteIndex, int mutRotIndex, double* dtot, double* dphy, double* dbin, double* devo, int* dcons, CataConsSitePairArray* pConsArray);
-int MetropolisWithCataCons(Sequence* pOld, Sequence* pBest, Structure* pStructure, RotamerList* pList, StringArray** ppRotamerType, IntArray** ppRotamerCount, int* seqIndex, double temp, int stepCount, FILE* pFileRot, FILE* pFileSeq, CataConsSitePairArray* pConsArray);
+int EnergyChangeUponSingleMutationWithCataCons(Structure* pStruct, Sequence* pSeq, int mutSiteIndex, int mutRotIndex, EvolutionScoreCache* pEvoCache, double* dtot, double* dphy, double* dbin, double* devo, int* dcons, CataConsSitePairArray* pConsArray);
+int MetropolisWithCataCons(Sequence* pOld, Sequence* pBest, Structure* pStructure, RotamerList* pList, StringArray** ppRotamerType, IntArray** ppRotamerCount, int* seqIndex, double temp, int stepCount, FILE* pFileRot, FILE* pFileSeq, CataConsSitePairArray* pConsArray, EvolutionScoreCache* pEvoCache, RandomGenerator* pRand);
 
+int StructureLoadCataCons(Structure* pStructure, CataConsSitePairArray* pConsArray, char* consfile);
+int SequenceGenTrajectorySeed(Structure* pStructure, RotamerList* pList, CataConsSitePairArray* pConsArray, Sequence* pSequence, RandomGenerator* pRand);
+int DesignWriteBestSequence(Structure* pStructure, Sequence* pBest, int trajIndex, FILE* pFileBestSeq);
+int SimulatedAnnealingTrajectory(Structure* pStructure, RotamerList* pList, StringArray** ppRotamerType, IntArray** ppRotamerCount, int stepCount, CataConsSitePairArray* pConsArray, PairEnergyTable* pTable, RandomGenerator* pRand, int trajIndex, FILE* pFileBestSeq);
+int ReplicaExchangeTrajectory(Structure* pStructure, RotamerList* pList, StringArray** ppRotamerType, IntArray** ppRotamerCount, int stepCount, CataConsSitePairArray* pConsArray, PairEnergyTable* pTable, unsigned long long seed, int trajIndex, int nthreads, FILE* pFileBestSeq);
 int SimulatedAnnealing(Structure* pStructure, RotamerList* pList);
 
 #endif
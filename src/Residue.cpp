@@ -216,6 +216,11 @@ Atom* ResidueGetAtomByName(Residue* pThis, char* atomName)
   }
 }
 
+Atom* ResidueGetAtomHbDorB(Residue* pThis, Atom* pAtom)
+{
+  return AtomArrayGetHbDorB(&pThis->atoms, pAtom);
+}
+
 int ResidueFindAtom(Residue* pThis, char* atomName, int* pIndex)
 {
   return AtomArrayFind(&pThis->atoms, atomName, pIndex);
@@ -527,14 +532,12 @@ BondSet* ResidueGetBonds(Residue* pThis)
 
 int ResidueAddBondsFromResiTopos(Residue* pThis, ResiTopoSet* pResiTopoCollection)
 {
-  ResidueTopology resiTopo;
-  ResidueTopologyCreate(&resiTopo);
-  if (FAILED(ResiTopoSetGet(pResiTopoCollection, pThis->name, &resiTopo)))
+  ResidueTopology* pResiTopo = NULL;
+  if (FAILED(ResiTopoSetFind(pResiTopoCollection, pThis->name, &pResiTopo)))
   {
     return DataNotExistError;
   }
-  BondSetCopy(&pThis->bonds, ResidueTopologyGetBonds(&resiTopo));
-  ResidueTopologyDestroy(&resiTopo);
+  BondSetCopy(&pThis->bonds, ResidueTopologyGetBonds(pResiTopo));
   return Success;
 }
 
@@ -552,11 +555,10 @@ int ResidueShowInPDBFormat(Residue* pThis, char* header, char* chainName, int at
 int ResiduePatch(Residue* pThis, char* patchName, AtomParamsSet* pAtomParam, ResiTopoSet* pTopos)
 {
   // delete old atoms
-  ResidueTopology patchResiTopo;
-  ResidueTopologyCreate(&patchResiTopo);
-  int result = ResiTopoSetGet(pTopos, patchName, &patchResiTopo);
+  ResidueTopology* pPatchResiTopo = NULL;
+  int result = ResiTopoSetFind(pTopos, patchName, &pPatchResiTopo);
   if (FAILED(result)) return result;
-  StringArray* deleteAtoms = ResidueTopologyGetDeletes(&patchResiTopo);
+  StringArray* deleteAtoms = ResidueTopologyGetDeletes(pPatchResiTopo);
   for (int i = 0;i < StringArrayGetCount(deleteAtoms);i++)
   {
     ResidueDeleteAtom(pThis, StringArrayGet(deleteAtoms, i));
@@ -574,7 +576,7 @@ int ResiduePatch(Residue* pThis, char* patchName, AtomParamsSet* pAtomParam, Res
   StringArrayInsert(&pThis->patches, 0, patchName);
 
   // deal with the bonds
-  BondSet* pPatchBonds = ResidueTopologyGetBonds(&patchResiTopo);
+  BondSet* pPatchBonds = ResidueTopologyGetBonds(pPatchResiTopo);
   for (int i = 0;i < BondSetGetCount(pPatchBonds);i++)
   {
     Bond* pCurBond = BondSetGet(pPatchBonds, i);
@@ -599,7 +601,6 @@ int ResiduePatch(Residue* pThis, char* patchName, AtomParamsSet* pAtomParam, Res
   }
   BondSetCopy(&pThis->bonds, &newBonds);
   BondSetDestroy(&newBonds);
-  ResidueTopologyDestroy(&patchResiTopo);
   return Success;
 }
 
@@ -609,12 +610,11 @@ int ResiduePatch(Residue* pThis, char* patchName, AtomParamsSet* pAtomParam, Res
 int ResiduePatchCTER(Residue* pThis, char* patchName, AtomParamsSet* pAtomParam, ResiTopoSet* pTopos)
 {
   // delete old atoms
-  ResidueTopology patchResiTopo;
-  ResidueTopologyCreate(&patchResiTopo);
-  int result = ResiTopoSetGet(pTopos, "CTER", &patchResiTopo);
+  ResidueTopology* pPatchResiTopo = NULL;
+  int result = ResiTopoSetFind(pTopos, "CTER", &pPatchResiTopo);
   if (FAILED(result)) return result;
   // do not delete atom O;
-  //StringArray* deleteAtoms = ResidueTopologyGetDeletes(&patchResiTopo);
+  //StringArray* deleteAtoms = ResidueTopologyGetDeletes(pPatchResiTopo);
   //for(int i=0;i<StringArrayGetCount(deleteAtoms);i++){
   //  ResidueDeleteAtom(pThis, StringArrayGet(deleteAtoms, i));
   //}
@@ -637,7 +637,7 @@ int ResiduePatchCTER(Residue* pThis, char* patchName, AtomParamsSet* pAtomParam,
   // new patches are stored at the head
   StringArrayInsert(&pThis->patches, 0, patchName);
   // deal with the bonds
-  BondSet* pPatchBonds = ResidueTopologyGetBonds(&patchResiTopo);
+  BondSet* pPatchBonds = ResidueTopologyGetBonds(pPatchResiTopo);
   for (int i = 0;i < BondSetGetCount(pPatchBonds);i++)
   {
     Bond* pCurBond = BondSetGet(pPatchBonds, i);
@@ -662,7 +662,6 @@ int ResiduePatchCTER(Residue* pThis, char* patchName, AtomParamsSet* pAtomParam,
   }
   BondSetCopy(&pThis->bonds, &newBonds);
   BondSetDestroy(&newBonds);
-  ResidueTopologyDestroy(&patchResiTopo);
 
   // remove the useless bonds
   char deleteBondWithPreviousOrNextResidue = '+';
@@ -746,13 +745,15 @@ int ResidueCalcAtomXYZ(Residue* pThis, ResiTopoSet* pResiTopos, Residue* pPrevRe
   // find IC from patch topology orderly;
   BOOL icFound = FALSE;
   CharmmIC ic;
-  ResidueTopology topo;
+  ResidueTopology* pTopo = NULL;
   CharmmICCreate(&ic);
-  ResidueTopologyCreate(&topo);
   for (int i = 0;i < StringArrayGetCount(&pThis->patches);i++)
   {
-    ResiTopoSetGet(pResiTopos, StringArrayGet(&pThis->patches, i), &topo);
-    if (!FAILED(ResidueTopologyFindCharmmIC(&topo, atomName, &ic)))
+    if (FAILED(ResiTopoSetFind(pResiTopos, StringArrayGet(&pThis->patches, i), &pTopo)))
+    {
+      continue;
+    }
+    if (!FAILED(ResidueTopologyFindCharmmIC(pTopo, atomName, &ic)))
     {
       icFound = TRUE;
       break;
@@ -761,8 +762,7 @@ int ResidueCalcAtomXYZ(Residue* pThis, ResiTopoSet* pResiTopos, Residue* pPrevRe
   // find IC in the residue topology;
   if (icFound == FALSE)
   {
-    ResiTopoSetGet(pResiTopos, ResidueGetName(pThis), &topo);
-    if (FAILED(ResidueTopologyFindCharmmIC(&topo, atomName, &ic)))
+    if (FAILED(ResiTopoSetFind(pResiTopos, ResidueGetName(pThis), &pTopo)) || FAILED(ResidueTopologyFindCharmmIC(pTopo, atomName, &ic)))
     {
       int result = DataNotExistError;
       return result;
@@ -791,14 +791,12 @@ int ResidueCalcAtomXYZ(Residue* pThis, ResiTopoSet* pResiTopos, Residue* pPrevRe
     }
     else
     {
-      ResidueTopologyDestroy(&topo);
       CharmmICDestroy(&ic);
       return DataNotExistError;
     }
   }
 
   GetFourthAtom(&xyzsOfAtomABC[0], &xyzsOfAtomABC[1], &xyzsOfAtomABC[2], CharmmICGetICParams(&ic), pDestXYZ);
-  ResidueTopologyDestroy(&topo);
   CharmmICDestroy(&ic);
   return Success;
 }
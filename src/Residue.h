@@ -93,6 +93,7 @@ int ResidueGetPolarity(Residue* pThis, Type_ResiduePolarity* pPolarity);
 int ResidueGetAtomCount(Residue* pThis);
 Atom* ResidueGetAtom(Residue* pThis, int index);
 Atom* ResidueGetAtomByName(Residue* pThis, char* atomName);
+Atom* ResidueGetAtomHbDorB(Residue* pThis, Atom* pAtom);
 int ResidueFindAtom(Residue* pThis, char* atomName, int* pIndex);
 int ResidueGetAtomXYZ(Residue* pThis, char* atomName, XYZ* pXYZ);
 AtomArray* ResidueGetAllAtoms(Residue* pThis);
@@ -124,6 +124,8 @@ int BondSetCreate(BondSet* pThis)
 {
   pThis->count = 0;
   pThis->bonds = NULL;
+  pThis->pSeparation = NULL;
+  pThis->separationShared = FALSE;
   return Success;
 }
 
@@ -136,6 +138,7 @@ int BondSetDestroy(BondSet* pThis)
   free(pThis->bonds);
   pThis->bonds = NULL;
   pThis->count = 0;
+  BondSetReleaseSeparation(pThis);
   return Success;
 }
 
@@ -150,6 +153,17 @@ int BondSetCopy(BondSet* pThis, BondSet* pOther)
     BondCreate(&pThis->bonds[i]);
     BondCopy(&pThis->bonds[i], &pOther->bonds[i]);
   }
+  if (pOther->pSeparation != NULL)
+  {
+    BondSeparation* pSep = pOther->pSeparation;
+    int n = pSep->atomCount;
+    pThis->pSeparation = (BondSeparation*)malloc(sizeof(BondSeparation));
+    pThis->pSeparation->atomCount = n;
+    pThis->pSeparation->atomNames = (char(*)[MAX_LEN_ATOM_NAME + 1])malloc(sizeof(*pSep->atomNames) * n);
+    memcpy(pThis->pSeparation->atomNames, pSep->atomNames, sizeof(*pSep->atomNames) * n);
+    pThis->pSeparation->hops = (unsigned char*)malloc(sizeof(unsigned char) * n * n);
+    memcpy(pThis->pSeparation->hops, pSep->hops, sizeof(unsigned char) * n * n);
+  }
   return Success;
 }
 
@@ -167,6 +181,7 @@ int BondSetAdd(BondSet* pThis, char* atom1, char* atom2, Type_Bond bondType)
     pThis->bonds = (Bond*)realloc(pThis->bonds, sizeof(Bond) * pThis->count);
     pNewlyAddedBond = &pThis->bonds[pThis->count - 1];
     BondCreate(pNewlyAddedBond);
+    BondSetReleaseSeparation(pThis);
     if (FAILED(BondSetFromName(pNewlyAddedBond, atom1)) || FAILED(BondSetToName(pNewlyAddedBond, atom2)) || FAILED(BondSetType(pNewlyAddedBond, bondType)))
     {
       return ValueError;
@@ -187,6 +202,7 @@ int BondSetRemove(BondSet* pThis, char* atom1, char* atom2)
       BondCopy(pCurBond, &pThis->bonds[pThis->count - 1]);
       BondDestroy(&pThis->bonds[pThis->count - 1]);
       (pThis->count)--;
+      BondSetReleaseSeparation(pThis);
       return Success;
     }
   }
@@ -225,6 +241,123 @@ int BondSetShow(BondSet* pThis)
   return Success;
 }
 
+int BondSetReleaseSeparation(BondSet* pThis)
+{
+  if (pThis->pSeparation != NULL && pThis->separationShared == FALSE)
+  {
+    free(pThis->pSeparation->atomNames);
+    free(pThis->pSeparation->hops);
+    free(pThis->pSeparation);
+  }
+  pThis->pSeparation = NULL;
+  pThis->separationShared = FALSE;
+  return Success;
+}
+
+int BondSetUpdateSeparation(BondSet* pThis)
+{
+  if (pThis->pSeparation != NULL)
+  {
+    return Success;
+  }
+  BondSeparation* pSep = (BondSeparation*)malloc(sizeof(BondSeparation));
+  pSep->atomCount = 0;
+  pSep->atomNames = (char(*)[MAX_LEN_ATOM_NAME + 1])malloc(sizeof(*pSep->atomNames) * (2 * pThis->count + 1));
+  int* bondSlots = (int*)malloc(sizeof(int) * (2 * pThis->count + 1));
+  for (int i = 0; i < 2 * pThis->count; i++)
+  {
+    char* atomName = (i % 2 == 0) ? pThis->bonds[i / 2].atomFromName : pThis->bonds[i / 2].atomToName;
+    int slot = 0;
+    while (slot < pSep->atomCount && strcmp(pSep->atomNames[slot], atomName) != 0) slot++;
+    if (slot == pSep->atomCount)
+    {
+      strcpy(pSep->atomNames[slot], atomName);
+      pSep->atomCount++;
+    }
+    bondSlots[i] = slot;
+  }
+
+  // neighbour lists of every atom slot in compressed form
+  int n = pSep->atomCount;
+  int* offsets = (int*)calloc(n + 1, sizeof(int));
+  int* neighbors = (int*)malloc(sizeof(int) * (2 * pThis->count + 1));
+  for (int i = 0; i < 2 * pThis->count; i++) offsets[bondSlots[i] + 1]++;
+  for (int a = 0; a < n; a++) offsets[a + 1] += offsets[a];
+  int* fill = (int*)malloc(sizeof(int) * (n + 1));
+  memcpy(fill, offsets, sizeof(int) * n);
+  for (int i = 0; i < pThis->count; i++)
+  {
+    neighbors[fill[bondSlots[2 * i]]++] = bondSlots[2 * i + 1];
+    neighbors[fill[bondSlots[2 * i + 1]]++] = bondSlots[2 * i];
+  }
+
+  // every atom has at least one bond, so it is one atom apart from itself as in ResidueIntraBond13Check()
+  pSep->hops = (unsigned char*)malloc(sizeof(unsigned char) * n * n + 1);
+  memset(pSep->hops, 15, sizeof(unsigned char) * n * n);
+  for (int a = 0; a < n; a++)
+  {
+    unsigned char* row = pSep->hops + a * n;
+    row[a] = 13;
+    for (int x = offsets[a]; x < offsets[a + 1]; x++) row[neighbors[x]] = 12;
+    for (int x = offsets[a]; x < offsets[a + 1]; x++)
+    {
+      int b = neighbors[x];
+      for (int y = offsets[b]; y < offsets[b + 1]; y++)
+      {
+        if (row[neighbors[y]] == 15) row[neighbors[y]] = 13;
+      }
+    }
+    for (int b = 0; b < n; b++)
+    {
+      if (row[b] != 13) continue;
+      for (int y = offsets[b]; y < offsets[b + 1]; y++)
+      {
+        if (row[neighbors[y]] == 15) row[neighbors[y]] = 14;
+      }
+    }
+  }
+  free(fill);
+  free(neighbors);
+  free(offsets);
+  free(bondSlots);
+  pThis->separationShared = FALSE;
+  pThis->pSeparation = pSep;
+  return Success;
+}
+
+int BondSetShareSeparation(BondSet* pThis, BondSet* pOwner)
+{
+  BondSetReleaseSeparation(pThis);
+  pThis->pSeparation = pOwner->pSeparation;
+  pThis->separationShared = (pOwner->pSeparation != NULL);
+  return Success;
+}
+
+int BondSetGetAtomSlot(BondSet* pThis, char* atomName)
+{
+  if (pThis->pSeparation == NULL)
+  {
+    // residues are shared by the threads of a parallel design run
+#pragma omp critical (BondSetSeparation)
+    BondSetUpdateSeparation(pThis);
+  }
+  BondSeparation* pSep = pThis->pSeparation;
+  for (int i = 0; i < pSep->atomCount; i++)
+  {
+    if (strcmp(pSep->atomNames[i], atomName) == 0) return i;
+  }
+  return -1;
+}
+
+int BondSetGetSeparation(BondSet* pThis, int slot1, int slot2)
+{
+  if (slot1 < 0 || slot2 < 0)
+  {
+    return 15;
+  }
+  return pThis->pSeparation->hops[slot1 * pThis->pSeparation->atomCount + slot2];
+}
+
 
 //------------Internal Coordinates-----------------------
 
@@ -640,6 +773,7 @@ int ResiTopoSetCreate(ResiTopoSet* pThis)
 {
   pThis->count = 0;
   pThis->topos = NULL;
+  StringIndexCreate(&pThis->nameIndex);
   return Success;
 }
 
@@ -652,6 +786,7 @@ int ResiTopoSetDestroy(ResiTopoSet* pThis)
   free(pThis->topos);
   pThis->topos = NULL;
   pThis->count = 0;
+  StringIndexDestroy(&pThis->nameIndex);
   return Success;
 }
 
@@ -665,45 +800,54 @@ int ResiTopoSetCopy(ResiTopoSet* pThis, ResiTopoSet* pOther)
     ResidueTopologyCreate(&pThis->topos[i]);
     ResidueTopologyCopy(&pThis->topos[i], &pOther->topos[i]);
   }
+  StringIndexCopy(&pThis->nameIndex, &pOther->nameIndex);
   return Success;
 }
 
 int ResiTopoSetGet(ResiTopoSet* pThis, char* resiName, ResidueTopology* pDestTopo)
 {
-  for (int i = 0;i < pThis->count;i++)
+  ResidueTopology* pTopo = NULL;
+  int result = ResiTopoSetFind(pThis, resiName, &pTopo);
+  if (FAILED(result))
   {
-    if (strcmp(ResidueTopologyGetName(&pThis->topos[i]), resiName) == 0)
-    {
-      ResidueTopologyCopy(pDestTopo, &pThis->topos[i]);
-      return Success;
-    }
+    return result;
   }
-  return DataNotExistError;
+  return ResidueTopologyCopy(pDestTopo, pTopo);
+}
+
+// Returns a pointer into the set instead of a copy; the topology is shared
+// and must not be modified or destroyed by the caller
+int ResiTopoSetFind(ResiTopoSet* pThis, char* resiName, ResidueTopology** ppTopo)
+{
+  int index = StringIndexGet(&pThis->nameIndex, resiName);
+  if (index < 0)
+  {
+    *ppTopo = NULL;
+    return DataNotExistError;
+  }
+  *ppTopo = &pThis->topos[index];
+  return Success;
 }
 
 int ResiTopoSetGetTopologyIndex(ResiTopoSet* pThis, char* resiName, int* index)
 {
-  for (int i = 0;i < pThis->count;i++)
+  int found = StringIndexGet(&pThis->nameIndex, resiName);
+  if (found < 0)
   {
-    if (strcmp(ResidueTopologyGetName(&pThis->topos[i]), resiName) == 0)
-    {
-      *index = i;
-      return Success;
-    }
+    return DataNotExistError;
   }
-  return DataNotExistError;
+  *index = found;
+  return Success;
 }
 
 int ResiTopoSetAdd(ResiTopoSet* pThis, ResidueTopology* pNewTopo)
 {
   // If already exist, replace the original
-  for (int i = 0;i < pThis->count;i++)
+  int index = StringIndexGet(&pThis->nameIndex, ResidueTopologyGetName(pNewTopo));
+  if (index >= 0)
   {
-    if (strcmp(ResidueTopologyGetName(&pThis->topos[i]), ResidueTopologyGetName(pNewTopo)) == 0)
-    {
-      ResidueTopologyCopy(&pThis->topos[i], pNewTopo);
-      return Success;
-    }
+    ResidueTopologyCopy(&pThis->topos[index], pNewTopo);
+    return Success;
   }
 
   int newCount = pThis->count + 1;
@@ -711,6 +855,7 @@ int ResiTopoSetAdd(ResiTopoSet* pThis, ResidueTopology* pNewTopo)
   ResidueTopologyCreate(&pThis->topos[newCount - 1]);
   ResidueTopologyCopy(&pThis->topos[newCount - 1], pNewTopo);
   pThis->count = newCount;
+  StringIndexSet(&pThis->nameIndex, ResidueTopologyGetName(pNewTopo), newCount - 1);
   return Success;
 }
 
@@ -737,6 +882,8 @@ int ResiTopoSetAddFromFile(ResiTopoSet* pThis, char* filepath)
       TraceError(errMsg, result);
       return result;
     }
+    // the bond separation table is copied along with the bonds to every residue built from this topology
+    BondSetUpdateSeparation(&newTopo.bonds);
     ResiTopoSetAdd(pThis, &newTopo);
     ResidueTopologyDestroy(&newTopo);
   }
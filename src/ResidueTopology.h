@@ -46,10 +46,21 @@ Type_Bond BondGetType(Bond* pThis);
 int BondSetType(Bond* pThis, Type_Bond newType);
 int BondShow(Bond* pThis);
 
+// bond separation between every two atoms named in a bond set: 12 (bonded), 13 (one atom apart),
+// 14 (two atoms apart) or 15 (further apart or unconnected), stored as an atomCount x atomCount byte matrix
+typedef struct _BondSeparation
+{
+  int atomCount;
+  char (*atomNames)[MAX_LEN_ATOM_NAME + 1];
+  unsigned char* hops;
+} BondSeparation;
+
 typedef struct _BondSet
 {
   int count;
   Bond* bonds;
+  BondSeparation* pSeparation;  // built on demand, dropped whenever the bonds change
+  BOOL separationShared;        // TRUE if pSeparation is borrowed from another bond set
 } BondSet;
 
 int BondSetCreate(BondSet* pThis);
@@ -61,6 +72,11 @@ int BondSetRemove(BondSet* pThis, char* atom1, char* atom2);
 Type_Bond BondSetFind(BondSet* pThis, char* atom1, char* atom2);
 Bond* BondSetGet(BondSet* pThis, int index);
 int BondSetShow(BondSet* pThis);
+int BondSetUpdateSeparation(BondSet* pThis);
+int BondSetReleaseSeparation(BondSet* pThis);
+int BondSetShareSeparation(BondSet* pThis, BondSet* pOwner);
+int BondSetGetAtomSlot(BondSet* pThis, char* atomName);
+int BondSetGetSeparation(BondSet* pThis, int slot1, int slot2);
 
 typedef struct _CharmmIC
 {
@@ -120,12 +136,14 @@ typedef struct _ResiTopoSet
 {
   int count;
   ResidueTopology* topos;
+  StringIndex nameIndex;
 } ResiTopoSet;
 
 int ResiTopoSetCreate(ResiTopoSet* pThis);
 int ResiTopoSetDestroy(ResiTopoSet* pThis);
 int ResiTopoSetCopy(ResiTopoSet* pThis, ResiTopoSet* pOther);
 int ResiTopoSetGet(ResiTopoSet* pThis, char* resiName, ResidueTopology* pDestTopo);
+int ResiTopoSetFind(ResiTopoSet* pThis, char* resiName, ResidueTopology** ppTopo);
 int ResiTopoSetGetTopologyIndex(ResiTopoSet* pThis, char* resiName, int* index);
 int ResiTopoSetAdd(ResiTopoSet* pThis, ResidueTopology* pNewTopo);
 int ResiTopoSetAddFromFile(ResiTopoSet* pThis, char* filepath);
@@ -243,6 +243,7 @@ int RotamerCreate(Rotamer* pRot)
   pRot->selfEnergyBin = 0;
   pRot->dunbrack = 0;
   DoubleArrayCreate(&pRot->Xs, 0);
+  pRot->representativeIndex = -1;
   return Success;
 }
 
@@ -271,8 +272,10 @@ int RotamerCopy(Rotamer* pDest, Rotamer* pSrc)
   pDest->vdwInternal = pSrc->vdwInternal;
   pDest->vdwBackbone = pSrc->vdwBackbone;
   pDest->selfEnergy = pSrc->selfEnergy;
+  pDest->selfEnergyBin = pSrc->selfEnergyBin;
   pDest->dunbrack = pSrc->dunbrack;
   DoubleArrayCopy(&pDest->Xs, &pSrc->Xs);
+  pDest->representativeIndex = pSrc->representativeIndex;
   return Success;
 }
 
@@ -433,6 +436,12 @@ Atom* RotamerGetAtomByName(Rotamer* pThis, char* atomName)
 }
 
 
+Atom* RotamerGetAtomHbDorB(Rotamer* pThis, Atom* pAtom)
+{
+  return AtomArrayGetHbDorB(&pThis->atoms, pAtom);
+}
+
+
 int RotamerFindAtom(Rotamer* pThis, char* atomName, int* index)
 {
   if (AtomArrayGetCount(&pThis->atoms) == 0)
@@ -513,10 +522,61 @@ double RotamerAndResidueSidechainRMSD(Rotamer* pThis, Residue* pOther)
 }
 
 
+// atom and bond arrays released by RotamerExtract() are kept per thread and handed back to the next RotamerRestore(),
+// so that restoring/extracting rotamers in the sampling loops does not go through malloc/free every time
+#define ROTAMER_BUFFER_CACHE_SIZE 16
+
+typedef struct _RotamerBufferCache
+{
+  void* buffers[ROTAMER_BUFFER_CACHE_SIZE];
+  size_t sizes[ROTAMER_BUFFER_CACHE_SIZE];
+  int count;
+} RotamerBufferCache;
+
+static RotamerBufferCache rotamerAtomBufferCache = { {NULL}, {0}, 0 };
+static RotamerBufferCache rotamerBondBufferCache = { {NULL}, {0}, 0 };
+#pragma omp threadprivate(rotamerAtomBufferCache, rotamerBondBufferCache)
+
+
+static void RotamerBufferCacheRelease(RotamerBufferCache* pCache, void* buffer, size_t size)
+{
+  if (buffer == NULL) return;
+  if (size == 0 || pCache->count == ROTAMER_BUFFER_CACHE_SIZE)
+  {
+    free(buffer);
+    return;
+  }
+  pCache->buffers[pCache->count] = buffer;
+  pCache->sizes[pCache->count] = size;
+  pCache->count++;
+}
+
+
+static void* RotamerBufferCacheAcquire(RotamerBufferCache* pCache, size_t size)
+{
+  // take the most recently released buffer that is large enough
+  for (int i = pCache->count - 1; i >= 0; i--)
+  {
+    if (pCache->sizes[i] >= size)
+    {
+      void* buffer = pCache->buffers[i];
+      pCache->count--;
+      pCache->buffers[i] = pCache->buffers[pCache->count];
+      pCache->sizes[i] = pCache->sizes[pCache->count];
+      return buffer;
+    }
+  }
+  return malloc(size);
+}
+
+
 int RotamerExtract(Rotamer* pThis)
 {
-  AtomArrayDestroy(&pThis->atoms);
-  BondSetDestroy(&pThis->bonds);
+  RotamerBufferCacheRelease(&rotamerAtomBufferCache, pThis->atoms.atoms, sizeof(Atom) * pThis->atoms.atomNum);
+  AtomArrayCreate(&pThis->atoms);
+  RotamerBufferCacheRelease(&rotamerBondBufferCache, pThis->bonds.bonds, sizeof(Bond) * pThis->bonds.count);
+  BondSetReleaseSeparation(&pThis->bonds);
+  BondSetCreate(&pThis->bonds);
   return Success;
 }
 
@@ -530,12 +590,22 @@ int RotamerRestore(Rotamer* pThis, RotamerSet* pRotamerSet)
     return Success;
   }
   Rotamer* pRepresentative = NULL;
-  for (int i = 0;i < pRotamerSet->representativeCount;i++)
+  int index = pThis->representativeIndex;
+  if (index >= 0 && index < pRotamerSet->representativeCount &&
+    !strcmp(RotamerGetType(pThis), RotamerGetType(&pRotamerSet->representatives[index])))
   {
-    if (!strcmp(RotamerGetType(pThis), RotamerGetType(&pRotamerSet->representatives[i])))
+    pRepresentative = &pRotamerSet->representatives[index];
+  }
+  else
+  {
+    for (int i = 0;i < pRotamerSet->representativeCount;i++)
     {
-      pRepresentative = &pRotamerSet->representatives[i];
-      break;
+      if (!strcmp(RotamerGetType(pThis), RotamerGetType(&pRotamerSet->representatives[i])))
+      {
+        pRepresentative = &pRotamerSet->representatives[i];
+        pThis->representativeIndex = i;
+        break;
+      }
     }
   }
   if (pRepresentative == NULL)
@@ -546,21 +616,30 @@ int RotamerRestore(Rotamer* pThis, RotamerSet* pRotamerSet)
     TraceError(errMsg, result);
     return result;
   }
-  // Restore atoms and bonds
-  AtomArrayCopy(&pThis->atoms, &pRepresentative->atoms);
-  BondSetCopy(&pThis->bonds, &pRepresentative->bonds);
-  if (AtomArrayGetCount(&pThis->atoms) != XYZArrayGetLength(&pThis->xyzs))
+  if (AtomArrayGetCount(&pRepresentative->atoms) != XYZArrayGetLength(&pThis->xyzs))
   {
     result = ValueError;
     sprintf(errMsg, "In file %s line %d, rotamer's atom count (%d) is not equal to representative rotamer's atom count (%d)",
-      __FILE__, __LINE__, XYZArrayGetLength(&pThis->xyzs), AtomArrayGetCount(&pThis->atoms));
+      __FILE__, __LINE__, XYZArrayGetLength(&pThis->xyzs), AtomArrayGetCount(&pRepresentative->atoms));
     TraceError(errMsg, result);
     return result;
   }
+  // Restore atoms and bonds into recycled buffers
+  RotamerExtract(pThis);
+  int atomCount = AtomArrayGetCount(&pRepresentative->atoms);
+  pThis->atoms.atoms = (Atom*)RotamerBufferCacheAcquire(&rotamerAtomBufferCache, sizeof(Atom) * atomCount);
+  memcpy(pThis->atoms.atoms, pRepresentative->atoms.atoms, sizeof(Atom) * atomCount);
+  pThis->atoms.atomNum = atomCount;
+  int bondCount = BondSetGetCount(&pRepresentative->bonds);
+  pThis->bonds.bonds = (Bond*)RotamerBufferCacheAcquire(&rotamerBondBufferCache, sizeof(Bond) * bondCount);
+  memcpy(pThis->bonds.bonds, pRepresentative->bonds.bonds, sizeof(Bond) * bondCount);
+  pThis->bonds.count = bondCount;
+  // the bond topology is the representative's, so borrow its bond separation table
+  BondSetShareSeparation(&pThis->bonds, &pRepresentative->bonds);
   // Copy atom XYZ from Xyzs
-  for (int i = 0; i < AtomArrayGetCount(&pThis->atoms); i++)
+  for (int i = 0; i < atomCount; i++)
   {
-    AtomArrayGet(&pThis->atoms, i)->xyz = *XYZArrayGet(&pThis->xyzs, i);
+    pThis->atoms.atoms[i].xyz = *XYZArrayGet(&pThis->xyzs, i);
   }
 
   return Success;
@@ -650,14 +729,19 @@ int RotamerOfProteinInitAtomsAndBonds_Charmm22(Rotamer* pThis, Residue* pResi, A
     // else get the coordinate from the crystal structure;
     if (strcmp(pResi->name, "GLY") == 0)
     {
-      ResidueTopology rotamerTopo;
+      ResidueTopology* pRotamerTopo = NULL;
       CharmmIC ic;
-      ResidueTopologyCreate(&rotamerTopo);
+      if (FAILED(ResiTopoSetFind(resiTopos, RotamerGetType(pThis), &pRotamerTopo)))
+      {
+        AtomDestroy(&rotamerAtom);
+        result = DataNotExistError;
+        sprintf(errMsg, "in file %s line %d, cannot find residue topology for %s", __FILE__, __LINE__, RotamerGetType(pThis));
+        TraceError(errMsg, result);
+        return result;
+      }
       CharmmICCreate(&ic);
-      ResiTopoSetGet(resiTopos, RotamerGetType(pThis), &rotamerTopo);
-      ResidueTopologyFindCharmmIC(&rotamerTopo, "CB", &ic);
+      ResidueTopologyFindCharmmIC(pRotamerTopo, "CB", &ic);
       GetFourthAtom(&RotamerGetAtomByName(pThis, "N")->xyz, &RotamerGetAtomByName(pThis, "C")->xyz, &RotamerGetAtomByName(pThis, "CA")->xyz, ic.icParam, &xyz);
-      ResidueTopologyDestroy(&rotamerTopo);
       CharmmICDestroy(&ic);
     }
     else
@@ -693,18 +777,17 @@ int RotamerOfProteinInitAtomsAndBonds_Charmm22(Rotamer* pThis, Residue* pResi, A
   }
 
   // Add the bonds between sidechain atoms in the rotamer
-  ResidueTopology rotTopo;
-  ResidueTopologyCreate(&rotTopo);
-  if (FAILED(ResiTopoSetGet(resiTopos, pThis->type, &rotTopo)))
+  ResidueTopology* pRotTopo = NULL;
+  if (FAILED(ResiTopoSetFind(resiTopos, pThis->type, &pRotTopo)))
   {
     result = DataNotExistError;
     sprintf(errMsg, "in file %s line %d,cannot find residue topology for %s", __FILE__, __LINE__, RotamerGetType(pThis));
     TraceError(errMsg, result);
     return result;
   }
-  for (int i = 0;i < BondSetGetCount(ResidueTopologyGetBonds(&rotTopo));i++)
+  for (int i = 0;i < BondSetGetCount(ResidueTopologyGetBonds(pRotTopo));i++)
   {
-    Bond* pCurBond = BondSetGet(ResidueTopologyGetBonds(&rotTopo), i);
+    Bond* pCurBond = BondSetGet(ResidueTopologyGetBonds(pRotTopo), i);
     char* fromAtomName = BondGetFromName(pCurBond);
     char* toAtomName = BondGetToName(pCurBond);
     Atom* fromAtom = AtomArrayGetByName(&pThis->atoms, fromAtomName);
@@ -721,9 +804,9 @@ int RotamerOfProteinInitAtomsAndBonds_Charmm22(Rotamer* pThis, Residue* pResi, A
   }
 
   // Add the bonds between CB and other atoms
-  for (int i = 0;i < BondSetGetCount(ResidueTopologyGetBonds(&rotTopo));i++)
+  for (int i = 0;i < BondSetGetCount(ResidueTopologyGetBonds(pRotTopo));i++)
   {
-    Bond* pCurBond = BondSetGet(ResidueTopologyGetBonds(&rotTopo), i);
+    Bond* pCurBond = BondSetGet(ResidueTopologyGetBonds(pRotTopo), i);
     char* fromAtomName = BondGetFromName(pCurBond);
     char* toAtomName = BondGetToName(pCurBond);
     Atom* fromAtom = AtomArrayGetByName(&pThis->atoms, fromAtomName);
@@ -754,7 +837,6 @@ int RotamerOfProteinInitAtomsAndBonds_Charmm22(Rotamer* pThis, Residue* pResi, A
   }
 
   XYZArrayResize(&pThis->xyzs, AtomArrayGetCount(&pThis->atoms));
-  ResidueTopologyDestroy(&rotTopo);
   return Success;
 }
 
@@ -823,21 +905,27 @@ int RotamerOfProteinInitAtomsAndBonds_Charmm19(Rotamer* pThis, Residue* pResi, A
       }
       else
       {
-        ResidueTopology nterTopo;
+        ResidueTopology* pNterTopo = NULL;
         CharmmIC charmm;
         StringArray hydrogens;
         StringArrayCreate(&hydrogens);
         StringArrayAppend(&hydrogens, "HT1");
         StringArrayAppend(&hydrogens, "HT2");
         StringArrayAppend(&hydrogens, "HT3");
-        ResidueTopologyCreate(&nterTopo);
-        ResiTopoSetGet(resiTopos, "NTER", &nterTopo);
+        if (FAILED(ResiTopoSetFind(resiTopos, "NTER", &pNterTopo)))
+        {
+          StringArrayDestroy(&hydrogens);
+          AtomDestroy(&rotamerAtom);
+          sprintf(errMsg, "in file %s line %d, cannot find residue topology for NTER", __FILE__, __LINE__);
+          TraceError(errMsg, DataNotExistError);
+          return DataNotExistError;
+        }
         CharmmICCreate(&charmm);
         for (int i = 0; i < StringArrayGetCount(&hydrogens); i++)
         {
           char* atomName = StringArrayGet(&hydrogens, i);
           AtomParamsSetGetAtomParamByName(atomParams, "NTER", atomName, &rotamerAtom);
-          ResidueTopologyFindCharmmIC(&nterTopo, atomName, &charmm);
+          ResidueTopologyFindCharmmIC(pNterTopo, atomName, &charmm);
           GetFourthAtom(&RotamerGetAtomByName(pThis, charmm.atomNames[0])->xyz,
             &RotamerGetAtomByName(pThis, charmm.atomNames[1])->xyz,
             &RotamerGetAtomByName(pThis, charmm.atomNames[2])->xyz,
@@ -848,7 +936,6 @@ int RotamerOfProteinInitAtomsAndBonds_Charmm19(Rotamer* pThis, Residue* pResi, A
         }
         StringArrayDestroy(&hydrogens);
         CharmmICDestroy(&charmm);
-        ResidueTopologyDestroy(&nterTopo);
         AtomParamsSetGetAtomParamByName(atomParams, "NTER", "N", &rotamerAtom);
         AtomCopyParameter(RotamerGetAtomByName(pThis, "N"), &rotamerAtom);
         AtomParamsSetGetAtomParamByName(atomParams, "NTER", "CA", &rotamerAtom);
@@ -859,21 +946,27 @@ int RotamerOfProteinInitAtomsAndBonds_Charmm19(Rotamer* pThis, Residue* pResi, A
     {//Residue is Proline
       if (strcmp(RotamerGetType(pThis), "GLY") == 0)
       {//Rotamer is Glycine
-        ResidueTopology nterTopo;
+        ResidueTopology* pNterTopo = NULL;
         CharmmIC charmm;
         StringArray hydrogens;
         StringArrayCreate(&hydrogens);
         StringArrayAppend(&hydrogens, "HT1");
         StringArrayAppend(&hydrogens, "HT2");
         StringArrayAppend(&hydrogens, "HT3");
-        ResidueTopologyCreate(&nterTopo);
-        ResiTopoSetGet(resiTopos, "GLYP", &nterTopo);
+        if (FAILED(ResiTopoSetFind(resiTopos, "GLYP", &pNterTopo)))
+        {
+          StringArrayDestroy(&hydrogens);
+          AtomDestroy(&rotamerAtom);
+          sprintf(errMsg, "in file %s line %d, cannot find residue topology for GLYP", __FILE__, __LINE__);
+          TraceError(errMsg, DataNotExistError);
+          return DataNotExistError;
+        }
         CharmmICCreate(&charmm);
         for (int i = 0; i < StringArrayGetCount(&hydrogens); i++)
         {
           char* atomName = StringArrayGet(&hydrogens, i);
           AtomParamsSetGetAtomParamByName(atomParams, "GLYP", atomName, &rotamerAtom);
-          ResidueTopologyFindCharmmIC(&nterTopo, atomName, &charmm);
+          ResidueTopologyFindCharmmIC(pNterTopo, atomName, &charmm);
           GetFourthAtom(&RotamerGetAtomByName(pThis, charmm.atomNames[0])->xyz,
             &RotamerGetAtomByName(pThis, charmm.atomNames[1])->xyz,
             &RotamerGetAtomByName(pThis, charmm.atomNames[2])->xyz,
@@ -884,7 +977,6 @@ int RotamerOfProteinInitAtomsAndBonds_Charmm19(Rotamer* pThis, Residue* pResi, A
         }
         StringArrayDestroy(&hydrogens);
         CharmmICDestroy(&charmm);
-        ResidueTopologyDestroy(&nterTopo);
         AtomParamsSetGetAtomParamByName(atomParams, "GLYP", "N", &rotamerAtom);
         AtomCopyParameter(RotamerGetAtomByName(pThis, "N"), &rotamerAtom);
         AtomParamsSetGetAtomParamByName(atomParams, "GLYP", "CA", &rotamerAtom);
@@ -901,21 +993,27 @@ int RotamerOfProteinInitAtomsAndBonds_Charmm19(Rotamer* pThis, Residue* pResi, A
       }
       else
       {//Rotamer is in any other type
-        ResidueTopology nterTopo;
+        ResidueTopology* pNterTopo = NULL;
         CharmmIC charmm;
         StringArray hydrogens;
         StringArrayCreate(&hydrogens);
         StringArrayAppend(&hydrogens, "HT1");
         StringArrayAppend(&hydrogens, "HT2");
         StringArrayAppend(&hydrogens, "HT3");
-        ResidueTopologyCreate(&nterTopo);
-        ResiTopoSetGet(resiTopos, "NTER", &nterTopo);
+        if (FAILED(ResiTopoSetFind(resiTopos, "NTER", &pNterTopo)))
+        {
+          StringArrayDestroy(&hydrogens);
+          AtomDestroy(&rotamerAtom);
+          sprintf(errMsg, "in file %s line %d, cannot find residue topology for NTER", __FILE__, __LINE__);
+          TraceError(errMsg, DataNotExistError);
+          return DataNotExistError;
+        }
         CharmmICCreate(&charmm);
         for (int i = 0; i < StringArrayGetCount(&hydrogens); i++)
         {
           char* atomName = StringArrayGet(&hydrogens, i);
           AtomParamsSetGetAtomParamByName(atomParams, "NTER", atomName, &rotamerAtom);
-          ResidueTopologyFindCharmmIC(&nterTopo, atomName, &charmm);
+          ResidueTopologyFindCharmmIC(pNterTopo, atomName, &charmm);
           GetFourthAtom(&RotamerGetAtomByName(pThis, charmm.atomNames[0])->xyz,
             &RotamerGetAtomByName(pThis, charmm.atomNames[1])->xyz,
             &RotamerGetAtomByName(pThis, charmm.atomNames[2])->xyz,
@@ -926,7 +1024,6 @@ int RotamerOfProteinInitAtomsAndBonds_Charmm19(Rotamer* pThis, Residue* pResi, A
         }
         StringArrayDestroy(&hydrogens);
         CharmmICDestroy(&charmm);
-        ResidueTopologyDestroy(&nterTopo);
         AtomParamsSetGetAtomParamByName(atomParams, "NTER", "N", &rotamerAtom);
         AtomCopyParameter(RotamerGetAtomByName(pThis, "N"), &rotamerAtom);
         AtomParamsSetGetAtomParamByName(atomParams, "NTER", "CA", &rotamerAtom);
@@ -937,21 +1034,27 @@ int RotamerOfProteinInitAtomsAndBonds_Charmm19(Rotamer* pThis, Residue* pResi, A
     {//Residue is in other type (not Gly and Pro)
       if (strcmp(RotamerGetType(pThis), "GLY") == 0)
       {
-        ResidueTopology nterTopo;
+        ResidueTopology* pNterTopo = NULL;
         CharmmIC charmm;
         StringArray hydrogens;
         StringArrayCreate(&hydrogens);
         StringArrayAppend(&hydrogens, "HT1");
         StringArrayAppend(&hydrogens, "HT2");
         StringArrayAppend(&hydrogens, "HT3");
-        ResidueTopologyCreate(&nterTopo);
-        ResiTopoSetGet(resiTopos, "GLYP", &nterTopo);
+        if (FAILED(ResiTopoSetFind(resiTopos, "GLYP", &pNterTopo)))
+        {
+          StringArrayDestroy(&hydrogens);
+          AtomDestroy(&rotamerAtom);
+          sprintf(errMsg, "in file %s line %d, cannot find residue topology for GLYP", __FILE__, __LINE__);
+          TraceError(errMsg, DataNotExistError);
+          return DataNotExistError;
+        }
         CharmmICCreate(&charmm);
         for (int i = 0; i < StringArrayGetCount(&hydrogens); i++)
         {
           char* atomName = StringArrayGet(&hydrogens, i);
           AtomParamsSetGetAtomParamByName(atomParams, "GLYP", atomName, &rotamerAtom);
-          ResidueTopologyFindCharmmIC(&nterTopo, atomName, &charmm);
+          ResidueTopologyFindCharmmIC(pNterTopo, atomName, &charmm);
           GetFourthAtom(&RotamerGetAtomByName(pThis, charmm.atomNames[0])->xyz,
             &RotamerGetAtomByName(pThis, charmm.atomNames[1])->xyz,
             &RotamerGetAtomByName(pThis, charmm.atomNames[2])->xyz,
@@ -962,7 +1065,6 @@ int RotamerOfProteinInitAtomsAndBonds_Charmm19(Rotamer* pThis, Residue* pResi, A
         }
         StringArrayDestroy(&hydrogens);
         CharmmICDestroy(&charmm);
-        ResidueTopologyDestroy(&nterTopo);
         AtomParamsSetGetAtomParamByName(atomParams, "GLYP", "N", &rotamerAtom);
         AtomCopyParameter(RotamerGetAtomByName(pThis, "N"), &rotamerAtom);
         AtomParamsSetGetAtomParamByName(atomParams, "GLYP", "CA", &rotamerAtom);
@@ -1090,16 +1192,20 @@ int RotamerOfProteinInitAtomsAndBonds_Charmm19(Rotamer* pThis, Residue* pResi, A
   {
     if (strcmp(RotamerGetType(pThis), "GLY") != 0)
     {
-      ResidueTopology rotamerTopo;
+      ResidueTopology* pRotamerTopo = NULL;
       CharmmIC ic;
 
-      ResidueTopologyCreate(&rotamerTopo);
+      if (FAILED(ResiTopoSetFind(resiTopos, RotamerGetType(pThis), &pRotamerTopo)))
+      {
+        result = DataNotExistError;
+        sprintf(errMsg, "in file %s line %d, cannot find residue topology for %s", __FILE__, __LINE__, RotamerGetType(pThis));
+        TraceError(errMsg, result);
+        return result;
+      }
       CharmmICCreate(&ic);
-      ResiTopoSetGet(resiTopos, RotamerGetType(pThis), &rotamerTopo);
-      ResidueTopologyFindCharmmIC(&rotamerTopo, "CB", &ic);
+      ResidueTopologyFindCharmmIC(pRotamerTopo, "CB", &ic);
       GetFourthAtom(&RotamerGetAtomByName(pThis, "N")->xyz, &RotamerGetAtomByName(pThis, "C")->xyz, &RotamerGetAtomByName(pThis, "CA")->xyz, ic.icParam, &AtomArrayGetByName(&pThis->atoms, "CB")->xyz);
       AtomArrayGetByName(&pThis->atoms, "CB")->isXyzValid = TRUE;
-      ResidueTopologyDestroy(&rotamerTopo);
       CharmmICDestroy(&ic);
     }
     else
@@ -1140,9 +1246,8 @@ int RotamerOfProteinInitAtomsAndBonds_Charmm19(Rotamer* pThis, Residue* pResi, A
   }
 
   // Add the bonds between sidechain atoms in the rotamer residue
-  ResidueTopology rotTopo;
-  ResidueTopologyCreate(&rotTopo);
-  if (FAILED(ResiTopoSetGet(resiTopos, pThis->type, &rotTopo)))
+  ResidueTopology* pRotTopo = NULL;
+  if (FAILED(ResiTopoSetFind(resiTopos, pThis->type, &pRotTopo)))
   {
     // Cannot Find this type of rotamer in Residue Topologies
     result = DataNotExistError;
@@ -1150,9 +1255,9 @@ int RotamerOfProteinInitAtomsAndBonds_Charmm19(Rotamer* pThis, Residue* pResi, A
     TraceError(errMsg, result);
     return result;
   }
-  for (int i = 0;i < BondSetGetCount(ResidueTopologyGetBonds(&rotTopo));i++)
+  for (int i = 0;i < BondSetGetCount(ResidueTopologyGetBonds(pRotTopo));i++)
   {
-    Bond* pCurBond = BondSetGet(ResidueTopologyGetBonds(&rotTopo), i);
+    Bond* pCurBond = BondSetGet(ResidueTopologyGetBonds(pRotTopo), i);
     char* fromAtomName = BondGetFromName(pCurBond);
     char* toAtomName = BondGetToName(pCurBond);
     Atom* fromAtom = AtomArrayGetByName(&pThis->atoms, fromAtomName);
@@ -1169,9 +1274,9 @@ int RotamerOfProteinInitAtomsAndBonds_Charmm19(Rotamer* pThis, Residue* pResi, A
   }
 
   // Add the bonds between CB and other atoms
-  for (int i = 0;i < BondSetGetCount(ResidueTopologyGetBonds(&rotTopo));i++)
+  for (int i = 0;i < BondSetGetCount(ResidueTopologyGetBonds(pRotTopo));i++)
   {
-    Bond* pCurBond = BondSetGet(ResidueTopologyGetBonds(&rotTopo), i);
+    Bond* pCurBond = BondSetGet(ResidueTopologyGetBonds(pRotTopo), i);
     char* fromAtomName = BondGetFromName(pCurBond);
     char* toAtomName = BondGetToName(pCurBond);
     Atom* fromAtom = AtomArrayGetByName(&pThis->atoms, fromAtomName);
@@ -1229,7 +1334,6 @@ int RotamerOfProteinInitAtomsAndBonds_Charmm19(Rotamer* pThis, Residue* pResi, A
   }
 
   XYZArrayResize(&pThis->xyzs, AtomArrayGetCount(&pThis->atoms));
-  ResidueTopologyDestroy(&rotTopo);
   return Success;
 }
 
@@ -1274,9 +1378,8 @@ int RotamerOfProteinPatch(Rotamer* pThis, char* patchType, AtomParamsSet* atomPa
 int RotamerOfProteinCalcXYZ(Rotamer* pThis, Residue* pResi, char* patchName, DoubleArray* torsions, ResiTopoSet* resiTopos)
 {
   char errMsg[MAX_LEN_ERR_MSG + 1];
-  ResidueTopology rotamerTopology;
-  ResidueTopologyCreate(&rotamerTopology);
-  int result = ResiTopoSetGet(resiTopos, pThis->type, &rotamerTopology);
+  ResidueTopology* pRotamerTopology = NULL;
+  int result = ResiTopoSetFind(resiTopos, pThis->type, &pRotamerTopology);
   if (FAILED(result))
   {
     sprintf(errMsg, "in file %s line %d, cannot find the Topology for rotamer %s", __FILE__, __LINE__, RotamerGetType(pThis));
@@ -1294,11 +1397,11 @@ int RotamerOfProteinCalcXYZ(Rotamer* pThis, Residue* pResi, char* patchName, Dou
     CharmmIC icOfCurrentTorsion;
     CharmmICCreate(&icOfCurrentTorsion);
     BOOL icFound = FALSE;
-    for (int icIndex = 0; icIndex < ResidueTopologyGetCharmmICCount(&rotamerTopology); icIndex++)
+    for (int icIndex = 0; icIndex < ResidueTopologyGetCharmmICCount(pRotamerTopology); icIndex++)
     {
       Type_ProteinAtomOrder atomBOrder;
       Type_ProteinAtomOrder atomCOrder;
-      ResidueTopologyGetCharmmIC(&rotamerTopology, icIndex, &icOfCurrentTorsion);
+      ResidueTopologyGetCharmmIC(pRotamerTopology, icIndex, &icOfCurrentTorsion);
       atomBOrder = Type_ProteinAtomOrder_JudgedByAtomName(CharmmICGetAtomB(&icOfCurrentTorsion));
       atomCOrder = Type_ProteinAtomOrder_JudgedByAtomName(CharmmICGetAtomC(&icOfCurrentTorsion));
       if (desiredAtomBOrder == atomBOrder && desiredAtomCOrder == atomCOrder)
@@ -1396,7 +1499,6 @@ int RotamerOfProteinCalcXYZ(Rotamer* pThis, Residue* pResi, char* patchName, Dou
     XYZArraySet(&pThis->xyzs, i, &(AtomArrayGet(&pThis->atoms, i)->xyz));
   }
 
-  ResidueTopologyDestroy(&rotamerTopology);
   return Success;
 }
 
@@ -1614,13 +1716,18 @@ int RotamerSetAdd(RotamerSet* pThis, Rotamer* pNewRotamer)
   }
   RotamerCopy(&pThis->rotamers[pThis->count - 1], pNewRotamer);
 
-  if (RotamerSetGetRepresentative(pThis, pNewRotamer->type) == NULL)
+  Rotamer* pRepresentative = RotamerSetGetRepresentative(pThis, pNewRotamer->type);
+  if (pRepresentative == NULL)
   {
     (pThis->representativeCount)++;
     pThis->representatives = (Rotamer*)realloc(pThis->representatives, sizeof(Rotamer) * pThis->representativeCount);
     RotamerCreate(&pThis->representatives[pThis->representativeCount - 1]);
     RotamerCopy(&pThis->representatives[pThis->representativeCount - 1], pNewRotamer);
+    pRepresentative = &pThis->representatives[pThis->representativeCount - 1];
+    AtomArrayResolveHbDorB(&pRepresentative->atoms);
+    BondSetUpdateSeparation(&pRepresentative->bonds);
   }
+  pThis->rotamers[pThis->count - 1].representativeIndex = (int)(pRepresentative - pThis->representatives);
 
   return Success;
 }
@@ -2104,9 +2211,13 @@ int ResidueCalcSidechainTorsion(Residue* pThis, ResiTopoSet* pResiTopos)
   else if (!strcmp(resName, "TYR")) { torsionCount = 2; }
   else if (!strcmp(resName, "VAL")) { torsionCount = 1; }
 
-  ResidueTopology resiTop;
-  ResidueTopologyCreate(&resiTop);
-  ResiTopoSetGet(pResiTopos, resName, &resiTop);
+  ResidueTopology* pResiTop = NULL;
+  if (torsionCount > 0 && FAILED(ResiTopoSetFind(pResiTopos, resName, &pResiTop)))
+  {
+    sprintf(errMsg, "in file %s line %d, cannot find residue topology for %s", __FILE__, __LINE__, resName);
+    TraceError(errMsg, DataNotExistError);
+    return DataNotExistError;
+  }
   for (int torsionIndex = 0;torsionIndex < torsionCount;torsionIndex++)
   {
     Type_ProteinAtomOrder desiredAtomBOrder = Type_ProteinAtomOrder_FromInt(torsionIndex);
@@ -2114,11 +2225,11 @@ int ResidueCalcSidechainTorsion(Residue* pThis, ResiTopoSet* pResiTopos)
     CharmmIC icOfCurrentTorsion;
     CharmmICCreate(&icOfCurrentTorsion);
     BOOL icFound = FALSE;
-    for (int icIndex = 0; icIndex < ResidueTopologyGetCharmmICCount(&resiTop); icIndex++)
+    for (int icIndex = 0; icIndex < ResidueTopologyGetCharmmICCount(pResiTop); icIndex++)
     {
       Type_ProteinAtomOrder atomBOrder;
       Type_ProteinAtomOrder atomCOrder;
-      ResidueTopologyGetCharmmIC(&resiTop, icIndex, &icOfCurrentTorsion);
+      ResidueTopologyGetCharmmIC(pResiTop, icIndex, &icOfCurrentTorsion);
       atomBOrder = Type_ProteinAtomOrder_JudgedByAtomName(CharmmICGetAtomB(&icOfCurrentTorsion));
       atomCOrder = Type_ProteinAtomOrder_JudgedByAtomName(CharmmICGetAtomC(&icOfCurrentTorsion));
       if (desiredAtomBOrder == atomBOrder && desiredAtomCOrder == atomCOrder)
@@ -2145,7 +2256,6 @@ int ResidueCalcSidechainTorsion(Residue* pThis, ResiTopoSet* pResiTopos)
 
     CharmmICDestroy(&icOfCurrentTorsion);
   }
-  ResidueTopologyDestroy(&resiTop);
   return Success;
 }
 
@@ -2404,3 +2514,53 @@ int BBdepRotamerLibCreate2(BBdepRotamerLib* pRotLib, char* binlibfile)
 }
 
 
+// the bounding sphere is computed from the stored coordinates, so the rotamer does not need to be restored
+int RotamerGetBoundingSphere(Rotamer* pRotamer, XYZ* pCenter, double* radius)
+{
+  pCenter->X = pCenter->Y = pCenter->Z = 0;
+  *radius = -1;
+  int count = XYZArrayGetLength(&pRotamer->xyzs);
+  if (count == 0) return Success;
+  for (int i = 0; i < count; i++)
+  {
+    XYZAdd(pCenter, XYZArrayGet(&pRotamer->xyzs, i));
+  }
+  XYZScale(pCenter, 1.0 / count);
+  *radius = 0;
+  for (int i = 0; i < count; i++)
+  {
+    double dist = XYZDistance(pCenter, XYZArrayGet(&pRotamer->xyzs, i));
+    if (dist > *radius) *radius = dist;
+  }
+  return Success;
+}
+
+
+int RotamerSetGetBoundingSphere(RotamerSet* pRotSet, XYZ* pCenter, double* radius)
+{
+  pCenter->X = pCenter->Y = pCenter->Z = 0;
+  *radius = -1;
+  int count = 0;
+  for (int i = 0; i < RotamerSetGetCount(pRotSet); i++)
+  {
+    XYZArray* pXyzs = &RotamerSetGet(pRotSet, i)->xyzs;
+    for (int j = 0; j < XYZArrayGetLength(pXyzs); j++)
+    {
+      XYZAdd(pCenter, XYZArrayGet(pXyzs, j));
+      count++;
+    }
+  }
+  if (count == 0) return Success;
+  XYZScale(pCenter, 1.0 / count);
+  *radius = 0;
+  for (int i = 0; i < RotamerSetGetCount(pRotSet); i++)
+  {
+    XYZArray* pXyzs = &RotamerSetGet(pRotSet, i)->xyzs;
+    for (int j = 0; j < XYZArrayGetLength(pXyzs); j++)
+    {
+      double dist = XYZDistance(pCenter, XYZArrayGet(pXyzs, j));
+      if (dist > *radius) *radius = dist;
+    }
+  }
+  return Success;
+}
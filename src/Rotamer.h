@@ -49,6 +49,7 @@ typedef struct _Rotamer
   double selfEnergyBin;
   double dunbrack;
   DoubleArray Xs; //side-chain torsions
+  int representativeIndex; // index of the same-type representative in the owning RotamerSet, -1 if unknown
 } Rotamer;
 
 int RotamerCreate(Rotamer* pThis);
@@ -72,6 +73,7 @@ BOOL RotamerAndResidueInSameType(Rotamer* pThis, Residue* pOther);
 int RotamerGetAtomCount(Rotamer* pThis);
 Atom* RotamerGetAtom(Rotamer* pThis, int index);
 Atom* RotamerGetAtomByName(Rotamer* pThis, char* atomName);
+Atom* RotamerGetAtomHbDorB(Rotamer* pThis, Atom* pAtom);
 int RotamerFindAtom(Rotamer* pThis, char* atomName, int* index);
 int RotamerAddAtoms(Rotamer* pThis, AtomArray* pNewAtoms);
 BondSet* RotamerGetBonds(Rotamer* pThis);
@@ -129,6 +131,8 @@ int RotamerRestore(Rotamer* pThis, RotamerSet* pRotamerSet);
 int RotamerSetGetRepresentativeCount(RotamerSet* pThis);
 Rotamer* RotamerSetGetRepresentativeByIndex(RotamerSet* pThis, int index);
 int RotamerShowBondInformation(Rotamer* pThis);
+int RotamerGetBoundingSphere(Rotamer* pThis, XYZ* pCenter, double* radius);
+int RotamerSetGetBoundingSphere(RotamerSet* pThis, XYZ* pCenter, double* radius);
 
 
 typedef struct _RotLibPhiPsi
@@ -2022,9 +2022,14 @@ BOOL IsNativeRotamerInBBdepRotLib(Structure* pThis, int chainIndex, int resiInde
 
     DoubleArray xangles;
     DoubleArrayCreate(&xangles, 0);
-    ResidueTopology resiTop;
-    ResidueTopologyCreate(&resiTop);
-    ResiTopoSetGet(pResiTopos, resname, &resiTop);
+    ResidueTopology* pResiTop = NULL;
+    if (torsionCount > 0 && FAILED(ResiTopoSetFind(pResiTopos, resname, &pResiTop)))
+    {
+      sprintf(errMsg, "in file %s line %d, cannot find residue topology for %s", __FILE__, __LINE__, resname);
+      TraceError(errMsg, DataNotExistError);
+      DoubleArrayDestroy(&xangles);
+      return DataNotExistError;
+    }
     for (int torsionIndex = 0;torsionIndex < torsionCount;torsionIndex++)
     {
       Type_ProteinAtomOrder desiredAtomBOrder = Type_ProteinAtomOrder_FromInt(torsionIndex);
@@ -2032,11 +2037,11 @@ BOOL IsNativeRotamerInBBdepRotLib(Structure* pThis, int chainIndex, int resiInde
       CharmmIC icOfCurrentTorsion;
       CharmmICCreate(&icOfCurrentTorsion);
       BOOL icFound = FALSE;
-      for (int icIndex = 0; icIndex < ResidueTopologyGetCharmmICCount(&resiTop); icIndex++)
+      for (int icIndex = 0; icIndex < ResidueTopologyGetCharmmICCount(pResiTop); icIndex++)
       {
         Type_ProteinAtomOrder atomBOrder;
         Type_ProteinAtomOrder atomCOrder;
-        ResidueTopologyGetCharmmIC(&resiTop, icIndex, &icOfCurrentTorsion);
+        ResidueTopologyGetCharmmIC(pResiTop, icIndex, &icOfCurrentTorsion);
         atomBOrder = Type_ProteinAtomOrder_JudgedByAtomName(CharmmICGetAtomB(&icOfCurrentTorsion));
         atomCOrder = Type_ProteinAtomOrder_JudgedByAtomName(CharmmICGetAtomC(&icOfCurrentTorsion));
         if (desiredAtomBOrder == atomBOrder && desiredAtomCOrder == atomCOrder)
@@ -2063,7 +2068,6 @@ BOOL IsNativeRotamerInBBdepRotLib(Structure* pThis, int chainIndex, int resiInde
 
       CharmmICDestroy(&icOfCurrentTorsion);
     }
-    ResidueTopologyDestroy(&resiTop);
 
     //step2: get the phi&psi angles for the current residue
     int binindex = ((int)(pDestResidue->phipsi[0] + 180) / 10) * 36 + (int)(pDestResidue->phipsi[1] + 180) / 10;
@@ -2173,9 +2177,14 @@ BOOL IsNativeRotamerInBBindRotLib(Structure* pThis, int chainIndex, int resiInde
 
     DoubleArray xangles;
     DoubleArrayCreate(&xangles, 0);
-    ResidueTopology resiTop;
-    ResidueTopologyCreate(&resiTop);
-    ResiTopoSetGet(pResiTopos, resname, &resiTop);
+    ResidueTopology* pResiTop = NULL;
+    if (torsionCount > 0 && FAILED(ResiTopoSetFind(pResiTopos, resname, &pResiTop)))
+    {
+      sprintf(errMsg, "in file %s line %d, cannot find residue topology for %s", __FILE__, __LINE__, resname);
+      TraceError(errMsg, DataNotExistError);
+      DoubleArrayDestroy(&xangles);
+      return DataNotExistError;
+    }
     for (int torsionIndex = 0;torsionIndex < torsionCount;torsionIndex++)
     {
       Type_ProteinAtomOrder desiredAtomBOrder = Type_ProteinAtomOrder_FromInt(torsionIndex);
@@ -2183,11 +2192,11 @@ BOOL IsNativeRotamerInBBindRotLib(Structure* pThis, int chainIndex, int resiInde
       CharmmIC icOfCurrentTorsion;
       CharmmICCreate(&icOfCurrentTorsion);
       BOOL icFound = FALSE;
-      for (int icIndex = 0; icIndex < ResidueTopologyGetCharmmICCount(&resiTop); icIndex++)
+      for (int icIndex = 0; icIndex < ResidueTopologyGetCharmmICCount(pResiTop); icIndex++)
       {
         Type_ProteinAtomOrder atomBOrder;
         Type_ProteinAtomOrder atomCOrder;
-        ResidueTopologyGetCharmmIC(&resiTop, icIndex, &icOfCurrentTorsion);
+        ResidueTopologyGetCharmmIC(pResiTop, icIndex, &icOfCurrentTorsion);
         atomBOrder = Type_ProteinAtomOrder_JudgedByAtomName(CharmmICGetAtomB(&icOfCurrentTorsion));
         atomCOrder = Type_ProteinAtomOrder_JudgedByAtomName(CharmmICGetAtomC(&icOfCurrentTorsion));
         if (desiredAtomBOrder == atomBOrder && desiredAtomCOrder == atomCOrder)
@@ -2214,7 +2223,6 @@ BOOL IsNativeRotamerInBBindRotLib(Structure* pThis, int chainIndex, int resiInde
 
       CharmmICDestroy(&icOfCurrentTorsion);
     }
-    ResidueTopologyDestroy(&resiTop);
 
 
     //step2: check the torsions in rotamer library
@@ -2468,6 +2476,7 @@ int ProteinSiteBuildNativeRotamer(Structure* pThis, int chnNdx, int resNdx, Resi
 
 int ProteinSiteBuildFlippedNativeRotamer(Structure* pStructure, int chainIndex, int resiIndex, ResiTopoSet* pResiTopos)
 {
+  char errMsg[MAX_LEN_ERR_MSG + 1];
   Chain* pChain = StructureGetChain(pStructure, chainIndex);
   Residue* pResidue = ChainGetResidue(pChain, resiIndex);
   if (pChain->type == Type_Chain_Protein)
@@ -2499,12 +2508,18 @@ int ProteinSiteBuildFlippedNativeRotamer(Structure* pStructure, int chainIndex,
         RotamerGetAtom(&tempRotamer, index2)->xyz = tempXYZ1;
         XYZArraySet(&tempRotamer.xyzs, index1, &tempXYZ2);
         XYZArraySet(&tempRotamer.xyzs, index2, &tempXYZ1);
-        ResidueTopology resiTopo;
+        ResidueTopology* pResiTopo = NULL;
         CharmmIC ic;
-        ResidueTopologyCreate(&resiTopo);
         CharmmICCreate(&ic);
-        ResiTopoSetGet(pResiTopos, "ASN", &resiTopo);
-        ResidueTopologyFindCharmmIC(&resiTopo, "HD21", &ic);
+        if (FAILED(ResiTopoSetFind(pResiTopos, "ASN", &pResiTopo)))
+        {
+          sprintf(errMsg, "in file %s line %d, cannot find residue topology for ASN", __FILE__, __LINE__);
+          TraceError(errMsg, DataNotExistError);
+          CharmmICDestroy(&ic);
+          RotamerDestroy(&tempRotamer);
+          return DataNotExistError;
+        }
+        ResidueTopologyFindCharmmIC(pResiTopo, "HD21", &ic);
         GetFourthAtom(&RotamerGetAtomByName(&tempRotamer, CharmmICGetAtomA(&ic))->xyz,
           &RotamerGetAtomByName(&tempRotamer, CharmmICGetAtomB(&ic))->xyz,
           &RotamerGetAtomByName(&tempRotamer, CharmmICGetAtomC(&ic))->xyz,
@@ -2513,7 +2528,7 @@ int ProteinSiteBuildFlippedNativeRotamer(Structure* pStructure, int chainIndex,
         RotamerFindAtom(&tempRotamer, "HD21", &index1);
         RotamerGetAtom(&tempRotamer, index1)->xyz = tempXYZ1;
         XYZArraySet(&tempRotamer.xyzs, index1, &tempXYZ1);
-        ResidueTopologyFindCharmmIC(&resiTopo, "HD22", &ic);
+        ResidueTopologyFindCharmmIC(pResiTopo, "HD22", &ic);
         GetFourthAtom(&RotamerGetAtomByName(&tempRotamer, CharmmICGetAtomA(&ic))->xyz,
           &RotamerGetAtomByName(&tempRotamer, CharmmICGetAtomB(&ic))->xyz,
           &RotamerGetAtomByName(&tempRotamer, CharmmICGetAtomC(&ic))->xyz,
@@ -2522,7 +2537,6 @@ int ProteinSiteBuildFlippedNativeRotamer(Structure* pStructure, int chainIndex,
         RotamerFindAtom(&tempRotamer, "HD22", &index1);
         RotamerGetAtom(&tempRotamer, index1)->xyz = tempXYZ1;
         XYZArraySet(&tempRotamer.xyzs, index1, &tempXYZ1);
-        ResidueTopologyDestroy(&resiTopo);
         CharmmICDestroy(&ic);
       }
       else if (strcmp(RotamerGetType(pRotamer), "GLN") == 0)
@@ -2536,12 +2550,18 @@ int ProteinSiteBuildFlippedNativeRotamer(Structure* pStructure, int chainIndex,
         RotamerGetAtom(&tempRotamer, index2)->xyz = tempXYZ1;
         XYZArraySet(&tempRotamer.xyzs, index1, &tempXYZ2);
         XYZArraySet(&tempRotamer.xyzs, index2, &tempXYZ1);
-        ResidueTopology resiTopo;
+        ResidueTopology* pResiTopo = NULL;
         CharmmIC ic;
-        ResidueTopologyCreate(&resiTopo);
         CharmmICCreate(&ic);
-        ResiTopoSetGet(pResiTopos, "GLN", &resiTopo);
-        ResidueTopologyFindCharmmIC(&resiTopo, "HE21", &ic);
+        if (FAILED(ResiTopoSetFind(pResiTopos, "GLN", &pResiTopo)))
+        {
+          sprintf(errMsg, "in file %s line %d, cannot find residue topology for GLN", __FILE__, __LINE__);
+          TraceError(errMsg, DataNotExistError);
+          CharmmICDestroy(&ic);
+          RotamerDestroy(&tempRotamer);
+          return DataNotExistError;
+        }
+        ResidueTopologyFindCharmmIC(pResiTopo, "HE21", &ic);
         GetFourthAtom(&RotamerGetAtomByName(&tempRotamer, CharmmICGetAtomA(&ic))->xyz,
           &RotamerGetAtomByName(&tempRotamer, CharmmICGetAtomB(&ic))->xyz,
           &RotamerGetAtomByName(&tempRotamer, CharmmICGetAtomC(&ic))->xyz,
@@ -2550,7 +2570,7 @@ int ProteinSiteBuildFlippedNativeRotamer(Structure* pStructure, int chainIndex,
         RotamerFindAtom(&tempRotamer, "HE21", &index1);
         RotamerGetAtom(&tempRotamer, index1)->xyz = tempXYZ1;
         XYZArraySet(&tempRotamer.xyzs, index1, &tempXYZ1);
-        ResidueTopologyFindCharmmIC(&resiTopo, "HE22", &ic);
+        ResidueTopologyFindCharmmIC(pResiTopo, "HE22", &ic);
         GetFourthAtom(&RotamerGetAtomByName(&tempRotamer, CharmmICGetAtomA(&ic))->xyz,
           &RotamerGetAtomByName(&tempRotamer, CharmmICGetAtomB(&ic))->xyz,
           &RotamerGetAtomByName(&tempRotamer, CharmmICGetAtomC(&ic))->xyz,
@@ -2559,7 +2579,6 @@ int ProteinSiteBuildFlippedNativeRotamer(Structure* pStructure, int chainIndex,
         RotamerFindAtom(&tempRotamer, "HE22", &index1);
         RotamerGetAtom(&tempRotamer, index1)->xyz = tempXYZ1;
         XYZArraySet(&tempRotamer.xyzs, index1, &tempXYZ1);
-        ResidueTopologyDestroy(&resiTopo);
         CharmmICDestroy(&ic);
       }
       else if (strcmp(RotamerGetType(pRotamer), "HSD") == 0)
@@ -2581,12 +2600,18 @@ int ProteinSiteBuildFlippedNativeRotamer(Structure* pStructure, int chainIndex,
         RotamerGetAtom(&tempRotamer, index2)->xyz = tempXYZ1;
         XYZArraySet(&tempRotamer.xyzs, index1, &tempXYZ2);
         XYZArraySet(&tempRotamer.xyzs, index2, &tempXYZ1);
-        ResidueTopology resiTopo;
+        ResidueTopology* pResiTopo = NULL;
         CharmmIC ic;
-        ResidueTopologyCreate(&resiTopo);
         CharmmICCreate(&ic);
-        ResiTopoSetGet(pResiTopos, "HSD", &resiTopo);
-        ResidueTopologyFindCharmmIC(&resiTopo, "HD1", &ic);
+        if (FAILED(ResiTopoSetFind(pResiTopos, "HSD", &pResiTopo)))
+        {
+          sprintf(errMsg, "in file %s line %d, cannot find residue topology for HSD", __FILE__, __LINE__);
+          TraceError(errMsg, DataNotExistError);
+          CharmmICDestroy(&ic);
+          RotamerDestroy(&tempRotamer);
+          return DataNotExistError;
+        }
+        ResidueTopologyFindCharmmIC(pResiTopo, "HD1", &ic);
         GetFourthAtom(&RotamerGetAtomByName(&tempRotamer, CharmmICGetAtomA(&ic))->xyz,
           &RotamerGetAtomByName(&tempRotamer, CharmmICGetAtomB(&ic))->xyz,
           &RotamerGetAtomByName(&tempRotamer, CharmmICGetAtomC(&ic))->xyz,
@@ -2595,7 +2620,6 @@ int ProteinSiteBuildFlippedNativeRotamer(Structure* pStructure, int chainIndex,
         RotamerFindAtom(&tempRotamer, "HD1", &index1);
         RotamerGetAtom(&tempRotamer, index1)->xyz = tempXYZ1;
         XYZArraySet(&tempRotamer.xyzs, index1, &tempXYZ1);
-        ResidueTopologyDestroy(&resiTopo);
         CharmmICDestroy(&ic);
       }
       else if (strcmp(RotamerGetType(pRotamer), "HSE") == 0)
@@ -2617,12 +2641,18 @@ int ProteinSiteBuildFlippedNativeRotamer(Structure* pStructure, int chainIndex,
         RotamerGetAtom(&tempRotamer, index2)->xyz = tempXYZ1;
         XYZArraySet(&tempRotamer.xyzs, index1, &tempXYZ2);
         XYZArraySet(&tempRotamer.xyzs, index2, &tempXYZ1);
-        ResidueTopology resiTopo;
+        ResidueTopology* pResiTopo = NULL;
         CharmmIC ic;
-        ResidueTopologyCreate(&resiTopo);
         CharmmICCreate(&ic);
-        ResiTopoSetGet(pResiTopos, "HSE", &resiTopo);
-        ResidueTopologyFindCharmmIC(&resiTopo, "HE2", &ic);
+        if (FAILED(ResiTopoSetFind(pResiTopos, "HSE", &pResiTopo)))
+        {
+          sprintf(errMsg, "in file %s line %d, cannot find residue topology for HSE", __FILE__, __LINE__);
+          TraceError(errMsg, DataNotExistError);
+          CharmmICDestroy(&ic);
+          RotamerDestroy(&tempRotamer);
+          return DataNotExistError;
+        }
+        ResidueTopologyFindCharmmIC(pResiTopo, "HE2", &ic);
         GetFourthAtom(&RotamerGetAtomByName(&tempRotamer, CharmmICGetAtomA(&ic))->xyz,
           &RotamerGetAtomByName(&tempRotamer, CharmmICGetAtomB(&ic))->xyz,
           &RotamerGetAtomByName(&tempRotamer, CharmmICGetAtomC(&ic))->xyz,
@@ -2631,7 +2661,6 @@ int ProteinSiteBuildFlippedNativeRotamer(Structure* pStructure, int chainIndex,
         RotamerFindAtom(&tempRotamer, "HE2", &index1);
         RotamerGetAtom(&tempRotamer, index1)->xyz = tempXYZ1;
         XYZArraySet(&tempRotamer.xyzs, index1, &tempXYZ1);
-        ResidueTopologyDestroy(&resiTopo);
         CharmmICDestroy(&ic);
       }
       RotamerSetAdd(pSet, &tempRotamer);
@@ -2645,20 +2674,26 @@ int ProteinSiteBuildFlippedNativeRotamer(Structure* pStructure, int chainIndex,
 
 int ProteinSiteExpandHydroxylRotamers(Structure* pStructure, int chainIndex, int resiIndex, ResiTopoSet* pTopos)
 {
+  char errMsg[MAX_LEN_ERR_MSG + 1];
   Chain* pChain = StructureGetChain(pStructure, chainIndex);
   if (pChain->type == Type_Chain_Protein)
   {
     DesignSite* pSite = StructureFindDesignSite(pStructure, chainIndex, resiIndex);
     RotamerSet* pSet = DesignSiteGetRotamers(pSite);
     int rotamerCount = RotamerSetGetCount(pSet); // the rotamer set will be expanded, we need to record the current count
-    ResidueTopology tops;
+    ResidueTopology* pTops = NULL;
     CharmmIC ics;
-    ResidueTopologyCreate(&tops);
     CharmmICCreate(&ics);
     if (RotamerSetGetRepresentative(pSet, "SER"))
     {
-      ResiTopoSetGet(pTopos, "SER", &tops);
-      ResidueTopologyFindCharmmIC(&tops, "HG", &ics);
+      if (FAILED(ResiTopoSetFind(pTopos, "SER", &pTops)))
+      {
+        sprintf(errMsg, "in file %s line %d, cannot find residue topology for SER", __FILE__, __LINE__);
+        TraceError(errMsg, DataNotExistError);
+        CharmmICDestroy(&ics);
+        return DataNotExistError;
+      }
+      ResidueTopologyFindCharmmIC(pTops, "HG", &ics);
       double icParaX = ics.icParam[2];
       int addedCount = 0;
       Rotamer tempRot;
@@ -2722,8 +2757,14 @@ int ProteinSiteExpandHydroxylRotamers(Structure* pStructure, int chainIndex, int
     // for thr rots
     if (RotamerSetGetRepresentative(pSet, "THR") != NULL)
     {
-      ResiTopoSetGet(pTopos, "THR", &tops);
-      ResidueTopologyFindCharmmIC(&tops, "HG1", &ics);
+      if (FAILED(ResiTopoSetFind(pTopos, "THR", &pTops)))
+      {
+        sprintf(errMsg, "in file %s line %d, cannot find residue topology for THR", __FILE__, __LINE__);
+        TraceError(errMsg, DataNotExistError);
+        CharmmICDestroy(&ics);
+        return DataNotExistError;
+      }
+      ResidueTopologyFindCharmmIC(pTops, "HG1", &ics);
       double icParaX = ics.icParam[2];
       int addedCount = 0;
       Rotamer tempRot;
@@ -2787,8 +2828,14 @@ int ProteinSiteExpandHydroxylRotamers(Structure* pStructure, int chainIndex, int
     // for tyr rots
     if (RotamerSetGetRepresentative(pSet, "TYR") != NULL)
     {
-      ResiTopoSetGet(pTopos, "TYR", &tops);
-      ResidueTopologyFindCharmmIC(&tops, "HH", &ics);
+      if (FAILED(ResiTopoSetFind(pTopos, "TYR", &pTops)))
+      {
+        sprintf(errMsg, "in file %s line %d, cannot find residue topology for TYR", __FILE__, __LINE__);
+        TraceError(errMsg, DataNotExistError);
+        CharmmICDestroy(&ics);
+        return DataNotExistError;
+      }
+      ResidueTopologyFindCharmmIC(pTops, "HH", &ics);
       double icPara_Tyr = ics.icParam[2];
       int addedCount = 0;
       Rotamer tempRot;
@@ -2822,7 +2869,6 @@ int ProteinSiteExpandHydroxylRotamers(Structure* pStructure, int chainIndex, int
       //printf("Design site (%2d, %4d): %d TYR rots expanded\n", chnNdx, ResidueGetPosInChain(pDesignSite->pRes), addedCount);
       RotamerDestroy(&tempRot);
     }
-    ResidueTopologyDestroy(&tops);
     CharmmICDestroy(&ics);
   }
   return Success;
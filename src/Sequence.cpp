@@ -466,6 +466,33 @@ int StructureGetWholeSequence(Structure* pStructure, Sequence* sequence, char* s
 }
 
 
+// record the position of every design site in the sequence built by StructureGetWholeSequence()
+int StructureMapDesignSitesToWholeSequence(Structure* pStructure)
+{
+  for (int i = 0;i < StructureGetDesignSiteCount(pStructure);i++)
+  {
+    StructureGetDesignSite(pStructure, i)->seqNdx = -1;
+  }
+  int index = 0;
+  for (int i = 0;i < StructureGetChainCount(pStructure);i++)
+  {
+    Chain* pChain = StructureGetChain(pStructure, i);
+    if (strcmp(DES_CHAINS, ChainGetName(pChain)))continue;
+    for (int j = 0;j < ChainGetResidueCount(pChain);j++)
+    {
+      Residue* pResi = ChainGetResidue(pChain, j);
+      if (ResidueGetDesignType(pResi) != Type_DesType_Fixed)
+      {
+        int siteIdx = StructureGetDesignSiteIndex(pStructure, i, j);
+        StructureGetDesignSite(pStructure, siteIdx)->seqNdx = index;
+      }
+      index++;
+    }
+  }
+  return Success;
+}
+
+
 int StructureWriteFirstLigandRotamerIntoMol2(Structure* pStructure, char* mol2file)
 {
   int result = Success;
@@ -46,6 +46,7 @@ int DesignShowMinEnergyDesignSites(Structure* pStructure, Sequence* pSeq, char*
 int DesignShowMinEnergyDesignMutableSites(Structure* pStructure, Sequence* sequence, char* pdbfile);
 int DesignShowMinEnergyDesignLigand(Structure* pStructure, Sequence* sequence, char* mol2file);
 int StructureGetWholeSequence(Structure* pStructure, Sequence* sequence, char* seq);
+int StructureMapDesignSitesToWholeSequence(Structure* pStructure);
 int StructureWriteFirstLigandRotamerIntoMol2(Structure* pStructure, char* mol2file);
 
 #endif // SEQUENCE_H
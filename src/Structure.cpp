@@ -307,6 +307,15 @@ int StructureReadPDB(Structure* pStructure, char* pdbFile, AtomParamsSet* pAtomP
     }
   }
 
+  for (int i = 0; i < StructureGetChainCount(pStructure); i++)
+  {
+    Chain* pChainI = StructureGetChain(pStructure, i);
+    for (int j = 0; j < ChainGetResidueCount(pChainI); j++)
+    {
+      AtomArrayResolveHbDorB(ResidueGetAllAtoms(ChainGetResidue(pChainI, j)));
+    }
+  }
+
   FileReaderDestroy(&file);
   return Success;
 }
@@ -393,6 +402,7 @@ int StructureReadMol2(Structure* pStructure, char* mol2file, AtomParamsSet* pAto
       pAtom->isXyzValid = TRUE;
     }
   }
+  AtomArrayResolveHbDorB(ResidueGetAllAtoms(&newResi));
   ChainAppendResidue(&newChain, &newResi);
   StructureAddChain(pStructure, &newChain);
   ChainDestroy(&newChain);
@@ -701,6 +711,35 @@ int StructureRemoveAllDesignSites(Structure* pThis)
   return Success;
 }
 
+
+int StructureDesignViewCreate(Structure* pThis, Structure* pOther)
+{
+  *pThis = *pOther;
+  pThis->designSites = (DesignSite*)malloc(sizeof(DesignSite) * pOther->desSiteCount);
+  for (int i = 0; i < pOther->desSiteCount; i++)
+  {
+    DesignSiteCreate(&pThis->designSites[i]);
+    DesignSiteCopy(&pThis->designSites[i], &pOther->designSites[i]);
+  }
+  return Success;
+}
+
+
+int StructureDesignViewDestroy(Structure* pThis)
+{
+  // DesignSiteDestroy() is not used since it resets the design type of the shared residue
+  for (int i = 0; i < pThis->desSiteCount; i++)
+  {
+    RotamerSetDestroy(&pThis->designSites[i].rots);
+    IntArrayDestroy(&pThis->designSites[i].nbrNdxs);
+  }
+  free(pThis->designSites);
+  pThis->designSites = NULL;
+  pThis->desSiteCount = 0;
+  return Success;
+}
+
+
 int ProteinSiteRemoveDesignSite(Structure* pThis, int chainIndex, int resiIndex)
 {
   DesignSite* pDesignSite = StructureFindDesignSite(pThis, chainIndex, resiIndex);
@@ -1543,4 +1582,236 @@ int StructureCalcAminoAcidDunbrackEnergy(Structure* pStructure, BBdepRotamerLib*
     }
   }
   return Success;
-}
\ No newline at end of file
+}
+
+
+int ResidueGridCreate(ResidueGrid* pThis)
+{
+  pThis->chainCount = 0;
+  pThis->residueCount = 0;
+  pThis->chainOffsets = NULL;
+  pThis->chnNdxs = NULL;
+  pThis->resNdxs = NULL;
+  pThis->centers = NULL;
+  pThis->radii = NULL;
+  pThis->maxRadius = 0;
+  pThis->cellSize = 0;
+  pThis->dims[0] = pThis->dims[1] = pThis->dims[2] = 0;
+  pThis->cellStarts = NULL;
+  pThis->cellResidues = NULL;
+  return Success;
+}
+
+
+int ResidueGridDestroy(ResidueGrid* pThis)
+{
+  free(pThis->chainOffsets);
+  free(pThis->chnNdxs);
+  free(pThis->resNdxs);
+  free(pThis->centers);
+  free(pThis->radii);
+  free(pThis->cellStarts);
+  free(pThis->cellResidues);
+  ResidueGridCreate(pThis);
+  return Success;
+}
+
+
+static int ResidueGridCellIndex(ResidueGrid* pThis, int ix, int iy, int iz)
+{
+  return (ix * pThis->dims[1] + iy) * pThis->dims[2] + iz;
+}
+
+
+static int ResidueGridCellCoord(ResidueGrid* pThis, double value, double origin, int dim)
+{
+  int index = (int)floor((value - origin) / pThis->cellSize);
+  if (index < 0) index = 0;
+  if (index >= dim) index = dim - 1;
+  return index;
+}
+
+
+// the grid only describes atoms with valid coordinates at the time it is built, rebuild it if the structure changes
+int ResidueGridBuild(ResidueGrid* pThis, Structure* pStructure, double cellSize)
+{
+  ResidueGridDestroy(pThis);
+  pThis->chainCount = StructureGetChainCount(pStructure);
+  pThis->chainOffsets = (int*)malloc(sizeof(int) * (pThis->chainCount + 1));
+  pThis->residueCount = 0;
+  for (int i = 0; i < pThis->chainCount; i++)
+  {
+    pThis->chainOffsets[i] = pThis->residueCount;
+    pThis->residueCount += ChainGetResidueCount(StructureGetChain(pStructure, i));
+  }
+  pThis->chainOffsets[pThis->chainCount] = pThis->residueCount;
+  pThis->chnNdxs = (int*)malloc(sizeof(int) * (pThis->residueCount + 1));
+  pThis->resNdxs = (int*)malloc(sizeof(int) * (pThis->residueCount + 1));
+  pThis->centers = (XYZ*)malloc(sizeof(XYZ) * (pThis->residueCount + 1));
+  pThis->radii = (double*)malloc(sizeof(double) * (pThis->residueCount + 1));
+
+  XYZ minXYZ, maxXYZ;
+  minXYZ.X = minXYZ.Y = minXYZ.Z = 0;
+  maxXYZ = minXYZ;
+  BOOL firstSphere = TRUE;
+  for (int i = 0; i < pThis->chainCount; i++)
+  {
+    Chain* pChain = StructureGetChain(pStructure, i);
+    for (int j = 0; j < ChainGetResidueCount(pChain); j++)
+    {
+      int serial = pThis->chainOffsets[i] + j;
+      Residue* pResi = ChainGetResidue(pChain, j);
+      pThis->chnNdxs[serial] = i;
+      pThis->resNdxs[serial] = j;
+      XYZ center;
+      center.X = center.Y = center.Z = 0;
+      int validCount = 0;
+      for (int k = 0; k < ResidueGetAtomCount(pResi); k++)
+      {
+        Atom* pAtom = ResidueGetAtom(pResi, k);
+        if (pAtom->isXyzValid == FALSE) continue;
+        XYZAdd(&center, &pAtom->xyz);
+        validCount++;
+      }
+      pThis->radii[serial] = -1;
+      if (validCount == 0) continue;
+      XYZScale(&center, 1.0 / validCount);
+      double radius = 0;
+      for (int k = 0; k < ResidueGetAtomCount(pResi); k++)
+      {
+        Atom* pAtom = ResidueGetAtom(pResi, k);
+        if (pAtom->isXyzValid == FALSE) continue;
+        double dist = XYZDistance(&center, &pAtom->xyz);
+        if (dist > radius) radius = dist;
+      }
+      pThis->centers[serial] = center;
+      pThis->radii[serial] = radius;
+      if (radius > pThis->maxRadius) pThis->maxRadius = radius;
+      if (firstSphere == TRUE)
+      {
+        minXYZ = maxXYZ = center;
+        firstSphere = FALSE;
+      }
+      else
+      {
+        if (center.X < minXYZ.X) minXYZ.X = center.X;
+        if (center.Y < minXYZ.Y) minXYZ.Y = center.Y;
+        if (center.Z < minXYZ.Z) minXYZ.Z = center.Z;
+        if (center.X > maxXYZ.X) maxXYZ.X = center.X;
+        if (center.Y > maxXYZ.Y) maxXYZ.Y = center.Y;
+        if (center.Z > maxXYZ.Z) maxXYZ.Z = center.Z;
+      }
+    }
+  }
+  if (firstSphere == TRUE)
+  {
+    minXYZ.X = minXYZ.Y = minXYZ.Z = 0;
+    maxXYZ = minXYZ;
+  }
+
+  // enlarge the cells if the structure is very sparse, so that the grid does not take too much memory
+  pThis->origin = minXYZ;
+  pThis->cellSize = cellSize > 1.0 ? cellSize : 1.0;
+  while (TRUE)
+  {
+    pThis->dims[0] = (int)floor((maxXYZ.X - minXYZ.X) / pThis->cellSize) + 1;
+    pThis->dims[1] = (int)floor((maxXYZ.Y - minXYZ.Y) / pThis->cellSize) + 1;
+    pThis->dims[2] = (int)floor((maxXYZ.Z - minXYZ.Z) / pThis->cellSize) + 1;
+    if ((double)pThis->dims[0] * pThis->dims[1] * pThis->dims[2] <= 8.0 * pThis->residueCount + 64) break;
+    pThis->cellSize *= 1.5;
+  }
+
+  // counting sort of residues into cells
+  int cellCount = pThis->dims[0] * pThis->dims[1] * pThis->dims[2];
+  pThis->cellStarts = (int*)calloc(cellCount + 1, sizeof(int));
+  pThis->cellResidues = (int*)malloc(sizeof(int) * (pThis->residueCount + 1));
+  int* cellOfResidue = (int*)malloc(sizeof(int) * (pThis->residueCount + 1));
+  for (int s = 0; s < pThis->residueCount; s++)
+  {
+    cellOfResidue[s] = -1;
+    if (pThis->radii[s] < 0) continue;
+    int ix = ResidueGridCellCoord(pThis, pThis->centers[s].X, pThis->origin.X, pThis->dims[0]);
+    int iy = ResidueGridCellCoord(pThis, pThis->centers[s].Y, pThis->origin.Y, pThis->dims[1]);
+    int iz = ResidueGridCellCoord(pThis, pThis->centers[s].Z, pThis->origin.Z, pThis->dims[2]);
+    cellOfResidue[s] = ResidueGridCellIndex(pThis, ix, iy, iz);
+    pThis->cellStarts[cellOfResidue[s] + 1]++;
+  }
+  for (int c = 0; c < cellCount; c++)
+  {
+    pThis->cellStarts[c + 1] += pThis->cellStarts[c];
+  }
+  int* fill = (int*)malloc(sizeof(int) * (cellCount + 1));
+  memcpy(fill, pThis->cellStarts, sizeof(int) * (cellCount + 1));
+  for (int s = 0; s < pThis->residueCount; s++)
+  {
+    if (cellOfResidue[s] < 0) continue;
+    pThis->cellResidues[fill[cellOfResidue[s]]++] = s;
+  }
+  free(fill);
+  free(cellOfResidue);
+
+  return Success;
+}
+
+
+int ResidueGridGetSerial(ResidueGrid* pThis, int chainIndex, int resiIndex)
+{
+  return pThis->chainOffsets[chainIndex] + resiIndex;
+}
+
+
+// returns FALSE only if no atom of the residue can be within 'cutoff' of any point inside the sphere
+BOOL ResidueGridSphereMayInteract(ResidueGrid* pThis, int serial, XYZ* pCenter, double radius, double cutoff)
+{
+  if (pThis->radii[serial] < 0 || radius < 0) return FALSE;
+  return XYZDistance(pCenter, &pThis->centers[serial]) - pThis->radii[serial] - radius <= cutoff ? TRUE : FALSE;
+}
+
+
+// pNeighbors is an array of IntArray (one per chain) that receives, in ascending order,
+// the indices of residues in each chain that may interact with the given sphere
+int ResidueGridFindNeighbors(ResidueGrid* pThis, XYZ* pCenter, double radius, double cutoff, IntArray* pNeighbors)
+{
+  for (int i = 0; i < pThis->chainCount; i++)
+  {
+    pNeighbors[i].length = 0;
+  }
+  if (radius < 0 || pThis->residueCount == 0) return Success;
+
+  double reach = radius + cutoff + pThis->maxRadius;
+  int lower[3], upper[3];
+  lower[0] = ResidueGridCellCoord(pThis, pCenter->X - reach, pThis->origin.X, pThis->dims[0]);
+  lower[1] = ResidueGridCellCoord(pThis, pCenter->Y - reach, pThis->origin.Y, pThis->dims[1]);
+  lower[2] = ResidueGridCellCoord(pThis, pCenter->Z - reach, pThis->origin.Z, pThis->dims[2]);
+  upper[0] = ResidueGridCellCoord(pThis, pCenter->X + reach, pThis->origin.X, pThis->dims[0]);
+  upper[1] = ResidueGridCellCoord(pThis, pCenter->Y + reach, pThis->origin.Y, pThis->dims[1]);
+  upper[2] = ResidueGridCellCoord(pThis, pCenter->Z + reach, pThis->origin.Z, pThis->dims[2]);
+  for (int ix = lower[0]; ix <= upper[0]; ix++)
+  {
+    for (int iy = lower[1]; iy <= upper[1]; iy++)
+    {
+      for (int iz = lower[2]; iz <= upper[2]; iz++)
+      {
+        int cell = ResidueGridCellIndex(pThis, ix, iy, iz);
+        for (int c = pThis->cellStarts[cell]; c < pThis->cellStarts[cell + 1]; c++)
+        {
+          int serial = pThis->cellResidues[c];
+          if (ResidueGridSphereMayInteract(pThis, serial, pCenter, radius, cutoff) == FALSE) continue;
+          // keep the original residue order so that energies are summed in the same order as a full scan
+          IntArray* pChainNbrs = &pNeighbors[pThis->chnNdxs[serial]];
+          int pos = IntArrayGetLength(pChainNbrs);
+          while (pos > 0 && IntArrayGet(pChainNbrs, pos - 1) > pThis->resNdxs[serial]) pos--;
+          IntArrayInsert(pChainNbrs, pos, pThis->resNdxs[serial]);
+        }
+      }
+    }
+  }
+  return Success;
+}
+
+
+int ResidueGridFindResidueNeighbors(ResidueGrid* pThis, int chainIndex, int resiIndex, double cutoff, IntArray* pNeighbors)
+{
+  int serial = ResidueGridGetSerial(pThis, chainIndex, resiIndex);
+  return ResidueGridFindNeighbors(pThis, &pThis->centers[serial], pThis->radii[serial], cutoff, pNeighbors);
+}
@@ -59,6 +59,9 @@ int StructureShowDesignSites(Structure* pThis);
 int ProteinSiteAddDesignSite(Structure* pThis, int chainIndex, int resiIndex);
 int ProteinSiteRemoveDesignSite(Structure* pThis, int chainIndex, int resiIndex);
 int StructureRemoveAllDesignSites(Structure* pThis);
+// a private copy of the design sites sharing all chains, so rotamers can be restored/extracted per thread
+int StructureDesignViewCreate(Structure* pThis, Structure* pOther);
+int StructureDesignViewDestroy(Structure* pThis);
 
 // other functions
 int ChainComputeResiduePosition(Structure* pStructure, int chainIndex);
@@ -80,6 +83,32 @@ int StructureMutateNucleotide(Residue* pQuery, char oneLetterName, Structure* pS
 int StructureCalcAminoAcidPropensityAndRamaEnergy(Structure* pStructure, AAppTable* pAAPP, RamaTable* pRama);
 int StructureCalcAminoAcidDunbrackEnergy(Structure* pStructure, BBdepRotamerLib* pBBdep);
 
+// residue bounding spheres binned on a cubic cell grid, used to skip residue pairs that are too far apart to interact
+typedef struct _ResidueGrid
+{
+  int chainCount;
+  int residueCount;
+  int* chainOffsets;  // serial index of the first residue in each chain
+  int* chnNdxs;
+  int* resNdxs;
+  XYZ* centers;
+  double* radii;      // -1 for a residue without any valid atom
+  double maxRadius;
+  XYZ origin;
+  double cellSize;
+  int dims[3];
+  int* cellStarts;    // residues in cell c are cellResidues[cellStarts[c]] ... cellResidues[cellStarts[c+1]-1]
+  int* cellResidues;
+} ResidueGrid;
+
+int ResidueGridCreate(ResidueGrid* pThis);
+int ResidueGridDestroy(ResidueGrid* pThis);
+int ResidueGridBuild(ResidueGrid* pThis, Structure* pStructure, double cellSize);
+int ResidueGridGetSerial(ResidueGrid* pThis, int chainIndex, int resiIndex);
+BOOL ResidueGridSphereMayInteract(ResidueGrid* pThis, int serial, XYZ* pCenter, double radius, double cutoff);
+int ResidueGridFindNeighbors(ResidueGrid* pThis, XYZ* pCenter, double radius, double cutoff, IntArray* pNeighbors);
+int ResidueGridFindResidueNeighbors(ResidueGrid* pThis, int chainIndex, int resiIndex, double cutoff, IntArray* pNeighbors);
+
 //deal with nucleic acid
 
 #endif // STRUCTURE_H
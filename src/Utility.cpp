@@ -198,6 +198,100 @@ int StringArrayShow(StringArray* pThis)
   return Success;
 }
 
+static unsigned int StringIndexHash(char* key)
+{
+  unsigned int hash = 2166136261u;
+  for (unsigned char* p = (unsigned char*)key; *p != '\0'; p++)
+  {
+    hash ^= *p;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+int StringIndexCreate(StringIndex* pThis)
+{
+  pThis->keys = NULL;
+  pThis->values = NULL;
+  pThis->capacity = 0;
+  pThis->count = 0;
+  return Success;
+}
+
+int StringIndexDestroy(StringIndex* pThis)
+{
+  for (int i = 0; i < pThis->capacity; i++)
+  {
+    if (pThis->keys[i] != NULL) free(pThis->keys[i]);
+  }
+  free(pThis->keys);
+  free(pThis->values);
+  return StringIndexCreate(pThis);
+}
+
+int StringIndexCopy(StringIndex* pThis, StringIndex* pOther)
+{
+  StringIndexDestroy(pThis);
+  for (int i = 0; i < pOther->capacity; i++)
+  {
+    if (pOther->keys[i] != NULL) StringIndexSet(pThis, pOther->keys[i], pOther->values[i]);
+  }
+  return Success;
+}
+
+int StringIndexSet(StringIndex* pThis, char* key, int value)
+{
+  // keep the load factor at or below one half so probes stay short
+  if (2 * (pThis->count + 1) > pThis->capacity)
+  {
+    StringIndex grown;
+    grown.capacity = pThis->capacity == 0 ? 64 : 2 * pThis->capacity;
+    grown.count = 0;
+    grown.keys = (char**)calloc(grown.capacity, sizeof(char*));
+    grown.values = (int*)calloc(grown.capacity, sizeof(int));
+    for (int i = 0; i < pThis->capacity; i++)
+    {
+      if (pThis->keys[i] == NULL) continue;
+      unsigned int slot = StringIndexHash(pThis->keys[i]) & (grown.capacity - 1);
+      while (grown.keys[slot] != NULL) slot = (slot + 1) & (grown.capacity - 1);
+      grown.keys[slot] = pThis->keys[i];
+      grown.values[slot] = pThis->values[i];
+      grown.count++;
+    }
+    free(pThis->keys);
+    free(pThis->values);
+    *pThis = grown;
+  }
+
+  unsigned int slot = StringIndexHash(key) & (pThis->capacity - 1);
+  while (pThis->keys[slot] != NULL)
+  {
+    if (strcmp(pThis->keys[slot], key) == 0)
+    {
+      pThis->values[slot] = value;
+      return Success;
+    }
+    slot = (slot + 1) & (pThis->capacity - 1);
+  }
+  pThis->keys[slot] = (char*)malloc(sizeof(char) * (strlen(key) + 1));
+  strcpy(pThis->keys[slot], key);
+  pThis->values[slot] = value;
+  pThis->count++;
+  return Success;
+}
+
+int StringIndexGet(StringIndex* pThis, char* key)
+{
+  if (pThis->count == 0) return -1;
+  unsigned int slot = StringIndexHash(key) & (pThis->capacity - 1);
+  while (pThis->keys[slot] != NULL)
+  {
+    if (strcmp(pThis->keys[slot], key) == 0) return pThis->values[slot];
+    slot = (slot + 1) & (pThis->capacity - 1);
+  }
+  return -1;
+}
+
 int FileReaderCreate(FileReader* pThis, char* path)
 {
   char errMsg[MAX_LEN_ERR_MSG + 1];
@@ -772,6 +866,41 @@ int SpentTimeShow(time_t ts, time_t te)
   return Success;
 }
 
+
+int RandomGeneratorSeed(RandomGenerator* pThis, unsigned long long seed)
+{
+  // splitmix64 scrambling, so that consecutive seeds give unrelated streams; the state must not be zero
+  seed += 0x9E3779B97F4A7C15ULL;
+  seed = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  seed = (seed ^ (seed >> 27)) * 0x94D049BB133111EBULL;
+  seed = seed ^ (seed >> 31);
+  pThis->state = seed != 0 ? seed : 0x9E3779B97F4A7C15ULL;
+  return Success;
+}
+
+
+static unsigned long long RandomGeneratorNext(RandomGenerator* pThis)
+{
+  pThis->state ^= pThis->state >> 12;
+  pThis->state ^= pThis->state << 25;
+  pThis->state ^= pThis->state >> 27;
+  return pThis->state * 0x2545F4914F6CDD1DULL;
+}
+
+
+// returns an integer in [0, range)
+int RandomGeneratorInt(RandomGenerator* pThis, int range)
+{
+  return (int)((RandomGeneratorNext(pThis) >> 33) % (unsigned long long)range);
+}
+
+
+// returns a real number in (0, 1]
+double RandomGeneratorReal(RandomGenerator* pThis)
+{
+  return ((RandomGeneratorNext(pThis) >> 11) + 1.0) / 9007199254740992.0;
+}
+
 int AA1ToAA3(char name1, char name3[MAX_LEN_RES_NAME])
 {
   switch (name1)
@@ -57,6 +57,22 @@ int StringArrayAppend(StringArray* pThis, char* srcString);
 int StringArraySplitString(StringArray* pThis, char* srcStr, char splitter);
 int StringArrayShow(StringArray* pThis);
 
+// open-addressing hash from a name to an integer slot, used for name lookups
+// in the read-only parameter and topology tables
+typedef struct _StringIndex
+{
+  char** keys;
+  int* values;
+  int capacity;
+  int count;
+} StringIndex;
+
+int StringIndexCreate(StringIndex* pThis);
+int StringIndexDestroy(StringIndex* pThis);
+int StringIndexCopy(StringIndex* pThis, StringIndex* pOther);
+int StringIndexSet(StringIndex* pThis, char* key, int value);
+int StringIndexGet(StringIndex* pThis, char* key);
+
 
 typedef enum _Type_CoordinateFile
 {
@@ -139,6 +155,17 @@ int AddChainTER(FILE* pFile);
 int ShowProgress(int width, double percentage);
 int SpentTimeShow(time_t ts, time_t te);
 
+// random number generator with its own state (xorshift64*), so that concurrent
+// design trajectories do not share the hidden state of rand()
+typedef struct _RandomGenerator
+{
+  unsigned long long state;
+} RandomGenerator;
+
+int RandomGeneratorSeed(RandomGenerator* pThis, unsigned long long seed);
+int RandomGeneratorInt(RandomGenerator* pThis, int range);
+double RandomGeneratorReal(RandomGenerator* pThis);
+
 typedef enum _Type_Residue
 {
   Type_Residue_Ala,
@@ -30,6 +30,7 @@ extern BOOL FLAG_PPI;
 extern BOOL FLAG_PROT_LIG;
 
 extern double WEIGHTS[MAX_ENERGY_TERM];
+extern int NTHREADS;
 
 #define PNATAA_USING_ROSETTA_LOSS_FUNCTION
 //#define PNATAA_USING_EVOEF_LOSS_FUNCTION
@@ -234,38 +235,223 @@ int Xshow(double* x, int xcount)
 }
 
 
-int PNATROT_LossFunction(EnergyTermsRot* pTerms, double* x, int xcount, double* loss)
+//only the weights of the selected energy group are optimized, as in the finite-difference gradients
+int GradientMaskByFlag(double* grad, int xcount)
 {
-  double score = 0;
-  for (int i = 0; i < pTerms->posCount; i++)
+  int first = 0, last = 0;
+  if (FLAG_MONOMER)
+  {
+    first = 0;
+    last = NUM_ENERGY_MON;
+  }
+  else if (FLAG_PPI)
+  {
+    first = NUM_ENERGY_MON;
+    last = NUM_ENERGY_MON + NUM_ENERGY_PPI;
+  }
+  else if (FLAG_PROT_LIG)
+  {
+    first = NUM_ENERGY_MON + NUM_ENERGY_PPI;
+    last = xcount;
+  }
+  for (int i = 0; i < xcount; i++)
+  {
+    if (i < first || i >= last) grad[i] = 0.0;
+  }
+  return Success;
+}
+
+
+int LBFGSMemoryCreate(LBFGSMemory* pThis, int xcount)
+{
+  pThis->xcount = xcount;
+  pThis->count = 0;
+  pThis->head = 0;
+  pThis->s = (double*)calloc(LBFGS_HISTORY * xcount, sizeof(double));
+  pThis->y = (double*)calloc(LBFGS_HISTORY * xcount, sizeof(double));
+  pThis->rho = (double*)calloc(LBFGS_HISTORY, sizeof(double));
+  return Success;
+}
+
+
+int LBFGSMemoryDestroy(LBFGSMemory* pThis)
+{
+  free(pThis->s);
+  free(pThis->y);
+  free(pThis->rho);
+  pThis->s = NULL;
+  pThis->y = NULL;
+  pThis->rho = NULL;
+  pThis->count = 0;
+  pThis->head = 0;
+  return Success;
+}
+
+
+int LBFGSMemoryReset(LBFGSMemory* pThis)
+{
+  pThis->count = 0;
+  pThis->head = 0;
+  return Success;
+}
+
+
+//store the pair (x1-x0, grad1-grad0); pairs without positive curvature are dropped to keep the inverse Hessian positive definite
+int LBFGSMemoryUpdate(LBFGSMemory* pThis, double* x0, double* x1, double* grad0, double* grad1)
+{
+  int slot = (pThis->head + pThis->count) % LBFGS_HISTORY;
+  double* s = pThis->s + slot * pThis->xcount;
+  double* y = pThis->y + slot * pThis->xcount;
+  double sy = 0;
+  for (int k = 0; k < pThis->xcount; k++)
+  {
+    s[k] = x1[k] - x0[k];
+    y[k] = grad1[k] - grad0[k];
+    sy += s[k] * y[k];
+  }
+  if (sy <= 1e-10) return ValueError;
+  pThis->rho[slot] = 1.0 / sy;
+  if (pThis->count < LBFGS_HISTORY) pThis->count++;
+  else pThis->head = (pThis->head + 1) % LBFGS_HISTORY;
+  return Success;
+}
+
+
+//two-loop recursion: dir = H * grad, so the step is x -= alpha * dir
+int LBFGSMemoryDirection(LBFGSMemory* pThis, double* grad, double* dir)
+{
+  int n = pThis->xcount;
+  double alpha[LBFGS_HISTORY];
+  memcpy(dir, grad, sizeof(double) * n);
+  for (int i = pThis->count - 1; i >= 0; i--)
+  {
+    int slot = (pThis->head + i) % LBFGS_HISTORY;
+    double* s = pThis->s + slot * n;
+    double* y = pThis->y + slot * n;
+    double sq = 0;
+    for (int k = 0; k < n; k++) sq += s[k] * dir[k];
+    alpha[i] = pThis->rho[slot] * sq;
+    for (int k = 0; k < n; k++) dir[k] -= alpha[i] * y[k];
+  }
+  if (pThis->count > 0)
+  {
+    int slot = (pThis->head + pThis->count - 1) % LBFGS_HISTORY;
+    double* y = pThis->y + slot * n;
+    double yy = 0;
+    for (int k = 0; k < n; k++) yy += y[k] * y[k];
+    double gamma = 1.0 / (pThis->rho[slot] * yy);
+    for (int k = 0; k < n; k++) dir[k] *= gamma;
+  }
+  for (int i = 0; i < pThis->count; i++)
+  {
+    int slot = (pThis->head + i) % LBFGS_HISTORY;
+    double* s = pThis->s + slot * n;
+    double* y = pThis->y + slot * n;
+    double yr = 0;
+    for (int k = 0; k < n; k++) yr += y[k] * dir[k];
+    double beta = pThis->rho[slot] * yr;
+    for (int k = 0; k < n; k++) dir[k] += (alpha[i] - beta) * s[k];
+  }
+  return Success;
+}
+
+
+//loss of one position; if grad is not NULL, the analytic gradient of the loss is added to it.
+//the Boltzmann factors are taken relative to the lowest score so that exp() cannot overflow
+double PNATROT_PositionLoss(EnergyTermRot* pTermRot, double* x, int xcount, double* grad)
+{
+  double smin = DBL_MAX;
+  for (int t = 0; t < 2; t++)
   {
-    double wtsum = 0, mutsum = 0;
-    EnergyTermRot* pTermRot = &pTerms->terms[i];
-    for (int j = 0; j < pTermRot->rotCount[0]; j++)
+    for (int j = 0; j < pTermRot->rotCount[t]; j++)
     {
-      double wtsumJ = 0;
+      double score = 0;
       for (int k = 0;k < xcount;k++)
       {
-        wtsumJ += pTermRot->energy[0][j][k] * x[k];
+        score += pTermRot->energy[t][j][k] * x[k];
       }
-      wtsum += exp(-1.0 * wtsumJ);
+      if (score < smin) smin = score;
     }
-    for (int j = 0; j < pTermRot->rotCount[1]; j++)
+  }
+
+  double wtsum = 0, mutsum = 0;
+  double natavg[NUM_ENERGY_TERM], allavg[NUM_ENERGY_TERM];
+  if (grad != NULL)
+  {
+    memset(natavg, 0, sizeof(double) * xcount);
+    memset(allavg, 0, sizeof(double) * xcount);
+  }
+  for (int t = 0; t < 2; t++)
+  {
+    for (int j = 0; j < pTermRot->rotCount[t]; j++)
     {
-      double mutsumJ = 0;
+      double* energy = pTermRot->energy[t][j];
+      double score = 0;
       for (int k = 0;k < xcount;k++)
       {
-        mutsumJ += pTermRot->energy[1][j][k] * x[k];
+        score += energy[k] * x[k];
       }
-      mutsum += exp(-1.0 * mutsumJ);
+      double boltzmann = exp(smin - score);
+      if (t == 0) wtsum += boltzmann;
+      else mutsum += boltzmann;
+      if (grad == NULL) continue;
+      for (int k = 0;k < xcount;k++)
+      {
+        allavg[k] += boltzmann * energy[k];
+        if (t == 0) natavg[k] += boltzmann * energy[k];
+      }
+    }
+  }
+
+  //loss = log(wtsum+mutsum) - log(wtsum), whose derivative is the NAT-averaged energy minus the all-averaged energy
+  if (grad != NULL)
+  {
+    for (int k = 0;k < xcount;k++)
+    {
+      grad[k] += natavg[k] / wtsum - allavg[k] / (wtsum + mutsum);
     }
-    score -= log(wtsum / (wtsum + mutsum));
+  }
+  return -log(wtsum / (wtsum + mutsum));
+}
+
+
+int PNATROT_LossFunction(EnergyTermsRot* pTerms, double* x, int xcount, double* loss)
+{
+  double score = 0;
+#pragma omp parallel for schedule(dynamic, 16) num_threads(NTHREADS) reduction(+:score)
+  for (int i = 0; i < pTerms->posCount; i++)
+  {
+    score += PNATROT_PositionLoss(&pTerms->terms[i], x, xcount, NULL);
   }
   *loss = score;
   return Success;
 }
 
 
+//loss and analytic gradient in one pass over the positions; each thread accumulates its own gradient
+int PNATROT_LossAndGradient(EnergyTermsRot* pTerms, double* x, int xcount, double* loss, double* grad)
+{
+  double score = 0;
+  memset(grad, 0, sizeof(double) * xcount);
+#pragma omp parallel num_threads(NTHREADS) reduction(+:score)
+  {
+    double gradLocal[NUM_ENERGY_TERM];
+    memset(gradLocal, 0, sizeof(double) * xcount);
+#pragma omp for schedule(dynamic, 16)
+    for (int i = 0; i < pTerms->posCount; i++)
+    {
+      score += PNATROT_PositionLoss(&pTerms->terms[i], x, xcount, gradLocal);
+    }
+#pragma omp critical (WeightOptGradient)
+    for (int k = 0;k < xcount;k++)
+    {
+      grad[k] += gradLocal[k];
+    }
+  }
+  *loss = score;
+  GradientMaskByFlag(grad, xcount);
+  return Success;
+}
 
 
 int PNATROT_BacktrackLineSearch(EnergyTermsRot* pTerms, double lossk, double* xk, double* gradk, double scalar, int xcnt)
@@ -283,6 +469,12 @@ int PNATROT_BacktrackLineSearch(EnergyTermsRot* pTerms, double lossk, double* xk
     if (losskn >= lossk)
     {
       ak *= 0.1;
+      if (ak < 1e-12)
+      {
+        //no step along this direction lowers the loss; keep xk
+        free(xkn);
+        return ValueError;
+      }
     }
     else break;
   } while (TRUE);
@@ -447,20 +639,80 @@ int PNATROT_WeightOptByGradientDescent(char* pdblistfile)
   int count = 1;
   double gradnorm = 0;
   double loss = 0;
-  PNATROT_LossFunction(&terms, x, xcount, &loss);
+  PNATROT_LossAndGradient(&terms, x, xcount, &loss, grad);
   while (count <= MAX_STEP)
   {
     printf("step %d:\n", count);
     printf("wgt:");
     Xshow(x, xcount);
     double lossold = loss;
-    PNATROT_CalcGradientForward(&terms, loss, x, grad, xcount);
     gradnorm = GradientNorm(grad, xcount);
     printf("gradnorm: %12.6f, loss: %12.6f\n", gradnorm, loss);
     //GradientUnit(grad);
     if (gradnorm < 1e-3) break;
     PNATROT_BacktrackLineSearch(&terms, loss, x, grad, 10.0 / gradnorm, xcount);
-    PNATROT_LossFunction(&terms, x, xcount, &loss);
+    PNATROT_LossAndGradient(&terms, x, xcount, &loss, grad);
+    if (fabs(loss - lossold) < EPSILON) break;
+    count++;
+  };
+  printf("final weights:\n");
+  printf("wgt:");
+  Xshow(x, xcount);
+
+  return Success;
+}
+
+
+int PNATROT_WeightOptByLBFGS(char* pdblistfile)
+{
+  EnergyTermsRot terms;
+  EnergyTermsRotCreate(&terms);
+  EnergyTermsRotRead(&terms, pdblistfile);
+
+  int xcount = NUM_ENERGY_TERM;
+  double x[NUM_ENERGY_TERM];
+  double grad[NUM_ENERGY_TERM];
+  double xold[NUM_ENERGY_TERM];
+  double gradold[NUM_ENERGY_TERM];
+  double dir[NUM_ENERGY_TERM];
+  for (int i = 0;i < NUM_ENERGY_TERM;i++) x[i] = 1;
+
+  LBFGSMemory memory;
+  LBFGSMemoryCreate(&memory, xcount);
+  int count = 1;
+  double gradnorm = 0;
+  double loss = 0;
+  PNATROT_LossAndGradient(&terms, x, xcount, &loss, grad);
+  while (count <= MAX_STEP)
+  {
+    printf("step %d:\n", count);
+    printf("wgt:");
+    Xshow(x, xcount);
+    double lossold = loss;
+    gradnorm = GradientNorm(grad, xcount);
+    printf("gradnorm: %12.6f, loss: %12.6f\n", gradnorm, loss);
+    if (gradnorm < 1e-3) break;
+    LBFGSMemoryDirection(&memory, grad, dir);
+    double slope = 0;
+    for (int k = 0;k < xcount;k++) slope += dir[k] * grad[k];
+    if (slope <= 0)
+    {
+      LBFGSMemoryReset(&memory);
+      memcpy(dir, grad, sizeof(double) * xcount);
+    }
+    //without curvature pairs the direction is the gradient itself, scaled as in gradient descent
+    double scalar = memory.count == 0 ? 10.0 / gradnorm : 1.0;
+    memcpy(xold, x, sizeof(double) * xcount);
+    memcpy(gradold, grad, sizeof(double) * xcount);
+    if (FAILED(PNATROT_BacktrackLineSearch(&terms, loss, x, dir, scalar, xcount)))
+    {
+      if (memory.count == 0) break;
+      LBFGSMemoryReset(&memory);
+      count++;
+      continue;
+    }
+    PNATROT_LossAndGradient(&terms, x, xcount, &loss, grad);
+    LBFGSMemoryUpdate(&memory, xold, x, gradold, grad);
     if (fabs(loss - lossold) < EPSILON) break;
     count++;
   };
@@ -468,6 +720,8 @@ int PNATROT_WeightOptByGradientDescent(char* pdblistfile)
   printf("wgt:");
   Xshow(x, xcount);
 
+  LBFGSMemoryDestroy(&memory);
+  EnergyTermsRotDestroy(&terms);
   return Success;
 }
 
@@ -624,50 +878,83 @@ int EnergyTermsAARead(EnergyTermsAA* pTerms, char* pdblist)
 }
 
 
-int PNATAA_LossFunction(EnergyTermsAA* pTerms, double* x, int xcount, double* loss)
-{
 #ifdef PNATAA_USING_ROSETTA_LOSS_FUNCTION
-  printf("optimize weights using the rosetta-like loss function\n");
-  long double lossscore = 0;
-  for (int i = 0; i < pTerms->posCount; i++)
+//loss of one position; if grad is not NULL, the analytic gradient of the loss is added to it.
+//the best scores are piecewise linear in the weights, so the gradient follows the best rotamers
+double PNATAA_PositionLoss(EnergyTermAA* pTermAll, double* x, int xcount, double* grad)
+{
+  double natbest = 100;
+  double* natEnergy = NULL;
+  for (int t = TYPE_TWENTYTWO - 2; t < TYPE_TWENTYTWO; t++)
   {
-    EnergyTermAA* pTermAll = &pTerms->terms[i];
-    double natbest = 100;
-    for (int j = 0; j < pTermAll->rotCount[TYPE_TWENTYTWO - 2]; j++)
+    for (int j = 0; j < pTermAll->rotCount[t]; j++)
     {
       double natscore = 0;
       for (int k = 0;k < xcount;k++)
       {
-        natscore += pTermAll->energy[TYPE_TWENTYTWO - 2][j][k] * x[k];
+        natscore += pTermAll->energy[t][j][k] * x[k];
+      }
+      if (natscore < natbest)
+      {
+        natbest = natscore;
+        natEnergy = pTermAll->energy[t][j];
       }
-      if (natscore < natbest) natbest = natscore;
     }
-    for (int j = 0; j < pTermAll->rotCount[TYPE_TWENTYTWO - 1]; j++)
+  }
+  long double partition = 0;
+  double boltzmann[TYPE_TWENTYTWO - 2];
+  double* rotEnergy[TYPE_TWENTYTWO - 2];
+  for (int s = 0;s < TYPE_TWENTYTWO - 2;s++)
+  {
+    boltzmann[s] = 0;
+    rotEnergy[s] = NULL;
+    if (pTermAll->rotCount[s] <= 0) continue;
+    double rotbest = 100;
+    for (int j = 0; j < pTermAll->rotCount[s]; j++)
     {
-      double score = 0;
+      double rotscore = 0;
       for (int k = 0;k < xcount;k++)
       {
-        score += pTermAll->energy[TYPE_TWENTYTWO - 1][j][k] * x[k];
+        rotscore += pTermAll->energy[s][j][k] * x[k];
+      }
+      if (rotscore < rotbest)
+      {
+        rotbest = rotscore;
+        rotEnergy[s] = pTermAll->energy[s][j];
       }
-      if (score < natbest) natbest = score;
     }
-    long double partition = 0;
+    boltzmann[s] = exp(natbest - rotbest);
+    partition += boltzmann[s];
+  }
+
+  if (grad != NULL)
+  {
     for (int s = 0;s < TYPE_TWENTYTWO - 2;s++)
     {
-      if (pTermAll->rotCount[s] <= 0) continue;
-      double rotbest = 100;
-      for (int j = 0; j < pTermAll->rotCount[s]; j++)
+      if (boltzmann[s] == 0) continue;
+      double weight = boltzmann[s] / (1 + partition);
+      for (int k = 0;k < xcount;k++)
       {
-        double rotscore = 0;
-        for (int k = 0;k < xcount;k++)
-        {
-          rotscore += pTermAll->energy[s][j][k] * x[k];
-        }
-        if (rotscore < rotbest) rotbest = rotscore;
+        double natTerm = natEnergy != NULL ? natEnergy[k] : 0;
+        double rotTerm = rotEnergy[s] != NULL ? rotEnergy[s][k] : 0;
+        grad[k] += weight * (natTerm - rotTerm);
       }
-      partition += exp(natbest - rotbest);
     }
-    lossscore += log(1 + partition);
+  }
+  return log(1 + partition);
+}
+#endif
+
+
+int PNATAA_LossFunction(EnergyTermsAA* pTerms, double* x, int xcount, double* loss)
+{
+#ifdef PNATAA_USING_ROSETTA_LOSS_FUNCTION
+  printf("optimize weights using the rosetta-like loss function\n");
+  long double lossscore = 0;
+#pragma omp parallel for schedule(dynamic, 16) num_threads(NTHREADS) reduction(+:lossscore)
+  for (int i = 0; i < pTerms->posCount; i++)
+  {
+    lossscore += PNATAA_PositionLoss(&pTerms->terms[i], x, xcount, NULL);
   }
   *loss = lossscore;
 #endif
@@ -805,6 +1092,38 @@ int PNATAA_LossFunction(EnergyTermsAA* pTerms, double* x, int xcount, double* lo
   return Success;
 }
 
+//loss and gradient in one pass over the positions; each thread accumulates its own gradient.
+//only the rosetta-like loss has an analytic gradient, the others fall back to finite differences
+int PNATAA_LossAndGradient(EnergyTermsAA* pTerms, double* x, int xcount, double* loss, double* grad)
+{
+#ifdef PNATAA_USING_ROSETTA_LOSS_FUNCTION
+  long double lossscore = 0;
+  memset(grad, 0, sizeof(double) * xcount);
+#pragma omp parallel num_threads(NTHREADS) reduction(+:lossscore)
+  {
+    double gradLocal[NUM_ENERGY_TERM];
+    memset(gradLocal, 0, sizeof(double) * xcount);
+#pragma omp for schedule(dynamic, 16)
+    for (int i = 0; i < pTerms->posCount; i++)
+    {
+      lossscore += PNATAA_PositionLoss(&pTerms->terms[i], x, xcount, gradLocal);
+    }
+#pragma omp critical (WeightOptGradient)
+    for (int k = 0;k < xcount;k++)
+    {
+      grad[k] += gradLocal[k];
+    }
+  }
+  *loss = lossscore;
+  GradientMaskByFlag(grad, xcount);
+#else
+  PNATAA_LossFunction(pTerms, x, xcount, loss);
+  PNATAA_CalcGradientForward(pTerms, *loss, x, grad, xcount);
+#endif
+  return Success;
+}
+
+
 int PNATAA_BacktrackLineSearch(EnergyTermsAA* pTerms, double lossk, double* xk, double* gradk, double scalar, int xcnt)
 {
   double ak = 1.0;
@@ -820,6 +1139,12 @@ int PNATAA_BacktrackLineSearch(EnergyTermsAA* pTerms, double lossk, double* xk,
     if (losskn >= lossk)
     {
       ak *= 0.1;
+      if (ak < 1e-12)
+      {
+        //no step along this direction lowers the loss; keep xk
+        free(xkn);
+        return ValueError;
+      }
     }
     else break;
   } while (TRUE);
@@ -873,22 +1198,9 @@ int PNATAA_CalcGradientForward(EnergyTermsAA* pTerms, double loss, double* x, do
 }
 
 
-int PNATAA_WeightOptByGradientDescent(char* pdblist)
+//map the energy weights read from file onto the optimized weights
+int PNATAA_WeightsFromEnergyWeights(double* x)
 {
-  srand((unsigned int)time(NULL));
-  EnergyTermsAA terms;
-  EnergyTermsAACreate(&terms);
-  EnergyTermsAARead(&terms, pdblist);
-
-  int xcount = NUM_ENERGY_TERM;
-  double x[NUM_ENERGY_TERM];
-  double grad[NUM_ENERGY_TERM];
-  //the 20 reference energies are initialized to be zero
-  //for(int i=0;i<20;i++) x[i]=0;
-  //for(int i=20;i<NUM_ENERGY_TERM;i++) x[i]=(double)rand()/RAND_MAX;
-  //for(int i=0;i<20;i++) x[i]=0;
-  //for(int i=20;i<NUM_ENERGY_TERM;i++) x[i]=1;
-  //set initial values from weights read from file
   x[0] = WEIGHTS[1];
   x[1] = WEIGHTS[2];
   x[2] = WEIGHTS[3];
@@ -966,23 +1278,106 @@ int PNATAA_WeightOptByGradientDescent(char* pdblist)
   x[70] = WEIGHTS[88];
   x[71] = WEIGHTS[89];
 
+  return Success;
+}
+
+
+int PNATAA_WeightOptByGradientDescent(char* pdblist)
+{
+  srand((unsigned int)time(NULL));
+  EnergyTermsAA terms;
+  EnergyTermsAACreate(&terms);
+  EnergyTermsAARead(&terms, pdblist);
+
+  int xcount = NUM_ENERGY_TERM;
+  double x[NUM_ENERGY_TERM];
+  double grad[NUM_ENERGY_TERM];
+  //the 20 reference energies are initialized to be zero
+  //for(int i=0;i<20;i++) x[i]=0;
+  //for(int i=20;i<NUM_ENERGY_TERM;i++) x[i]=(double)rand()/RAND_MAX;
+  //for(int i=0;i<20;i++) x[i]=0;
+  //for(int i=20;i<NUM_ENERGY_TERM;i++) x[i]=1;
+  //set initial values from weights read from file
+  PNATAA_WeightsFromEnergyWeights(x);
+
   int count = 1;
   double gradnorm = 0;
   double loss = 0;
-  PNATAA_LossFunction(&terms, x, xcount, &loss);
+  PNATAA_LossAndGradient(&terms, x, xcount, &loss, grad);
   while (count <= MAX_STEP)
   {
     printf("Step %d:\n", count);
     printf("Wgt:");
     Xshow(x, xcount);
     double lossold = loss;
-    PNATAA_CalcGradientForward(&terms, loss, x, grad, xcount);
     gradnorm = GradientNorm(grad, xcount);
     printf("GradNorm: %12.6f, Loss: %12.6f\n", gradnorm, loss);
     //GradientUnit(grad);
     if (gradnorm < 1e-3) break;
     PNATAA_BacktrackLineSearch(&terms, loss, x, grad, 10.0 / gradnorm, xcount);
-    PNATAA_LossFunction(&terms, x, xcount, &loss);
+    PNATAA_LossAndGradient(&terms, x, xcount, &loss, grad);
+    if (fabs(loss - lossold) < EPSILON) break;
+    count++;
+  };
+  printf("Final weights:\n");
+  printf("Wgt:");
+  Xshow(x, xcount);
+
+  EnergyTermsAADestroy(&terms);
+  return Success;
+}
+
+
+int PNATAA_WeightOptByLBFGS(char* pdblist)
+{
+  EnergyTermsAA terms;
+  EnergyTermsAACreate(&terms);
+  EnergyTermsAARead(&terms, pdblist);
+
+  int xcount = NUM_ENERGY_TERM;
+  double x[NUM_ENERGY_TERM];
+  double grad[NUM_ENERGY_TERM];
+  double xold[NUM_ENERGY_TERM];
+  double gradold[NUM_ENERGY_TERM];
+  double dir[NUM_ENERGY_TERM];
+  PNATAA_WeightsFromEnergyWeights(x);
+
+  LBFGSMemory memory;
+  LBFGSMemoryCreate(&memory, xcount);
+  int count = 1;
+  double gradnorm = 0;
+  double loss = 0;
+  PNATAA_LossAndGradient(&terms, x, xcount, &loss, grad);
+  while (count <= MAX_STEP)
+  {
+    printf("Step %d:\n", count);
+    printf("Wgt:");
+    Xshow(x, xcount);
+    double lossold = loss;
+    gradnorm = GradientNorm(grad, xcount);
+    printf("GradNorm: %12.6f, Loss: %12.6f\n", gradnorm, loss);
+    if (gradnorm < 1e-3) break;
+    LBFGSMemoryDirection(&memory, grad, dir);
+    double slope = 0;
+    for (int k = 0;k < xcount;k++) slope += dir[k] * grad[k];
+    if (slope <= 0)
+    {
+      LBFGSMemoryReset(&memory);
+      memcpy(dir, grad, sizeof(double) * xcount);
+    }
+    //without curvature pairs the direction is the gradient itself, scaled as in gradient descent
+    double scalar = memory.count == 0 ? 10.0 / gradnorm : 1.0;
+    memcpy(xold, x, sizeof(double) * xcount);
+    memcpy(gradold, grad, sizeof(double) * xcount);
+    if (FAILED(PNATAA_BacktrackLineSearch(&terms, loss, x, dir, scalar, xcount)))
+    {
+      if (memory.count == 0) break;
+      LBFGSMemoryReset(&memory);
+      count++;
+      continue;
+    }
+    PNATAA_LossAndGradient(&terms, x, xcount, &loss, grad);
+    LBFGSMemoryUpdate(&memory, xold, x, gradold, grad);
     if (fabs(loss - lossold) < EPSILON) break;
     count++;
   };
@@ -990,6 +1385,7 @@ int PNATAA_WeightOptByGradientDescent(char* pdblist)
   printf("Wgt:");
   Xshow(x, xcount);
 
+  LBFGSMemoryDestroy(&memory);
   EnergyTermsAADestroy(&terms);
   return Success;
 }
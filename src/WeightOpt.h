@@ -28,6 +28,7 @@ IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define  WOLFE_C1       1e-4
 #define  WOLFE_C2       0.1
 #define  MAX_STEP       10000
+#define  LBFGS_HISTORY  8
 
 
 int isNumber(double x);
@@ -61,13 +62,34 @@ double GradientNorm(double* grad, int xcount);
 double GradientMax(double* grad, int xcount);
 int Xupdate(double* x, double* grad, int xcount, double alpha);
 int Xshow(double* x, int xcount);
+int GradientMaskByFlag(double* grad, int xcount);
+
+
+typedef struct _LBFGSMemory
+{
+  int xcount;
+  int count;
+  int head;
+  double* s;
+  double* y;
+  double* rho;
+}LBFGSMemory;
+
+int LBFGSMemoryCreate(LBFGSMemory* pThis, int xcount);
+int LBFGSMemoryDestroy(LBFGSMemory* pThis);
+int LBFGSMemoryReset(LBFGSMemory* pThis);
+int LBFGSMemoryUpdate(LBFGSMemory* pThis, double* x0, double* x1, double* grad0, double* grad1);
+int LBFGSMemoryDirection(LBFGSMemory* pThis, double* grad, double* dir);
 
 int PNATROT_BacktrackLineSearch(EnergyTermsRot* pTerms, double lossk, double* xk, double* gradk, double scalar, int xcnt);
+double PNATROT_PositionLoss(EnergyTermRot* pTermRot, double* x, int xcount, double* grad);
 int PNATROT_LossFunction(EnergyTermsRot* pTerms, double* x, int xcount, double* loss);
+int PNATROT_LossAndGradient(EnergyTermsRot* pTerms, double* x, int xcount, double* loss, double* grad);
 int PNATROT_CalcGradientTwoSide(EnergyTermsRot* pTerms, double loss, double* x, double* grad, int xcount);
 int PNATROT_CalcGradientForward(EnergyTermsRot* pTerms, double loss, double* x, double* grad, int xcount);
 int PNATROT_CalcGradientBackword(EnergyTermsRot* pTerms, double loss, double* x, double* grad, int xcount);
 int PNATROT_WeightOptByGradientDescent(char* pdblistfile);
+int PNATROT_WeightOptByLBFGS(char* pdblistfile);
 
 
 #define TYPE_TWENTYTWO 22
@@ -94,8 +116,12 @@ int EnergyTermsAACreate(EnergyTermsAA* pTerms);
 int EnergyTermsAADestroy(EnergyTermsAA* pTerms);
 int EnergyTermsAARead(EnergyTermsAA* pTerms, char* pdblist);
 int PNATAA_BacktrackLineSearch(EnergyTermsAA* pTerms, double lossk, double* xk, double* gradk, double scalar, int xcnt);
+double PNATAA_PositionLoss(EnergyTermAA* pTermAll, double* x, int xcount, double* grad);
 int PNATAA_LossFunction(EnergyTermsAA* pTerms, double* x, int xcount, double* loss);
+int PNATAA_LossAndGradient(EnergyTermsAA* pTerms, double* x, int xcount, double* loss, double* grad);
 int PNATAA_CalcGradientForward(EnergyTermsAA* pTerms, double loss, double* x, double* grad, int xcount);
+int PNATAA_WeightsFromEnergyWeights(double* x);
 int PNATAA_WeightOptByGradientDescent(char* pdblistfile);
+int PNATAA_WeightOptByLBFGS(char* pdblistfile);
 
 #endif
\ No newline at end of file